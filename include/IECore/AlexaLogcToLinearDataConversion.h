@@ -55,6 +55,7 @@ struct AlexaLogcToLinearDataConversion : public DataConversion< F, T >
 	BOOST_STATIC_ASSERT( boost::is_floating_point< T >::value );
 
 	typedef LinearToAlexaLogcDataConversion<T, F> InverseType;
+	typedef boost::true_type IsExpensive;
 
 	/// Perform the conversion
 	T operator()( F f ) const;
@@ -75,6 +75,10 @@ class BlobbyImplicitSurfaceFunction : public ImplicitSurfaceFunction<P, V>
 		/// Evaluate the function at the specified point
 		virtual Value getValue( const Point &p );
 
+		/// Evaluates the function at many points at once. The candidate blobs are gathered once for
+		/// each spatially coherent group of points, rather than once per point.
+		virtual void getValues( const Point *points, size_t numPoints, Value *values );
+
 	protected:
 
 		typedef std::vector< Bound > BoundVector;
@@ -87,6 +91,11 @@ class BlobbyImplicitSurfaceFunction : public ImplicitSurfaceFunction<P, V>
 
 		BoundVector m_bounds;
 		Tree *m_tree;
+
+	private :
+
+		struct Candidates;
+		void getValuesWalk( const Point *points, size_t numPoints, Value *values, Candidates &candidates ) const;
 };
 
 typedef BlobbyImplicitSurfaceFunction<Imath::V3f, float>  BlobbyImplicitSurfaceFunctionV3ff;
@@ -35,6 +35,7 @@
 #include <cassert>
 
 #include "IECore/BoxTraits.h"
+#include "IECore/BoxOps.h"
 
 namespace IECore
 {
@@ -133,4 +134,122 @@ typename BlobbyImplicitSurfaceFunction<P,V>::Value BlobbyImplicitSurfaceFunction
 	return this->operator()(p);
 }
 
+/// The blobs which may influence a group of points, stored as separate arrays
+/// so that the loop accumulating their contributions is free of indirection and
+/// branching, and can be vectorised by the compiler.
+template<typename P, typename V>
+struct BlobbyImplicitSurfaceFunction<P,V>::Candidates
+{
+	std::vector<BoundVectorConstIterator> intersecting;
+
+	std::vector<PointBaseType> x;
+	std::vector<PointBaseType> y;
+	std::vector<PointBaseType> z;
+	std::vector<Value> radiusSquared;
+	/// Coefficients of the falloff polynomial in distance squared,
+	/// premultiplied by the strength.
+	std::vector<Value> c0;
+	std::vector<Value> c1;
+	std::vector<Value> c2;
+	std::vector<Value> c3;
+};
+
+template<typename P, typename V>
+void BlobbyImplicitSurfaceFunction<P,V>::getValues( const Point *points, size_t numPoints, Value *values )
+{
+	Candidates candidates;
+	getValuesWalk( points, numPoints, values, candidates );
+}
+
+template<typename P, typename V>
+void BlobbyImplicitSurfaceFunction<P,V>::getValuesWalk( const Point *points, size_t numPoints, Value *values, Candidates &candidates ) const
+{
+	if( !numPoints )
+	{
+		return;
+	}
+
+	assert( m_tree );
+
+	Bound bound = BoxTraits<Bound>::create( points[0], points[0] );
+	for( size_t i = 1; i < numPoints; ++i )
+	{
+		boxExtend( bound, points[i] );
+	}
+
+	const size_t numCandidates = m_tree->intersectingBounds( bound, candidates.intersecting );
+
+	/// If the points are spread too widely to share their candidates usefully,
+	/// then we split them in two and try again with tighter bounds. Points which
+	/// are adjacent in the array are assumed to be close in space, as they are
+	/// for a grid evaluated in order.
+	if( numCandidates > 64 && numPoints > 64 )
+	{
+		const size_t half = numPoints / 2;
+		getValuesWalk( points, half, values, candidates );
+		getValuesWalk( points + half, numPoints - half, values + half, candidates );
+		return;
+	}
+
+	candidates.x.resize( numCandidates );
+	candidates.y.resize( numCandidates );
+	candidates.z.resize( numCandidates );
+	candidates.radiusSquared.resize( numCandidates );
+	candidates.c0.resize( numCandidates );
+	candidates.c1.resize( numCandidates );
+	candidates.c2.resize( numCandidates );
+	candidates.c3.resize( numCandidates );
+
+	for( size_t c = 0; c < numCandidates; ++c )
+	{
+		const int boundIndex = std::distance<BoundVectorConstIterator>( m_bounds.begin(), candidates.intersecting[c] );
+		assert( boundIndex >= 0 );
+		assert( boundIndex < (int)m_bounds.size() );
+
+		const Point &p = m_p->readable()[boundIndex];
+		candidates.x[c] = vecGet( p, 0 );
+		candidates.y[c] = vecGet( p, 1 );
+		candidates.z[c] = vecGet( p, 2 );
+
+		const Value b = m_radius->readable()[boundIndex];
+		const Value bSqrd = b * b;
+		const double s = m_strength->readable()[boundIndex];
+		candidates.radiusSquared[c] = bSqrd;
+		candidates.c0[c] = s;
+		candidates.c1[c] = s * -22.0 / ( 9.0 * bSqrd );
+		candidates.c2[c] = s * 17.0 / ( 9.0 * bSqrd * bSqrd );
+		candidates.c3[c] = s * -4.0 / ( 9.0 * bSqrd * bSqrd * bSqrd );
+	}
+
+	const PointBaseType *x = numCandidates ? &candidates.x[0] : 0;
+	const PointBaseType *y = numCandidates ? &candidates.y[0] : 0;
+	const PointBaseType *z = numCandidates ? &candidates.z[0] : 0;
+	const Value *radiusSquared = numCandidates ? &candidates.radiusSquared[0] : 0;
+	const Value *c0 = numCandidates ? &candidates.c0[0] : 0;
+	const Value *c1 = numCandidates ? &candidates.c1[0] : 0;
+	const Value *c2 = numCandidates ? &candidates.c2[0] : 0;
+	const Value *c3 = numCandidates ? &candidates.c3[0] : 0;
+
+	for( size_t i = 0; i < numPoints; ++i )
+	{
+		const PointBaseType px = vecGet( points[i], 0 );
+		const PointBaseType py = vecGet( points[i], 1 );
+		const PointBaseType pz = vecGet( points[i], 2 );
+
+		Value totalInfluence = -1.e-6;
+		for( size_t c = 0; c < numCandidates; ++c )
+		{
+			const PointBaseType dx = x[c] - px;
+			const PointBaseType dy = y[c] - py;
+			const PointBaseType dz = z[c] - pz;
+			const PointBaseType distSqrd = dx * dx + dy * dy + dz * dz;
+			const Value d = distSqrd;
+			const Value influence = c0[c] + d * ( c1[c] + d * ( c2[c] + d * c3[c] ) );
+			totalInfluence += distSqrd < radiusSquared[c] ? influence : Value( 0 );
+		}
+
+		values[i] = totalInfluence;
+	}
+}
+
 } // namespace IECore
@@ -75,6 +75,15 @@ class BoundedKDTree
 		/// making queries.
 		void init( BoundIterator first, BoundIterator last, int maxLeafSize=4 );
 
+		/// Recomputes the bounds of all the nodes without changing the structure
+		/// of the tree. This should be called after the bounds passed to init()
+		/// have been modified in place, and is much cheaper than calling init()
+		/// again, although queries may become slower if the bounds move significantly
+		/// relative to one another. The work is performed in parallel.
+		/// \threading This can't be called while other threads are
+		/// making queries.
+		void refit();
+
 		/// Populates the passed vector of iterators with the bounds which intersect "b". Returns the number of bounds found.
 		/// \threading May be called by multiple concurrent threads provided they each use a different vector for the result.
 		/// \todo There should be a form where nearNeighbours is an output iterator, to allow any container to be filled.
@@ -103,10 +112,16 @@ class BoundedKDTree
 		typedef typename Permutation::const_iterator PermutationConstIterator;
 
 		class AxisSort;
+		class BoundTask;
+
+		/// The depth to which subtrees are bounded in parallel by refit().
+		enum { ParallelBoundDepth = 8 };
 
 		unsigned char majorAxis( PermutationConstIterator permFirst, PermutationConstIterator permLast );
 		void build( NodeIndex nodeIndex, PermutationIterator permFirst, PermutationIterator permLast );
-		void bound( NodeIndex nodeIndex );
+		/// Computes the bounds of the specified node and its descendants. Subtrees
+		/// are computed in parallel down to the specified depth below the node.
+		void bound( NodeIndex nodeIndex, unsigned int parallelDepth );
 
 		template<typename S>
 		void intersectingBoundsWalk( NodeIndex nodeIndex, const S &p, std::vector<BoundIterator> &bounds ) const;
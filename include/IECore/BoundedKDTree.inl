@@ -35,6 +35,8 @@
 #include <algorithm>
 #include <cassert>
 
+#include "tbb/parallel_invoke.h"
+
 #include "IECore/VectorTraits.h"
 #include "IECore/VectorOps.h"
 #include "IECore/BoxOps.h"
@@ -169,13 +171,36 @@ unsigned char BoundedKDTree<BoundIterator>::majorAxis( PermutationConstIterator
 }
 
 template<class BoundIterator>
-void BoundedKDTree<BoundIterator>::bound( NodeIndex nodeIndex  )
+class BoundedKDTree<BoundIterator>::BoundTask
+{
+	public :
+
+		BoundTask( BoundedKDTree *tree, NodeIndex nodeIndex, unsigned int parallelDepth )
+			:	m_tree( tree ), m_nodeIndex( nodeIndex ), m_parallelDepth( parallelDepth )
+		{
+		}
+
+		void operator()() const
+		{
+			m_tree->bound( m_nodeIndex, m_parallelDepth );
+		}
+
+	private :
+
+		BoundedKDTree *m_tree;
+		NodeIndex m_nodeIndex;
+		unsigned int m_parallelDepth;
+
+};
+
+template<class BoundIterator>
+void BoundedKDTree<BoundIterator>::bound( NodeIndex nodeIndex, unsigned int parallelDepth )
 {
 	assert( nodeIndex < m_nodes.size() );
 
 	Node &node = m_nodes[nodeIndex];
 
-	assert( BoxTraits<Bound>::isEmpty( node.bound() ) );
+	BoxTraits<Bound>::makeEmpty( node.bound() );
 
 	if( node.isLeaf() )
 	{
@@ -192,8 +217,18 @@ void BoundedKDTree<BoundIterator>::bound( NodeIndex nodeIndex  )
 		assert( lowChildIndex( nodeIndex ) < m_nodes.size() );
 		assert( highChildIndex( nodeIndex ) < m_nodes.size() );
 
-		bound( lowChildIndex( nodeIndex ) );
-		bound( highChildIndex( nodeIndex ) );
+		if( parallelDepth )
+		{
+			tbb::parallel_invoke(
+				BoundTask( this, lowChildIndex( nodeIndex ), parallelDepth - 1 ),
+				BoundTask( this, highChildIndex( nodeIndex ), parallelDepth - 1 )
+			);
+		}
+		else
+		{
+			bound( lowChildIndex( nodeIndex ), 0 );
+			bound( highChildIndex( nodeIndex ), 0 );
+		}
 		boxExtend( node.bound(), m_nodes[lowChildIndex( nodeIndex )].bound() );
 		boxExtend( node.bound(), m_nodes[highChildIndex( nodeIndex )].bound() );
 	}
@@ -258,7 +293,18 @@ void BoundedKDTree<BoundIterator>::init( BoundIterator first, BoundIterator last
 
 	/// \todo Can we reserve() enough space for m_nodes before doing this?
 	build( rootIndex(), m_perm.begin(), m_perm.end() );
-	bound( rootIndex() );
+	// bounding is done serially, as trees are often built lazily by
+	// clients holding a lock.
+	bound( rootIndex(), 0 );
+}
+
+template<class BoundIterator>
+void BoundedKDTree<BoundIterator>::refit()
+{
+	if( m_nodes.size() )
+	{
+		bound( rootIndex(), ParallelBoundDepth );
+	}
 }
 
 template<class BoundIterator>
@@ -0,0 +1,202 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef IE_CORE_BOUNDINGVOLUMEHIERARCHY_H
+#define IE_CORE_BOUNDINGVOLUMEHIERARCHY_H
+
+#include <vector>
+#include <cassert>
+
+#include "OpenEXR/ImathBox.h"
+
+#include "tbb/atomic.h"
+
+#include "IECore/BoxTraits.h"
+#include "IECore/VectorTraits.h"
+
+namespace IECore
+{
+
+/// A bounding volume hierarchy permitting fast intersection/overlap tests
+/// against a set of bounded volumes. It provides the same interface as
+/// BoundedKDTree, so that algorithms walking the nodes may be written to use
+/// either. Unlike the BoundedKDTree, each split is chosen using the surface
+/// area heuristic evaluated over a fixed number of bins, the nodes are stored
+/// contiguously with siblings adjacent to one another, and the tree is built
+/// in parallel.
+/// \ingroup mathGroup
+template<class BoundIterator>
+class BoundingVolumeHierarchy
+{
+	public:
+
+		typedef BoundIterator Iterator;
+		typedef typename std::iterator_traits<BoundIterator>::value_type Bound;
+		typedef typename BoxTraits<Bound>::BaseType BaseType;
+		class Node;
+		typedef std::vector<Node> NodeVector;
+		typedef typename NodeVector::size_type NodeIndex;
+
+		/// Constructs an uninitialised tree - you must call init() before
+		/// using it.
+		BoundingVolumeHierarchy();
+
+		/// Creates a hierarchy for the fast searching of bounds.
+		/// Note that the hierarchy does not own the passed bounds -
+		/// it is up to you to ensure that they remain valid and
+		/// unchanged as long as the BoundingVolumeHierarchy is in use.
+		BoundingVolumeHierarchy( BoundIterator first, BoundIterator last, int maxLeafSize=4 );
+
+		/// Builds the hierarchy for the specified bounds - the iterator range
+		/// must remain valid and unchanged as long as the hierarchy is in use.
+		/// This method can be called again to rebuild the hierarchy at any time.
+		/// \threading This can't be called while other threads are
+		/// making queries.
+		void init( BoundIterator first, BoundIterator last, int maxLeafSize=4 );
+
+		/// Recomputes the bounds of all the nodes without changing the structure
+		/// of the hierarchy. This should be called after the bounds passed to init()
+		/// have been modified in place, and is much cheaper than calling init()
+		/// again, although queries may become slower if the bounds move significantly
+		/// relative to one another. The work is performed in parallel.
+		/// \threading This can't be called while other threads are
+		/// making queries.
+		void refit();
+
+		/// Populates the passed vector of iterators with the bounds which intersect "b". Returns the number of bounds found.
+		/// \threading May be called by multiple concurrent threads provided they each use a different vector for the result.
+		template<typename S>
+		unsigned int intersectingBounds( const S &b, std::vector<BoundIterator> &bounds ) const;
+
+		/// Returns the number of nodes in the hierarchy.
+		inline NodeIndex numNodes() const;
+
+		/// Retrieve the node associated with a given index
+		inline const Node& node( NodeIndex idx ) const;
+
+		/// Returns the index for the root node
+		inline NodeIndex rootIndex() const;
+
+		/// Retrieve the index of the "low" child node. Note that unlike
+		/// BoundedKDTree this is not a static method, as the children
+		/// are not stored at implicit locations.
+		inline NodeIndex lowChildIndex( NodeIndex index ) const;
+
+		/// Retrieve the index of the "high" child node
+		inline NodeIndex highChildIndex( NodeIndex index ) const;
+
+	private:
+
+		typedef std::vector<BoundIterator> Permutation;
+		typedef typename Permutation::iterator PermutationIterator;
+		typedef typename VectorTraits<BaseType>::BaseType Real;
+
+		enum
+		{
+			/// The number of bins used to evaluate candidate splits along each axis.
+			NumBins = 16,
+			/// Nodes containing more than this number of bounds are binned and
+			/// have their children built in parallel.
+			ParallelThreshold = 4096,
+			/// The depth to which subtrees are refitted in parallel.
+			ParallelRefitDepth = 8
+		};
+
+		struct Bin;
+		class Bins;
+		class SplitPredicate;
+		class BuildTask;
+		class RefitTask;
+
+		static Real halfArea( const Bound &b );
+
+		void build( NodeIndex nodeIndex, PermutationIterator permFirst, PermutationIterator permLast, const Bound &centroidBound );
+		void makeLeaf( NodeIndex nodeIndex, PermutationIterator permFirst, PermutationIterator permLast );
+		/// Recomputes the bounds of the specified node and its descendants. Subtrees
+		/// are refitted in parallel down to the specified depth below the node.
+		void refit( NodeIndex nodeIndex, unsigned int parallelDepth );
+
+		template<typename S>
+		void intersectingBoundsWalk( NodeIndex nodeIndex, const S &b, std::vector<BoundIterator> &bounds ) const;
+
+		Permutation m_perm;
+		NodeVector m_nodes;
+		int m_maxLeafSize;
+		tbb::atomic<NodeIndex> m_numNodes;
+
+};
+
+template<class BoundIterator>
+class BoundingVolumeHierarchy<BoundIterator>::Node
+{
+	public :
+
+		/// Must be default constructible for use as element within std::vector
+		Node();
+
+		inline bool isLeaf() const;
+
+		inline BoundIterator *permFirst() const;
+
+		inline BoundIterator *permLast() const;
+
+		inline bool isBranch() const;
+
+		inline const Bound &bound() const;
+
+	private :
+
+		friend class BoundingVolumeHierarchy<BoundIterator>;
+
+		Bound m_bound;
+
+		/// The index of the low child, with the high child immediately following it.
+		/// As the root can never be a child, this is 0 for leaf nodes.
+		NodeIndex m_firstChild;
+
+		BoundIterator *m_permFirst;
+		BoundIterator *m_permLast;
+
+};
+
+typedef BoundingVolumeHierarchy<std::vector<Imath::Box2f>::const_iterator> Box2fBVH;
+typedef BoundingVolumeHierarchy<std::vector<Imath::Box2d>::const_iterator> Box2dBVH;
+typedef BoundingVolumeHierarchy<std::vector<Imath::Box3f>::const_iterator> Box3fBVH;
+typedef BoundingVolumeHierarchy<std::vector<Imath::Box3d>::const_iterator> Box3dBVH;
+
+}
+
+#include "BoundingVolumeHierarchy.inl"
+
+#endif // IE_CORE_BOUNDINGVOLUMEHIERARCHY_H
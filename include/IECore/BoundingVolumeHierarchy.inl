@@ -0,0 +1,575 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cassert>
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_reduce.h"
+#include "tbb/parallel_invoke.h"
+
+#include "IECore/VectorOps.h"
+#include "IECore/BoxOps.h"
+
+namespace IECore
+{
+
+//////////////////////////////////////////////////////////////////////////
+// Build helpers
+//////////////////////////////////////////////////////////////////////////
+
+template<class BoundIterator>
+struct BoundingVolumeHierarchy<BoundIterator>::Bin
+{
+	Bin()
+		:	count( 0 )
+	{
+		BoxTraits<Bound>::makeEmpty( bound );
+		BoxTraits<Bound>::makeEmpty( centroidBound );
+	}
+
+	void extend( const Bin &other )
+	{
+		boxExtend( bound, other.bound );
+		boxExtend( centroidBound, other.centroidBound );
+		count += other.count;
+	}
+
+	Bound bound;
+	Bound centroidBound;
+	size_t count;
+};
+
+/// Accumulates bounds into bins along each axis, according to where their centers
+/// lie within the bound of all the centers. Used as the body for tbb::parallel_reduce.
+template<class BoundIterator>
+class BoundingVolumeHierarchy<BoundIterator>::Bins
+{
+
+	public :
+
+		Bins( const Bound &centroidBound )
+			:	m_centroidBound( centroidBound )
+		{
+			const BaseType size = boxSize( centroidBound );
+			for( unsigned axis = 0; axis < VectorTraits<BaseType>::dimensions(); axis++ )
+			{
+				const Real s = VectorTraits<BaseType>::get( size, axis );
+				m_scale[axis] = s > Real( 0 ) ? Real( NumBins ) / s : Real( 0 );
+			}
+		}
+
+		Bins( Bins &other, tbb::split )
+			:	m_centroidBound( other.m_centroidBound )
+		{
+			std::copy( other.m_scale, other.m_scale + 3, m_scale );
+		}
+
+		void operator()( const tbb::blocked_range<PermutationIterator> &range )
+		{
+			for( PermutationIterator it = range.begin(); it != range.end(); ++it )
+			{
+				const Bound &b = **it;
+				const BaseType center = boxCenter( b );
+				for( unsigned axis = 0; axis < VectorTraits<BaseType>::dimensions(); axis++ )
+				{
+					Bin &bin = m_bins[axis][binIndex( center, axis )];
+					boxExtend( bin.bound, b );
+					boxExtend( bin.centroidBound, center );
+					bin.count++;
+				}
+			}
+		}
+
+		void join( const Bins &other )
+		{
+			for( unsigned axis = 0; axis < VectorTraits<BaseType>::dimensions(); axis++ )
+			{
+				for( int i = 0; i < NumBins; i++ )
+				{
+					m_bins[axis][i].extend( other.m_bins[axis][i] );
+				}
+			}
+		}
+
+		int binIndex( const BaseType &center, unsigned axis ) const
+		{
+			const Real offset = VectorTraits<BaseType>::get( center, axis ) - VectorTraits<BaseType>::get( BoxTraits<Bound>::min( m_centroidBound ), axis );
+			const int i = static_cast<int>( offset * m_scale[axis] );
+			return std::max( 0, std::min( i, NumBins - 1 ) );
+		}
+
+		Bin m_bins[3][NumBins];
+
+	private :
+
+		Bound m_centroidBound;
+		Real m_scale[3];
+
+};
+
+template<class BoundIterator>
+class BoundingVolumeHierarchy<BoundIterator>::SplitPredicate
+{
+
+	public :
+
+		SplitPredicate( const Bins &bins, unsigned axis, int lastLowBin )
+			:	m_bins( bins ), m_axis( axis ), m_lastLowBin( lastLowBin )
+		{
+		}
+
+		bool operator()( BoundIterator it ) const
+		{
+			return m_bins.binIndex( boxCenter( *it ), m_axis ) <= m_lastLowBin;
+		}
+
+	private :
+
+		const Bins &m_bins;
+		unsigned m_axis;
+		int m_lastLowBin;
+
+};
+
+template<class BoundIterator>
+class BoundingVolumeHierarchy<BoundIterator>::BuildTask
+{
+
+	public :
+
+		BuildTask( BoundingVolumeHierarchy *bvh, NodeIndex nodeIndex, PermutationIterator permFirst, PermutationIterator permLast, const Bound &centroidBound )
+			:	m_bvh( bvh ), m_nodeIndex( nodeIndex ), m_permFirst( permFirst ), m_permLast( permLast ), m_centroidBound( centroidBound )
+		{
+		}
+
+		void operator()() const
+		{
+			m_bvh->build( m_nodeIndex, m_permFirst, m_permLast, m_centroidBound );
+		}
+
+	private :
+
+		BoundingVolumeHierarchy *m_bvh;
+		NodeIndex m_nodeIndex;
+		PermutationIterator m_permFirst;
+		PermutationIterator m_permLast;
+		Bound m_centroidBound;
+
+};
+
+template<class BoundIterator>
+class BoundingVolumeHierarchy<BoundIterator>::RefitTask
+{
+
+	public :
+
+		RefitTask( BoundingVolumeHierarchy *bvh, NodeIndex nodeIndex, unsigned int parallelDepth )
+			:	m_bvh( bvh ), m_nodeIndex( nodeIndex ), m_parallelDepth( parallelDepth )
+		{
+		}
+
+		void operator()() const
+		{
+			m_bvh->refit( m_nodeIndex, m_parallelDepth );
+		}
+
+	private :
+
+		BoundingVolumeHierarchy *m_bvh;
+		NodeIndex m_nodeIndex;
+		unsigned int m_parallelDepth;
+
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Node
+//////////////////////////////////////////////////////////////////////////
+
+template<class BoundIterator>
+BoundingVolumeHierarchy<BoundIterator>::Node::Node()
+	:	m_firstChild( 0 ), m_permFirst( 0 ), m_permLast( 0 )
+{
+	BoxTraits<Bound>::makeEmpty( m_bound );
+}
+
+template<class BoundIterator>
+bool BoundingVolumeHierarchy<BoundIterator>::Node::isLeaf() const
+{
+	return m_firstChild == 0;
+}
+
+template<class BoundIterator>
+BoundIterator *BoundingVolumeHierarchy<BoundIterator>::Node::permFirst() const
+{
+	assert( isLeaf() );
+
+	return m_permFirst;
+}
+
+template<class BoundIterator>
+BoundIterator *BoundingVolumeHierarchy<BoundIterator>::Node::permLast() const
+{
+	assert( isLeaf() );
+
+	return m_permLast;
+}
+
+template<class BoundIterator>
+bool BoundingVolumeHierarchy<BoundIterator>::Node::isBranch() const
+{
+	return m_firstChild != 0;
+}
+
+template<class BoundIterator>
+const typename BoundingVolumeHierarchy<BoundIterator>::Bound &BoundingVolumeHierarchy<BoundIterator>::Node::bound() const
+{
+	return m_bound;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BoundingVolumeHierarchy
+//////////////////////////////////////////////////////////////////////////
+
+template<class BoundIterator>
+BoundingVolumeHierarchy<BoundIterator>::BoundingVolumeHierarchy()
+	:	m_maxLeafSize( 4 )
+{
+	m_numNodes = 0;
+}
+
+template<class BoundIterator>
+BoundingVolumeHierarchy<BoundIterator>::BoundingVolumeHierarchy( BoundIterator first, BoundIterator last, int maxLeafSize )
+{
+	init( first, last, maxLeafSize );
+}
+
+template<class BoundIterator>
+void BoundingVolumeHierarchy<BoundIterator>::init( BoundIterator first, BoundIterator last, int maxLeafSize )
+{
+	m_maxLeafSize = std::max( maxLeafSize, 1 );
+
+	m_perm.resize( last - first );
+	unsigned int i=0;
+	for( BoundIterator it=first; it!=last; it++ )
+	{
+		m_perm[i++] = it;
+	}
+
+	// a binary tree with at least one bound in each leaf can't have more than
+	// 2n-1 nodes, so we allocate that many up front and can then fill them from
+	// many threads without reallocating.
+	m_nodes.clear();
+	m_nodes.resize( std::max<size_t>( 2 * m_perm.size(), 2 ) - 1 );
+	m_numNodes = 1;
+
+	// binning with an empty centroid bound puts everything in the first bin,
+	// giving us the bound of the root and of all the centers.
+	Bound emptyBound;
+	BoxTraits<Bound>::makeEmpty( emptyBound );
+	Bins rootBins( emptyBound );
+	tbb::parallel_reduce( tbb::blocked_range<PermutationIterator>( m_perm.begin(), m_perm.end(), ParallelThreshold ), rootBins );
+
+	m_nodes[rootIndex()].m_bound = rootBins.m_bins[0][0].bound;
+	build( rootIndex(), m_perm.begin(), m_perm.end(), rootBins.m_bins[0][0].centroidBound );
+
+	NodeVector( m_nodes.begin(), m_nodes.begin() + m_numNodes ).swap( m_nodes );
+}
+
+template<class BoundIterator>
+void BoundingVolumeHierarchy<BoundIterator>::refit()
+{
+	if( m_nodes.size() )
+	{
+		refit( rootIndex(), ParallelRefitDepth );
+	}
+}
+
+template<class BoundIterator>
+void BoundingVolumeHierarchy<BoundIterator>::refit( NodeIndex nodeIndex, unsigned int parallelDepth )
+{
+	assert( nodeIndex < m_nodes.size() );
+
+	Node &node = m_nodes[nodeIndex];
+	BoxTraits<Bound>::makeEmpty( node.m_bound );
+
+	if( node.isLeaf() )
+	{
+		for( BoundIterator *perm = node.m_permFirst; perm != node.m_permLast; perm++ )
+		{
+			boxExtend( node.m_bound, **perm );
+		}
+		return;
+	}
+
+	const NodeIndex firstChild = node.m_firstChild;
+	if( parallelDepth )
+	{
+		tbb::parallel_invoke(
+			RefitTask( this, firstChild, parallelDepth - 1 ),
+			RefitTask( this, firstChild + 1, parallelDepth - 1 )
+		);
+	}
+	else
+	{
+		refit( firstChild, 0 );
+		refit( firstChild + 1, 0 );
+	}
+
+	boxExtend( node.m_bound, m_nodes[firstChild].m_bound );
+	boxExtend( node.m_bound, m_nodes[firstChild+1].m_bound );
+}
+
+template<class BoundIterator>
+typename BoundingVolumeHierarchy<BoundIterator>::Real BoundingVolumeHierarchy<BoundIterator>::halfArea( const Bound &b )
+{
+	if( BoxTraits<Bound>::isEmpty( b ) )
+	{
+		return Real( 0 );
+	}
+
+	const BaseType size = boxSize( b );
+	const unsigned dimensions = VectorTraits<BaseType>::dimensions();
+	if( dimensions == 2 )
+	{
+		// for 2d bounds the perimeter is the appropriate measure
+		return VectorTraits<BaseType>::get( size, 0 ) + VectorTraits<BaseType>::get( size, 1 );
+	}
+
+	Real result( 0 );
+	for( unsigned i = 0; i < dimensions; i++ )
+	{
+		for( unsigned j = i + 1; j < dimensions; j++ )
+		{
+			result += VectorTraits<BaseType>::get( size, i ) * VectorTraits<BaseType>::get( size, j );
+		}
+	}
+	return result;
+}
+
+template<class BoundIterator>
+void BoundingVolumeHierarchy<BoundIterator>::makeLeaf( NodeIndex nodeIndex, PermutationIterator permFirst, PermutationIterator permLast )
+{
+	Node &node = m_nodes[nodeIndex];
+	node.m_firstChild = 0;
+	if( permFirst != permLast )
+	{
+		BoundIterator *base = &(m_perm[0]);
+		node.m_permFirst = base + ( permFirst - m_perm.begin() );
+		node.m_permLast = base + ( permLast - m_perm.begin() );
+	}
+}
+
+template<class BoundIterator>
+void BoundingVolumeHierarchy<BoundIterator>::build( NodeIndex nodeIndex, PermutationIterator permFirst, PermutationIterator permLast, const Bound &centroidBound )
+{
+	assert( nodeIndex < m_nodes.size() );
+
+	const size_t size = permLast - permFirst;
+	if( size <= (size_t)m_maxLeafSize )
+	{
+		makeLeaf( nodeIndex, permFirst, permLast );
+		return;
+	}
+
+	Bins bins( centroidBound );
+	if( size > (size_t)ParallelThreshold )
+	{
+		tbb::parallel_reduce( tbb::blocked_range<PermutationIterator>( permFirst, permLast, ParallelThreshold ), bins );
+	}
+	else
+	{
+		bins( tbb::blocked_range<PermutationIterator>( permFirst, permLast ) );
+	}
+
+	// find the split with the lowest cost, which is proportional to the
+	// surface area of each side multiplied by the number of bounds within it.
+
+	int bestAxis = -1;
+	int bestLastLowBin = -1;
+	Real bestCost = Imath::limits<Real>::max();
+	for( unsigned axis = 0; axis < VectorTraits<BaseType>::dimensions(); axis++ )
+	{
+		Real highCosts[NumBins];
+		size_t highCounts[NumBins];
+		Bin high;
+		for( int i = NumBins - 1; i > 0; i-- )
+		{
+			high.extend( bins.m_bins[axis][i] );
+			highCosts[i-1] = halfArea( high.bound ) * Real( high.count );
+			highCounts[i-1] = high.count;
+		}
+
+		Bin low;
+		for( int i = 0; i < NumBins - 1; i++ )
+		{
+			low.extend( bins.m_bins[axis][i] );
+			if( !low.count || !highCounts[i] )
+			{
+				continue;
+			}
+			const Real cost = halfArea( low.bound ) * Real( low.count ) + highCosts[i];
+			if( cost < bestCost )
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestLastLowBin = i;
+			}
+		}
+	}
+
+	PermutationIterator permMid;
+	Bin low, high;
+	if( bestAxis != -1 )
+	{
+		permMid = std::partition( permFirst, permLast, SplitPredicate( bins, bestAxis, bestLastLowBin ) );
+		for( int i = 0; i < NumBins; i++ )
+		{
+			( i <= bestLastLowBin ? low : high ).extend( bins.m_bins[bestAxis][i] );
+		}
+	}
+	else
+	{
+		// all the centers are coincident, so binning can't separate them. we just
+		// split the bounds in half so that the leaves stay small.
+		permMid = permFirst + size / 2;
+		for( PermutationIterator it = permFirst; it != permLast; ++it )
+		{
+			Bin &bin = it < permMid ? low : high;
+			boxExtend( bin.bound, **it );
+			boxExtend( bin.centroidBound, boxCenter( **it ) );
+		}
+	}
+
+	assert( permMid != permFirst && permMid != permLast );
+
+	const NodeIndex firstChild = m_numNodes.fetch_and_add( 2 );
+	assert( firstChild + 1 < m_nodes.size() );
+	m_nodes[nodeIndex].m_firstChild = firstChild;
+	m_nodes[firstChild].m_bound = low.bound;
+	m_nodes[firstChild+1].m_bound = high.bound;
+
+	if( size > (size_t)ParallelThreshold )
+	{
+		tbb::parallel_invoke(
+			BuildTask( this, firstChild, permFirst, permMid, low.centroidBound ),
+			BuildTask( this, firstChild + 1, permMid, permLast, high.centroidBound )
+		);
+	}
+	else
+	{
+		build( firstChild, permFirst, permMid, low.centroidBound );
+		build( firstChild + 1, permMid, permLast, high.centroidBound );
+	}
+}
+
+template<class BoundIterator>
+typename BoundingVolumeHierarchy<BoundIterator>::NodeIndex BoundingVolumeHierarchy<BoundIterator>::numNodes() const
+{
+	return m_nodes.size();
+}
+
+template<class BoundIterator>
+const typename BoundingVolumeHierarchy<BoundIterator>::Node& BoundingVolumeHierarchy<BoundIterator>::node( NodeIndex idx ) const
+{
+	assert( idx < m_nodes.size() );
+
+	return m_nodes[idx];
+}
+
+template<class BoundIterator>
+typename BoundingVolumeHierarchy<BoundIterator>::NodeIndex BoundingVolumeHierarchy<BoundIterator>::rootIndex() const
+{
+	return 0;
+}
+
+template<class BoundIterator>
+typename BoundingVolumeHierarchy<BoundIterator>::NodeIndex BoundingVolumeHierarchy<BoundIterator>::lowChildIndex( NodeIndex index ) const
+{
+	assert( m_nodes[index].isBranch() );
+	return m_nodes[index].m_firstChild;
+}
+
+template<class BoundIterator>
+typename BoundingVolumeHierarchy<BoundIterator>::NodeIndex BoundingVolumeHierarchy<BoundIterator>::highChildIndex( NodeIndex index ) const
+{
+	assert( m_nodes[index].isBranch() );
+	return m_nodes[index].m_firstChild + 1;
+}
+
+template<class BoundIterator>
+template<typename S>
+unsigned int BoundingVolumeHierarchy<BoundIterator>::intersectingBounds( const S &b, std::vector<BoundIterator> &bounds ) const
+{
+	bounds.clear();
+
+	if( m_nodes.size() )
+	{
+		intersectingBoundsWalk( rootIndex(), b, bounds );
+	}
+
+	return bounds.size();
+}
+
+template<class BoundIterator>
+template<typename S>
+void BoundingVolumeHierarchy<BoundIterator>::intersectingBoundsWalk( NodeIndex nodeIndex, const S &b, std::vector<BoundIterator> &bounds ) const
+{
+	const Node &node = m_nodes[nodeIndex];
+	if( node.isLeaf() )
+	{
+		BoundIterator *permLast = node.permLast();
+		for( BoundIterator *perm = node.permFirst(); perm!=permLast; perm++ )
+		{
+			if( boxIntersects( **perm, b ) )
+			{
+				bounds.push_back( *perm );
+			}
+		}
+	}
+	else
+	{
+		const NodeIndex firstChild = node.m_firstChild;
+		if( boxIntersects( m_nodes[firstChild].bound(), b ) )
+		{
+			intersectingBoundsWalk( firstChild, b, bounds );
+		}
+		if( boxIntersects( m_nodes[firstChild+1].bound(), b ) )
+		{
+			intersectingBoundsWalk( firstChild + 1, b, bounds );
+		}
+	}
+}
+
+} // namespace IECore
@@ -36,7 +36,7 @@
 #define IE_CORE_CACHEDREADER_H
 
 #include "IECore/SearchPath.h"
-#include "IECore/LRUCache.h"
+#include "IECore/ShardedLRUCache.h"
 
 #include <set>
 
@@ -129,7 +129,7 @@ class CachedReader : public RefCounted
 
 		struct Getter;
 
-		typedef LRUCache<std::string, ConstObjectPtr> Cache;
+		typedef ShardedLRUCache<std::string, ConstObjectPtr> Cache;
 		SearchPath m_paths;
 		Cache m_cache;
 
@@ -44,7 +44,8 @@ namespace IECore
 /// The ColorTransformOp defines a base class for Ops which
 /// transform the colors of a Primitive. By default the "Cs" or "R",
 /// "G", and "B" channels are transformed but this can be changed
-/// using the appropriate parameters.
+/// using the appropriate parameters. Colors are transformed in batches,
+/// in parallel unless isTransformThreadSafe() says otherwise.
 /// \ingroup imageProcessingGroup
 class ColorTransformOp : public PrimitiveOp
 {
@@ -73,30 +74,67 @@ class ColorTransformOp : public PrimitiveOp
 		BoolParameter * premultipliedParameter();
 		const BoolParameter * premultipliedParameter() const;
 
+		/// Applies a chain of ColorTransformOps to the primitive in place, making a single pass over
+		/// its data rather than one pass per op. The result is the same as calling operate() on each
+		/// op in turn with the copy parameter off, provided they all have the same primitive variable
+		/// and premultiplication parameters - only those belonging to the first op are used. Ops whose
+		/// enable parameter is off are skipped.
+		static void transformChain( const std::vector<ColorTransformOp *> &ops, Primitive *primitive );
+
 	protected :
 
 		/// Called once per operation. This is an opportunity to perform any preprocessing
 		/// necessary before many calls to transform() are made.
 		virtual void begin( const CompoundObject * operands );
-		/// Called once per color element (pixel for ImagePrimitives).
-		/// Must be implemented by subclasses to transform color in place.
+		/// Called once per color element (pixel for ImagePrimitives) by the default
+		/// implementation of transformBatch(). Must be implemented by subclasses to
+		/// transform color in place.
 		virtual void transform( Imath::Color3f &color ) const = 0;
+		/// Called to transform a batch of colors in place, with each component stored in
+		/// a separate array. The default implementation calls transform() for each color in
+		/// turn, but derived classes may reimplement it to process the whole batch at once,
+		/// with simple loops which the compiler is able to vectorise.
+		virtual void transformBatch( float *red, float *green, float *blue, size_t numColors ) const;
+		/// Returns true if transform() and transformBatch() may be called concurrently from
+		/// multiple threads, in which case batches are transformed in parallel. The default
+		/// implementation returns true, and derived classes which maintain state during the
+		/// transform or call libraries which aren't threadsafe should return false.
+		virtual bool isTransformThreadSafe() const;
 		/// Called once per operation, after all calls to transform() have been made - even if
 		// /transform() throws an exception. This is an opportunity to perform any cleanup necessary.
 		virtual void end();
 
 	private :
 
-		/// Implemented in terms of begin(), transform() and end(), which should be implemented
+		/// Implemented in terms of begin(), transformBatch() and end(), which should be implemented
 		/// appropriately by subclasses.
 		virtual void modifyPrimitive( Primitive * primitive, const CompoundObject * operands );
 
+		struct Stage
+		{
+			Stage( ColorTransformOp *op, const CompoundObject *operands );
+			ColorTransformOp *op;
+			const CompoundObject *operands;
+		};
+		typedef std::vector<Stage> Chain;
+
+		/// Transforms the primitive by all the ops in the chain, using the parameters of this op to
+		/// find the colors.
+		void transformPrimitive( const Chain &chain, Primitive * primitive );
 		template<typename T>
 		const typename T::BaseType *alphaData( Primitive * primitive, size_t requiredElements );
 		template <typename T>
-		void transformSeparate( Primitive * primitive, const CompoundObject * operands, T * r, T * g, T * b );
+		void transformSeparate( const Chain &chain, Primitive * primitive, T * r, T * g, T * b );
 		template <typename T>
-		void transformInterleaved( Primitive * primitive, const CompoundObject * operands, T * colors );
+		void transformInterleaved( const Chain &chain, Primitive * primitive, T * colors );
+		template<typename F>
+		static void transformChainData( const Chain &chain, size_t numColors, const F &functor );
+		static void transformBatch( const Chain &chain, float *red, float *green, float *blue, const float *alpha, size_t numColors );
+
+		template<typename T>
+		class SeparateTransform;
+		template<typename T>
+		class InterleavedTransform;
 
 		StringParameterPtr m_colorPrimVarParameter;
 		StringParameterPtr m_redPrimVarParameter;
@@ -37,6 +37,7 @@
 
 #include "boost/static_assert.hpp"
 #include "boost/type_traits.hpp"
+#include "boost/mpl/or.hpp"
 
 #include "IECore/DataConversion.h"
 
@@ -55,6 +56,9 @@ class CompoundDataConversion : public DataConversion< typename C1::FromType, typ
 		/// Inverse defined by the equality: (f o g)'(x) = ( g' o f' )(x)
 		typedef CompoundDataConversion< typename C2::InverseType, typename C1::InverseType > InverseType;
 
+		/// Expensive if either of the conversions is
+		typedef boost::mpl::or_< typename C1::IsExpensive, typename C2::IsExpensive > IsExpensive;
+
 		/// Instantiate a conversion using the default constructors for C1 and C2
 		CompoundDataConversion();
 
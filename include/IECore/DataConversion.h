@@ -56,6 +56,11 @@ struct DataConversion : public std::unary_function<F, T>
 	/// that DataConvert, for example, can optimise specific cases.
 	typedef boost::false_type IsIdentity;
 
+	/// Conversions which are expensive to compute can be marked as such. DataConvert will then use a TabulatedDataConversion
+	/// in their place when converting large arrays of 8 bit, 16 bit or half data, evaluating the conversion only once for each
+	/// possible input value.
+	typedef boost::false_type IsExpensive;
+
 	virtual ~DataConversion()
 	{
 	}
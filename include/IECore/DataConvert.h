@@ -51,6 +51,10 @@ namespace IECore
 /// FloatVectorPataPtr result = convert( myUIntVectorDataPtr );
 /// \endcode
 ///
+/// Vector conversions marked as IsExpensive are performed using a TabulatedDataConversion
+/// when the input type allows it and the array is larger than the table, so that 8 bit,
+/// 16 bit and half data pays for at most one evaluation per distinct input value.
+///
 /// The "Enable" template parameter is for internal use only.
 ///
 /// There are two variants of the function, one which constructs the conversion using its default
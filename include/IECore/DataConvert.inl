@@ -36,8 +36,11 @@
 
 #include "boost/utility/enable_if.hpp"
 #include "boost/mpl/and.hpp"
+#include "boost/mpl/bool.hpp"
 #include "boost/mpl/not.hpp"
 
+#include "IECore/TabulatedDataConversion.h"
+
 namespace IECore
 {
 
@@ -77,10 +80,32 @@ struct DataConvert< F, T, C, typename boost::enable_if< boost::mpl::and_< boost:
 		result->writable().resize( f->readable().size() );
 
 		assert( result->readable().size() == f->readable().size() );
-		std::transform( f->readable().begin(),  f->readable().end(), result->writable().begin(), c );
+		transform( f->readable(), result->writable(), c, boost::mpl::bool_<UseTable::value>() );
 
 		return result;
 	}
+
+	private :
+
+		typedef typename F::ValueType::value_type FromValueType;
+		typedef boost::mpl::and_< typename C::IsExpensive, TypeTraits::IsTabulatable<FromValueType> > UseTable;
+
+		void transform( const typename F::ValueType &from, typename T::ValueType &to, C &c, boost::mpl::false_ )
+		{
+			std::transform( from.begin(), from.end(), to.begin(), c );
+		}
+
+		void transform( const typename F::ValueType &from, typename T::ValueType &to, C &c, boost::mpl::true_ )
+		{
+			if( from.size() < TabulatedDataConversion<C>::tableSize )
+			{
+				// not enough elements to pay for building the table
+				transform( from, to, c, boost::mpl::false_() );
+				return;
+			}
+			std::transform( from.begin(), from.end(), to.begin(), TabulatedDataConversion<C>( c ) );
+		}
+
 };
 
 template<typename F, typename T, typename C>
@@ -36,17 +36,22 @@
 #define IE_CORE_EXRIMAGEREADER_H
 
 #include "IECore/ImageReader.h"
+#include "IECore/NumericParameter.h"
 
 namespace Imf
 {
-	class Channel;
 	class InputFile;
+	class TiledInputFile;
 };
 
 namespace IECore
 {
 
-/// The EXRImageReader class reads OpenEXR files.
+/// The EXRImageReader class reads OpenEXR files. Tiled files are read a row of tiles
+/// at a time, so that reading a small region of a large image only decompresses the
+/// tiles which overlap it. For mipmapped and ripmapped files the "mipLevel" parameter
+/// selects a lower resolution level to read, and dataWindow() and displayWindow()
+/// describe that level rather than the full resolution image.
 /// \ingroup ioGroup
 class EXRImageReader : public ImageReader
 {
@@ -68,6 +73,19 @@ class EXRImageReader : public ImageReader
 		virtual Imath::Box2i displayWindow();
 		virtual std::string sourceColorSpace() const ;
 
+		/// Returns the number of resolution levels available to the "mipLevel" parameter.
+		/// This is 1 for scanline files and tiled files without mipmaps, and for ripmapped
+		/// files only the levels with equal reductions in x and y are counted.
+		int numMipLevels();
+
+		/// Sets the number of threads OpenEXR uses to decompress image data.
+		/// This is global to the OpenEXR library, and so also affects
+		/// EXRImageWriter and any other users of OpenEXR in the process. Unless
+		/// a number has already been chosen by the time the first file is
+		/// opened, one thread per processor is used.
+		static void setNumThreads( int numThreads );
+		static int getNumThreads();
+
 	protected:
 
 		// overwrites base implementation by adding blind data values from header information.
@@ -75,18 +93,27 @@ class EXRImageReader : public ImageReader
 
 	private:
 
-		template<class T>
-		DataPtr readTypedChannel( const std::string &name, const Imath::Box2i &dataWindow, const Imf::Channel *channel );
-
 		virtual DataPtr readChannel( const std::string &name, const Imath::Box2i &dataWindow, bool raw );
+		/// Reads all the channels in a single pass, so that each block of the file is
+		/// only decompressed once.
+		virtual void readChannels( const std::vector<std::string> &names, const Imath::Box2i &dataWindow, bool raw, std::vector<DataPtr> &channels );
 
 		static const ReaderDescription<EXRImageReader> g_readerDescription;
 
+		void constructParameters();
+
 		/// Tries to open the file, returning true on success and false on failure. On success,
-		/// m_header and m_inputFile will be valid. If throwOnFailure is true then a descriptive
+		/// m_inputFile will be valid, as will m_tiledInputFile if the file is tiled. If throwOnFailure is true then a descriptive
 		/// Exception is thrown rather than false being returned.
 		bool open( bool throwOnFailure = false );
 		Imf::InputFile *m_inputFile;
+		/// Only valid for tiled files.
+		Imf::TiledInputFile *m_tiledInputFile;
+
+		/// Returns the value of the "mipLevel" parameter, throwing an Exception
+		/// if the file doesn't have that level.
+		int mipLevel();
+		IntParameterPtr m_mipLevelParameter;
 
 };
 
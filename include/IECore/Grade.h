@@ -90,6 +90,9 @@ class Grade : public ColorTransformOp
 		/// initializes temporary values A, B and 1/gamma.
 		virtual void begin( const CompoundObject * operands );
 		virtual void transform( Imath::Color3f &color ) const;
+		/// Grades each channel of the batch in turn, skipping the gamma
+		/// calculation where it has no effect.
+		virtual void transformBatch( float *red, float *green, float *blue, size_t numColors ) const;
 
 	private :
 
@@ -140,6 +140,13 @@ class ImageReader : public Reader
 		/// invalid names or dataWindows which are not wholly within the dataWindow in the file.
 		virtual DataPtr readChannel( const std::string &name, const Imath::Box2i &dataWindow, bool raw ) = 0;
 
+		/// Reads the specified area from all the named channels, filling channels with the results
+		/// in the same order as names. This is called by doOperation(), and the default implementation
+		/// simply calls readChannel() for each name in turn. Derived classes may reimplement it to read
+		/// all the channels in a single pass through the file. The same guarantees on names and dataWindow
+		/// apply as for readChannel().
+		virtual void readChannels( const std::vector<std::string> &names, const Imath::Box2i &dataWindow, bool raw, std::vector<DataPtr> &channels );
+
 	private :
 
 		Box2iParameterPtr m_dataWindowParameter;
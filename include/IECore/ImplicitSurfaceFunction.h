@@ -74,6 +74,18 @@ class ImplicitSurfaceFunction : public RefCounted
 
 		virtual Value getValue( const Point &p ) = 0;
 
+		/// Evaluates the function at each of numPoints points, placing the results in values. The
+		/// default implementation simply calls getValue() for each point, but derived classes may
+		/// override it to share work between neighbouring points, so batches of spatially coherent
+		/// points are likely to be evaluated most efficiently.
+		virtual void getValues( const Point *points, size_t numPoints, Value *values )
+		{
+			for( size_t i = 0; i < numPoints; ++i )
+			{
+				values[i] = getValue( points[i] );
+			}
+		}
+
 };
 
 typedef ImplicitSurfaceFunction<Imath::V3f, float> ImplicitSurfaceFunctionV3ff;
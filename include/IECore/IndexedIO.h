@@ -199,6 +199,12 @@ class IndexedIO : public RunTimeTyped
 		/// Any IndexedIO instances to child directories will be in a invalid state and should not be used after commit is called.
 		virtual void commit() = 0;
 
+		/// Hints that the given entries, specified by their paths relative to this directory, are
+		/// going to be read soon. Directories are prefetched with all of their contents. Implementations
+		/// may use it to start loading the data in the background, returning immediately. The default
+		/// implementation does nothing.
+		virtual void prefetch( const std::vector<IndexedIO::EntryIDList> &paths ) const;
+
 		/// Returns a new interface for the parent of this node in the file or a NULL pointer if it's the root.
 		virtual IndexedIOPtr parentDirectory() = 0;
 
@@ -69,14 +69,17 @@ class KDTree
 		/// Note that the tree does not own the passed points -
 		/// it is up to you to ensure that they remain valid and
 		/// unchanged as long as the KDTree is in use.
-		KDTree( PointIterator first, PointIterator last, int maxLeafSize=4 );
+		KDTree( PointIterator first, PointIterator last, int maxLeafSize=4, bool parallel=true );
 
 		/// Builds the tree for the specified points - the iterator range
 		/// must remain valid and unchanged as long as the tree is in use.
 		/// This method can be called again to rebuild the tree at any time.
 		/// \threading This can't be called while other threads are
-		/// making queries.
-		void init( PointIterator first, PointIterator last, int maxLeafSize=4  );
+		/// making queries. If parallel is true, the tree is built using
+		/// multiple threads, during which the calling thread may execute
+		/// other unrelated TBB tasks. Pass false if calling while holding a
+		/// lock which those tasks might also try to acquire.
+		void init( PointIterator first, PointIterator last, int maxLeafSize=4, bool parallel=true );
 
 		/// Returns an iterator to the nearest neighbour to the point p.
 		/// \threading May be called by multiple concurrent threads.
@@ -106,6 +109,21 @@ class KDTree
 		template<typename Box, typename OutputIterator>
 		void enclosedPoints( const Box &bound, OutputIterator it ) const;
 
+		//! @name Batch queries
+		/// These perform a query for each of a number of points, using multiple
+		/// threads, and without allocating memory for each query.
+		////////////////////////////////////////////////////////////////////////
+		//@{
+		/// Fills nearestNeighbours with the nearest neighbour to each of the points.
+		void batchNearestNeighbour( const std::vector<Point> &points, std::vector<PointIterator> &nearestNeighbours ) const;
+		/// Fills nearNeighbours with the closest numNeighbours neighbours to each of the points,
+		/// storing them consecutively so that the neighbours for points[i] start at index
+		/// i * numNeighbours. The neighbours for each point are sorted with the closest first.
+		/// If the tree contains fewer than numNeighbours points, the unused elements are given
+		/// the iterator to the end of the points and a distSquared of Imath::limits<BaseType>::max().
+		void batchNearestNNeighbours( const std::vector<Point> &points, unsigned int numNeighbours, std::vector<Neighbour> &nearNeighbours ) const;
+		//@}
+
 		/// Returns the number of nodes in the tree.
 		inline NodeIndex numNodes() const;
 		/// Returns the specified Node of the tree. See rootIndex(), lowChildIndex() and highChildIndex() for
@@ -128,9 +146,17 @@ class KDTree
 		typedef typename Permutation::const_iterator PermutationConstIterator;
 
 		class AxisSort;
+		class BuildTask;
+		class BatchNearestNeighbour;
+		class BatchNearestNNeighbours;
+
+		/// Subtrees with more than this number of points are built in parallel.
+		enum { ParallelThreshold = 10000 };
 
 		unsigned char majorAxis( PermutationConstIterator permFirst, PermutationConstIterator permLast );
-		void build( NodeIndex nodeIndex, PermutationIterator permFirst, PermutationIterator permLast );
+		void build( NodeIndex nodeIndex, PermutationIterator permFirst, PermutationIterator permLast, bool parallel );
+		/// Returns a pointer to the copy of the first point in a leaf node.
+		inline const Point *leafPoints( const Node &node ) const;
 
 		void nearestNeighbourWalk( NodeIndex nodeIndex, const Point &p, PointIterator &closestPoint, BaseType &distSquared ) const;
 
@@ -142,6 +168,9 @@ class KDTree
 		void nearestNNeighboursWalk( NodeIndex nodeIndex, const Point &p, unsigned int numNeighbours, std::vector<Neighbour> &nearNeighbours, BaseType &maxDistSquared ) const;
 
 		Permutation m_perm;
+		/// A copy of the points in the same order as m_perm, so
+		/// that the points within each leaf are stored contiguously.
+		std::vector<Point> m_points;
 		NodeVector m_nodes;
 		int m_maxLeafSize;
 		PointIterator m_lastPoint;
@@ -33,6 +33,11 @@
 //////////////////////////////////////////////////////////////////////////
 
 #include <algorithm>
+
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+#include "tbb/parallel_invoke.h"
+
 #include "OpenEXR/ImathLimits.h"
 #include "IECore/VectorOps.h"
 #include "IECore/BoxOps.h"
@@ -108,6 +113,89 @@ class KDTree<PointIterator>::AxisSort
 		const unsigned int m_axis;
 };
 
+template<class PointIterator>
+class KDTree<PointIterator>::BuildTask
+{
+	public :
+
+		BuildTask( KDTree *tree, NodeIndex nodeIndex, PermutationIterator permFirst, PermutationIterator permLast )
+			:	m_tree( tree ), m_nodeIndex( nodeIndex ), m_permFirst( permFirst ), m_permLast( permLast )
+		{
+		}
+
+		void operator()() const
+		{
+			m_tree->build( m_nodeIndex, m_permFirst, m_permLast, true );
+		}
+
+	private :
+
+		KDTree *m_tree;
+		NodeIndex m_nodeIndex;
+		PermutationIterator m_permFirst;
+		PermutationIterator m_permLast;
+
+};
+
+template<class PointIterator>
+class KDTree<PointIterator>::BatchNearestNeighbour
+{
+	public :
+
+		BatchNearestNeighbour( const KDTree *tree, const std::vector<Point> &points, std::vector<PointIterator> &nearestNeighbours )
+			:	m_tree( tree ), m_points( points ), m_nearestNeighbours( nearestNeighbours )
+		{
+		}
+
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			for( size_t i=r.begin(); i!=r.end(); ++i )
+			{
+				m_nearestNeighbours[i] = m_tree->nearestNeighbour( m_points[i] );
+			}
+		}
+
+	private :
+
+		const KDTree *m_tree;
+		const std::vector<Point> &m_points;
+		std::vector<PointIterator> &m_nearestNeighbours;
+
+};
+
+template<class PointIterator>
+class KDTree<PointIterator>::BatchNearestNNeighbours
+{
+	public :
+
+		BatchNearestNNeighbours( const KDTree *tree, const std::vector<Point> &points, unsigned int numNeighbours, std::vector<Neighbour> &nearNeighbours )
+			:	m_tree( tree ), m_points( points ), m_numNeighbours( numNeighbours ), m_nearNeighbours( nearNeighbours )
+		{
+		}
+
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			// reused for every query in the range, so that we only allocate once
+			std::vector<Neighbour> neighbours;
+			neighbours.reserve( m_numNeighbours );
+			for( size_t i=r.begin(); i!=r.end(); ++i )
+			{
+				unsigned int numFound = m_tree->nearestNNeighbours( m_points[i], m_numNeighbours, neighbours );
+				std::copy( neighbours.begin(), neighbours.end(), m_nearNeighbours.begin() + i * m_numNeighbours );
+				assert( numFound <= m_numNeighbours );
+				(void)numFound;
+			}
+		}
+
+	private :
+
+		const KDTree *m_tree;
+		const std::vector<Point> &m_points;
+		unsigned int m_numNeighbours;
+		std::vector<Neighbour> &m_nearNeighbours;
+
+};
+
 // initialisation
 
 template<class PointIterator>
@@ -116,13 +204,13 @@ KDTree<PointIterator>::KDTree()
 }
 
 template<class PointIterator>
-KDTree<PointIterator>::KDTree( PointIterator first, PointIterator last, int maxLeafSize )
+KDTree<PointIterator>::KDTree( PointIterator first, PointIterator last, int maxLeafSize, bool parallel )
 {
-	init( first, last, maxLeafSize );
+	init( first, last, maxLeafSize, parallel );
 }
 
 template<class PointIterator>
-void KDTree<PointIterator>::init( PointIterator first, PointIterator last, int maxLeafSize  )
+void KDTree<PointIterator>::init( PointIterator first, PointIterator last, int maxLeafSize, bool parallel )
 {
 	m_maxLeafSize = maxLeafSize;
 	m_lastPoint = last;
@@ -133,8 +221,25 @@ void KDTree<PointIterator>::init( PointIterator first, PointIterator last, int m
 		m_perm[i++] = it;
 	}
 
-	/// \todo Can we reserve() enough space for m_nodes before doing this?
-	build( rootIndex(), m_perm.begin(), m_perm.end() );
+	// the tree is balanced, with the high child of each branch containing at least as
+	// many points as the low child. so the node with the highest index is found by following
+	// the high children all the way down. we allocate all the nodes up front so that subtrees
+	// can be built concurrently.
+	NodeIndex maxNodeIndex = rootIndex();
+	for( size_t size = m_perm.size(); size > (size_t)m_maxLeafSize; size -= size / 2 )
+	{
+		maxNodeIndex = highChildIndex( maxNodeIndex );
+	}
+	m_nodes.clear();
+	m_nodes.resize( maxNodeIndex + 1 );
+
+	build( rootIndex(), m_perm.begin(), m_perm.end(), parallel );
+
+	m_points.resize( m_perm.size() );
+	for( size_t i=0; i<m_perm.size(); i++ )
+	{
+		m_points[i] = *(m_perm[i]);
+	}
 }
 
 template<class PointIterator>
@@ -172,13 +277,9 @@ unsigned char KDTree<PointIterator>::majorAxis( PermutationConstIterator permFir
 }
 
 template<class PointIterator>
-void KDTree<PointIterator>::build( NodeIndex nodeIndex, PermutationIterator permFirst, PermutationIterator permLast )
+void KDTree<PointIterator>::build( NodeIndex nodeIndex, PermutationIterator permFirst, PermutationIterator permLast, bool parallel )
 {
-	// make room for the new node
-	if( nodeIndex>=m_nodes.size() )
-	{
-		m_nodes.resize( nodeIndex+1 );
-	}
+	assert( nodeIndex < m_nodes.size() );
 
 	if( permLast - permFirst > m_maxLeafSize )
 	{
@@ -189,8 +290,18 @@ void KDTree<PointIterator>::build( NodeIndex nodeIndex, PermutationIterator perm
 		// insert node
 		m_nodes[nodeIndex].makeBranch( cutAxis, cutValue );
 
-		build( lowChildIndex( nodeIndex ), permFirst, permMid );
-		build( highChildIndex( nodeIndex ), permMid, permLast );
+		if( parallel && permLast - permFirst > ParallelThreshold )
+		{
+			tbb::parallel_invoke(
+				BuildTask( this, lowChildIndex( nodeIndex ), permFirst, permMid ),
+				BuildTask( this, highChildIndex( nodeIndex ), permMid, permLast )
+			);
+		}
+		else
+		{
+			build( lowChildIndex( nodeIndex ), permFirst, permMid, parallel );
+			build( highChildIndex( nodeIndex ), permMid, permLast, parallel );
+		}
 	}
 	else
 	{
@@ -250,6 +361,34 @@ unsigned int KDTree<PointIterator>::nearestNNeighbours( const Point &p, unsigned
 	return nearNeighbours.size();
 }
 
+template<class PointIterator>
+void KDTree<PointIterator>::batchNearestNeighbour( const std::vector<Point> &points, std::vector<PointIterator> &nearestNeighbours ) const
+{
+	nearestNeighbours.resize( points.size() );
+	tbb::parallel_for( tbb::blocked_range<size_t>( 0, points.size(), 100 ), BatchNearestNeighbour( this, points, nearestNeighbours ) );
+}
+
+template<class PointIterator>
+void KDTree<PointIterator>::batchNearestNNeighbours( const std::vector<Point> &points, unsigned int numNeighbours, std::vector<Neighbour> &nearNeighbours ) const
+{
+	nearNeighbours.clear();
+	nearNeighbours.resize( points.size() * numNeighbours, Neighbour( m_lastPoint, Imath::limits<BaseType>::max() ) );
+	if( numNeighbours )
+	{
+		tbb::parallel_for( tbb::blocked_range<size_t>( 0, points.size(), 100 ), BatchNearestNNeighbours( this, points, numNeighbours, nearNeighbours ) );
+	}
+}
+
+template<class PointIterator>
+inline const typename KDTree<PointIterator>::Point *KDTree<PointIterator>::leafPoints( const Node &node ) const
+{
+	if( m_points.empty() )
+	{
+		return 0;
+	}
+	return &(m_points[0]) + ( node.permFirst() - &(m_perm[0]) );
+}
+
 template<class PointIterator>
 void KDTree<PointIterator>::nearestNeighbourWalk( NodeIndex nodeIndex, const Point &p, PointIterator &closestPoint, BaseType &distSquared ) const
 {
@@ -257,9 +396,10 @@ void KDTree<PointIterator>::nearestNeighbourWalk( NodeIndex nodeIndex, const Poi
 	if( node.isLeaf() )
 	{
 		PointIterator *permLast = node.permLast();
-		for( PointIterator *perm = node.permFirst(); perm!=permLast; perm++ )
+		const Point *point = leafPoints( node );
+		for( PointIterator *perm = node.permFirst(); perm!=permLast; perm++, point++ )
 		{
-			const Point &pp = **perm;
+			const Point &pp = *point;
 			BaseType dist2 = vecDistance2( p, pp );
 
 			if( dist2 < distSquared )
@@ -300,9 +440,10 @@ void KDTree<PointIterator>::nearestNeighboursWalk( NodeIndex nodeIndex, const Po
 	if( node.isLeaf() )
 	{
 		PointIterator *permLast = node.permLast();
-		for( PointIterator *perm = node.permFirst(); perm!=permLast; perm++ )
+		const Point *point = leafPoints( node );
+		for( PointIterator *perm = node.permFirst(); perm!=permLast; perm++, point++ )
 		{
-			const Point &pp = **perm;
+			const Point &pp = *point;
 			BaseType dist2 = vecDistance2( p, pp );
 
 			if (dist2 < r2 )
@@ -342,9 +483,10 @@ void KDTree<PointIterator>::nearestNNeighboursWalk( NodeIndex nodeIndex, const P
 	if( node.isLeaf() )
 	{
 		PointIterator *permLast = node.permLast();
-		for( PointIterator *perm = node.permFirst(); perm!=permLast; perm++ )
+		const Point *point = leafPoints( node );
+		for( PointIterator *perm = node.permFirst(); perm!=permLast; perm++, point++ )
 		{
-			const Point &pp = **perm;
+			const Point &pp = *point;
 			BaseType dist2 = vecDistance2( p, pp );
 
 			if( dist2 < maxDistSquared || nearNeighbours.size() < numNeighbours )
@@ -406,9 +548,10 @@ void KDTree<PointIterator>::enclosedPointsWalk( NodeIndex nodeIndex, const Box &
 	if( node.isLeaf() )
 	{
 		PointIterator *permLast = node.permLast();
-		for( PointIterator *perm = node.permFirst(); perm!=permLast; perm++ )
+		const Point *point = leafPoints( node );
+		for( PointIterator *perm = node.permFirst(); perm!=permLast; perm++, point++ )
 		{
-			const Point &pp = **perm;
+			const Point &pp = *point;
 			if( boxIntersects( bound, pp ) )
 			{
 				*it++ = *perm;
@@ -71,6 +71,9 @@ IE_CORE_FORWARDDECLARE( LensModel );
 /// * Call validate() to validate the parameters and set up any internal state as necessary.
 /// * Call distort(), undistort() or bounds() as desired to query distorted UV values.
 ///
+/// distort() and undistort() are called concurrently from multiple threads by LensDistortOp, so
+/// implementations must not modify the model.
+///
 
 class LensModel : public Parameterised
 {
@@ -57,6 +57,7 @@ struct LinearToAlexaLogcDataConversion : public DataConversion< F, T >
 	BOOST_STATIC_ASSERT( boost::is_floating_point< T >::value );
 
 	typedef LinearToAlexaLogcDataConversion<T, F> InverseType;
+	typedef boost::true_type IsExpensive;
 
 	/// Perform the conversion
 	T operator()( F f ) const;
@@ -59,6 +59,7 @@ struct LinearToPanalogDataConversion : public DataConversion< F, T >
 		BOOST_STATIC_ASSERT( boost::is_floating_point< F >::value );
 
 		typedef PanalogToLinearDataConversion<T, F> InverseType;
+		typedef boost::true_type IsExpensive;
 		
 		/// Make a default converter with constant values
 		LinearToPanalogDataConversion();
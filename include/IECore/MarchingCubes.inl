@@ -35,6 +35,10 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
 
 #include "OpenEXR/ImathLimits.h"
 
@@ -46,6 +50,9 @@ namespace IECore
 template< typename ImplicitFn, typename MeshBuilder >
 MarchingCubes<ImplicitFn, MeshBuilder>::MarchingCubes( typename ImplicitFn::Ptr fn, typename MeshBuilder::Ptr builder ) :
 		m_bound(),		
+		m_blockStart( 0 ),
+		m_blockEnd( -1 ),
+		m_valuesStart( 0 ),
 		m_fn( fn ),
 		m_builder( builder ),
 		m_resolution( -1, -1, -1 ),
@@ -65,16 +72,26 @@ void MarchingCubes<ImplicitFn, MeshBuilder>::march( const MarchingCubes<Implicit
 {
 	m_resolution = res;
 	m_bound = bound;
+	m_blockStart = 0;
+	m_blockEnd = m_resolution.z - 1;
+	m_values.clear();
+
+	marchBlock( iso );
+}
+
+template< typename ImplicitFn, typename MeshBuilder >
+void MarchingCubes<ImplicitFn, MeshBuilder>::marchBlock( typename MarchingCubes<ImplicitFn, MeshBuilder>::ValueBaseType iso )
+{
 	m_numVerts = 0;
 	m_P = new V3xVectorData();
 	m_N = new V3xVectorData();	
 		
 	m_verts = new V3iVectorData();
-	m_verts->writable().resize( m_resolution.x * m_resolution.y * m_resolution.z, Imath::V3i( -1, -1, -1 ) );
+	m_verts->writable().resize( m_resolution.x * m_resolution.y * ( m_blockEnd - m_blockStart + 1 ), Imath::V3i( -1, -1, -1 ) );
 	
 	computeIntersectionPoints( iso ) ;
 
-	for ( m_currentGridPos.z = 0 ; m_currentGridPos.z < m_resolution.z-1 ; m_currentGridPos.z++ )
+	for ( m_currentGridPos.z = m_blockStart ; m_currentGridPos.z < m_blockEnd ; m_currentGridPos.z++ )
 	{
 		for ( m_currentGridPos.y = 0 ; m_currentGridPos.y < m_resolution.y-1 ; m_currentGridPos.y++ )
 		{
@@ -103,6 +120,201 @@ void MarchingCubes<ImplicitFn, MeshBuilder>::march( const MarchingCubes<Implicit
 	}
 }
 
+template< typename ImplicitFn, typename MeshBuilder >
+class MarchingCubes<ImplicitFn, MeshBuilder>::BlockBuilder : public RefCounted
+{
+	public :
+
+		IE_CORE_DECLAREMEMBERPTR( BlockBuilder );
+
+		/// The block marcher keeps its own copy of the vertices, so
+		/// we needn't store them here.
+		template<typename T>
+		void addVertex( const Imath::Vec3<T> &p, const Imath::Vec3<T> &n )
+		{
+		}
+
+		void addTriangle( int v0, int v1, int v2 )
+		{
+			triangles.push_back( v0 );
+			triangles.push_back( v1 );
+			triangles.push_back( v2 );
+		}
+
+		std::vector<int> triangles;
+
+};
+
+template< typename ImplicitFn, typename MeshBuilder >
+struct MarchingCubes<ImplicitFn, MeshBuilder>::MarchBlocks
+{
+	MarchBlocks( const MarchingCubes *marcher, int firstBlock, int blockSize, ValueBaseType iso, std::vector<typename BlockMarcher::Ptr> &blocks )
+		:	m_marcher( marcher ), m_firstBlock( firstBlock ), m_blockSize( blockSize ), m_iso( iso ), m_blocks( blocks )
+	{
+	}
+
+	void operator()( const tbb::blocked_range<int> &r ) const
+	{
+		for( int b = r.begin(); b != r.end(); ++b )
+		{
+			typename BlockMarcher::Ptr block = new BlockMarcher( m_marcher->m_fn, new BlockBuilder() );
+			m_marcher->initBlock( *block, b, m_blockSize, m_iso );
+			m_blocks[b - m_firstBlock] = block;
+		}
+	}
+
+	const MarchingCubes *m_marcher;
+	int m_firstBlock;
+	int m_blockSize;
+	ValueBaseType m_iso;
+	std::vector<typename BlockMarcher::Ptr> &m_blocks;
+};
+
+template< typename ImplicitFn, typename MeshBuilder >
+void MarchingCubes<ImplicitFn, MeshBuilder>::parallelMarch( const MarchingCubes<ImplicitFn, MeshBuilder>::BoxType &bound, const Imath::V3i &res, typename MarchingCubes<ImplicitFn, MeshBuilder>::ValueBaseType iso, int blockSize, int maxBlocksInFlight )
+{
+	m_resolution = res;
+	m_bound = bound;
+	m_values.clear();
+
+	blockSize = std::max( blockSize, 1 );
+	maxBlocksInFlight = std::max( maxBlocksInFlight, 1 );
+
+	const int numCubeLayers = m_resolution.z - 1;
+	const int numBlocks = numCubeLayers > 0 ? ( numCubeLayers + blockSize - 1 ) / blockSize : 0;
+
+	/// The ids of the vertices on the top layer of the last block added to the
+	/// builder, which are shared with the bottom layer of the next block.
+	std::vector<Imath::V2i> sharedLayer;
+	int numVertices = 0;
+
+	std::vector<typename BlockMarcher::Ptr> blocks;
+	for( int firstBlock = 0; firstBlock < numBlocks; firstBlock += maxBlocksInFlight )
+	{
+		const int lastBlock = std::min( firstBlock + maxBlocksInFlight, numBlocks );
+		blocks.resize( lastBlock - firstBlock );
+
+		tbb::parallel_for( tbb::blocked_range<int>( firstBlock, lastBlock, 1 ), MarchBlocks( this, firstBlock, blockSize, iso, blocks ) );
+
+		for( typename std::vector<typename BlockMarcher::Ptr>::iterator it = blocks.begin(); it != blocks.end(); ++it )
+		{
+			weldBlock( **it, sharedLayer, numVertices );
+			*it = 0;
+		}
+	}
+}
+
+template< typename ImplicitFn, typename MeshBuilder >
+template< typename Block >
+void MarchingCubes<ImplicitFn, MeshBuilder>::initBlock( Block &block, int blockIndex, int blockSize, typename MarchingCubes<ImplicitFn, MeshBuilder>::ValueBaseType iso ) const
+{
+	block.m_resolution = m_resolution;
+	block.m_bound = m_bound;
+	block.m_blockStart = blockIndex * blockSize;
+	block.m_blockEnd = std::min( block.m_blockStart + blockSize, m_resolution.z - 1 );
+	block.cacheValues();
+	block.marchBlock( iso );
+	block.m_values.clear();
+}
+
+template< typename ImplicitFn, typename MeshBuilder >
+template< typename Block >
+void MarchingCubes<ImplicitFn, MeshBuilder>::weldBlock( const Block &block, std::vector<Imath::V2i> &sharedLayer, int &numVertices )
+{
+	const typename V3xVectorData::ValueType &P = block.m_P->readable();
+	const typename V3xVectorData::ValueType &N = block.m_N->readable();
+	const std::vector<Imath::V3i> &verts = block.m_verts->readable();
+	const int layerSize = m_resolution.x * m_resolution.y;
+
+	std::vector<int> vertexIds( P.size(), -1 );
+
+	/// The vertices on the x and y edges of the bottom layer were also made by the
+	/// previous block, and the two are identical because they were computed from the
+	/// same function values, so we reuse the vertices already given to the builder.
+	if( block.m_blockStart > 0 )
+	{
+		assert( (int)sharedLayer.size() == layerSize );
+		for( int i = 0; i < layerSize; ++i )
+		{
+			if( verts[i].x != -1 )
+			{
+				assert( sharedLayer[i].x != -1 );
+				vertexIds[verts[i].x] = sharedLayer[i].x;
+			}
+			if( verts[i].y != -1 )
+			{
+				assert( sharedLayer[i].y != -1 );
+				vertexIds[verts[i].y] = sharedLayer[i].y;
+			}
+		}
+	}
+
+	for( size_t v = 0; v < P.size(); ++v )
+	{
+		if( vertexIds[v] == -1 )
+		{
+			m_builder->addVertex( P[v], N[v] );
+			vertexIds[v] = numVertices++;
+		}
+	}
+
+	const std::vector<int> &triangles = block.m_builder->triangles;
+	for( size_t t = 0; t < triangles.size(); t += 3 )
+	{
+		m_builder->addTriangle( vertexIds[triangles[t]], vertexIds[triangles[t+1]], vertexIds[triangles[t+2]] );
+	}
+
+	sharedLayer.resize( layerSize );
+	const Imath::V3i *topLayer = &verts[0] + ( block.m_blockEnd - block.m_blockStart ) * layerSize;
+	for( int i = 0; i < layerSize; ++i )
+	{
+		sharedLayer[i].x = topLayer[i].x != -1 ? vertexIds[topLayer[i].x] : -1;
+		sharedLayer[i].y = topLayer[i].y != -1 ? vertexIds[topLayer[i].y] : -1;
+	}
+}
+
+template< typename ImplicitFn, typename MeshBuilder >
+void MarchingCubes<ImplicitFn, MeshBuilder>::cacheValues()
+{
+	m_valuesStart = std::max( m_blockStart - 1, 0 );
+	const int valuesEnd = std::min( m_blockEnd + 1, m_resolution.z - 1 );
+
+	std::vector<Point> points;
+	points.reserve( m_resolution.x * m_resolution.y * ( valuesEnd - m_valuesStart + 1 ) );
+	for ( int k = m_valuesStart ; k <= valuesEnd ; k++ )
+	{
+		for ( int j = 0 ; j < m_resolution.y ; j++ )
+		{
+			for ( int i = 0 ; i < m_resolution.x ; i++ )
+			{
+				points.push_back( gridToWorld( i, j, k ) );
+			}
+		}
+	}
+
+	evaluate( points, m_values, HasBatchEvaluation() );
+}
+
+template< typename ImplicitFn, typename MeshBuilder >
+void MarchingCubes<ImplicitFn, MeshBuilder>::evaluate( const std::vector<Point> &points, std::vector<ValueBaseType> &values, boost::true_type hasBatchEvaluation )
+{
+	values.resize( points.size() );
+	if( points.size() )
+	{
+		m_fn->getValues( &points[0], points.size(), &values[0] );
+	}
+}
+
+template< typename ImplicitFn, typename MeshBuilder >
+void MarchingCubes<ImplicitFn, MeshBuilder>::evaluate( const std::vector<Point> &points, std::vector<ValueBaseType> &values, boost::false_type hasBatchEvaluation )
+{
+	values.resize( points.size() );
+	for( size_t i = 0; i < points.size(); ++i )
+	{
+		values[i] = m_fn->operator()( points[i] );
+	}
+}
+
 template< typename ImplicitFn, typename MeshBuilder >
 typename MarchingCubes<ImplicitFn, MeshBuilder>::Point MarchingCubes<ImplicitFn, MeshBuilder>::gridToWorld( const typename MarchingCubes<ImplicitFn, MeshBuilder>::PointBaseType i, const typename MarchingCubes<ImplicitFn, MeshBuilder>::PointBaseType j, const typename MarchingCubes<ImplicitFn, MeshBuilder>::PointBaseType k ) const     	      
 {										           	      
@@ -127,13 +339,20 @@ typename MarchingCubes<ImplicitFn, MeshBuilder>::ValueBaseType MarchingCubes<Imp
 	assert( k >= 0 );
 	assert( k < m_resolution.z );
 
+	if ( m_values.size() )
+	{
+		const int index = i + j*m_resolution.x + (k-m_valuesStart)*m_resolution.x*m_resolution.y;
+		assert( index >= 0 && index < (int)m_values.size() );
+		return m_values[index];
+	}
+
 	return m_fn->operator()( gridToWorld( i, j, k ) );
 }										           	      
 
 template< typename ImplicitFn, typename MeshBuilder >
 void MarchingCubes<ImplicitFn, MeshBuilder>::computeIntersectionPoints( typename MarchingCubes<ImplicitFn, MeshBuilder>::ValueBaseType iso )
 {
-	for ( m_currentGridPos.z = 0 ; m_currentGridPos.z < m_resolution.z ; m_currentGridPos.z++ )
+	for ( m_currentGridPos.z = m_blockStart ; m_currentGridPos.z <= m_blockEnd ; m_currentGridPos.z++ )
 	{
 		for ( m_currentGridPos.y = 0 ; m_currentGridPos.y < m_resolution.y ; m_currentGridPos.y++ )
 		{
@@ -158,7 +377,7 @@ void MarchingCubes<ImplicitFn, MeshBuilder>::computeIntersectionPoints( typename
 					m_currentCubeValues[3] = m_currentCubeValues[0] ;
 				}
 
-				if ( m_currentGridPos.z < m_resolution.z - 1 )
+				if ( m_currentGridPos.z < m_blockEnd )
 				{
 					m_currentCubeValues[4] = getIsoValue( m_currentGridPos.x, m_currentGridPos.y, m_currentGridPos.z+1) - iso ;
 				}
@@ -1083,37 +1302,37 @@ typename MarchingCubes<ImplicitFn, MeshBuilder>::ValueBaseType MarchingCubes<Imp
 template< typename ImplicitFn, typename MeshBuilder >
 int MarchingCubes<ImplicitFn, MeshBuilder>::getVertX( const int i, const int j, const int k ) const
 {
-	return m_verts->readable()[ i + j*m_resolution.x + k*m_resolution.x*m_resolution.y].x ;
+	return m_verts->readable()[ i + j*m_resolution.x + (k-m_blockStart)*m_resolution.x*m_resolution.y].x ;
 }
 
 template< typename ImplicitFn, typename MeshBuilder >
 int MarchingCubes<ImplicitFn, MeshBuilder>::getVertY( const int i, const int j, const int k ) const
 {
-	return m_verts->readable()[ i + j*m_resolution.x + k*m_resolution.x*m_resolution.y].y ;
+	return m_verts->readable()[ i + j*m_resolution.x + (k-m_blockStart)*m_resolution.x*m_resolution.y].y ;
 }
 
 template< typename ImplicitFn, typename MeshBuilder >
 int MarchingCubes<ImplicitFn, MeshBuilder>::getVertZ( const int i, const int j, const int k ) const
 {
-	return m_verts->readable()[ i + j*m_resolution.x + k*m_resolution.x*m_resolution.y].z ;
+	return m_verts->readable()[ i + j*m_resolution.x + (k-m_blockStart)*m_resolution.x*m_resolution.y].z ;
 }
 
 template< typename ImplicitFn, typename MeshBuilder >
 void MarchingCubes<ImplicitFn, MeshBuilder>::setVertX( const int val, const int i, const int j, const int k )
 {
-	m_verts->writable()[ i + j*m_resolution.x + k*m_resolution.x*m_resolution.y].x = val ;
+	m_verts->writable()[ i + j*m_resolution.x + (k-m_blockStart)*m_resolution.x*m_resolution.y].x = val ;
 }
 
 template< typename ImplicitFn, typename MeshBuilder >
 void MarchingCubes<ImplicitFn, MeshBuilder>::setVertY( const int val, const int i, const int j, const int k )
 {
-	m_verts->writable()[ i + j*m_resolution.x + k*m_resolution.x*m_resolution.y].y = val ;
+	m_verts->writable()[ i + j*m_resolution.x + (k-m_blockStart)*m_resolution.x*m_resolution.y].y = val ;
 }
 
 template< typename ImplicitFn, typename MeshBuilder >
 void MarchingCubes<ImplicitFn, MeshBuilder>::setVertZ( const int val, const int i, const int j, const int k )
 {
-	m_verts->writable()[ i + j*m_resolution.x + k*m_resolution.x*m_resolution.y].z = val ;
+	m_verts->writable()[ i + j*m_resolution.x + (k-m_blockStart)*m_resolution.x*m_resolution.y].z = val ;
 }
 
 template< typename ImplicitFn, typename MeshBuilder >
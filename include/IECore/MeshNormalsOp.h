@@ -40,7 +40,10 @@
 namespace IECore
 {
 
-/// A MeshPrimitiveOp to calculate vertex normals.
+/// A MeshPrimitiveOp to calculate vertex normals. The computation is multithreaded,
+/// using the adjacency tables provided by MeshTopology::get(), which are cached
+/// so that they may be reused when the op is applied to each frame of a deforming
+/// mesh.
 /// \ingroup geometryProcessingGroup
 class MeshNormalsOp : public MeshPrimitiveOp
 {
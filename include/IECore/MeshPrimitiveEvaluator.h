@@ -41,7 +41,9 @@
 
 #include "IECore/PrimitiveEvaluator.h"
 #include "IECore/MeshPrimitive.h"
+#include "IECore/MeshTopology.h"
 #include "IECore/BoundedKDTree.h"
+#include "IECore/BoundingVolumeHierarchy.h"
 
 namespace IECore
 {
@@ -101,9 +103,20 @@ class MeshPrimitiveEvaluator : public PrimitiveEvaluator
 		};
 		IE_CORE_DECLAREPTR( Result );
 
+		/// The types of tree which may be used to accelerate the closestPoint(),
+		/// intersectionPoint() and intersectionPoints() queries.
+		enum TreeType
+		{
+			/// The tree returned by triangleBoundTree().
+			KDTreeType,
+			/// The tree returned by triangleBVH(), which is faster to build
+			/// and to query.
+			BVHType
+		};
+
 		static PrimitiveEvaluatorPtr create( ConstPrimitivePtr primitive );
 
-		MeshPrimitiveEvaluator( ConstMeshPrimitivePtr mesh );
+		MeshPrimitiveEvaluator( ConstMeshPrimitivePtr mesh, TreeType treeType = BVHType );
 
 		virtual ~MeshPrimitiveEvaluator();
 
@@ -139,6 +152,45 @@ class MeshPrimitiveEvaluator : public PrimitiveEvaluator
 		/// Returns a bounding box covering all the uv coordinates of the mesh.
 		const Imath::Box2f uvBound() const;
 
+		//! @name Batch queries
+		/// These methods perform many queries in a single call, evaluating them in parallel.
+		/// They avoid the per-query overhead of the methods above, and store the results in
+		/// a BatchResults structure, which holds a separate array for each quantity, with
+		/// one element per query.
+		//////////////////////////////////////////////////////////////////////////
+		//@{
+		struct BatchResults
+		{
+			/// The index of the triangle found by each query, or -1 if the query failed.
+			std::vector<int> triangleIndices;
+			std::vector<Imath::V3f> barycentricCoordinates;
+			std::vector<Imath::V3f> points;
+			std::vector<Imath::V3f> normals;
+		};
+		/// Equivalent to calling closestPoint() for each of the points.
+		void batchClosestPoint( const std::vector<Imath::V3f> &points, BatchResults &results ) const;
+		/// Equivalent to calling intersectionPoint() for each ray, where the rays are specified by
+		/// corresponding elements of origins and directions.
+		void batchIntersectionPoint( const std::vector<Imath::V3f> &origins, const std::vector<Imath::V3f> &directions,
+			BatchResults &results, float maxDistance = Imath::limits<float>::max() ) const;
+		/// Equivalent to calling pointAtUV() for each of the uvs. Throws if the mesh has no
+		/// suitable uvs.
+		void batchPointAtUV( const std::vector<Imath::V2f> &uvs, BatchResults &results ) const;
+		//@}
+
+		//! @name Deformation
+		//////////////////////////////////////////////////////////////////////////
+		//@{
+		/// Updates the evaluator to use new vertex positions, for meshes which deform
+		/// without changing their topology. This is much cheaper than constructing a new
+		/// evaluator, as the bounds of the existing trees are refitted rather than rebuilt,
+		/// and the uv tree is reused. The volume, center of gravity, surface area and averaged
+		/// normals are discarded, to be recomputed on demand. Throws an InvalidArgumentException
+		/// if the number of positions doesn't match the number of vertices in the mesh.
+		/// \threading This can't be called while other threads are using the evaluator.
+		void setPositions( ConstV3fVectorDataPtr positions );
+		//@}
+
 		//! @name Internal KDTrees.
 		/// The MeshPrimitiveEvaluator uses internal KDTrees to perform many of
 		/// its queries. Const access is provided to these so that clients can use them
@@ -151,11 +203,20 @@ class MeshPrimitiveEvaluator : public PrimitiveEvaluator
 		typedef std::vector<TriangleBound> TriangleBoundVector;
 		/// A BoundedKDTree providing accelerated lookups of triangles using their bounding boxes.
 		typedef BoundedKDTree<TriangleBoundVector::iterator> TriangleBoundTree;
+		/// A BoundingVolumeHierarchy providing accelerated lookups of triangles using their bounding boxes.
+		typedef BoundingVolumeHierarchy<TriangleBoundVector::iterator> TriangleBVH;
 		/// Returns a pointer to the bounding boxes for each triangle.
 		const TriangleBoundVector *triangleBounds() const;
+		/// Returns the type of tree used to perform queries, as passed to the constructor.
+		TreeType treeType() const;
 		/// Returns a pointer to a tree that can be used for performing fast spacial queries.
 		///  The iterators in this tree point to elements in the vector returned by triangleBounds().
+		/// If the evaluator was constructed with BVHType, the tree is built on the first call.
 		const TriangleBoundTree *triangleBoundTree() const;
+		/// Returns a pointer to a bounding volume hierarchy that can be used for performing fast
+		/// spacial queries, or 0 if the evaluator was constructed with KDTreeType. The iterators
+		/// in this tree point to elements in the vector returned by triangleBounds().
+		const TriangleBVH *triangleBVH() const;
 		
 		/// A type for storing the uv bounding box for a triangle.
 		typedef Imath::Box2f UVBound;
@@ -179,15 +240,38 @@ class MeshPrimitiveEvaluator : public PrimitiveEvaluator
 		const std::vector<int> *m_meshVertexIds;
 
 		TriangleBoundVector m_triangles;
-		TriangleBoundTree *m_tree;
+		TreeType m_treeType;
+		mutable TriangleBoundTree *m_tree;
+		TriangleBVH *m_bvh;
+		typedef tbb::mutex TreeMutex;
+		mutable TreeMutex m_treeMutex;
 
 		UVBoundVector m_uvTriangles;		
 		UVBoundTree *m_uvTree;
 
 		bool pointAtUVWalk( UVBoundTree::NodeIndex nodeIndex, const Imath::V2f &targetUV, Result *result ) const;
-		void closestPointWalk( TriangleBoundTree::NodeIndex nodeIndex, const Imath::V3f &p, float &closestDistanceSqrd, Result *result ) const;
-		bool intersectionPointWalk( TriangleBoundTree::NodeIndex nodeIndex, const Imath::Line3f &ray, float &maxDistSqrd, Result *result, bool &hit ) const;
-		void intersectionPointsWalk( TriangleBoundTree::NodeIndex nodeIndex, const Imath::Line3f &ray, float maxDistSqrd, std::vector<PrimitiveEvaluator::ResultPtr> &results ) const;
+		/// The walks are templated so that they may be used with either
+		/// a TriangleBoundTree or a TriangleBVH.
+		template<typename Tree>
+		void closestPointWalk( const Tree &tree, typename Tree::NodeIndex nodeIndex, const Imath::V3f &p, float &closestDistanceSqrd, Result *result ) const;
+		template<typename Tree>
+		bool intersectionPointWalk( const Tree &tree, typename Tree::NodeIndex nodeIndex, const Imath::Line3f &ray, float &maxDistSqrd, Result *result, bool &hit ) const;
+		template<typename Tree>
+		void intersectionPointsWalk( const Tree &tree, typename Tree::NodeIndex nodeIndex, const Imath::Line3f &ray, float maxDistSqrd, std::vector<PrimitiveEvaluator::ResultPtr> &results ) const;
+		/// Perform the walks above using whichever tree is in use.
+		void treeClosestPoint( const Imath::V3f &p, Result *result ) const;
+		bool treeIntersectionPoint( const Imath::Line3f &ray, float maxDistSqrd, Result *result ) const;
+		/// Fills in the point, normal and uv of a result from the triangle and
+		/// barycentric coordinates found by one of the walks above.
+		void completeResult( Result *result ) const;
+
+		class BatchQuery;
+		class BatchClosestPoint;
+		class BatchIntersectionPoint;
+		class BatchPointAtUV;
+		class UpdateTriangleBounds;
+		class VertexAngleWeightedNormals;
+		class EdgeAverageNormals;
 
 		void calculateMassProperties() const;
 		void calculateAverageNormals() const;
@@ -209,10 +293,10 @@ class MeshPrimitiveEvaluator : public PrimitiveEvaluator
 		mutable bool m_haveAverageNormals;
 		typedef int VertexIndex;
 		typedef int TriangleIndex;
-		typedef std::pair<VertexIndex, VertexIndex> Edge;
 
-		typedef std::map< Edge, Imath::V3f > EdgeAverageNormals;
-		mutable EdgeAverageNormals m_edgeAverageNormals;
+		/// Edge normals are indexed as the edges of m_topology.
+		mutable ConstMeshTopologyPtr m_topology;
+		mutable std::vector<Imath::V3f> m_edgeAverageNormals;
 
 		mutable V3fVectorDataPtr m_vertexAngleWeightedNormals;
 
@@ -0,0 +1,242 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef IECORE_MESHTOPOLOGY_H
+#define IECORE_MESHTOPOLOGY_H
+
+#include <vector>
+
+#include "OpenEXR/ImathVec.h"
+
+#include "tbb/atomic.h"
+
+#include "IECore/RefCounted.h"
+#include "IECore/VectorTypedData.h"
+
+namespace IECore
+{
+
+IE_CORE_FORWARDDECLARE( MeshTopology )
+IE_CORE_FORWARDDECLARE( MeshPrimitive )
+
+/// A MeshTopology stores adjacency tables for the faces and vertices of a mesh, in
+/// compressed sparse row form, so that algorithms can gather values from the faces
+/// surrounding each vertex rather than scattering values from each face onto its
+/// vertices. Gathering allows such algorithms to process the vertices in parallel
+/// without any write races, and the order in which the values are gathered matches
+/// the order in which a serial scatter would have visited them.
+///
+/// The face and vertex tables are built on construction, and the edge and triangle
+/// tables are built on first use, so that algorithms which don't need them don't pay
+/// for them. All the tables may be accessed concurrently from multiple threads.
+///
+/// The tables depend only on the verticesPerFace and vertexIds of a mesh, so
+/// the get() methods cache them keyed on a hash of that data, allowing them to be
+/// reused by all the meshes which share a topology, and by successive frames of a
+/// deforming mesh.
+/// \ingroup geometryProcessingGroup
+class MeshTopology : public RefCounted
+{
+
+	public :
+
+		IE_CORE_DECLAREMEMBERPTR( MeshTopology );
+
+		/// Builds the tables for faces with the specified vertex counts, referencing
+		/// numVertices vertices via the specified vertexIds. The vertexIds needn't be
+		/// the ids of a mesh - any facevarying index array may be used (the indices
+		/// for shared uvs for instance). Throws an InvalidArgumentException if the
+		/// vertexIds don't match verticesPerFace or are out of range. The tables are
+		/// built using multiple threads unless parallel is false, both here and when
+		/// the edge and triangle tables are built on demand. A copy of the vertexIds
+		/// is kept for building the edge tables, so the caller is free to modify them
+		/// afterwards.
+		MeshTopology( const IntVectorData *verticesPerFace, const IntVectorData *vertexIds, size_t numVertices, bool parallel = true );
+		virtual ~MeshTopology();
+
+		size_t numFaces() const;
+		size_t numVertices() const;
+		size_t numFaceVertices() const;
+
+		//! @name Face tables
+		//////////////////////////////////////////////////////////////////////////////
+		//@{
+		/// Returns numFaces()+1 offsets such that the face-vertices for face f are
+		/// in the range [ faceOffsets()[f], faceOffsets()[f+1] ).
+		const std::vector<int> &faceOffsets() const;
+		/// Returns the index of the face each face-vertex belongs to.
+		const std::vector<int> &faceVertexFaces() const;
+		/// Returns the face-vertex following the specified one in its face,
+		/// wrapping around at the end of the face.
+		inline int nextFaceVertex( int faceVertex ) const;
+		/// Returns the face-vertex preceding the specified one in its face,
+		/// wrapping around at the start of the face.
+		inline int previousFaceVertex( int faceVertex ) const;
+		//@}
+
+		//! @name Vertex tables
+		//////////////////////////////////////////////////////////////////////////////
+		//@{
+		/// Returns numVertices()+1 offsets such that the face-vertices referencing
+		/// vertex v are in the range vertexFaceVertices()[vertexFaceVertexOffsets()[v]]
+		/// to vertexFaceVertices()[vertexFaceVertexOffsets()[v+1]].
+		const std::vector<int> &vertexFaceVertexOffsets() const;
+		/// Returns the indices of the face-vertices referencing each vertex, grouped
+		/// by vertex and in increasing order within each group. The face for each is
+		/// given by faceVertexFaces().
+		const std::vector<int> &vertexFaceVertices() const;
+		//@}
+
+		//! @name Edge tables
+		/// Each edge is stored once, however many faces use it. The half-edge for a
+		/// face-vertex runs from that face-vertex to nextFaceVertex(), and it lies
+		/// on exactly one edge.
+		//////////////////////////////////////////////////////////////////////////////
+		//@{
+		size_t numEdges() const;
+		/// Returns the two vertices of each edge, with the lower vertex first.
+		/// The edges are sorted by their first and then their second vertex.
+		const std::vector<Imath::V2i> &edges() const;
+		/// Returns numVertices()+1 offsets such that the edges whose first vertex
+		/// is v are in the range [ vertexEdgeOffsets()[v], vertexEdgeOffsets()[v+1] ).
+		const std::vector<int> &vertexEdgeOffsets() const;
+		/// Returns the edge on which the half-edge for each face-vertex lies.
+		const std::vector<int> &faceVertexEdges() const;
+		/// Returns numEdges()+1 offsets such that the face-vertices whose half-edges
+		/// lie on edge e are in the range edgeFaceVertices()[edgeFaceVertexOffsets()[e]]
+		/// to edgeFaceVertices()[edgeFaceVertexOffsets()[e+1]].
+		const std::vector<int> &edgeFaceVertexOffsets() const;
+		/// Returns the face-vertices whose half-edges lie on each edge, grouped
+		/// by edge and in increasing order within each group.
+		const std::vector<int> &edgeFaceVertices() const;
+		/// Returns the index of the edge between the specified vertices, which
+		/// may be given in either order, or -1 if there is no such edge.
+		int edgeIndex( int vertex0, int vertex1 ) const;
+		//@}
+
+		//! @name Triangle tables
+		/// These describe a triangulation of the mesh made by fanning each face
+		/// around its first face-vertex, as used by TriangulateOp. Faces with fewer
+		/// than three vertices have no triangles.
+		//////////////////////////////////////////////////////////////////////////////
+		//@{
+		size_t numTriangles() const;
+		/// Returns numFaces()+1 offsets such that the triangles for face f are
+		/// in the range [ faceTriangleOffsets()[f], faceTriangleOffsets()[f+1] ).
+		const std::vector<int> &faceTriangleOffsets() const;
+		/// Returns the face each triangle was made from.
+		const std::vector<int> &triangleFaces() const;
+		/// Returns the three face-vertices of each triangle, in the same winding
+		/// order as the face.
+		const std::vector<int> &triangleFaceVertices() const;
+		//@}
+
+		/// Returns the memory used by the tables, including any built on demand.
+		size_t memoryUsage() const;
+
+		//! @name Cache
+		/// The topologies returned by get() are shared via a cache keyed on the hashes
+		/// of the topology data, with a cost given by memoryUsage() when they are
+		/// inserted. The edge and triangle tables built on demand afterwards aren't
+		/// charged to the cache, so its real memory usage may exceed the limit given
+		/// to setCacheMaxMemory() by up to the size of those tables.
+		//////////////////////////////////////////////////////////////////////////////
+		//@{
+		/// Returns the topology for the specified data, computing it if it isn't already
+		/// in the cache.
+		static ConstMeshTopologyPtr get( const IntVectorData *verticesPerFace, const IntVectorData *vertexIds, size_t numVertices );
+		/// Returns the topology for the specified mesh.
+		static ConstMeshTopologyPtr get( const MeshPrimitive *mesh );
+		static void setCacheMaxMemory( size_t maxMemory );
+		static size_t getCacheMaxMemory();
+		/// Returns the total cost of the topologies currently held in the cache.
+		static size_t cacheMemoryUsage();
+		/// Discards all the cached topologies.
+		static void clearCache();
+		//@}
+
+	private :
+
+		struct CountValences;
+		struct FillFaceVertexFaces;
+		struct FillVertexFaceVertices;
+		struct SortVertexFaceVertices;
+		struct CountEdges;
+		struct FillEdges;
+		struct FillTriangles;
+
+		struct EdgeTables
+		{
+			std::vector<Imath::V2i> edges;
+			std::vector<int> vertexEdgeOffsets;
+			std::vector<int> faceVertexEdges;
+			std::vector<int> edgeFaceVertexOffsets;
+			std::vector<int> edgeFaceVertices;
+		};
+
+		const EdgeTables &edgeTables() const;
+		void buildEdgeTables( EdgeTables &tables ) const;
+
+		struct TriangleTables
+		{
+			std::vector<int> faceTriangleOffsets;
+			std::vector<int> triangleFaces;
+			std::vector<int> triangleFaceVertices;
+		};
+
+		const TriangleTables &triangleTables() const;
+		void buildTriangleTables( TriangleTables &tables ) const;
+
+		bool m_parallel;
+		// A copy kept for building the edge tables on demand.
+		ConstIntVectorDataPtr m_vertexIds;
+
+		std::vector<int> m_faceOffsets;
+		std::vector<int> m_faceVertexFaces;
+		std::vector<int> m_vertexFaceVertexOffsets;
+		std::vector<int> m_vertexFaceVertices;
+
+		// Built on demand by edgeTables() and triangleTables().
+		mutable tbb::atomic<EdgeTables *> m_edgeTables;
+		mutable tbb::atomic<TriangleTables *> m_triangleTables;
+
+};
+
+IE_CORE_DECLAREPTR( MeshTopology );
+
+} // namespace IECore
+
+#include "IECore/MeshTopology.inl"
+
+#endif // IECORE_MESHTOPOLOGY_H
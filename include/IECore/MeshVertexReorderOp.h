@@ -37,10 +37,10 @@
 
 #include <set>
 #include <vector>
-#include <map>
 
 #include "IECore/SimpleTypedParameter.h"
 #include "IECore/TypedPrimitiveOp.h"
+#include "IECore/MeshTopology.h"
 
 namespace IECore
 {
@@ -76,25 +76,18 @@ class MeshVertexReorderOp : public MeshPrimitiveOp
 
 		typedef std::pair< VertexId, VertexId > Edge;
 
-		typedef std::vector< FaceId > FaceList;
 		typedef std::set< FaceId > FaceSet;
 		typedef std::vector< Edge > EdgeList;
 		typedef std::vector<VertexId> VertexList;
 
-		typedef std::map< FaceId, EdgeList > FaceToEdgesMap;
-		typedef std::map< FaceId, VertexList > FaceToVerticesMap;
-		typedef std::map< VertexId, FaceSet > VertexToFacesMap;
-		typedef std::map< Edge, FaceList > EdgeToConnectedFacesMap;
-
-		FaceToEdgesMap m_faceToEdgesMap;
-		FaceToVerticesMap m_faceToVerticesMap;
-		EdgeToConnectedFacesMap m_edgeToConnectedFacesMap;
-		VertexToFacesMap m_vertexToFacesMap;
-		VertexList m_faceVaryingOffsets;
+		/// Adjacency is provided by the cached MeshTopology for the input mesh.
+		ConstMeshTopologyPtr m_topology;
+		ConstIntVectorDataPtr m_vertexIds;
 		int m_numFaces;
 		int m_numVerts;
 
 		void buildInternalTopology( const MeshPrimitive * mesh );
+		void vertexFaces( VertexId vertex, FaceSet &faces ) const;
 
 		int faceDirection( FaceId face, Edge edge );
 
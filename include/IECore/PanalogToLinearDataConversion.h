@@ -61,6 +61,7 @@ class PanalogToLinearDataConversion : public DataConversion< F, T >
 		BOOST_STATIC_ASSERT( boost::is_floating_point< T >::value );
 
 		typedef LinearToPanalogDataConversion< T, F > InverseType;
+		typedef boost::true_type IsExpensive;
 
 		/// Make a default converter with constant values
 		PanalogToLinearDataConversion();
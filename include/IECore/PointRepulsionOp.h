@@ -42,6 +42,7 @@
 #include "IECore/TypedPrimitiveParameter.h"
 #include "IECore/PrimitiveVariable.h"
 #include "IECore/Random.h"
+#include "IECore/BoundingVolumeHierarchy.h"
 
 namespace IECore
 {
@@ -51,6 +52,8 @@ IE_CORE_FORWARDDECLARE( ImagePrimitiveEvaluator )
 IE_CORE_FORWARDDECLARE( MeshPrimitiveEvaluator )
 
 /// \todo Class docs
+/// \threading The per point work in each iteration is performed in parallel. The results
+/// don't depend on the number of threads used, so they are identical to those of a serial run.
 /// \ingroup geometryProcessingGroup
 class PointRepulsionOp : public ModifyOp
 {
@@ -83,7 +86,9 @@ class PointRepulsionOp : public ModifyOp
 	protected :
 
 		void getNearestPointsAndDensities( ImagePrimitiveEvaluator *, const PrimitiveVariable &density, MeshPrimitiveEvaluator *, const PrimitiveVariable &s, const PrimitiveVariable &t, std::vector<Imath::V3f> &points, std::vector<float> &densities );
-		void calculateForces( std::vector<Imath::V3f> &points, std::vector<float> &radii, std::vector<Imath::Box3f> &bounds, std::vector<Imath::V3f> &forces, Imath::Rand48 &generator, std::vector<float> &densities, float densityInv );
+		/// Calculates the forces on each point, using a tree built from the bounds. The seed is used to generate
+		/// random directions for coincident points, and should be different for each iteration.
+		void calculateForces( const Box3fBVH &tree, const std::vector<Imath::V3f> &points, const std::vector<float> &radii, const std::vector<Imath::Box3f> &bounds, std::vector<Imath::V3f> &forces, unsigned long seed, const std::vector<float> &densities, float densityInv );
 
 		virtual void modify( Object * object, const CompoundObject * operands );
 
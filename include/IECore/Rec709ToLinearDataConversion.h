@@ -55,6 +55,7 @@ struct Rec709ToLinearDataConversion : public DataConversion< F, T >
 	BOOST_STATIC_ASSERT( boost::is_floating_point< T >::value );
 
 	typedef LinearToRec709DataConversion<T, F> InverseType;
+	typedef boost::true_type IsExpensive;
 
 	/// Perform the conversion
 	T operator()( F f ) const;
@@ -48,6 +48,8 @@ IE_CORE_FORWARDDECLARE( SceneCache );
 /// The destruction of the root scene will trigger the recursive computation of the bounding boxes for all the
 /// locations that no bounds were written. It will also store (without duplication) all the
 /// sample times used by objects, transforms, bounds and attributes.
+/// Distinct locations may be written concurrently from different threads, so independent subtrees
+/// can be exported in parallel, as long as each location is only written by one thread at a time.
 /// \ingroup ioGroup
 class SceneCache : public SampledSceneInterface
 {
@@ -130,7 +132,42 @@ class SceneCache : public SampledSceneInterface
 		virtual SceneInterfacePtr createChild( const Name &name );
 		virtual SceneInterfacePtr scene( const Path &path, MissingBehaviour missingBehaviour = ThrowIfMissing );
 		virtual ConstSceneInterfacePtr scene( const Path &path, SceneInterface::MissingBehaviour missingBehaviour = ThrowIfMissing ) const;
+
+		/// Launches a background task that loads the index of the given locations and asks the
+		/// IndexedIO to prefetch the requested samples. Only supported in Read mode.
+		virtual void prefetch( const std::vector<Path> &paths, const std::vector<double> &times, unsigned entries = PrefetchAll ) const;
 		
+		/*
+		 * Batch queries
+		 */
+
+		/// Reads the bounds of the given locations (full paths) at the given time. This is equivalent
+		/// to calling readBound() on each location, but the sample interval is only computed once for
+		/// each distinct set of sample times. Throws if a location is missing. Only supported in Read mode.
+		void readBounds( const std::vector<Path> &paths, double time, std::vector<Imath::Box3d> &bounds ) const;
+		/// As readBounds(), for readTransformAsMatrix().
+		void readTransformsAsMatrix( const std::vector<Path> &paths, double time, std::vector<Imath::M44d> &transforms ) const;
+
+		/*
+		 * Object cache
+		 */
+
+		/// SceneCache readers can share a cache of the objects, bounds and transforms they load, keyed
+		/// by file, location and sample, so that repeated reads of the same samples don't load them again.
+		/// The cost of each item is given by Object::memoryUsage(). The cache is disabled by default - set
+		/// a maximum memory greater than 0 to enable it. The read methods return copies of the cached
+		/// objects, which are cheap as the copies share their data until it is modified.
+		static void setObjectCacheMaxMemory( size_t maxMemory );
+		static size_t getObjectCacheMaxMemory();
+		/// Returns the memory used by the objects currently held in the cache.
+		static size_t objectCacheMemoryUsage();
+		/// Discards all the cached objects and resets the hit and miss counts.
+		static void clearObjectCache();
+		/// Returns the number of reads served from the cache since it was last cleared.
+		static size_t objectCacheHits();
+		/// Returns the number of reads which had to load the sample from the file since the cache was last cleared.
+		static size_t objectCacheMisses();
+
 		// The attribute names used to mark animated topology and primitive variables
 		// when SceneCache objects are Primitives.
 		static const Name &animatedObjectTopologyAttribute;
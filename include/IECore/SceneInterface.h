@@ -222,6 +222,26 @@ class SceneInterface : public RunTimeTyped
 		/// Returns a const interface for querying the scene at the given path (full path). 
 		virtual ConstSceneInterfacePtr scene( const Path &path, MissingBehaviour missingBehaviour = ThrowIfMissing ) const = 0;
 
+		/*
+		 * Prefetching
+		 */
+
+		/// Flags specifying which entries of a location should be prefetched.
+		enum PrefetchEntries
+		{
+			PrefetchBound = 1,
+			PrefetchTransform = 2,
+			PrefetchAttributes = 4,
+			PrefetchObject = 8,
+			PrefetchAll = PrefetchBound | PrefetchTransform | PrefetchAttributes | PrefetchObject
+		};
+
+		/// Hints that the given entries of the given locations (full paths) are going to be read soon, at the
+		/// given times. If no times are given then all the samples are prefetched. Implementations may start
+		/// loading the data in the background and return immediately, so that the subsequent read calls
+		/// are faster. Missing locations are ignored. The default implementation does nothing.
+		virtual void prefetch( const std::vector<Path> &paths, const std::vector<double> &times, unsigned entries = PrefetchAll ) const;
+
 		/*
 		 * Utility functions
 		 */
@@ -0,0 +1,186 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef IECORE_SHARDEDLRUCACHE_H
+#define IECORE_SHARDEDLRUCACHE_H
+
+#include <list>
+
+#include "tbb/atomic.h"
+#include "tbb/spin_rw_mutex.h"
+
+#include "boost/noncopyable.hpp"
+#include "boost/function.hpp"
+#include "boost/unordered_map.hpp"
+
+namespace IECore
+{
+
+/// A cache with the same interface and cost semantics as LRUCache, designed for heavy concurrent use.
+/// The items are stored in hash maps split over several shards, each protected by its own read-write
+/// lock, so that threads accessing different items rarely contend. Rather than maintaining an exact
+/// least-recently-used order, which requires exclusive access on every hit, each item has a "referenced"
+/// flag which is set when it is retrieved, and items are discarded using the CLOCK algorithm - cycling
+/// through the items, clearing the flags and discarding the first item found without one. This means
+/// that cache hits only take a shared lock on a single shard.
+/// The Key type must be hashable with boost::hash.
+/// \threading It is safe to call the methods of ShardedLRUCache from concurrent threads. Concurrent calls
+/// to get() for the same key result in a single call to the GetterFunction. When items are being added
+/// concurrently, the current cost may temporarily exceed the maximum cost.
+/// \ingroup utilityGroup
+template<typename Key, typename Ptr>
+class ShardedLRUCache : private boost::noncopyable
+{
+	public:
+
+		typedef Key KeyType;
+		typedef Ptr PtrType;
+		typedef size_t Cost;
+
+		/// The GetterFunction is responsible for computing the value and cost for a cache entry
+		/// when given the key. It should throw a descriptive exception if it can't get the data for
+		/// any reason.
+		typedef boost::function<Ptr ( const Key &key, Cost &cost )> GetterFunction;
+		/// The optional RemovalCallback is called whenever an item is discarded from the cache.
+		typedef boost::function<void ( const Key &key, const Ptr &data )> RemovalCallback;
+
+		ShardedLRUCache( GetterFunction getter );
+		ShardedLRUCache( GetterFunction getter, Cost maxCost );
+		ShardedLRUCache( GetterFunction getter, RemovalCallback removalCallback, Cost maxCost );
+		virtual ~ShardedLRUCache();
+
+		void clear();
+
+		// Erases the given key if it is contained in the cache. Returns whether any item was removed.
+		bool erase( const Key &key );
+
+		/// Set the maximum cost of the items held in the cache, discarding any items if necessary.
+		void setMaxCost( Cost maxCost );
+
+		/// Get the maximum possible cost of cacheable items
+		Cost getMaxCost() const;
+
+		/// Returns the current cost of items held in the cache
+		Cost currentCost() const;
+
+		/// Retrieves the item from the cache, computing it if necessary. Throws if the item can not be
+		/// computed.
+		Ptr get( const Key &key );
+
+		/// Registers an object in the cache directly. Returns true for success and false on failure -
+		/// failure can occur if the cost exceeds the maximum cost for the cache.
+		bool set( const Key &key, const Ptr &data, Cost cost );
+
+		/// Returns true if the object is in the cache.
+		bool cached( const Key &key ) const;
+
+	protected:
+
+		typedef tbb::spin_rw_mutex Mutex;
+
+		enum Status
+		{
+			New, // brand new unpopulated entry
+			Caching, // unpopulated entry which is waiting for m_getter to return
+			Cached, // entry complete with value
+			Erased, // entry once had value but removed by limitCost
+			TooCostly, // entry cost exceeds m_maxCost and therefore isn't stored
+			Failed // m_getter failed when computing entry
+		};
+
+		struct CacheEntry;
+
+		typedef boost::unordered_map<Key, CacheEntry> Map;
+		typedef typename Map::value_type Item;
+		/// The items of a shard which are currently Cached, in the order visited by the clock hand.
+		typedef std::list<Item *> List;
+		typedef typename List::iterator ListIterator;
+
+		struct CacheEntry
+		{
+			CacheEntry();
+
+			Cost cost;
+			ListIterator listIterator;
+			tbb::atomic<Status> status;
+			tbb::atomic<bool> referenced;
+			Ptr data;
+		};
+
+		struct Shard
+		{
+			Shard();
+
+			mutable Mutex mutex;
+			Map map;
+			List list;
+			ListIterator hand;
+		};
+
+		enum
+		{
+			NumShards = 32
+		};
+
+		Shard &shard( const Key &key );
+		const Shard &shard( const Key &key ) const;
+
+		/// Stores the item in the shard, replacing any previous value. The shard must be locked for writing.
+		void insert( Shard &shard, Item &item, const Ptr &data, Cost cost );
+		/// Discards the value of the item if it is Cached. The shard must be locked for writing.
+		void discard( Shard &shard, Item &item, bool callRemovalCallback );
+
+		/// Clear out data using the CLOCK strategy until the current cost does not exceed the specified cost.
+		void limitCost( Cost cost );
+		/// Discards a single item not referenced since the clock hand last passed it. Returns false if
+		/// the cache is empty.
+		bool discardOne();
+
+		static void nullRemovalCallback( const Key &key, const Ptr &data );
+
+		GetterFunction m_getter;
+		RemovalCallback m_removalCallback;
+
+		tbb::atomic<Cost> m_maxCost;
+		tbb::atomic<Cost> m_currentCost;
+		tbb::atomic<size_t> m_clockShard;
+
+		Shard m_shards[NumShards];
+};
+
+} // namespace IECore
+
+#include "IECore/ShardedLRUCache.inl"
+
+#endif // IECORE_SHARDEDLRUCACHE_H
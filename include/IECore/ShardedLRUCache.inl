@@ -0,0 +1,369 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef IECORE_SHARDEDLRUCACHE_INL
+#define IECORE_SHARDEDLRUCACHE_INL
+
+#include <cassert>
+
+#include "tbb/tbb_thread.h"
+
+#include "boost/functional/hash.hpp"
+
+#include "IECore/Exception.h"
+
+namespace IECore
+{
+
+template<typename Key, typename Ptr>
+ShardedLRUCache<Key, Ptr>::CacheEntry::CacheEntry()
+	:	cost( 0 ), data()
+{
+	status = New;
+	referenced = false;
+}
+
+template<typename Key, typename Ptr>
+ShardedLRUCache<Key, Ptr>::Shard::Shard()
+{
+	hand = list.end();
+}
+
+template<typename Key, typename Ptr>
+ShardedLRUCache<Key, Ptr>::ShardedLRUCache( GetterFunction getter )
+	:	m_getter( getter ), m_removalCallback( nullRemovalCallback )
+{
+	m_maxCost = 500;
+	m_currentCost = 0;
+	m_clockShard = 0;
+}
+
+template<typename Key, typename Ptr>
+ShardedLRUCache<Key, Ptr>::ShardedLRUCache( GetterFunction getter, Cost maxCost )
+	:	m_getter( getter ), m_removalCallback( nullRemovalCallback )
+{
+	m_maxCost = maxCost;
+	m_currentCost = 0;
+	m_clockShard = 0;
+}
+
+template<typename Key, typename Ptr>
+ShardedLRUCache<Key, Ptr>::ShardedLRUCache( GetterFunction getter, RemovalCallback removalCallback, Cost maxCost )
+	:	m_getter( getter ), m_removalCallback( removalCallback )
+{
+	m_maxCost = maxCost;
+	m_currentCost = 0;
+	m_clockShard = 0;
+}
+
+template<typename Key, typename Ptr>
+ShardedLRUCache<Key, Ptr>::~ShardedLRUCache()
+{
+}
+
+template<typename Key, typename Ptr>
+void ShardedLRUCache<Key, Ptr>::clear()
+{
+	for( size_t i = 0; i < NumShards; ++i )
+	{
+		Shard &shard = m_shards[i];
+		typename Mutex::scoped_lock lock( shard.mutex, /* write = */ true );
+
+		// as in LRUCache, we don't remove the entries from the map, because threads
+		// waiting in get() hold references to them.
+		for( typename Map::iterator it = shard.map.begin(); it != shard.map.end(); ++it )
+		{
+			discard( shard, *it, true );
+			it->second.status = Erased;
+		}
+	}
+}
+
+template<typename Key, typename Ptr>
+void ShardedLRUCache<Key, Ptr>::setMaxCost( Cost maxCost )
+{
+	m_maxCost = maxCost;
+	limitCost( maxCost );
+}
+
+template<typename Key, typename Ptr>
+typename ShardedLRUCache<Key, Ptr>::Cost ShardedLRUCache<Key, Ptr>::getMaxCost() const
+{
+	return m_maxCost;
+}
+
+template<typename Key, typename Ptr>
+typename ShardedLRUCache<Key, Ptr>::Cost ShardedLRUCache<Key, Ptr>::currentCost() const
+{
+	return m_currentCost;
+}
+
+template<typename Key, typename Ptr>
+bool ShardedLRUCache<Key, Ptr>::cached( const Key &key ) const
+{
+	const Shard &shard = this->shard( key );
+	typename Mutex::scoped_lock lock( shard.mutex, /* write = */ false );
+	typename Map::const_iterator it = shard.map.find( key );
+	return ( it != shard.map.end() && it->second.status==Cached );
+}
+
+template<typename Key, typename Ptr>
+Ptr ShardedLRUCache<Key, Ptr>::get( const Key& key )
+{
+	Shard &shard = this->shard( key );
+
+	{
+		// fast path for cache hits, which only needs a shared lock.
+		typename Mutex::scoped_lock lock( shard.mutex, /* write = */ false );
+		typename Map::iterator it = shard.map.find( key );
+		if( it != shard.map.end() && it->second.status==Cached )
+		{
+			CacheEntry &cacheEntry = it->second;
+			if( !cacheEntry.referenced )
+			{
+				cacheEntry.referenced = true;
+			}
+			return cacheEntry.data;
+		}
+	}
+
+	typename Mutex::scoped_lock lock( shard.mutex, /* write = */ true );
+
+	// creates an entry if one doesn't exist yet. it is never removed from the map, so
+	// the reference remains valid while the lock is released.
+	CacheEntry &cacheEntry = shard.map[key];
+
+	while( cacheEntry.status==Caching )
+	{
+		// another thread is doing the work. we need to wait
+		// until it is done.
+		lock.release();
+			while( cacheEntry.status==Caching )
+			{
+				tbb::this_tbb_thread::yield();
+			}
+		lock.acquire( shard.mutex, /* write = */ true );
+	}
+
+	if( cacheEntry.status==New || cacheEntry.status==Erased || cacheEntry.status==TooCostly )
+	{
+		assert( cacheEntry.data==Ptr() );
+		Ptr data = Ptr();
+		Cost cost = 0;
+		try
+		{
+			cacheEntry.status = Caching;
+			lock.release(); // allows other threads to do stuff while we're computing the value
+				data = m_getter( key, cost );
+		}
+		catch( ... )
+		{
+			lock.acquire( shard.mutex, /* write = */ true );
+			cacheEntry.status = Failed;
+			throw;
+		}
+		set( key, data, cost );
+		return data;
+	}
+	else if( cacheEntry.status==Cached )
+	{
+		cacheEntry.referenced = true;
+		return cacheEntry.data;
+	}
+	else
+	{
+		assert( cacheEntry.status==Failed );
+		throw Exception( "Previous attempt to get item failed." );
+	}
+}
+
+template<typename Key, typename Ptr>
+bool ShardedLRUCache<Key, Ptr>::set( const Key &key, const Ptr &data, Cost cost )
+{
+	Shard &shard = this->shard( key );
+
+	if( cost > m_maxCost )
+	{
+		typename Mutex::scoped_lock lock( shard.mutex, /* write = */ true );
+		Item &item = *shard.map.insert( Item( key, CacheEntry() ) ).first;
+		discard( shard, item, false );
+		item.second.status = TooCostly;
+		return false;
+	}
+
+	// make room for the new item before locking the shard, because limitCost()
+	// needs to lock the shards itself.
+	limitCost( m_maxCost - cost );
+
+	typename Mutex::scoped_lock lock( shard.mutex, /* write = */ true );
+	Item &item = *shard.map.insert( Item( key, CacheEntry() ) ).first;
+	insert( shard, item, data, cost );
+
+	return true;
+}
+
+template<typename Key, typename Ptr>
+bool ShardedLRUCache<Key, Ptr>::erase( const Key &key )
+{
+	Shard &shard = this->shard( key );
+	typename Mutex::scoped_lock lock( shard.mutex, /* write = */ true );
+
+	typename Map::iterator it = shard.map.find( key );
+	if( it == shard.map.end() )
+	{
+		return false;
+	}
+
+	discard( shard, *it, true );
+	it->second.status = Erased;
+	return true;
+}
+
+template<typename Key, typename Ptr>
+typename ShardedLRUCache<Key, Ptr>::Shard &ShardedLRUCache<Key, Ptr>::shard( const Key &key )
+{
+	return m_shards[ boost::hash<Key>()( key ) % NumShards ];
+}
+
+template<typename Key, typename Ptr>
+const typename ShardedLRUCache<Key, Ptr>::Shard &ShardedLRUCache<Key, Ptr>::shard( const Key &key ) const
+{
+	return m_shards[ boost::hash<Key>()( key ) % NumShards ];
+}
+
+template<typename Key, typename Ptr>
+void ShardedLRUCache<Key, Ptr>::insert( Shard &shard, Item &item, const Ptr &data, Cost cost )
+{
+	discard( shard, item, false );
+
+	CacheEntry &cacheEntry = item.second;
+	cacheEntry.data = data;
+	cacheEntry.cost = cost;
+	cacheEntry.referenced = false;
+	// inserting just behind the hand means the new item is the last one to be visited.
+	cacheEntry.listIterator = shard.list.insert( shard.hand, &item );
+	cacheEntry.status = Cached;
+
+	m_currentCost += cost;
+}
+
+template<typename Key, typename Ptr>
+void ShardedLRUCache<Key, Ptr>::discard( Shard &shard, Item &item, bool callRemovalCallback )
+{
+	CacheEntry &cacheEntry = item.second;
+	if( cacheEntry.status!=Cached )
+	{
+		return;
+	}
+
+	if( callRemovalCallback )
+	{
+		m_removalCallback( item.first, cacheEntry.data );
+	}
+
+	if( shard.hand == cacheEntry.listIterator )
+	{
+		++shard.hand;
+	}
+	shard.list.erase( cacheEntry.listIterator );
+
+	m_currentCost -= cacheEntry.cost;
+	cacheEntry.cost = 0;
+	cacheEntry.data = Ptr();
+	cacheEntry.status = Erased;
+}
+
+template<typename Key, typename Ptr>
+void ShardedLRUCache<Key, Ptr>::limitCost( Cost cost )
+{
+	while( m_currentCost > cost )
+	{
+		if( !discardOne() )
+		{
+			break;
+		}
+	}
+}
+
+template<typename Key, typename Ptr>
+bool ShardedLRUCache<Key, Ptr>::discardOne()
+{
+	// the clock hand moves across the shards in turn, sweeping each one once. if a whole
+	// round finds only referenced items, their flags have been cleared by then and the
+	// next round will discard one.
+	while( true )
+	{
+		bool empty = true;
+		for( size_t i = 0; i < NumShards; ++i )
+		{
+			Shard &shard = m_shards[ m_clockShard.fetch_and_increment() % NumShards ];
+			typename Mutex::scoped_lock lock( shard.mutex, /* write = */ true );
+
+			empty = empty && shard.list.empty();
+			for( size_t n = shard.list.size(); n; --n )
+			{
+				if( shard.hand == shard.list.end() )
+				{
+					shard.hand = shard.list.begin();
+				}
+
+				Item &item = **shard.hand;
+				if( item.second.referenced )
+				{
+					item.second.referenced = false;
+					++shard.hand;
+				}
+				else
+				{
+					discard( shard, item, true );
+					return true;
+				}
+			}
+		}
+
+		if( empty )
+		{
+			return false;
+		}
+	}
+}
+
+template<typename Key, typename Ptr>
+void ShardedLRUCache<Key, Ptr>::nullRemovalCallback( const Key &key, const Ptr &data )
+{
+}
+
+} // namespace IECore
+
+#endif // IECORE_SHARDEDLRUCACHE_INL
@@ -39,6 +39,7 @@
 #include <iostream>
 #include <fstream>
 #include "tbb/recursive_mutex.h"
+#include "tbb/enumerable_thread_specific.h"
 #include "boost/optional.hpp"
 #include "boost/iostreams/filtering_stream.hpp"
 
@@ -50,7 +51,13 @@ namespace IECore
 {
 /// Abstract base class implementation of IndexedIO which operates with a stream file handle.
 /// It handles data instancing transparently for compact file sizes.
-/// Read operations are thread safe on read-only opened files.
+/// Read operations are thread safe on read-only opened files. Data is read with positional
+/// reads into per-thread buffers, and subindexes are decompressed without holding the file
+/// lock, so threads reading unrelated locations of the same file do not serialise. When the
+/// StreamFile provides a memory mapping of the file contents, data reads copy straight from
+/// the mapping. Write operations are thread safe as well, provided each thread writes to its
+/// own directories. The data is flattened, hashed and compressed by each thread, so only the
+/// index bookkeeping and the file writes are serialised.
 /// \ingroup ioGroup
 class StreamIndexedIO : public IndexedIO
 {
@@ -58,6 +65,18 @@ class StreamIndexedIO : public IndexedIO
 
 		IE_CORE_DECLARERUNTIMETYPED( StreamIndexedIO, IndexedIO );
 
+		/// Codecs available for compressing the blocks stored in the file.
+		/// The codec is recorded per block, so files can mix codecs freely.
+		enum Compression
+		{
+			NoCompression = 0,
+			/// The codec used by all files prior to version 6.
+			Gzip,
+			/// Zlib at its fastest compression level. Compresses and decompresses
+			/// several times faster than Gzip, at the cost of slightly larger blocks.
+			FastZlib
+		};
+
 		virtual ~StreamIndexedIO();
 
 		virtual IndexedIO::OpenMode openMode() const;
@@ -94,6 +113,23 @@ class StreamIndexedIO : public IndexedIO
 
 		void commit();
 
+		/// Loads the subindexes of the given entries and asks the StreamFile to prefetch
+		/// their data blocks, in the order they are stored in the file.
+		void prefetch( const std::vector<IndexedIO::EntryIDList> &paths ) const;
+
+		/// Sets the codec used for the main index and for the subindexes
+		/// committed from now on. The default is Gzip. The setting is shared
+		/// by all the directories of the file.
+		void setIndexCompression( Compression compression );
+		Compression getIndexCompression() const;
+
+		/// Sets the codec used for the data blocks of at least minSize bytes
+		/// written from now on. Blocks which don't shrink are stored raw. The
+		/// default is NoCompression. The setting is shared by all the directories
+		/// of the file.
+		void setDataCompression( Compression compression, size_t minSize = 4096 );
+		Compression getDataCompression() const;
+
 		void write(const IndexedIO::EntryID &name, const float *x, unsigned long arrayLength);
 		void write(const IndexedIO::EntryID &name, const double *x, unsigned long arrayLength);
 		void write(const IndexedIO::EntryID &name, const half *x, unsigned long arrayLength);
@@ -166,6 +202,17 @@ class StreamIndexedIO : public IndexedIO
 				void seekp( size_t pos, std::ios_base::seekdir dir );
 				void read( char *buffer, size_t size );
 				void write( const char *buffer, size_t size );
+
+				/// Reads size bytes starting at the given position, without using or affecting the
+				/// stream position. This is thread safe. The default implementation copies from the
+				/// mapped data if available, and otherwise locks the mutex, seeks and reads. Derived
+				/// classes may override it with a lock free implementation.
+				virtual void pread( char *buffer, size_t size, Imf::Int64 pos );
+
+				/// Hints that the given region of the file is going to be read soon. Derived
+				/// classes may start loading it in the background. The default implementation
+				/// does nothing.
+				virtual void prefetch( Imf::Int64 pos, Imf::Int64 size );
 				Imf::Int64 tellg();
 				Imf::Int64 tellp();
 
@@ -179,6 +226,17 @@ class StreamIndexedIO : public IndexedIO
 				// utility function that returns a temporary buffer for io operations (not thread safe).
 				char *ioBuffer( unsigned long size );
 
+				// utility function that returns a temporary buffer owned by the calling thread.
+				// The buffer remains valid until the next call from the same thread with the same slot.
+				// Two slots are available, so that data can be decompressed from one buffer into another.
+				char *threadBuffer( unsigned long size, unsigned int slot = 0 );
+
+				/// Returns a pointer to the given region of the file if the contents are memory mapped,
+				/// or 0 otherwise. The returned memory is read-only and valid for the lifetime of this object.
+				/// Access to mapped data does not require the mutex to be locked.
+				/// Throws an IOException if the region lies outside of the mapping.
+				const char *mappedData( Imf::Int64 pos, Imf::Int64 size ) const;
+
 				/// called after the main index is saved to disk, ready to close the file.
 				virtual void flush( size_t endPosition );
 
@@ -191,12 +249,25 @@ class StreamIndexedIO : public IndexedIO
 				// This function allocates and if in read-mode also reads the Index of the file.
 				void setStream( std::iostream *stream, bool emptyFile );
 
+				/// May be called by derived classes in Read mode to provide direct access to the
+				/// file contents. The derived class remains responsible for unmapping the memory.
+				void setMappedData( const char *data, size_t size );
+
 				IndexedIO::OpenMode m_openmode;
 				std::iostream *m_stream;
 				Mutex m_mutex;
 
+				const char *m_mappedData;
+				size_t m_mappedSize;
+
 				unsigned long m_ioBufferLen;
 				char *m_ioBuffer;
+
+				struct ThreadBuffers
+				{
+					std::vector<char> slots[2];
+				};
+				tbb::enumerable_thread_specific< ThreadBuffers > m_threadBuffers;
 		};
 		IE_CORE_DECLAREPTR( StreamFile );
 
@@ -36,6 +36,7 @@
 
 #include "IECore/ImageReader.h"
 #include "IECore/VectorTypedData.h"
+#include "IECore/NumericParameter.h"
 
 // forward declaration
 struct tiff;
@@ -66,6 +67,11 @@ namespace IECore
 /// TIFFTAG_XPOSITION<br>
 /// TIFFTAG_YPOSITION<br>
 ///
+/// Only the tiles or strips which overlap the requested data window are decoded.
+/// Mipmapped files such as tdl textures store each level in its own directory, and the
+/// "mipLevel" parameter may be used to choose a lower resolution level - it is added to
+/// the directory index specified with setDirectory().
+///
 /// \ingroup ioGroup
 class TIFFImageReader : public ImageReader
 {
@@ -86,7 +92,7 @@ class TIFFImageReader : public ImageReader
 		unsigned int numDirectories();
 
 		/// Sets the index of the directory we want to read from the TIFF file. By default we read out the first directory
-		/// present.
+		/// present. Note that the "mipLevel" parameter is added to this index to give the directory which is actually read.
 		void setDirectory( unsigned int directoryIndex );
 
 		//! @name ImageReader interface
@@ -106,6 +112,8 @@ class TIFFImageReader : public ImageReader
 		// filename associator
 		static const ReaderDescription<TIFFImageReader> m_readerDescription;
 
+		void constructParameters();
+
 		/// Opens the file, if necessary, and determines the number of directories present, returning true on success
 		/// and false on failure. On success, the m_tiffImage and m_numDirectories data members will be valid.
 		/// If throwOnFailure is true then a descriptive Exception is thrown rather than false being returned.
@@ -125,13 +133,16 @@ class TIFFImageReader : public ImageReader
 		std::string m_tiffImageFileName;
 
 		unsigned int m_currentDirectoryIndex;
+		IntParameterPtr m_mipLevelParameter;
 		unsigned int m_numDirectories;
 		bool m_haveDirectory;
 
 		std::vector<unsigned char> m_buffer;
+		Imath::Box2i m_bufferWindow;
 
-		// Reads the interlaced data from the current directory into the buffer
-		void readBuffer();
+		// Reads the interlaced data for the specified region of the current directory into the buffer,
+		// decoding only the tiles or strips which overlap it.
+		void readBuffer( const Imath::Box2i &region );
 
 		Imath::Box2i m_displayWindow;
 		Imath::Box2i m_dataWindow;
@@ -0,0 +1,82 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef IE_CORE_TABULATEDDATACONVERSION_H
+#define IE_CORE_TABULATEDDATACONVERSION_H
+
+#include <vector>
+
+#include "boost/static_assert.hpp"
+
+#include "IECore/TypeTraits.h"
+#include "IECore/DataConversion.h"
+
+namespace IECore
+{
+
+/// A conversion which precomputes the result of another conversion for every
+/// possible input value, and then performs lookups into the resulting table. This
+/// is only possible for the TypeTraits::IsTabulatable input types, and is only
+/// worthwhile when the wrapped conversion is expensive and the number of values to
+/// be converted exceeds the size of the table. DataConvert uses it automatically
+/// for conversions marked with IsExpensive.
+template<typename C>
+class TabulatedDataConversion : public DataConversion< typename C::FromType, typename C::ToType >
+{
+	public:
+
+		typedef typename C::FromType FromType;
+		typedef typename C::ToType ToType;
+
+		BOOST_STATIC_ASSERT( TypeTraits::IsTabulatable<FromType>::value );
+
+		/// The number of entries in the table.
+		static const size_t tableSize = size_t( 1 ) << ( sizeof( FromType ) * 8 );
+
+		/// Tabulates the results of the given conversion.
+		TabulatedDataConversion( const C &c = C() );
+
+		/// Perform the conversion
+		ToType operator()( FromType f ) const;
+
+	private:
+
+		std::vector<ToType> m_table;
+};
+
+} // namespace IECore
+
+#include "IECore/TabulatedDataConversion.inl"
+
+#endif // IE_CORE_TABULATEDDATACONVERSION_H
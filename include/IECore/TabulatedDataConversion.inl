@@ -0,0 +1,96 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef IE_CORE_TABULATEDDATACONVERSION_INL
+#define IE_CORE_TABULATEDDATACONVERSION_INL
+
+#include "boost/type_traits/make_unsigned.hpp"
+
+namespace IECore
+{
+
+namespace Detail
+{
+
+// Functions mapping between the possible input values and their indices in the table.
+
+template<typename F>
+inline size_t tabulatedIndex( F f )
+{
+	return static_cast<typename boost::make_unsigned<F>::type>( f );
+}
+
+inline size_t tabulatedIndex( half f )
+{
+	return f.bits();
+}
+
+template<typename F>
+inline F tabulatedValue( size_t index )
+{
+	return static_cast<F>( static_cast<typename boost::make_unsigned<F>::type>( index ) );
+}
+
+template<>
+inline half tabulatedValue<half>( size_t index )
+{
+	half result;
+	result.setBits( index );
+	return result;
+}
+
+} // namespace Detail
+
+template<typename C>
+const size_t TabulatedDataConversion<C>::tableSize;
+
+template<typename C>
+TabulatedDataConversion<C>::TabulatedDataConversion( const C &c )
+	:	m_table( tableSize )
+{
+	for( size_t i = 0; i < tableSize; ++i )
+	{
+		m_table[i] = c( Detail::tabulatedValue<FromType>( i ) );
+	}
+}
+
+template<typename C>
+inline typename TabulatedDataConversion<C>::ToType TabulatedDataConversion<C>::operator()( FromType f ) const
+{
+	return m_table[Detail::tabulatedIndex( f )];
+}
+
+} // namespace IECore
+
+#endif // IE_CORE_TABULATEDDATACONVERSION_INL
@@ -47,6 +47,10 @@ namespace IECore
 /// A MeshPrimitiveOp to perform triangulation of MeshPrimitives.
 /// \todo Currently we just do a simple "fan" across the face, but we eventually need
 /// to deal with concave polygons, polgons with holes, and non-planar polygons
+/// The fan depends only on the mesh topology, so it is taken from the cached
+/// MeshTopology triangle tables, and the primitive variables are then remapped
+/// in parallel. Meshes sharing a topology, such as the frames of a deforming
+/// mesh, only pay for computing the fan once.
 /// \ingroup geometryProcessingGroup
 class TriangulateOp : public TypedPrimitiveOp<MeshPrimitive>
 {
@@ -287,6 +287,14 @@ template< typename T > struct IsInterpolableSimpleTypedData : boost::mpl::and_<
 /// IsStrictlyInterpolableSimpleTypedData
 template< typename T > struct IsStrictlyInterpolableSimpleTypedData : boost::mpl::and_< IsSimpleTypedData<T>, IsStrictlyInterpolable< typename ValueType<T>::type > > {};
 
+/// IsTabulatable
+/// This represents the types with few enough distinct values that a function of them can be precomputed for every
+/// possible input, as done by TabulatedDataConversion - 8 and 16 bit integers, and half.
+template< typename T > struct IsTabulatable : boost::mpl::or_<
+	boost::mpl::and_< boost::is_integral<T>, boost::mpl::not_< boost::is_same<T, bool> >, boost::mpl::bool_< sizeof( T ) <= 2 > >,
+	boost::is_same< typename boost::remove_cv<T>::type, half >
+> {};
+
 /// IsSpline
 template<typename T, typename U = void > struct IsSpline : public boost::false_type {};
 template<typename T, typename U> struct IsSpline< Spline<T, U> > : public boost::true_type {};
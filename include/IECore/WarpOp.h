@@ -46,12 +46,16 @@ namespace IECore
 /// The display window does not change in this process, but the data window may change.
 /// The mapping is determined by the derived classes. The base class is responsible for resizing the
 /// data window and applying filter on the colors based on the floating point positions returned by warp method.
+/// The output is processed in tiles, in parallel. The warped positions and filter weights for a tile are computed
+/// once and then used to resample every channel, and the filters are evaluated separably in x and y.
 /// \ingroup imageProcessingGroup
 class WarpOp : public ImagePrimitiveOp
 {
 	public:
 
-		enum FilterType { None = 0, Bilinear, TypeCount };
+		/// Cubic uses a Catmull-Rom spline over 4x4 pixels, and Lanczos a 3 lobed
+		/// Lanczos window over 6x6 pixels.
+		enum FilterType { None = 0, Bilinear, Cubic, Lanczos, TypeCount };
 
 		WarpOp( const std::string &description );
 		virtual ~WarpOp();
@@ -77,7 +81,8 @@ class WarpOp : public ImagePrimitiveOp
 		/// Called once per element (pixel for ImagePrimitives).
 		/// Must be implemented by subclasses to determine where the color will come from.
 		/// The returned coordinate is on pixel space of the input image and the given V2f coordinates are on the
-		/// output image pixel space.
+		/// output image pixel space. This is called concurrently from several threads, so implementations must be
+		/// threadsafe.
 		virtual Imath::V2f warp( const Imath::V2f &p ) const = 0;
 		/// Called once per operation, after all calls to transform() have been made. This is
 		/// an opportunity to perform any cleanup necessary.
@@ -87,8 +92,10 @@ class WarpOp : public ImagePrimitiveOp
 
 		IntParameterPtr m_filterParameter;
 
-		struct Warp;
-		friend class Warp;
+		struct Channel;
+		class Tile;
+		struct ResampleTile;
+		struct AllocateChannel;
 };
 
 IE_CORE_DECLAREPTR( WarpOp );
@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2014, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef IECORE_PARALLELDATACONVERSION_H
+#define IECORE_PARALLELDATACONVERSION_H
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+
+namespace IECore
+{
+namespace Detail
+{
+
+/// A functor for use with despatchTypedData, which converts the elements of
+/// vector TypedData in place, in parallel, using a Conversion< V, V > where V
+/// is the element type. Used by the color space ChannelOps.
+template<template<typename, typename> class Conversion>
+struct ParallelDataConversion
+{
+	typedef void ReturnType;
+
+	template<typename T>
+	ReturnType operator()( T * data )
+	{
+		typedef typename T::ValueType Container;
+		Container &values = data->writable();
+		tbb::parallel_for( tbb::blocked_range<size_t>( 0, values.size(), 1024 ), Transform<Container>( values ) );
+	}
+
+	template<typename Container>
+	struct Transform
+	{
+		Transform( Container &values )
+			:	m_values( values )
+		{
+		}
+
+		void operator()( const tbb::blocked_range<size_t> &range ) const
+		{
+			typedef typename Container::value_type V;
+			Conversion< V, V > converter;
+			for( size_t i = range.begin(); i != range.end(); ++i )
+			{
+				m_values[i] = converter( m_values[i] );
+			}
+		}
+
+		Container &m_values;
+	};
+};
+
+} // namespace Detail
+} // namespace IECore
+
+#endif // IECORE_PARALLELDATACONVERSION_H
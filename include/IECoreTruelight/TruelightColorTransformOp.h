@@ -75,6 +75,9 @@ class TruelightColorTransformOp : public IECore::ColorTransformOp
 
 		virtual void begin( const IECore::CompoundObject * operands );
 		virtual void transform( Imath::Color3f &color ) const;
+		/// Returns false, as we don't know that the truelight instance can
+		/// be used from several threads at once.
+		virtual bool isTransformThreadSafe() const;
 
 	private :
 
@@ -36,6 +36,7 @@
 #include "IECore/TypeTraits.h"
 #include "IECore/DespatchTypedData.h"
 #include "IECore/AlexaLogcToLinearDataConversion.h"
+#include "IECore/private/ParallelDataConversion.h"
 
 using namespace IECore;
 using namespace std;
@@ -54,23 +55,8 @@ AlexaLogcToLinearOp::~AlexaLogcToLinearOp()
 {
 }
 
-struct AlexaLogcToLinearOp::Converter
+struct AlexaLogcToLinearOp::Converter : public Detail::ParallelDataConversion<AlexaLogcToLinearDataConversion>
 {
-	typedef void ReturnType;
-
-	template<typename T>
-	ReturnType operator()( T * data )
-	{
-		typedef typename T::ValueType Container;
-		typedef typename Container::value_type V;
-		typedef typename Container::iterator It;
-		AlexaLogcToLinearDataConversion< V, V > converter;
-		It end = data->writable().end();
-		for ( It it = data->writable().begin(); it != end; it++ )
-		{
-			*it = converter( *it );
-		}
-	}
 };
 
 void AlexaLogcToLinearOp::modifyChannels( const Imath::Box2i &displayWindow, const Imath::Box2i &dataWindow, ChannelVector &channels )
@@ -56,6 +56,59 @@ using namespace boost;
 
 IE_CORE_DEFINERUNTIMETYPED( ColorSpaceTransformOp );
 
+typedef std::vector< std::vector< std::string > > ChannelSets;
+
+/// Applies a run of consecutive ColorTransformOps from a conversion in a single pass
+/// over each set of channels, rather than a pass per op.
+static void transformColors( std::vector<ColorTransformOpPtr> &ops, ImagePrimitive *image, const ChannelSets &channelSets, const StringParameter *alphaPrimVarParameter, const BoolParameter *premultipliedParameter )
+{
+	if( !ops.size() )
+	{
+		return;
+	}
+
+	std::vector<ColorTransformOp *> chain;
+	for ( std::vector<ColorTransformOpPtr>::const_iterator it = ops.begin(); it != ops.end(); ++it )
+	{
+		ColorTransformOp *op = it->get();
+		op->inputParameter()->setValue( image );
+		op->copyParameter()->setTypedValue( false );
+
+		op->alphaPrimVarParameter()->setTypedValue( alphaPrimVarParameter->getTypedValue() );
+		op->premultipliedParameter()->setTypedValue( premultipliedParameter->getTypedValue() );
+
+		chain.push_back( op );
+	}
+
+	// ColorTransformOp::transformChain() uses the primitive variable names from the first op
+	ColorTransformOp *op = chain[0];
+	for ( ChannelSets::const_iterator it = channelSets.begin(); it != channelSets.end(); ++it )
+	{
+		if ( it->size() == 1 )
+		{
+			op->colorPrimVarParameter()->setTypedValue( (*it)[0] );
+
+			op->redPrimVarParameter()->setValue( op->redPrimVarParameter()->defaultValue()->copy() );
+			op->greenPrimVarParameter()->setValue( op->greenPrimVarParameter()->defaultValue()->copy() );
+			op->bluePrimVarParameter()->setValue( op->bluePrimVarParameter()->defaultValue()->copy() );
+		}
+		else
+		{
+			assert( it->size() == 3 );
+
+			op->redPrimVarParameter()->setTypedValue( (*it)[0] );
+			op->greenPrimVarParameter()->setTypedValue( (*it)[1] );
+			op->bluePrimVarParameter()->setTypedValue( (*it)[2] );
+
+			op->colorPrimVarParameter()->setValue( op->colorPrimVarParameter()->defaultValue()->copy() );
+
+		}
+		ColorTransformOp::transformChain( chain, image );
+	}
+
+	ops.clear();
+}
+
 ColorSpaceTransformOp::ColorSpaceTransformOp()
 	:	ImagePrimitiveOp( "Converts channels from one named colorspace to another. Additional colorspaces can be registered at runtime." )
 {
@@ -333,7 +386,6 @@ void ColorSpaceTransformOp::modifyTypedPrimitive( ImagePrimitive * image, const
 	}
 
 	std::vector< std::string > channelNames;
-	typedef std::vector< std::vector< std::string > > ChannelSets;
 	ChannelSets channelSets;
 	std::vector< std::string > channels;
 
@@ -378,6 +430,8 @@ void ColorSpaceTransformOp::modifyTypedPrimitive( ImagePrimitive * image, const
 		}
 	}
 
+	std::vector<ColorTransformOpPtr> colorTransforms;
+
 	bool first = true;
 	ConversionInfo previous;
 	std::vector< ConversionInfo >::const_iterator it = conversions.begin();
@@ -404,6 +458,17 @@ void ColorSpaceTransformOp::modifyTypedPrimitive( ImagePrimitive * image, const
 			throw InvalidArgumentException( ( boost::format( "ColorSpaceTransformOp: '%s' to '%s' conversion registered unsupported Op type '%s'" ) % inputColorSpace % outputColorSpace % currentConversion->typeName()).str() );
 		}
 
+		if ( currentConversion->isInstanceOf( ColorTransformOpTypeId ) )
+		{
+			// defer the transform, so that consecutive ColorTransformOps
+			// can be applied in a single pass over the image.
+			colorTransforms.push_back( assertedStaticCast< ColorTransformOp >( currentConversion ) );
+			previous = current;
+			continue;
+		}
+
+		transformColors( colorTransforms, image, channelSets, alphaPrimVarParameter(), premultipliedParameter() );
+
 		currentConversion->inputParameter()->setValue( image );
 		currentConversion->copyParameter()->setTypedValue( false );
 
@@ -445,43 +510,6 @@ void ColorSpaceTransformOp::modifyTypedPrimitive( ImagePrimitive * image, const
 				}
 			}
 		}
-		else
-		{
-			assert( currentConversion->isInstanceOf( ColorTransformOpTypeId ) );
-
-			ColorTransformOpPtr op = dynamicPointerCast< ColorTransformOp >( currentConversion );
-
-			for ( ChannelSets::const_iterator it = channelSets.begin(); it != channelSets.end(); ++it )
-			{
-				op->inputParameter()->setValue( image );
-				op->copyParameter()->setTypedValue( false );
-
-				op->alphaPrimVarParameter()->setValue( alphaPrimVarParameter()->getValue() );
-				op->premultipliedParameter()->setValue( premultipliedParameter()->getValue() );
-
-				if ( it->size() == 1 )
-				{
-					op->colorPrimVarParameter()->setTypedValue( (*it)[0] );
-
-					op->redPrimVarParameter()->setValue( op->redPrimVarParameter()->defaultValue()->copy() );
-					op->greenPrimVarParameter()->setValue( op->greenPrimVarParameter()->defaultValue()->copy() );
-					op->bluePrimVarParameter()->setValue( op->bluePrimVarParameter()->defaultValue()->copy() );
-				}
-				else
-				{
-					assert( it->size() == 3 );
-
-					op->redPrimVarParameter()->setTypedValue( (*it)[0] );
-					op->greenPrimVarParameter()->setTypedValue( (*it)[1] );
-					op->bluePrimVarParameter()->setTypedValue( (*it)[2] );
-
-					op->colorPrimVarParameter()->setValue( op->colorPrimVarParameter()->defaultValue()->copy() );
-
-				}
-				result = runTimeCast< ImagePrimitive >( op->operate() );
-				assert( result.get() == image );
-			}
-		}
 
 		assert( result.get() == image );
 		( void ) result;
@@ -489,6 +517,9 @@ void ColorSpaceTransformOp::modifyTypedPrimitive( ImagePrimitive * image, const
 		previous = current;
 
 	}
+
+	transformColors( colorTransforms, image, channelSets, alphaPrimVarParameter(), premultipliedParameter() );
+
 	assert( current.get<2>() == outputColorSpace );
 }
 
@@ -32,6 +32,11 @@
 //
 //////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+
 #include "IECore/ColorTransformOp.h"
 #include "IECore/CompoundObject.h"
 #include "IECore/CompoundParameter.h"
@@ -44,6 +49,16 @@ using namespace Imath;
 
 IE_CORE_DEFINERUNTIMETYPED( ColorTransformOp );
 
+/// The number of colors passed to each call to transformBatch(). This is
+/// small enough for the batch and alpha to stay in the L1 cache while every
+/// op in a chain is applied to it.
+static const size_t g_batchSize = 512;
+
+ColorTransformOp::Stage::Stage( ColorTransformOp *o, const CompoundObject *a )
+	:	op( o ), operands( a )
+{
+}
+
 ColorTransformOp::ColorTransformOp( const std::string &description )
 	:	PrimitiveOp( description )
 {
@@ -198,88 +213,242 @@ const typename T::BaseType *ColorTransformOp::alphaData( Primitive * primitive,
 	return d->baseReadable();
 }
 
-template <typename T>
-void ColorTransformOp::transformSeparate( Primitive * primitive, const CompoundObject * operands, T * r, T * g, T * b )
+template<typename T>
+class ColorTransformOp::SeparateTransform
 {
-	size_t n = r->baseSize();
-	const typename T::BaseType *alpha = alphaData<T>( primitive, n );
 
-	typename T::BaseType *rw = r->baseWritable();
-	typename T::BaseType *gw = g->baseWritable();
-	typename T::BaseType *bw = b->baseWritable();
+	public :
+
+		SeparateTransform( const Chain &chain, T *r, T *g, T *b, const T *alpha )
+			:	m_chain( chain ), m_r( r ), m_g( g ), m_b( b ), m_alpha( alpha )
+		{
+		}
+
+		void operator()( const tbb::blocked_range<size_t> &range ) const
+		{
+			float r[g_batchSize];
+			float g[g_batchSize];
+			float b[g_batchSize];
+			float alpha[g_batchSize];
+
+			for( size_t batchBegin = range.begin(); batchBegin < range.end(); batchBegin += g_batchSize )
+			{
+				const size_t n = std::min( g_batchSize, range.end() - batchBegin );
+				for( size_t i = 0; i < n; i++ )
+				{
+					r[i] = m_r[batchBegin+i];
+					g[i] = m_g[batchBegin+i];
+					b[i] = m_b[batchBegin+i];
+				}
+				if( m_alpha )
+				{
+					for( size_t i = 0; i < n; i++ )
+					{
+						alpha[i] = m_alpha[batchBegin+i];
+					}
+				}
+
+				transformBatch( m_chain, r, g, b, m_alpha ? alpha : 0, n );
+
+				for( size_t i = 0; i < n; i++ )
+				{
+					m_r[batchBegin+i] = r[i];
+					m_g[batchBegin+i] = g[i];
+					m_b[batchBegin+i] = b[i];
+				}
+			}
+		}
+
+	private :
 
-	begin( operands );
+		const Chain &m_chain;
+		T *m_r;
+		T *m_g;
+		T *m_b;
+		const T *m_alpha;
 
-	try
+};
+
+template<typename T>
+class ColorTransformOp::InterleavedTransform
+{
+
+	public :
+
+		InterleavedTransform( const Chain &chain, T *colors, const T *alpha )
+			:	m_chain( chain ), m_colors( colors ), m_alpha( alpha )
+		{
+		}
+
+		void operator()( const tbb::blocked_range<size_t> &range ) const
+		{
+			float r[g_batchSize];
+			float g[g_batchSize];
+			float b[g_batchSize];
+			float alpha[g_batchSize];
+
+			for( size_t batchBegin = range.begin(); batchBegin < range.end(); batchBegin += g_batchSize )
+			{
+				const size_t n = std::min( g_batchSize, range.end() - batchBegin );
+				const T *c = m_colors + batchBegin * 3;
+				for( size_t i = 0; i < n; i++ )
+				{
+					r[i] = c[i*3];
+					g[i] = c[i*3+1];
+					b[i] = c[i*3+2];
+				}
+				if( m_alpha )
+				{
+					for( size_t i = 0; i < n; i++ )
+					{
+						alpha[i] = m_alpha[batchBegin+i];
+					}
+				}
+
+				transformBatch( m_chain, r, g, b, m_alpha ? alpha : 0, n );
+
+				T *cw = m_colors + batchBegin * 3;
+				for( size_t i = 0; i < n; i++ )
+				{
+					cw[i*3] = r[i];
+					cw[i*3+1] = g[i];
+					cw[i*3+2] = b[i];
+				}
+			}
+		}
+
+	private :
+
+		const Chain &m_chain;
+		T *m_colors;
+		const T *m_alpha;
+
+};
+
+void ColorTransformOp::transformBatch( const Chain &chain, float *r, float *g, float *b, const float *alpha, size_t n )
+{
+	for( Chain::const_iterator it = chain.begin(); it != chain.end(); ++it )
 	{
-		for( size_t i=0; i<n; i++ )
+		// we unpremultiply and premultiply around every op rather than around
+		// the whole chain, so that we match the results of applying the ops
+		// one at a time exactly.
+		if( alpha )
 		{
-			Color3f c( *rw, *gw, *bw );
-			if( alpha && *alpha > 0 )
+			for( size_t i = 0; i < n; i++ )
 			{
-				c /= *alpha;
+				if( alpha[i] > 0 )
+				{
+					r[i] /= alpha[i];
+					g[i] /= alpha[i];
+					b[i] /= alpha[i];
+				}
 			}
-			transform( c );
-			if( alpha )
+		}
+
+		it->op->transformBatch( r, g, b, n );
+
+		if( alpha )
+		{
+			for( size_t i = 0; i < n; i++ )
 			{
-				c *= *alpha++;
+				r[i] *= alpha[i];
+				g[i] *= alpha[i];
+				b[i] *= alpha[i];
 			}
-			
-			*rw++ = c[0];
-			*gw++ = c[1];
-			*bw++ = c[2];
+		}
+	}
+}
+
+template<typename F>
+void ColorTransformOp::transformChainData( const Chain &chain, size_t numColors, const F &functor )
+{
+	bool threadSafe = true;
+	for( Chain::const_iterator it = chain.begin(); it != chain.end(); ++it )
+	{
+		threadSafe = threadSafe && it->op->isTransformThreadSafe();
+	}
+
+	size_t numBegun = 0;
+	try
+	{
+		for( ; numBegun < chain.size(); numBegun++ )
+		{
+			chain[numBegun].op->begin( chain[numBegun].operands );
+		}
+
+		tbb::blocked_range<size_t> range( 0, numColors, g_batchSize );
+		if( threadSafe )
+		{
+			tbb::parallel_for( range, functor );
+		}
+		else
+		{
+			functor( range );
 		}
 	}
 	catch ( ... )
 	{
-		end();
+		// end() must be called for every op which began successfully,
+		// even if the transform throws.
+		for( size_t i = 0; i < numBegun; i++ )
+		{
+			chain[i].op->end();
+		}
 		throw;
 	}
 
-	end();
+	for( Chain::const_iterator it = chain.begin(); it != chain.end(); ++it )
+	{
+		it->op->end();
+	}
+}
+
+template <typename T>
+void ColorTransformOp::transformSeparate( const Chain &chain, Primitive * primitive, T * r, T * g, T * b )
+{
+	size_t n = r->baseSize();
+	const typename T::BaseType *alpha = alphaData<T>( primitive, n );
+
+	SeparateTransform<typename T::BaseType> functor( chain, r->baseWritable(), g->baseWritable(), b->baseWritable(), alpha );
+	transformChainData( chain, n, functor );
 }
 
 template<typename T>
-void ColorTransformOp::transformInterleaved( Primitive * primitive, const CompoundObject * operands, T * colors )
+void ColorTransformOp::transformInterleaved( const Chain &chain, Primitive * primitive, T * colors )
 {
 	assert( colors->baseSize() %3 == 0 );
 	size_t numElements = colors->baseSize() / 3;
 
 	const typename T::BaseType *alpha = alphaData<TypedData<std::vector<typename T::BaseType> > >( primitive, numElements );
 
-	begin( operands );
-	try
-	{
+	InterleavedTransform<typename T::BaseType> functor( chain, colors->baseWritable(), alpha );
+	transformChainData( chain, numElements, functor );
+}
 
-		size_t i = 0;
-		typename T::BaseType *data = colors->baseWritable();
-		for( i=0; i<numElements; i++ )
+void ColorTransformOp::transformChain( const std::vector<ColorTransformOp *> &ops, Primitive *primitive )
+{
+	Chain chain;
+	for( std::vector<ColorTransformOp *>::const_iterator it = ops.begin(); it != ops.end(); ++it )
+	{
+		if( (*it)->enableParameter()->getTypedValue() )
 		{
-			Color3f c( data[0], data[1], data[2] );
-			if( alpha && *alpha > 0 )
-			{
-				c /= *alpha;
-			}
-			transform( c );
-			if( alpha )
-			{
-				c *= *alpha++;
-			}
-			*data++ = c[0];
-			*data++ = c[1];
-			*data++ = c[2];
+			chain.push_back( Stage( *it, (*it)->parameters()->getTypedValidatedValue<CompoundObject>() ) );
 		}
 	}
-	catch ( ... )
+
+	if( chain.size() )
 	{
-		end();
-		throw;
+		ops[0]->transformPrimitive( chain, primitive );
 	}
-
-	end();
 }
 
 void ColorTransformOp::modifyPrimitive( Primitive * primitive, const CompoundObject * operands )
+{
+	Chain chain( 1, Stage( this, operands ) );
+	transformPrimitive( chain, primitive );
+}
+
+void ColorTransformOp::transformPrimitive( const Chain &chain, Primitive * primitive )
 {
 	PrimitiveVariableMap::iterator colorIt = primitive->variables.find( m_colorPrimVarParameter->getTypedValue() );
 	if( colorIt!=primitive->variables.end() && colorIt->second.data )
@@ -288,16 +457,16 @@ void ColorTransformOp::modifyPrimitive( Primitive * primitive, const CompoundObj
 		switch( colorIt->second.data->typeId() )
 		{
 			case Color3fDataTypeId :
-				transformInterleaved<Color3fData>( primitive, operands, staticPointerCast<Color3fData>( colorIt->second.data ) );
+				transformInterleaved<Color3fData>( chain, primitive, staticPointerCast<Color3fData>( colorIt->second.data ) );
 				break;
 			case Color3fVectorDataTypeId :
-				transformInterleaved<Color3fVectorData>( primitive, operands, staticPointerCast<Color3fVectorData>( colorIt->second.data ) );
+				transformInterleaved<Color3fVectorData>( chain, primitive, staticPointerCast<Color3fVectorData>( colorIt->second.data ) );
 				break;
 			case Color3dDataTypeId :
-				transformInterleaved<Color3dData>( primitive, operands, staticPointerCast<Color3dData>( colorIt->second.data ) );
+				transformInterleaved<Color3dData>( chain, primitive, staticPointerCast<Color3dData>( colorIt->second.data ) );
 				break;
 			case Color3dVectorDataTypeId :
-				transformInterleaved<Color3dVectorData>( primitive, operands, staticPointerCast<Color3dVectorData>( colorIt->second.data ) );
+				transformInterleaved<Color3dVectorData>( chain, primitive, staticPointerCast<Color3dVectorData>( colorIt->second.data ) );
 				break;
 			default :
 				throw Exception( "PrimitiveVariable has unsupported type." );
@@ -323,8 +492,8 @@ void ColorTransformOp::modifyPrimitive( Primitive * primitive, const CompoundObj
 		{
 			case HalfDataTypeId :
 				transformSeparate<HalfData>(
+					chain,
 					primitive,
-					operands,
 					staticPointerCast<HalfData>( rIt->second.data ),
 					staticPointerCast<HalfData>( gIt->second.data ),
 					staticPointerCast<HalfData>( bIt->second.data )
@@ -332,8 +501,8 @@ void ColorTransformOp::modifyPrimitive( Primitive * primitive, const CompoundObj
 				break;
 			case HalfVectorDataTypeId :
 				transformSeparate<HalfVectorData>(
+					chain,
 					primitive,
-					operands,
 					staticPointerCast<HalfVectorData>( rIt->second.data ),
 					staticPointerCast<HalfVectorData>( gIt->second.data ),
 					staticPointerCast<HalfVectorData>( bIt->second.data )
@@ -341,8 +510,8 @@ void ColorTransformOp::modifyPrimitive( Primitive * primitive, const CompoundObj
 				break;
 			case FloatDataTypeId :
 				transformSeparate<FloatData>(
+					chain,
 					primitive,
-					operands,
 					staticPointerCast<FloatData>( rIt->second.data ),
 					staticPointerCast<FloatData>( gIt->second.data ),
 					staticPointerCast<FloatData>( bIt->second.data )
@@ -350,8 +519,8 @@ void ColorTransformOp::modifyPrimitive( Primitive * primitive, const CompoundObj
 				break;
 			case FloatVectorDataTypeId :
 				transformSeparate<FloatVectorData>(
+					chain,
 					primitive,
-					operands,
 					staticPointerCast<FloatVectorData>( rIt->second.data ),
 					staticPointerCast<FloatVectorData>( gIt->second.data ),
 					staticPointerCast<FloatVectorData>( bIt->second.data )
@@ -369,6 +538,23 @@ void ColorTransformOp::begin( const CompoundObject * operands )
 {
 }
 
+void ColorTransformOp::transformBatch( float *red, float *green, float *blue, size_t numColors ) const
+{
+	for( size_t i = 0; i < numColors; i++ )
+	{
+		Color3f c( red[i], green[i], blue[i] );
+		transform( c );
+		red[i] = c[0];
+		green[i] = c[1];
+		blue[i] = c[2];
+	}
+}
+
+bool ColorTransformOp::isTransformThreadSafe() const
+{
+	return true;
+}
+
 void ColorTransformOp::end()
 {
 }
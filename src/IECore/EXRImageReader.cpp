@@ -39,6 +39,7 @@
 #include "IECore/VectorTypedData.h"
 #include "IECore/ImagePrimitive.h"
 #include "IECore/FileNameParameter.h"
+#include "IECore/CompoundParameter.h"
 #include "IECore/BoxOps.h"
 #include "IECore/MessageHandler.h"
 #include "IECore/DataConvert.h"
@@ -47,10 +48,15 @@
 
 #include "boost/format.hpp"
 
+#include "tbb/atomic.h"
+#include "tbb/task_scheduler_init.h"
+
 #include "OpenEXR/ImfInputFile.h"
+#include "OpenEXR/ImfTiledInputFile.h"
 #include "OpenEXR/ImfChannelList.h"
 #include "OpenEXR/Iex.h"
 #include "OpenEXR/ImfTestFile.h"
+#include "OpenEXR/ImfThreading.h"
 #include "OpenEXR/ImfFloatAttribute.h"
 #include "OpenEXR/ImfDoubleAttribute.h"
 #include "OpenEXR/ImfIntAttribute.h"
@@ -75,22 +81,39 @@ IE_CORE_DEFINERUNTIMETYPED( EXRImageReader );
 
 const Reader::ReaderDescription<EXRImageReader> EXRImageReader::g_readerDescription("exr");
 
+static tbb::atomic<bool> g_numThreadsInitialised;
+
 EXRImageReader::EXRImageReader() :
 		ImageReader( "Reads ILM OpenEXR file format." ),
-		m_inputFile( 0 )
+		m_inputFile( 0 ), m_tiledInputFile( 0 )
 {
+	constructParameters();
 }
 
 EXRImageReader::EXRImageReader(const string &fileName) :
 		ImageReader( "Reads ILM OpenEXR file format." ),
-		m_inputFile( 0 )
+		m_inputFile( 0 ), m_tiledInputFile( 0 )
 {
 	m_fileNameParameter->setTypedValue( fileName );
+	constructParameters();
 }
 
 EXRImageReader::~EXRImageReader()
 {
 	delete m_inputFile;
+	delete m_tiledInputFile;
+}
+
+void EXRImageReader::constructParameters()
+{
+	m_mipLevelParameter = new IntParameter(
+		"mipLevel",
+		"The resolution level to read from mipmapped and ripmapped files, where 0 is the full resolution image "
+		"and each successive level halves the resolution.",
+		0,
+		0
+	);
+	parameters()->addParameter( m_mipLevelParameter );
 }
 
 bool EXRImageReader::canRead( const string &fileName )
@@ -119,16 +142,77 @@ bool EXRImageReader::isComplete()
 	return m_inputFile->isComplete();
 }
 
+namespace
+{
+
+// Matches the sizes OpenEXR computes for the levels of mipmapped and ripmapped files.
+int levelSize( int size, int level, LevelRoundingMode roundingMode )
+{
+	int result = size >> level;
+	if( roundingMode == ROUND_UP && ( result << level ) < size )
+	{
+		result++;
+	}
+	return std::max( result, 1 );
+}
+
+} // namespace
+
 Imath::Box2i EXRImageReader::dataWindow()
 {
 	open( true );
+	const int level = mipLevel();
+	if( level )
+	{
+		return m_tiledInputFile->dataWindowForLevel( level, level );
+	}
 	return m_inputFile->header().dataWindow();
 }
 
 Imath::Box2i EXRImageReader::displayWindow()
 {
 	open( true );
-	return m_inputFile->header().displayWindow();
+	Box2i result = m_inputFile->header().displayWindow();
+	const int level = mipLevel();
+	if( level )
+	{
+		// OpenEXR doesn't store display windows for the lower levels, so we scale the
+		// full resolution one in the same way as the data window is scaled.
+		const LevelRoundingMode roundingMode = m_tiledInputFile->levelRoundingMode();
+		const Imath::V2i size = result.size() + Imath::V2i( 1 );
+		result.max = result.min + Imath::V2i( levelSize( size.x, level, roundingMode ), levelSize( size.y, level, roundingMode ) ) - Imath::V2i( 1 );
+	}
+	return result;
+}
+
+int EXRImageReader::numMipLevels()
+{
+	open( true );
+	if( !m_tiledInputFile )
+	{
+		return 1;
+	}
+
+	switch( m_tiledInputFile->levelMode() )
+	{
+		case MIPMAP_LEVELS :
+			return m_tiledInputFile->numLevels();
+		case RIPMAP_LEVELS :
+			return std::min( m_tiledInputFile->numXLevels(), m_tiledInputFile->numYLevels() );
+		default :
+			return 1;
+	}
+}
+
+int EXRImageReader::mipLevel()
+{
+	const int level = m_mipLevelParameter->getNumericValue();
+	const int numLevels = numMipLevels();
+	if( level >= numLevels )
+	{
+		throw InvalidArgumentException( ( boost::format( "EXRImageReader : Cannot read mip level %d from \"%s\", which has %d level(s)" ) % level % fileName() % numLevels ).str() );
+	}
+	return level;
 }
 
 std::string EXRImageReader::sourceColorSpace() const
@@ -136,134 +220,250 @@ std::string EXRImageReader::sourceColorSpace() const
 	return "linear";
 }
 
-template<class T>
-DataPtr EXRImageReader::readTypedChannel( const std::string &name, const Imath::Box2i &dataWindow, const Imf::Channel *channel )
+void EXRImageReader::setNumThreads( int numThreads )
 {
-	assert( channel );
-	Imath::V2i pixelDimensions = dataWindow.size() + Imath::V2i( 1 );
-	unsigned numPixels = pixelDimensions.x * pixelDimensions.y;
+	g_numThreadsInitialised = true;
+	setGlobalThreadCount( numThreads );
+}
 
-	typedef TypedData<vector<T> > DataType;
-	typename DataType::Ptr data = new DataType;
-	data->writable().resize( numPixels );
-
-	Imath::Box2i fullDataWindow = this->dataWindow();
-	if( fullDataWindow.min.x==dataWindow.min.x && fullDataWindow.max.x==dataWindow.max.x )
-	{
-		// the width we want to read matches the width in the file, so we can read straight
-		// into the result buffer
-		FrameBuffer frameBuffer;
-		T *buffer00 = data->baseWritable() - dataWindow.min.y * pixelDimensions.x - fullDataWindow.min.x;
-		Slice slice( channel->type, (char *)buffer00, sizeof(T), sizeof(T) * pixelDimensions.x );
-		frameBuffer.insert( name.c_str(), slice );
-		m_inputFile->setFrameBuffer( frameBuffer );
-		// exr library will choose the best order to read scanlines automatically (increasing or decreasing)
-		try
-		{
-			m_inputFile->readPixels( dataWindow.min.y, dataWindow.max.y );
-		}
-		catch( Iex::InputExc &e )
-		{
-			// so we can read incomplete files
-			msg( Msg::Warning, "EXRImageReader::readChannel", e.what() );
-			return data;
-		}
+int EXRImageReader::getNumThreads()
+{
+	return globalThreadCount();
+}
+
+namespace
+{
+
+/// The number of scanlines read at once when we must read through a temporary
+/// buffer. This is a multiple of the number of scanlines in a block for all
+/// the compression methods, so no block is decompressed more than once.
+const int g_scanlinesPerChunk = 256;
+
+size_t pixelSize( PixelType type )
+{
+	switch( type )
+	{
+		case UINT :
+			BOOST_STATIC_ASSERT( sizeof( unsigned int ) == 4 );
+			return sizeof( unsigned int );
+		case HALF :
+			return sizeof( half );
+		case FLOAT :
+			BOOST_STATIC_ASSERT( sizeof( float ) == 4 );
+			return sizeof( float );
+		default :
+			return 0;
 	}
-	else
-	{
-		// widths don't match, we need to read into a temporary buffer and then transfer just
-		// the bits we need into the result buffer.
-		int numTmpPixels = fullDataWindow.size().x + 1;
-		vector<T> tmpBuffer( numTmpPixels );
-		T *tmpBufferTransferStart = &(tmpBuffer[0]) + dataWindow.min.x - fullDataWindow.min.x;
-		size_t tmpBufferTransferLength = pixelDimensions.x * sizeof( T );
-		T *transferDestination = &(data->writable()[0]);
-
-		// slice has yStride of 0 so each successive scanline just overwrites the previous one
-		Slice slice( channel->type, (char *)(&(tmpBuffer[0]) - fullDataWindow.min.x), sizeof(T), 0 );
-		FrameBuffer frameBuffer;
-		frameBuffer.insert( name.c_str(), slice );
-		m_inputFile->setFrameBuffer( frameBuffer );
-
-		int yStart = dataWindow.min.y;
-		int yEnd = dataWindow.max.y;
-		int yStep = 1;
-		try
-		{
-			for( int y=yStart; y!=(yEnd+yStep); y+=yStep )
+}
+
+template<class T>
+char *createChannelData( size_t numPixels, DataPtr &data )
+{
+	typedef TypedData<vector<T> > DataType;
+	typename DataType::Ptr typedData = new DataType;
+	typedData->writable().resize( numPixels );
+	data = typedData;
+	return (char *)typedData->baseWritable();
+}
+
+DataPtr convertToFloat( PixelType type, DataPtr data )
+{
+	switch( type )
+	{
+		case UINT :
 			{
-				m_inputFile->readPixels( y );
-				memcpy( (char *)transferDestination, (const char *)tmpBufferTransferStart, tmpBufferTransferLength );
-				transferDestination += pixelDimensions.x;
+				DataConvert< UIntVectorData, FloatVectorData, ScaledDataConversion< unsigned int, float > > converter;
+				ConstUIntVectorDataPtr vec = staticPointerCast< UIntVectorData >( data );
+				return converter( vec );
 			}
-		}
-		catch( Iex::InputExc &e )
-		{
-			// so we can read incomplete files
-			msg( Msg::Warning, "EXRImageReader::readChannel", e.what() );
+		case HALF :
+			{
+				DataConvert< HalfVectorData, FloatVectorData, ScaledDataConversion< half, float > > converter;
+				ConstHalfVectorDataPtr vec = staticPointerCast< HalfVectorData >( data );
+				return converter( vec );
+			}
+		default :
 			return data;
-		}
 	}
+}
 
-#ifndef NDEBUG
-	for ( typename DataType::ValueType::const_iterator it = data->readable().begin(); it != data->readable().end(); ++it )
-	{
-		assert( *it == *it ); // Will fail iff NaN
-	}
-#endif
+} // namespace
 
-	return data;
+DataPtr EXRImageReader::readChannel( const string &name, const Imath::Box2i &dataWindow, bool raw )
+{
+	vector<string> names( 1, name );
+	vector<DataPtr> channels;
+	readChannels( names, dataWindow, raw, channels );
+	return channels[0];
 }
 
-DataPtr EXRImageReader::readChannel( const string &name, const Imath::Box2i &dataWindow, bool raw )
+void EXRImageReader::readChannels( const std::vector<std::string> &names, const Imath::Box2i &dataWindow, bool raw, std::vector<DataPtr> &channels )
 {
 	open( true );
 
 	try
 	{
+		const Imath::V2i pixelDimensions = dataWindow.size() + Imath::V2i( 1 );
+		const size_t numPixels = pixelDimensions.x * pixelDimensions.y;
+
+		// make the data for each channel, and find where its first pixel is
+
+		channels.resize( names.size() );
+		vector<PixelType> types( names.size() );
+		vector<char *> buffers( names.size() );
+		for( size_t i = 0; i < names.size(); ++i )
+		{
+			const Channel *channel = m_inputFile->header().channels().findChannel( names[i].c_str() );
+			assert( channel );
+			assert( channel->xSampling==1 ); /// \todo Support subsampling when we have a need for it
+			assert( channel->ySampling==1 );
+
+			types[i] = channel->type;
+			switch( channel->type )
+			{
+				case UINT :
+					buffers[i] = createChannelData<unsigned int>( numPixels, channels[i] );
+					break;
+				case HALF :
+					buffers[i] = createChannelData<half>( numPixels, channels[i] );
+					break;
+				case FLOAT :
+					buffers[i] = createChannelData<float>( numPixels, channels[i] );
+					break;
+				default :
+					throw IOException( ( boost::format( "EXRImageReader : Unsupported data type for channel \"%s\"" ) % names[i] ).str() );
+			}
+		}
 
-		const Channel *channel = m_inputFile->header().channels().findChannel( name.c_str() );
-		assert( channel );
-		assert( channel->xSampling==1 ); /// \todo Support subsampling when we have a need for it
-		assert( channel->ySampling==1 );
+		// read all the channels in one pass through the file
 
-		DataPtr res;
-		switch( channel->type )
+		const Imath::Box2i fullDataWindow = this->dataWindow();
+		try
 		{
-			case UINT :
-				BOOST_STATIC_ASSERT( sizeof( unsigned int ) == 4 );
-				res = readTypedChannel<unsigned int>( name, dataWindow, channel );
-				if ( raw )
+			if( m_tiledInputFile )
+			{
+				// only read the tiles which overlap the window we want, a row of tiles at a
+				// time, transferring the bits we need from temporary buffers into the result
+				// buffers.
+				const int level = mipLevel();
+				const int tileWidth = m_tiledInputFile->tileXSize();
+				const int tileHeight = m_tiledInputFile->tileYSize();
+				const int dx1 = ( dataWindow.min.x - fullDataWindow.min.x ) / tileWidth;
+				const int dx2 = ( dataWindow.max.x - fullDataWindow.min.x ) / tileWidth;
+				const int dy1 = ( dataWindow.min.y - fullDataWindow.min.y ) / tileHeight;
+				const int dy2 = ( dataWindow.max.y - fullDataWindow.min.y ) / tileHeight;
+
+				const int tmpMinX = fullDataWindow.min.x + dx1 * tileWidth;
+				const int tmpWidth = std::min( fullDataWindow.min.x + ( dx2 + 1 ) * tileWidth - 1, fullDataWindow.max.x ) - tmpMinX + 1;
+				vector<vector<char> > tmpBuffers( names.size() );
+				for( size_t i = 0; i < names.size(); ++i )
 				{
-					return res;
+					tmpBuffers[i].resize( tmpWidth * tileHeight * pixelSize( types[i] ) );
 				}
-				else
+
+				for( int dy = dy1; dy <= dy2; ++dy )
 				{
-					DataConvert< UIntVectorData, FloatVectorData, ScaledDataConversion< unsigned int, float > > converter;
-					ConstUIntVectorDataPtr vec = staticPointerCast< UIntVectorData >(res);
-					return converter( vec );
+					const int tileMinY = fullDataWindow.min.y + dy * tileHeight;
+
+					FrameBuffer frameBuffer;
+					for( size_t i = 0; i < names.size(); ++i )
+					{
+						const size_t size = pixelSize( types[i] );
+						char *buffer00 = &(tmpBuffers[i][0]) - ( tileMinY * tmpWidth + tmpMinX ) * size;
+						frameBuffer.insert( names[i].c_str(), Slice( types[i], buffer00, size, size * tmpWidth ) );
+					}
+					m_tiledInputFile->setFrameBuffer( frameBuffer );
+					m_tiledInputFile->readTiles( dx1, dx2, dy, dy, level, level );
+
+					const int yBegin = std::max( tileMinY, dataWindow.min.y );
+					const int yEnd = std::min( tileMinY + tileHeight - 1, dataWindow.max.y );
+					for( size_t i = 0; i < names.size(); ++i )
+					{
+						const size_t size = pixelSize( types[i] );
+						const char *transferSource = &(tmpBuffers[i][0]) + ( ( yBegin - tileMinY ) * tmpWidth + dataWindow.min.x - tmpMinX ) * size;
+						char *transferDestination = buffers[i] + ( yBegin - dataWindow.min.y ) * pixelDimensions.x * size;
+						for( int tileY = yBegin; tileY <= yEnd; ++tileY )
+						{
+							memcpy( transferDestination, transferSource, pixelDimensions.x * size );
+							transferSource += tmpWidth * size;
+							transferDestination += pixelDimensions.x * size;
+						}
+					}
 				}
-
-			case HALF :
-				res = readTypedChannel<half>( name, dataWindow, channel );
-				if ( raw )
+			}
+			else if( fullDataWindow.min.x==dataWindow.min.x && fullDataWindow.max.x==dataWindow.max.x )
+			{
+				// the width we want to read matches the width in the file, so we can read straight
+				// into the result buffers
+				FrameBuffer frameBuffer;
+				for( size_t i = 0; i < names.size(); ++i )
 				{
-					return res;
+					const size_t size = pixelSize( types[i] );
+					char *buffer00 = buffers[i] - ( dataWindow.min.y * pixelDimensions.x + fullDataWindow.min.x ) * size;
+					frameBuffer.insert( names[i].c_str(), Slice( types[i], buffer00, size, size * pixelDimensions.x ) );
 				}
-				else
+				m_inputFile->setFrameBuffer( frameBuffer );
+				// exr library will choose the best order to read scanlines automatically (increasing or decreasing)
+				m_inputFile->readPixels( dataWindow.min.y, dataWindow.max.y );
+			}
+			else
+			{
+				// widths don't match, we need to read into temporary buffers and then transfer just
+				// the bits we need into the result buffers. we do that a chunk of scanlines at a time
+				// to limit the size of the temporary buffers, aligning the chunks with the blocks in
+				// the file.
+				const int fullWidth = fullDataWindow.size().x + 1;
+				vector<vector<char> > tmpBuffers( names.size() );
+				for( size_t i = 0; i < names.size(); ++i )
 				{
-					DataConvert< HalfVectorData, FloatVectorData, ScaledDataConversion< half, float > > converter;
-					ConstHalfVectorDataPtr vec = staticPointerCast< HalfVectorData >(res);
-					return converter( vec );
+					tmpBuffers[i].resize( fullWidth * std::min( g_scanlinesPerChunk, pixelDimensions.y ) * pixelSize( types[i] ) );
 				}
 
-			case FLOAT :
-				BOOST_STATIC_ASSERT( sizeof( float ) == 4 );
-				return readTypedChannel<float>( name, dataWindow, channel );
-
-			default:
-				throw IOException( ( boost::format( "EXRImageReader : Unsupported data type for channel \"%s\"" ) % name ).str() );
+				int y = dataWindow.min.y;
+				while( y <= dataWindow.max.y )
+				{
+					const int chunkIndex = ( y - fullDataWindow.min.y ) / g_scanlinesPerChunk;
+					const int yEnd = std::min( dataWindow.max.y, fullDataWindow.min.y + ( chunkIndex + 1 ) * g_scanlinesPerChunk - 1 );
+
+					FrameBuffer frameBuffer;
+					for( size_t i = 0; i < names.size(); ++i )
+					{
+						const size_t size = pixelSize( types[i] );
+						char *buffer00 = &(tmpBuffers[i][0]) - ( y * fullWidth + fullDataWindow.min.x ) * size;
+						frameBuffer.insert( names[i].c_str(), Slice( types[i], buffer00, size, size * fullWidth ) );
+					}
+					m_inputFile->setFrameBuffer( frameBuffer );
+					m_inputFile->readPixels( y, yEnd );
+
+					for( size_t i = 0; i < names.size(); ++i )
+					{
+						const size_t size = pixelSize( types[i] );
+						const char *transferSource = &(tmpBuffers[i][0]) + ( dataWindow.min.x - fullDataWindow.min.x ) * size;
+						char *transferDestination = buffers[i] + ( y - dataWindow.min.y ) * pixelDimensions.x * size;
+						for( int chunkY = y; chunkY <= yEnd; ++chunkY )
+						{
+							memcpy( transferDestination, transferSource, pixelDimensions.x * size );
+							transferSource += fullWidth * size;
+							transferDestination += pixelDimensions.x * size;
+						}
+					}
+
+					y = yEnd + 1;
+				}
+			}
+		}
+		catch( Iex::InputExc &e )
+		{
+			// so we can read incomplete files
+			msg( Msg::Warning, "EXRImageReader::readChannel", boost::format( "%d channel(s) incomplete : %s" ) % names.size() % e.what() );
+		}
 
+		if( !raw )
+		{
+			for( size_t i = 0; i < names.size(); ++i )
+			{
+				channels[i] = convertToFloat( types[i], channels[i] );
+			}
 		}
 	}
 	catch ( Exception &e )
@@ -296,15 +496,34 @@ bool EXRImageReader::open( bool throwOnFailure )
 
 	delete m_inputFile;
 	m_inputFile = 0;
+	delete m_tiledInputFile;
+	m_tiledInputFile = 0;
+
+	if( !g_numThreadsInitialised )
+	{
+		// OpenEXR doesn't use threads by default, so unless the
+		// host application has already asked it to, we do.
+		if( !globalThreadCount() )
+		{
+			setGlobalThreadCount( tbb::task_scheduler_init::default_num_threads() );
+		}
+		g_numThreadsInitialised = true;
+	}
 
 	try
 	{
 		m_inputFile = new Imf::InputFile( fileName().c_str() );
+		if( m_inputFile->header().hasTileDescription() )
+		{
+			m_tiledInputFile = new Imf::TiledInputFile( fileName().c_str() );
+		}
 	}
 	catch( ... )
 	{
 		delete m_inputFile;
 		m_inputFile = 0;
+		delete m_tiledInputFile;
+		m_tiledInputFile = 0;
 		if( !throwOnFailure )
 		{
 			return false;
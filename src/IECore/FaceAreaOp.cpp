@@ -36,12 +36,15 @@
 #include "IECore/CompoundParameter.h"
 #include "IECore/PolygonAlgo.h"
 #include "IECore/PolygonIterator.h"
+#include "IECore/MeshTopology.h"
 
 #include "boost/format.hpp"
 #include "boost/tuple/tuple.hpp"
 #include "boost/iterator/zip_iterator.hpp"
 #include "boost/iterator/transform_iterator.hpp"
 
+#include "tbb/parallel_for.h"
+
 using namespace IECore;
 using namespace std;
 using namespace Imath;
@@ -107,6 +110,93 @@ struct STTupleToV3f
 	}
 };
 
+namespace
+{
+
+// Computes the area of each face from its vertex interpolated points.
+struct Areas
+{
+	Areas( const MeshPrimitive *mesh, const vector<int> &faceOffsets, const vector<V3f> &p, vector<float> &areas )
+		:	m_verticesPerFace( mesh->verticesPerFace()->readable() ), m_vertexIds( mesh->vertexIds()->readable() ),
+			m_faceOffsets( faceOffsets ), m_p( p ), m_areas( areas )
+	{
+	}
+
+	void operator()( const tbb::blocked_range<size_t> &r ) const
+	{
+		for( size_t f=r.begin(); f!=r.end(); ++f )
+		{
+			PolygonIterator pIt( m_verticesPerFace.begin() + f, m_vertexIds.begin() + m_faceOffsets[f], m_faceOffsets[f] );
+			m_areas[f] = polygonArea( pIt.vertexBegin( m_p.begin() ), pIt.vertexEnd( m_p.begin() ) );
+		}
+	}
+
+	private :
+
+		const vector<int> &m_verticesPerFace;
+		const vector<int> &m_vertexIds;
+		const vector<int> &m_faceOffsets;
+		const vector<V3f> &m_p;
+		vector<float> &m_areas;
+
+};
+
+// Computes the area of each face in texture space, from either vertex or
+// facevarying s and t values.
+struct TextureAreas
+{
+	TextureAreas( const MeshPrimitive *mesh, const vector<int> &faceOffsets, const vector<float> &s, const vector<float> &t, PrimitiveVariable::Interpolation interpolation, vector<float> &textureAreas )
+		:	m_verticesPerFace( mesh->verticesPerFace()->readable() ), m_vertexIds( mesh->vertexIds()->readable() ),
+			m_faceOffsets( faceOffsets ), m_s( s ), m_t( t ), m_interpolation( interpolation ), m_textureAreas( textureAreas )
+	{
+	}
+
+	void operator()( const tbb::blocked_range<size_t> &r ) const
+	{
+		for( size_t f=r.begin(); f!=r.end(); ++f )
+		{
+			PolygonIterator pIt( m_verticesPerFace.begin() + f, m_vertexIds.begin() + m_faceOffsets[f], m_faceOffsets[f] );
+			if( m_interpolation==PrimitiveVariable::Vertex )
+			{
+				typedef PolygonVertexIterator<vector<float>::const_iterator> VertexIterator;
+				typedef boost::tuple<VertexIterator, VertexIterator> IteratorTuple;
+				typedef boost::zip_iterator<IteratorTuple> ZipIterator;
+				typedef boost::transform_iterator<STTupleToV3f, ZipIterator> STIterator;
+
+				STIterator begin( ZipIterator( IteratorTuple( pIt.vertexBegin( m_s.begin() ), pIt.vertexBegin( m_t.begin() ) ) ) );
+				STIterator end( ZipIterator( IteratorTuple( pIt.vertexEnd( m_s.begin() ), pIt.vertexEnd( m_t.begin() ) ) ) );
+
+				m_textureAreas[f] = polygonArea( begin, end );
+			}
+			else
+			{
+				assert( m_interpolation==PrimitiveVariable::FaceVarying );
+				typedef boost::tuple<vector<float>::const_iterator, vector<float>::const_iterator> IteratorTuple;
+				typedef boost::zip_iterator<IteratorTuple> ZipIterator;
+				typedef boost::transform_iterator<STTupleToV3f, ZipIterator> STIterator;
+
+				STIterator begin( ZipIterator( IteratorTuple( pIt.faceVaryingBegin( m_s.begin() ), pIt.faceVaryingBegin( m_t.begin() ) ) ) );
+				STIterator end( ZipIterator( IteratorTuple( pIt.faceVaryingEnd( m_s.begin() ), pIt.faceVaryingEnd( m_t.begin() ) ) ) );
+
+				m_textureAreas[f] = polygonArea( begin, end );
+			}
+		}
+	}
+
+	private :
+
+		const vector<int> &m_verticesPerFace;
+		const vector<int> &m_vertexIds;
+		const vector<int> &m_faceOffsets;
+		const vector<float> &m_s;
+		const vector<float> &m_t;
+		PrimitiveVariable::Interpolation m_interpolation;
+		vector<float> &m_textureAreas;
+
+};
+
+} // namespace
+
 void FaceAreaOp::modifyTypedPrimitive( MeshPrimitive * mesh, const CompoundObject * operands )
 {
 	string areaPrimVarName = parameters()->parameter<StringParameter>( "areaPrimVar" )->getTypedValue();
@@ -123,13 +213,9 @@ void FaceAreaOp::modifyTypedPrimitive( MeshPrimitive * mesh, const CompoundObjec
 
 		FloatVectorDataPtr areasData = new FloatVectorData;
 		vector<float> &areas = areasData->writable();
-		areas.reserve( mesh->variableSize( PrimitiveVariable::Uniform ) );
-		PolygonIterator faceEnd = mesh->faceEnd();
-		for( PolygonIterator pIt = mesh->faceBegin(); pIt!=faceEnd; pIt++ )
-		{
-			typedef vector<V3f> PointVector;
-			areas.push_back( polygonArea( pIt.vertexBegin( p.begin() ), pIt.vertexEnd( p.begin() ) ) );
-		}
+		areas.resize( mesh->variableSize( PrimitiveVariable::Uniform ) );
+		ConstMeshTopologyPtr topology = MeshTopology::get( mesh );
+		tbb::parallel_for( tbb::blocked_range<size_t>( 0, areas.size(), 1000 ), Areas( mesh, topology->faceOffsets(), p, areas ) );
 
 		mesh->variables[areaPrimVarName] = PrimitiveVariable( PrimitiveVariable::Uniform, areasData );
 	}
@@ -173,35 +259,9 @@ void FaceAreaOp::modifyTypedPrimitive( MeshPrimitive * mesh, const CompoundObjec
 
 		FloatVectorDataPtr textureAreasData = new FloatVectorData;
 		vector<float> &textureAreas = textureAreasData->writable();
-		textureAreas.reserve( mesh->variableSize( PrimitiveVariable::Uniform ) );
-		PolygonIterator faceEnd = mesh->faceEnd();
-		for( PolygonIterator pIt = mesh->faceBegin(); pIt!=faceEnd; pIt++ )
-		{
-			if( sInterpolation==PrimitiveVariable::Vertex )
-			{
-				typedef PolygonVertexIterator<vector<float>::const_iterator> VertexIterator;
-				typedef boost::tuple<VertexIterator, VertexIterator> IteratorTuple;
-				typedef boost::zip_iterator<IteratorTuple> ZipIterator;
-				typedef boost::transform_iterator<STTupleToV3f, ZipIterator> STIterator;
-			
-				STIterator begin( ZipIterator( IteratorTuple( pIt.vertexBegin( s.begin() ), pIt.vertexBegin( t.begin() ) ) ) );
-				STIterator end( ZipIterator( IteratorTuple( pIt.vertexEnd( s.begin() ), pIt.vertexEnd( t.begin() ) ) ) );
-			
-				textureAreas.push_back( polygonArea( begin, end ) );
-			}
-			else
-			{
-				assert( sInterpolation==PrimitiveVariable::FaceVarying );
-				typedef boost::tuple<vector<float>::const_iterator, vector<float>::const_iterator> IteratorTuple;
-				typedef boost::zip_iterator<IteratorTuple> ZipIterator;
-				typedef boost::transform_iterator<STTupleToV3f, ZipIterator> STIterator;
-			
-				STIterator begin( ZipIterator( IteratorTuple( pIt.faceVaryingBegin( s.begin() ), pIt.faceVaryingBegin( t.begin() ) ) ) );
-				STIterator end( ZipIterator( IteratorTuple( pIt.faceVaryingEnd( s.begin() ), pIt.faceVaryingEnd( t.begin() ) ) ) );
-			
-				textureAreas.push_back( polygonArea( begin, end ) );
-			}
-		}
+		textureAreas.resize( mesh->variableSize( PrimitiveVariable::Uniform ) );
+		ConstMeshTopologyPtr topology = MeshTopology::get( mesh );
+		tbb::parallel_for( tbb::blocked_range<size_t>( 0, textureAreas.size(), 1000 ), TextureAreas( mesh, topology->faceOffsets(), s, t, sInterpolation, textureAreas ) );
 
 		mesh->variables[textureAreaPrimVarName] = PrimitiveVariable( PrimitiveVariable::Uniform, textureAreasData );
 	
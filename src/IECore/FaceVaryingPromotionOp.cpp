@@ -35,10 +35,12 @@
 #include "boost/regex.hpp"
 #include "boost/format.hpp"
 
+#include "tbb/parallel_for.h"
+
 #include "IECore/FaceVaryingPromotionOp.h"
 #include "IECore/DespatchTypedData.h"
 #include "IECore/CompoundParameter.h"
-#include "IECore/PolygonVertexIterator.h"
+#include "IECore/MeshTopology.h"
 
 using namespace IECore;
 
@@ -129,8 +131,8 @@ struct FaceVaryingPromotionOp::Promoter
 {
 	typedef DataPtr ReturnType;
 
-	Promoter( const std::vector<int> &vertsPerFace,  const std::vector<int> &vertIds )
-		:	m_interpolation( PrimitiveVariable::Invalid ), m_vertsPerFace( vertsPerFace ), m_vertIds( vertIds )
+	Promoter( const MeshPrimitive *mesh )
+		:	m_interpolation( PrimitiveVariable::Invalid ), m_mesh( mesh )
 	{
 	}
 
@@ -142,47 +144,78 @@ struct FaceVaryingPromotionOp::Promoter
 	template<typename T>
 	ReturnType operator()( T *data )
 	{	
-		typedef typename T::ValueType Container;
-		typedef typename Container::const_iterator ConstIterator;
-		
-		typename T::Ptr result = new T;
-		result->writable().reserve( m_vertIds.size() );
-		std::back_insert_iterator<Container> inserter( result->writable() );
+		// promotion is a gather from the source data, using the face of each
+		// face-vertex for uniform data, and the vertex id for vertex data.
+		const std::vector<int> *indices = 0;
 		switch( m_interpolation )
 		{
 			case PrimitiveVariable::Uniform :
 			{
-				ConstIterator dataIt = data->readable().begin();
-				for( std::vector<int>::const_iterator it=m_vertsPerFace.begin(); it!=m_vertsPerFace.end(); ++it, ++dataIt )
+				if( !m_topology )
 				{
-					std::fill_n( inserter, *it, *dataIt );
-				}				
+					m_topology = MeshTopology::get( m_mesh );
+				}
+				indices = &m_topology->faceVertexFaces();
 				break;
 			}
 			case PrimitiveVariable::Vertex :
 			case PrimitiveVariable::Varying :
 			{
-				std::copy(
-					PolygonVertexIterator<ConstIterator>( m_vertIds.begin(), data->readable().begin() ),
-					PolygonVertexIterator<ConstIterator>( m_vertIds.end(), data->readable().begin() ),
-					inserter
-				);					
+				indices = &m_mesh->vertexIds()->readable();
 				break;
 			}
 			default :
 				assert( 0 ); // shouldn't get here
 		}
 		
-		assert( result->readable().size() == m_vertIds.size() );
+		typename T::Ptr result = new T;
+		gather( data->readable(), *indices, result->writable() );
+
+		assert( result->readable().size() == m_mesh->vertexIds()->readable().size() );
 		
 		return result;
 	}
 
 	private :
 
+		template<typename Container>
+		struct Gather
+		{
+			Gather( const Container &source, const std::vector<int> &indices, Container &result )
+				:	m_source( source ), m_indices( indices ), m_result( result )
+			{
+			}
+
+			void operator()( const tbb::blocked_range<size_t> &r ) const
+			{
+				for( size_t i = r.begin(); i != r.end(); ++i )
+				{
+					m_result[i] = m_source[m_indices[i]];
+				}
+			}
+
+			const Container &m_source;
+			const std::vector<int> &m_indices;
+			Container &m_result;
+		};
+
+		template<typename Container>
+		static void gather( const Container &source, const std::vector<int> &indices, Container &result )
+		{
+			result.resize( indices.size() );
+			tbb::parallel_for( tbb::blocked_range<size_t>( 0, indices.size(), 1000 ), Gather<Container>( source, indices, result ) );
+		}
+
+		// the elements of std::vector<bool> share storage, so can't be written concurrently.
+		static void gather( const std::vector<bool> &source, const std::vector<int> &indices, std::vector<bool> &result )
+		{
+			result.resize( indices.size() );
+			Gather<std::vector<bool> >( source, indices, result )( tbb::blocked_range<size_t>( 0, indices.size() ) );
+		}
+
 		PrimitiveVariable::Interpolation m_interpolation;
-		const std::vector<int> &m_vertsPerFace;
-		const std::vector<int> &m_vertIds;
+		const MeshPrimitive *m_mesh;
+		ConstMeshTopologyPtr m_topology;
 
 };
 
@@ -199,7 +232,7 @@ void FaceVaryingPromotionOp::modifyTypedPrimitive( MeshPrimitive *mesh, const Co
 	bool promoteVarying = operands->member<BoolData>( "promoteVarying" )->readable();
 	bool promoteVertex = operands->member<BoolData>( "promoteVertex" )->readable();
 
-	Promoter promoter( mesh->verticesPerFace()->readable(), mesh->vertexIds()->readable() );
+	Promoter promoter( mesh );
 	for( PrimitiveVariableMap::iterator it=mesh->variables.begin(); it!=mesh->variables.end(); ++it )
 	{
 		switch( it->second.interpolation )
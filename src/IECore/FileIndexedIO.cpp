@@ -32,6 +32,12 @@
 //
 //////////////////////////////////////////////////////////////////////////
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
 #include "boost/filesystem/operations.hpp"
 
 #include "IECore/MessageHandler.h"
@@ -66,9 +72,27 @@ class FileIndexedIO::StreamFile : public StreamIndexedIO::StreamFile
 
 		void flush( size_t endPosition );
 
+		/// Reads with ::pread() on a dedicated file descriptor when the file is
+		/// not memory mapped, so concurrent reads never take the mutex.
+		void pread( char *buffer, size_t size, Imf::Int64 pos );
+
+		/// Advises the kernel to read the region ahead, so the actual reads
+		/// find it in the page cache.
+		void prefetch( Imf::Int64 pos, Imf::Int64 size );
+
+	private :
+
+		/// Opens a read-only file descriptor for positional reads and maps the whole
+		/// file into memory. Failure is not an error - reads fall back to the stream.
+		void map();
+
+		int m_fd;
+		void *m_mapping;
+		size_t m_mappingSize;
+
 };
 
-FileIndexedIO::StreamFile::StreamFile( const std::string &filename, IndexedIO::OpenMode mode ) : StreamIndexedIO::StreamFile(mode), m_filename( filename ), m_endPosition(0)
+FileIndexedIO::StreamFile::StreamFile( const std::string &filename, IndexedIO::OpenMode mode ) : StreamIndexedIO::StreamFile(mode), m_filename( filename ), m_endPosition(0), m_fd(-1), m_mapping(0), m_mappingSize(0)
 {
 	if (mode & IndexedIO::Write)
 	{
@@ -143,6 +167,7 @@ FileIndexedIO::StreamFile::StreamFile( const std::string &filename, IndexedIO::O
 			throw IOException( "FileIndexedIO: Caught error reading file '" + filename + "'" );
 		}
 
+		map();
 	}
 
 	assert( m_stream );
@@ -150,6 +175,73 @@ FileIndexedIO::StreamFile::StreamFile( const std::string &filename, IndexedIO::O
 	assert( m_index );
 }
 
+void FileIndexedIO::StreamFile::map()
+{
+	m_fd = ::open( m_filename.c_str(), O_RDONLY );
+	if ( m_fd == -1 )
+	{
+		return;
+	}
+
+	struct stat s;
+	if ( ::fstat( m_fd, &s ) == 0 && s.st_size > 0 )
+	{
+		void *mapping = ::mmap( 0, s.st_size, PROT_READ, MAP_SHARED, m_fd, 0 );
+		if ( mapping != MAP_FAILED )
+		{
+			m_mapping = mapping;
+			m_mappingSize = s.st_size;
+			setMappedData( static_cast< const char * >( m_mapping ), m_mappingSize );
+		}
+	}
+}
+
+void FileIndexedIO::StreamFile::pread( char *buffer, size_t size, Imf::Int64 pos )
+{
+	if ( m_fd == -1 || m_mapping )
+	{
+		StreamIndexedIO::StreamFile::pread( buffer, size, pos );
+		return;
+	}
+
+	while ( size )
+	{
+		ssize_t result = ::pread( m_fd, buffer, size, pos );
+		if ( result < 0 && errno == EINTR )
+		{
+			continue;
+		}
+		if ( result <= 0 )
+		{
+			throw IOException( ( boost::format( "FileIndexedIO: Error reading %d bytes at %d from file '%s'" ) % size % pos % m_filename ).str() );
+		}
+		buffer += result;
+		size -= result;
+		pos += result;
+	}
+}
+
+void FileIndexedIO::StreamFile::prefetch( Imf::Int64 pos, Imf::Int64 size )
+{
+	if ( m_mapping )
+	{
+		if ( pos + size > m_mappingSize )
+		{
+			return;
+		}
+		// madvise() requires a page aligned address
+		Imf::Int64 pageSize = ::sysconf( _SC_PAGESIZE );
+		Imf::Int64 begin = pos - ( pos % pageSize );
+		::madvise( static_cast< char * >( m_mapping ) + begin, pos + size - begin, MADV_WILLNEED );
+	}
+#ifdef __linux__
+	else if ( m_fd != -1 )
+	{
+		::posix_fadvise( m_fd, pos, size, POSIX_FADV_WILLNEED );
+	}
+#endif
+}
+
 void FileIndexedIO::StreamFile::flush( size_t endPosition )
 {
 	m_endPosition = endPosition;
@@ -157,6 +249,15 @@ void FileIndexedIO::StreamFile::flush( size_t endPosition )
 
 FileIndexedIO::StreamFile::~StreamFile()
 {
+	if ( m_mapping )
+	{
+		::munmap( m_mapping, m_mappingSize );
+	}
+	if ( m_fd != -1 )
+	{
+		::close( m_fd );
+	}
+
 	if ( m_openmode == IndexedIO::Write || m_openmode == IndexedIO::Append )
 	{
 		std::fstream *f = static_cast< std::fstream * >( m_stream );
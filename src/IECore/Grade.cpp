@@ -32,6 +32,8 @@
 //
 //////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+
 #include "IECore/Grade.h"
 #include "IECore/CompoundParameter.h"
 #include "IECore/MessageHandler.h"
@@ -251,3 +253,47 @@ void Grade::transform( Imath::Color3f &color ) const
 		if ( color.z > 1.0 ) color.z = 1.0;
 	}
 }
+
+static void gradeChannel( float *channel, size_t n, double a, double b, double invGamma, bool blackClamp, bool whiteClamp )
+{
+	if( invGamma == 1.0 )
+	{
+		for( size_t i = 0; i < n; i++ )
+		{
+			channel[i] = a * channel[i] + b;
+		}
+	}
+	else
+	{
+		for( size_t i = 0; i < n; i++ )
+		{
+			double c = a * channel[i] + b;
+			channel[i] = ( c >= 0.0 ? (float)pow( c, invGamma ) : c );
+		}
+	}
+
+	if( blackClamp )
+	{
+		for( size_t i = 0; i < n; i++ )
+		{
+			channel[i] = std::max( channel[i], 0.0f );
+		}
+	}
+
+	if( whiteClamp )
+	{
+		for( size_t i = 0; i < n; i++ )
+		{
+			channel[i] = std::min( channel[i], 1.0f );
+		}
+	}
+}
+
+void Grade::transformBatch( float *red, float *green, float *blue, size_t numColors ) const
+{
+	const bool blackClamp = m_blackClampParameter->getTypedValue();
+	const bool whiteClamp = m_whiteClampParameter->getTypedValue();
+	gradeChannel( red, numColors, m_A.x, m_B.x, m_invGamma.x, blackClamp, whiteClamp );
+	gradeChannel( green, numColors, m_A.y, m_B.y, m_invGamma.y, blackClamp, whiteClamp );
+	gradeChannel( blue, numColors, m_A.z, m_B.z, m_invGamma.z, blackClamp, whiteClamp );
+}
@@ -92,6 +92,10 @@ void IndexedIO::readable(const IndexedIO::EntryID &name) const
 {
 }
 
+void IndexedIO::prefetch( const std::vector<IndexedIO::EntryIDList> &paths ) const
+{
+}
+
 void IndexedIO::writable(const IndexedIO::EntryID &name) const
 {
 	if ( ( openMode() & (IndexedIO::Write | IndexedIO::Append) ) == 0)
@@ -37,6 +37,7 @@
 #include "IECore/DespatchTypedData.h"
 #include "IECore/CompoundParameter.h"
 #include "IECore/LinearToAlexaLogcDataConversion.h"
+#include "IECore/private/ParallelDataConversion.h"
 
 using namespace IECore;
 using namespace std;
@@ -55,23 +56,8 @@ LinearToAlexaLogcOp::~LinearToAlexaLogcOp()
 {
 }
 
-struct LinearToAlexaLogcOp::Converter
+struct LinearToAlexaLogcOp::Converter : public Detail::ParallelDataConversion<LinearToAlexaLogcDataConversion>
 {
-	typedef void ReturnType;
-
-	template<typename T>
-	ReturnType operator()( T * data )
-	{
-		typedef typename T::ValueType Container;
-		typedef typename Container::value_type V;
-		typedef typename Container::iterator It;
-		LinearToAlexaLogcDataConversion< V, V > converter;
-		It end = data->writable().end();
-		for ( It it = data->writable().begin(); it != end; it++ )
-		{
-			*it = converter( *it );
-		}
-	}
 };
 
 void LinearToAlexaLogcOp::modifyChannels( const Imath::Box2i &displayWindow, const Imath::Box2i &dataWindow, ChannelVector &channels )
@@ -37,6 +37,7 @@
 #include "IECore/DespatchTypedData.h"
 #include "IECore/CompoundParameter.h"
 #include "IECore/LinearToRec709DataConversion.h"
+#include "IECore/private/ParallelDataConversion.h"
 
 using namespace IECore;
 using namespace std;
@@ -55,23 +56,8 @@ LinearToRec709Op::~LinearToRec709Op()
 {
 }
 
-struct LinearToRec709Op::Converter
+struct LinearToRec709Op::Converter : public Detail::ParallelDataConversion<LinearToRec709DataConversion>
 {
-	typedef void ReturnType;
-
-	template<typename T>
-	ReturnType operator()( T * data )
-	{
-		typedef typename T::ValueType Container;
-		typedef typename Container::value_type V;
-		typedef typename Container::iterator It;
-		LinearToRec709DataConversion< V, V > converter;
-		It end = data->writable().end();
-		for ( It it = data->writable().begin(); it != end; it++ )
-		{
-			*it = converter( *it );
-		}
-	}
 };
 
 void LinearToRec709Op::modifyChannels( const Imath::Box2i &displayWindow, const Imath::Box2i &dataWindow, ChannelVector &channels )
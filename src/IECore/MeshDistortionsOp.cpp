@@ -36,9 +36,10 @@
 #include <algorithm>
 
 #include "boost/format.hpp"
-#include "tbb/parallel_sort.h"
+#include "tbb/parallel_for.h"
 
 #include "IECore/MeshDistortionsOp.h"
+#include "IECore/MeshTopology.h"
 #include "IECore/DespatchTypedData.h"
 #include "IECore/CompoundParameter.h"
 
@@ -191,9 +192,9 @@ struct MeshDistortionsOp::CalculateDistortions
 	public :
 		typedef void ReturnType;
 	
-		CalculateDistortions( const vector<int> &vertsPerFace, const vector<int> &vertIds, size_t faceVaryingSize, const vector<float> *u, const vector<float> *v, const vector<int> &uvIndices, ConstDataPtr pRefData )
+		CalculateDistortions( const MeshTopology *topology, const vector<float> *u, const vector<float> *v, const vector<int> &uvIndices, const MeshTopology *uvTopology, ConstDataPtr pRefData )
 			:	vvDistortionsData(0), fvUDistortionsData(0), fvVDistortionsData(0),
-				m_vertsPerFace( vertsPerFace ), m_vertIds( vertIds ), m_faceVaryingSize(faceVaryingSize), m_u( u ), m_v( v ), m_uvIds( uvIndices ), m_pRefData(pRefData)
+				m_topology( topology ), m_u( u ), m_v( v ), m_uvIds( uvIndices ), m_uvTopology( uvTopology ), m_pRefData(pRefData)
 		{
 		}
 	
@@ -204,165 +205,261 @@ struct MeshDistortionsOp::CalculateDistortions
 	
 	private :
 
-		const vector<int> &m_vertsPerFace;
-		const vector<int> &m_vertIds;
-		const size_t m_faceVaryingSize;
+		const MeshTopology *m_topology;
 		const vector<float> *m_u;
 		const vector<float> *m_v;
 		const vector<int> &m_uvIds;
+		const MeshTopology *m_uvTopology;
 		ConstDataPtr m_pRefData;
 
-		struct UVDistortion
+		// computes the distortion along each edge of the mesh
+		template<typename VecContainer>
+		struct EdgeDistortions
 		{
-			Imath::V2f distortion;
-			int counter;
+			typedef typename VecContainer::value_type Vec;
 
-			UVDistortion() : distortion(0), counter(0) 	{};
+			EdgeDistortions( const VecContainer &points, const VecContainer &refPoints, const vector<Imath::V2i> &edges, vector<float> &distortions )
+				:	m_points( points ), m_refPoints( refPoints ), m_edges( edges ), m_distortions( distortions )
+			{
+			}
 
-			void accumulateDistortion( float dist, const Imath::V2f &uv )
+			void operator()( const tbb::blocked_range<size_t> &r ) const
 			{
-				distortion.x += fabs( uv.x ) * dist;
-				distortion.y += fabs( uv.y ) * dist;
-				counter++;
+				for( size_t i = r.begin(); i != r.end(); ++i )
+				{
+					const Imath::V2i &e = m_edges[i];
+					Vec edge = m_points[e[1]] - m_points[e[0]];
+					Vec refEdge = m_refPoints[e[1]] - m_refPoints[e[0]];
+					float edgeLen = edge.length();
+					float refEdgeLen = refEdge.length();
+					float distortion = 0;
+					if ( edgeLen >= refEdgeLen )
+					{
+						distortion = fabs((edgeLen / refEdgeLen) - 1.0f);
+					}
+					else
+					{
+						distortion = -fabs( (refEdgeLen / edgeLen) - 1.0f );
+					}
+					m_distortions[i] = distortion;
+				}
 			}
+
+			const VecContainer &m_points;
+			const VecContainer &m_refPoints;
+			const vector<Imath::V2i> &m_edges;
+			vector<float> &m_distortions;
 		};
-		std::vector< UVDistortion > m_uvDistortions;
 
-		struct VertexDistortion 
+		// averages the distortions of the edges leaving and arriving at each vertex.
+		struct VertexDistortions
 		{
-			float distortion;
-			int counter;
-
-			VertexDistortion() : distortion(0), counter(0) 	{};
+			VertexDistortions( const MeshTopology *topology, const vector<float> &edgeDistortions, vector<float> &distortions )
+				:	m_topology( topology ), m_offsets( topology->vertexFaceVertexOffsets() ), m_faceVertices( topology->vertexFaceVertices() ),
+					m_faceVertexEdges( topology->faceVertexEdges() ), m_edgeDistortions( edgeDistortions ), m_distortions( distortions )
+			{
+			}
 
-			void accumulateDistortion( float dist )
+			void operator()( const tbb::blocked_range<size_t> &r ) const
 			{
-				distortion += dist;
-				counter++;
+				for( size_t i = r.begin(); i != r.end(); ++i )
+				{
+					float distortion = 0;
+					int counter = 0;
+					for( int j = m_offsets[i]; j < m_offsets[i+1]; ++j )
+					{
+						// the half-edges are visited in the same order as a
+						// walk over the faces would visit them.
+						const int fv = m_faceVertices[j];
+						const int previousFv = m_topology->previousFaceVertex( fv );
+						if( previousFv > fv )
+						{
+							distortion += m_edgeDistortions[m_faceVertexEdges[fv]];
+							distortion += m_edgeDistortions[m_faceVertexEdges[previousFv]];
+						}
+						else
+						{
+							distortion += m_edgeDistortions[m_faceVertexEdges[previousFv]];
+							distortion += m_edgeDistortions[m_faceVertexEdges[fv]];
+						}
+						counter += 2;
+					}
+					float invCounter = 0;
+					if ( counter )
+						invCounter = (1.0f/counter);
+					m_distortions[i] = distortion * invCounter;
+				}
 			}
-		};
-		std::vector< VertexDistortion > m_distortions;
 
-	public :
+			const MeshTopology *m_topology;
+			const vector<int> &m_offsets;
+			const vector<int> &m_faceVertices;
+			const vector<int> &m_faceVertexEdges;
+			const vector<float> &m_edgeDistortions;
+			vector<float> &m_distortions;
+		};
 
-		template<typename T>
-		ReturnType operator()( T * data )
+		// computes the uv direction along each half-edge.
+		struct UVDirections
 		{
-			typedef typename T::ValueType VecContainer;
-			typedef typename VecContainer::value_type Vec;
-			const T * refData = (T*)m_pRefData.get();
-			const VecContainer &points = data->readable();
-			const VecContainer &refPoints = refData->readable();
-			bool computeUV =  ( m_u && m_v );
+			UVDirections( const MeshTopology *topology, const vector<float> &u, const vector<float> &v, vector<Imath::V2f> &directions )
+				:	m_topology( topology ), m_u( u ), m_v( v ), m_directions( directions )
+			{
+			}
 
-			m_distortions.clear();
-			m_distortions.resize( points.size() );
+			void operator()( const tbb::blocked_range<size_t> &r ) const
+			{
+				for( size_t i = r.begin(); i != r.end(); ++i )
+				{
+					const int nextFv = m_topology->nextFaceVertex( i );
+					const Imath::V2f uv0( m_u[i], m_v[i] );
+					const Imath::V2f uv1( m_u[nextFv], m_v[nextFv] );
+					m_directions[i] = (uv1 - uv0).normalized();
+				}
+			}
 
-			// uses the uvIndices array in the same way MeshTangentsOp does...
-			int numUniqueTangents = 1 + *max_element( m_uvIds.begin(), m_uvIds.end() );
+			const MeshTopology *m_topology;
+			const vector<float> &m_u;
+			const vector<float> &m_v;
+			vector<Imath::V2f> &m_directions;
+		};
 
-			if ( computeUV )
+		// averages the distortions of the half-edges leaving and arriving at each
+		// unique uv, weighted by the uv direction of each half-edge.
+		struct UVDistortions
+		{
+			UVDistortions( const MeshTopology *uvTopology, const vector<int> &faceVertexEdges, const vector<float> &edgeDistortions, const vector<Imath::V2f> &directions, vector<Imath::V2f> &distortions )
+				:	m_uvTopology( uvTopology ), m_offsets( uvTopology->vertexFaceVertexOffsets() ), m_faceVertices( uvTopology->vertexFaceVertices() ),
+					m_faceVertexEdges( faceVertexEdges ), m_edgeDistortions( edgeDistortions ), m_directions( directions ), m_distortions( distortions )
 			{
-				m_uvDistortions.clear();
-				m_uvDistortions.resize( numUniqueTangents );
 			}
 
-			size_t fvi0 = 0;
-
-			for( size_t faceIndex = 0; faceIndex < m_vertsPerFace.size() ; faceIndex++ )
+			void operator()( const tbb::blocked_range<size_t> &r ) const
 			{
-				size_t firstFvi = fvi0;
-				unsigned vertex0 = m_vertIds[ fvi0 ];
-				Imath::V2f uv0(0);
-				if ( computeUV )
-				{
-					uv0 = Imath::V2f( (*m_u)[ fvi0 ], (*m_v)[ fvi0 ] );
-				}
-				for ( int v = 1; v <= m_vertsPerFace[faceIndex]; v++, fvi0++ )
+				for( size_t i = r.begin(); i != r.end(); ++i )
 				{
-					size_t fvi1 = fvi0 + 1;
-					if ( v == m_vertsPerFace[faceIndex] )
+					Imath::V2f distortion( 0 );
+					int counter = 0;
+					for( int j = m_offsets[i]; j < m_offsets[i+1]; ++j )
 					{
-						// final edge must also be computed...
-						fvi1 = firstFvi;
+						const int fv = m_faceVertices[j];
+						const int previousFv = m_uvTopology->previousFaceVertex( fv );
+						if( previousFv > fv )
+						{
+							accumulate( fv, distortion );
+							accumulate( previousFv, distortion );
+						}
+						else
+						{
+							accumulate( previousFv, distortion );
+							accumulate( fv, distortion );
+						}
+						counter += 2;
 					}
-					unsigned vertex1 = m_vertIds[ fvi1 ];
-					// compute distortion along the edge					
-					const Vec &p0 = points[ vertex0 ];
-					const Vec &refP0 = refPoints[ vertex0 ];
-					const Vec &p1 = points[ vertex1 ];
-					const Vec &refP1 = refPoints[ vertex1 ];
-					Vec edge = p1 - p0;
-					Vec refEdge = refP1 - refP0;
-					float edgeLen = edge.length();
-					float refEdgeLen = refEdge.length();
-					float distortion = 0;
-					if ( edgeLen >= refEdgeLen )
+					if ( counter )
 					{
-						distortion = fabs((edgeLen / refEdgeLen) - 1.0f);
-					}
-					else
-					{
-						distortion = -fabs( (refEdgeLen / edgeLen) - 1.0f );
+						distortion /= (float)counter;
 					}
+					m_distortions[i] = distortion;
+				}
+			}
 
-					// accumulate vertex distortions
-					m_distortions[ vertex0 ].accumulateDistortion( distortion );
-					m_distortions[ vertex1 ].accumulateDistortion( distortion );
-					vertex0 = vertex1;
+			void accumulate( int halfEdge, Imath::V2f &distortion ) const
+			{
+				const float dist = m_edgeDistortions[m_faceVertexEdges[halfEdge]];
+				const Imath::V2f &uv = m_directions[halfEdge];
+				distortion.x += fabs( uv.x ) * dist;
+				distortion.y += fabs( uv.y ) * dist;
+			}
 
-					if ( computeUV )
-					{
-						// compute uv vector
-						const Imath::V2f uv1( (*m_u)[ fvi1 ], (*m_v)[ fvi1 ] );
-						const Imath::V2f uvDir = (uv1 - uv0).normalized();
-						// accumulate uv distortion
-						m_uvDistortions[ m_uvIds[fvi0] ].accumulateDistortion( distortion, uvDir );
-						m_uvDistortions[ m_uvIds[fvi1] ].accumulateDistortion( distortion, uvDir );
-						uv0 = uv1;
-					}
+			const MeshTopology *m_uvTopology;
+			const vector<int> &m_offsets;
+			const vector<int> &m_faceVertices;
+			const vector<int> &m_faceVertexEdges;
+			const vector<float> &m_edgeDistortions;
+			const vector<Imath::V2f> &m_directions;
+			vector<Imath::V2f> &m_distortions;
+		};
+
+		// shuffles the unique uv distortions back into facevarying data.
+		struct FaceVaryingDistortions
+		{
+			FaceVaryingDistortions( const vector<Imath::V2f> &distortions, const vector<int> &uvIds, vector<float> &uDistortions, vector<float> &vDistortions )
+				:	m_distortions( distortions ), m_uvIds( uvIds ), m_uDistortions( uDistortions ), m_vDistortions( vDistortions )
+			{
+			}
+
+			void operator()( const tbb::blocked_range<size_t> &r ) const
+			{
+				for( size_t i = r.begin(); i != r.end(); ++i )
+				{
+					const Imath::V2f &distortion = m_distortions[m_uvIds[i]];
+					m_uDistortions[i] = distortion.x;
+					m_vDistortions[i] = distortion.y;
 				}
-				fvi0 = firstFvi + m_vertsPerFace[faceIndex];
 			}
 
-			// normalize distortions and build output vectors
+			const vector<Imath::V2f> &m_distortions;
+			const vector<int> &m_uvIds;
+			vector<float> &m_uDistortions;
+			vector<float> &m_vDistortions;
+		};
+
+	public :
+
+		template<typename T>
+		ReturnType operator()( T * data )
+		{
+			typedef typename T::ValueType VecContainer;
+			const T * refData = (T*)m_pRefData.get();
+			const VecContainer &points = data->readable();
+			const VecContainer &refPoints = refData->readable();
+			bool computeUV =  ( m_u && m_v );
+
+			// each edge is shared by the faces on either side of it, so we compute its
+			// distortion just once. the distortions are then gathered from the half-edges
+			// leaving and arriving at each vertex, so that they can be averaged in parallel.
+			vector<float> edgeDistortions( m_topology->numEdges() );
+			tbb::parallel_for(
+				tbb::blocked_range<size_t>( 0, edgeDistortions.size(), 1000 ),
+				EdgeDistortions<VecContainer>( points, refPoints, m_topology->edges(), edgeDistortions )
+			);
 
 			// create the distortion prim var.
 			vvDistortionsData = new FloatVectorData();
 			std::vector<float> &distortionVec = vvDistortionsData->writable();
-			distortionVec.reserve( m_distortions.size() );
-			for ( std::vector< VertexDistortion >::iterator vIt = m_distortions.begin(); vIt != m_distortions.end(); vIt++ )
-			{
-				float invCounter = 0;
-				if ( vIt->counter )
-					invCounter = (1.0f/vIt->counter);
-				distortionVec.push_back( vIt->distortion * invCounter );
-			}
-
-			// create U and V distortions
+			distortionVec.resize( points.size() );
+			tbb::parallel_for(
+				tbb::blocked_range<size_t>( 0, distortionVec.size(), 1000 ),
+				VertexDistortions( m_topology, edgeDistortions, distortionVec )
+			);
+
+			// create U and V distortions. uses the uvIndices array in the same way MeshTangentsOp does,
+			// gathering onto each unique uv via the uv topology.
 			if ( computeUV )
 			{
+				vector<Imath::V2f> uvDirections( m_topology->numFaceVertices() );
+				tbb::parallel_for(
+					tbb::blocked_range<size_t>( 0, uvDirections.size(), 1000 ),
+					UVDirections( m_topology, *m_u, *m_v, uvDirections )
+				);
+
+				vector<Imath::V2f> uvDistortions( m_uvTopology->numVertices() );
+				tbb::parallel_for(
+					tbb::blocked_range<size_t>( 0, uvDistortions.size(), 1000 ),
+					UVDistortions( m_uvTopology, m_topology->faceVertexEdges(), edgeDistortions, uvDirections, uvDistortions )
+				);
+
 				fvUDistortionsData = new FloatVectorData();
 				fvVDistortionsData = new FloatVectorData();
 				std::vector<float> &uDistortionVec = fvUDistortionsData->writable();
-				uDistortionVec.reserve( m_faceVaryingSize );
+				uDistortionVec.resize( m_u->size() );
 				std::vector<float> &vDistortionVec = fvVDistortionsData->writable();
-				vDistortionVec.reserve( m_faceVaryingSize );
-				
-				vector<float>::const_iterator uIt, vIt;
-				unsigned fvi = 0;
-
-				for ( uIt = m_u->begin(), vIt = m_v->begin(); uIt != m_u->end(); uIt++, vIt++, fvi++ )
-				{
-					UVDistortion &uvDist = m_uvDistortions[ m_uvIds[ fvi] ];
-					if ( uvDist.counter )
-					{
-						uvDist.distortion /= (float)uvDist.counter;
-						uvDist.counter = 0;
-					}
-					uDistortionVec.push_back( uvDist.distortion.x );
-					vDistortionVec.push_back( uvDist.distortion.y );
-				}
+				vDistortionVec.resize( m_u->size() );
+				tbb::parallel_for(
+					tbb::blocked_range<size_t>( 0, uDistortionVec.size(), 1000 ),
+					FaceVaryingDistortions( uvDistortions, m_uvIds, uDistortionVec, vDistortionVec )
+				);
 			}
 
 		}
@@ -452,10 +549,17 @@ void MeshDistortionsOp::modifyTypedPrimitive( MeshPrimitive * mesh, const Compou
 	const std::string &uDistortionPrimVarName = uDistortionPrimVarNameParameter()->getTypedValue();
 	const std::string &vDistortionPrimVarName = vDistortionPrimVarNameParameter()->getTypedValue();
 
-	size_t faceVaryingSize = mesh->variableSize( PrimitiveVariable::FaceVarying );
+	ConstMeshTopologyPtr topology = MeshTopology::get( mesh );
+	ConstMeshTopologyPtr uvTopology = 0;
+	if ( uData && vData )
+	{
+		const vector<int> &uvIndices = uvIndicesData->readable();
+		const size_t numUniqueUVs = uvIndices.size() ? 1 + *max_element( uvIndices.begin(), uvIndices.end() ) : 0;
+		uvTopology = MeshTopology::get( vertsPerFace, uvIndicesData.get(), numUniqueUVs );
+	}
 
-	CalculateDistortions f( vertsPerFace->readable(), mesh->vertexIds()->readable(), faceVaryingSize, (uData ? &uData->readable() : 0 ), 
-			( vData ? &vData->readable() : 0 ), uvIndicesData->readable(), pRefData );
+	CalculateDistortions f( topology.get(), (uData ? &uData->readable() : 0 ), 
+			( vData ? &vData->readable() : 0 ), uvIndicesData->readable(), uvTopology.get(), pRefData );
 
 	despatchTypedData<CalculateDistortions, TypeTraits::IsVec3VectorTypedData, HandleErrors>( pData, f );
 
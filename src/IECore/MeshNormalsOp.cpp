@@ -35,9 +35,12 @@
 #include "IECore/MeshNormalsOp.h"
 #include "IECore/DespatchTypedData.h"
 #include "IECore/CompoundParameter.h"
+#include "IECore/MeshTopology.h"
 
 #include "boost/format.hpp"
 
+#include "tbb/parallel_for.h"
+
 using namespace IECore;
 using namespace std;
 
@@ -91,8 +94,8 @@ struct MeshNormalsOp::CalculateNormals
 {
 	typedef DataPtr ReturnType;
 
-	CalculateNormals( const IntVectorData * vertsPerFace, const IntVectorData * vertIds )
-		:	m_vertsPerFace( vertsPerFace ), m_vertIds( vertIds )
+	CalculateNormals( const IntVectorData * vertIds, const MeshTopology * topology )
+		:	m_vertIds( vertIds ), m_topology( topology )
 	{
 	}
 
@@ -100,48 +103,99 @@ struct MeshNormalsOp::CalculateNormals
 	ReturnType operator()( T * data )
 	{
 		typedef typename T::ValueType VecContainer;
-		typedef typename VecContainer::value_type Vec;
 
 		const typename T::ValueType &points = data->readable();
-		const vector<int> &vertsPerFace = m_vertsPerFace->readable();
-		const vector<int> &vertIds = m_vertIds->readable();
 
+		// calculate the normal for each face
+		VecContainer faceNormals( m_topology->numFaces() );
+		tbb::parallel_for(
+			tbb::blocked_range<size_t>( 0, faceNormals.size(), 1000 ),
+			FaceNormals<VecContainer>( points, m_vertIds->readable(), m_topology->faceOffsets(), faceNormals )
+		);
+
+		// and then for each vertex, accumulate the normals of the faces which
+		// use it. gathering rather than scattering from the faces allows us to
+		// do this in parallel, and the order of accumulation matches that of a
+		// serial loop over the faces.
 		typename T::Ptr normalsData = new T;
 		normalsData->setInterpretation( GeometricData::Normal );
 		VecContainer &normals = normalsData->writable();
-		normals.resize( points.size(), Vec( 0 ) );
+		normals.resize( points.size() );
+		tbb::parallel_for(
+			tbb::blocked_range<size_t>( 0, normals.size(), 1000 ),
+			VertexNormals<VecContainer>( faceNormals, m_topology, normals )
+		);
 
-		// for each face, calculate its normal, and accumulate that normal onto
-		// the normal for each of its vertices.
-		const int *vertId = &(vertIds[0]);
-		for( vector<int>::const_iterator it = vertsPerFace.begin(); it!=vertsPerFace.end(); it++ )
+		return normalsData;
+	}
+
+	private :
+
+		template<typename VecContainer>
+		struct FaceNormals
 		{
-			const Vec &p0 = points[*vertId];
-			const Vec &p1 = points[*(vertId+1)];
-			const Vec &p2 = points[*(vertId+2)];
+			typedef typename VecContainer::value_type Vec;
+
+			FaceNormals( const VecContainer &points, const vector<int> &vertIds, const vector<int> &faceOffsets, VecContainer &faceNormals )
+				:	m_points( points ), m_vertIds( vertIds ), m_faceOffsets( faceOffsets ), m_faceNormals( faceNormals )
+			{
+			}
 
-			Vec normal = (p2-p1).cross(p0-p1);
-			normal.normalize();
-			for( int i=0; i<*it; i++ )
+			void operator()( const tbb::blocked_range<size_t> &r ) const
 			{
-				normals[*vertId] += normal;
-				vertId++;
+				for( size_t f=r.begin(); f!=r.end(); ++f )
+				{
+					const int *vertId = &(m_vertIds[m_faceOffsets[f]]);
+					const Vec &p0 = m_points[*vertId];
+					const Vec &p1 = m_points[*(vertId+1)];
+					const Vec &p2 = m_points[*(vertId+2)];
+
+					Vec normal = (p2-p1).cross(p0-p1);
+					normal.normalize();
+					m_faceNormals[f] = normal;
+				}
 			}
-		}
 
-		// normalize each of the vertex normals
-		for( typename VecContainer::iterator it=normals.begin(); it!=normals.end(); it++ )
+			const VecContainer &m_points;
+			const vector<int> &m_vertIds;
+			const vector<int> &m_faceOffsets;
+			VecContainer &m_faceNormals;
+		};
+
+		template<typename VecContainer>
+		struct VertexNormals
 		{
-			it->normalize();
-		}
+			typedef typename VecContainer::value_type Vec;
 
-		return normalsData;
-	}
+			VertexNormals( const VecContainer &faceNormals, const MeshTopology *topology, VecContainer &normals )
+				:	m_faceNormals( faceNormals ), m_offsets( topology->vertexFaceVertexOffsets() ),
+					m_faceVertices( topology->vertexFaceVertices() ), m_faces( topology->faceVertexFaces() ), m_normals( normals )
+			{
+			}
 
-	private :
+			void operator()( const tbb::blocked_range<size_t> &r ) const
+			{
+				for( size_t v=r.begin(); v!=r.end(); ++v )
+				{
+					Vec normal( 0 );
+					for( int i=m_offsets[v]; i<m_offsets[v+1]; ++i )
+					{
+						normal += m_faceNormals[m_faces[m_faceVertices[i]]];
+					}
+					normal.normalize();
+					m_normals[v] = normal;
+				}
+			}
+
+			const VecContainer &m_faceNormals;
+			const vector<int> &m_offsets;
+			const vector<int> &m_faceVertices;
+			const vector<int> &m_faces;
+			VecContainer &m_normals;
+		};
 
-		ConstIntVectorDataPtr m_vertsPerFace;
 		ConstIntVectorDataPtr m_vertIds;
+		ConstMeshTopologyPtr m_topology;
 
 };
 
@@ -171,7 +225,7 @@ void MeshNormalsOp::modifyTypedPrimitive( MeshPrimitive * mesh, const CompoundOb
 		throw InvalidArgumentException( e );
 	}
 
-	CalculateNormals f( mesh->verticesPerFace(), mesh->vertexIds() );
+	CalculateNormals f( mesh->vertexIds(), MeshTopology::get( mesh ).get() );
 	DataPtr n = despatchTypedData<CalculateNormals, TypeTraits::IsVec3VectorTypedData, HandleErrors>( pvIt->second.data, f );
 
 	mesh->variables[ nPrimVarNameParameter()->getTypedValue() ] = PrimitiveVariable( PrimitiveVariable::Vertex, n );
@@ -33,6 +33,10 @@
 //////////////////////////////////////////////////////////////////////////
 
 #include <cassert>
+#include <algorithm>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
 
 #include "OpenEXR/ImathBoxAlgo.h"
 #include "OpenEXR/ImathLineAlgo.h"
@@ -205,7 +209,7 @@ const V3i &MeshPrimitiveEvaluator::Result::vertexIds() const
 	return m_vertexIds;
 }
 
-MeshPrimitiveEvaluator::MeshPrimitiveEvaluator( ConstMeshPrimitivePtr mesh ) : m_uvTree(0), m_haveMassProperties( false ), m_haveSurfaceArea( false ), m_haveAverageNormals( false )
+MeshPrimitiveEvaluator::MeshPrimitiveEvaluator( ConstMeshPrimitivePtr mesh, TreeType treeType ) : m_treeType( treeType ), m_tree( 0 ), m_bvh( 0 ), m_uvTree(0), m_haveMassProperties( false ), m_haveSurfaceArea( false ), m_haveAverageNormals( false )
 {
 	if (! mesh )
 	{
@@ -295,7 +299,14 @@ MeshPrimitiveEvaluator::MeshPrimitiveEvaluator( ConstMeshPrimitivePtr mesh ) : m
 		}
 	}
 	
-	m_tree = new TriangleBoundTree( m_triangles.begin(), m_triangles.end() );
+	if( m_treeType == BVHType )
+	{
+		m_bvh = new TriangleBVH( m_triangles.begin(), m_triangles.end() );
+	}
+	else
+	{
+		m_tree = new TriangleBoundTree( m_triangles.begin(), m_triangles.end() );
+	}
 
 	if ( m_u.interpolation != PrimitiveVariable::Invalid && m_v.interpolation != PrimitiveVariable::Invalid )
 	{
@@ -317,11 +328,12 @@ PrimitiveEvaluatorPtr MeshPrimitiveEvaluator::create( ConstPrimitivePtr primitiv
 
 MeshPrimitiveEvaluator::~MeshPrimitiveEvaluator()
 {
-	assert( m_tree );
-
 	delete m_tree;
 	m_tree = 0;
 
+	delete m_bvh;
+	m_bvh = 0;
+
 	delete m_uvTree;
 	m_uvTree = 0;
 }
@@ -466,184 +478,196 @@ void MeshPrimitiveEvaluator::calculateMassProperties() const
 	m_haveMassProperties = true;
 }
 
-void MeshPrimitiveEvaluator::calculateAverageNormals() const
+class MeshPrimitiveEvaluator::VertexAngleWeightedNormals
 {
-	assert( m_mesh );
-	
-	if( m_haveAverageNormals )
-	{
-		return;
-	}
-	
-	NormalsMutex::scoped_lock lock( m_normalsMutex );
-	if( m_haveAverageNormals )
-	{
-		// another thread may have calculated the normals while we waited for the mutex
-		return;
-	}
-	
-	ConstIntVectorDataPtr verticesPerFace = m_mesh->verticesPerFace();
 
-#ifndef NDEBUG
-	for (IntVectorData::ValueType::const_iterator it = verticesPerFace->readable().begin(); it != verticesPerFace->readable().end(); ++it )
-	{
-		assert( *it == 3 );
-	}
-#endif
+	public :
 
-	/// Build vertex connectivity. We want to be able to quickly find the list of triangles connected to each vertex.
-	typedef std::map< VertexIndex, std::set<TriangleIndex> > VertexConnectivity;
-	VertexConnectivity vertexConnectivity;
-
-	IntVectorData::ValueType::const_iterator it = m_meshVertexIds->begin();
-	int triangleIndex = 0;
-	while ( it != m_meshVertexIds->end() )
-	{
-		VertexIndex v0 = *it ++;
-		VertexIndex v1 = *it ++;
-		VertexIndex v2 = *it ++;
+		VertexAngleWeightedNormals( const MeshPrimitiveEvaluator *evaluator, const MeshTopology *topology, std::vector<V3f> &normals )
+			:	m_evaluator( evaluator ), m_topology( topology ), m_normals( normals )
+		{
+		}
 
-		vertexConnectivity[ v0 ].insert( triangleIndex );
-		vertexConnectivity[ v1 ].insert( triangleIndex );
-		vertexConnectivity[ v2 ].insert( triangleIndex );
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			const std::vector<V3f> &verts = m_evaluator->m_verts->readable();
+			const std::vector<int> &vertexIds = *(m_evaluator->m_meshVertexIds);
+			const std::vector<int> &offsets = m_topology->vertexFaceVertexOffsets();
+			const std::vector<int> &faceVertices = m_topology->vertexFaceVertices();
+			const std::vector<int> &faces = m_topology->faceVertexFaces();
 
-		triangleIndex++;
-	}
+			for( size_t i = r.begin(); i != r.end(); ++i )
+			{
+				const VertexIndex vertexIndex = i;
+				Imath::V3f n( 0.0, 0.0, 0.0 );
 
-	assert( triangleIndex == (int)(verticesPerFace->readable().size()) );
+				TriangleIndex previousTriangle = -1;
+				for( int j = offsets[vertexIndex]; j < offsets[vertexIndex+1]; ++j )
+				{
+					/// The face-vertices are sorted, so a triangle referencing the vertex
+					/// more than once appears consecutively, and is only counted once.
+					const TriangleIndex triangle = faces[faceVertices[j]];
+					if( triangle == previousTriangle )
+					{
+						continue;
+					}
+					previousTriangle = triangle;
 
-	/// Calculate "Angle-weighted pseudo-normal" for each vertex. A description of this, and proof of its validity for use in signed distance functions
-	/// can be found here: www.ann.jussieu.fr/~frey/papiers/PsNormTVCG.pdf
-	m_vertexAngleWeightedNormals = new V3fVectorData( );
-	m_vertexAngleWeightedNormals->writable().reserve( m_verts->readable().size() );
+					/// Find the vertices associated with this triangle
+					VertexIndex v0 = vertexIds[ triangle * 3 + 0 ];
+					VertexIndex v1 = vertexIds[ triangle * 3 + 1 ];
+					VertexIndex v2 = vertexIds[ triangle * 3 + 2 ];
 
-	int numVertices = m_verts->readable().size();
+					/// Find the two edges that go from the current vertex (i) to the other	two triangle vertices
+					Imath::V3f e0, e1;
+					if ( v2 == vertexIndex )
+					{
+						e0 = (verts[ v1 ] - verts[ v2 ]).normalized();
+						e1 = (verts[ v0 ] - verts[ v2 ]).normalized();
+					}
+					else if ( v1 == vertexIndex )
+					{
+						e0 = (verts[ v2 ] - verts[ v1 ]).normalized();
+						e1 = (verts[ v0 ] - verts[ v1 ]).normalized();
+					}
+					else
+					{
+						assert( v0 == vertexIndex );
 
-	for ( VertexIndex vertexIndex = 0; vertexIndex < numVertices; vertexIndex++)
-	{
-		Imath::V3f n( 0.0, 0.0, 0.0 );
+						e0 = (verts[ v1 ] - verts[ v0 ]).normalized();
+						e1 = (verts[ v2 ] - verts[ v0 ]).normalized();
+					}
 
-		const std::set<TriangleIndex> &connectedTriangles = vertexConnectivity[ vertexIndex ];
+					double cosAngle = e0.dot( e1 );
+					double angle = acos( cosAngle );
+					assert( angle >= -Imath::limits<double>::epsilon() );
 
-		double angleTotal = 0.0;
-		for (std::set<TriangleIndex>::const_iterator faceIt = connectedTriangles.begin(); faceIt != connectedTriangles.end(); ++faceIt)
-		{
+					n += triangleNormal( verts[ v0 ], verts[ v1 ], verts[ v2 ] ) * angle;
+				}
 
-			/// Find the vertices associated with this triangle
-			VertexIndex v0 = (*m_meshVertexIds)[ (*faceIt) * 3 + 0 ];
-			assert( vertexConnectivity[ v0 ].find( *faceIt ) != vertexConnectivity[ v0 ].end() );
+				n.normalize();
+				m_normals[i] = n;
+			}
+		}
 
-			VertexIndex v1 = (*m_meshVertexIds)[ (*faceIt) * 3 + 1 ];
-			assert( vertexConnectivity[ v1 ].find( *faceIt ) != vertexConnectivity[ v1 ].end() );
+	private :
 
-			VertexIndex v2 = (*m_meshVertexIds)[ (*faceIt) * 3 + 2 ];
-			assert( vertexConnectivity[ v2 ].find( *faceIt ) != vertexConnectivity[ v2 ].end() );
+		const MeshPrimitiveEvaluator *m_evaluator;
+		const MeshTopology *m_topology;
+		std::vector<V3f> &m_normals;
 
-			/// Find the two edges that go from the current vertex (i) to the other	two triangle vertices
-			Imath::V3f e0, e1;
-			if ( v2 == vertexIndex )
-			{
-				e0 = (m_verts->readable()[ v1 ] - m_verts->readable()[ v2 ]).normalized();
-				e1 = (m_verts->readable()[ v0 ] - m_verts->readable()[ v2 ]).normalized();
-			}
-			else if ( v1 == vertexIndex )
-			{
-				e0 = (m_verts->readable()[ v2 ] - m_verts->readable()[ v1 ]).normalized();
-				e1 = (m_verts->readable()[ v0 ] - m_verts->readable()[ v1 ]).normalized();
-			}
-			else
-			{
-				assert( v0 == vertexIndex );
+};
 
-				e0 = (m_verts->readable()[ v1 ] - m_verts->readable()[ v0 ]).normalized();
-				e1 = (m_verts->readable()[ v2 ] - m_verts->readable()[ v0 ]).normalized();
-			}
+class MeshPrimitiveEvaluator::EdgeAverageNormals
+{
 
-			double cosAngle = e0.dot( e1 );
-			double angle = acos( cosAngle );
-			assert( angle >= -Imath::limits<double>::epsilon() );
-			angleTotal += angle;
+	public :
 
-			const Imath::V3f &p0 = m_verts->readable()[ v0 ];
-			const Imath::V3f &p1 = m_verts->readable()[ v1 ];
-			const Imath::V3f &p2 = m_verts->readable()[ v2 ];
-			n += triangleNormal( p0, p1, p2 ) * angle;
+		EdgeAverageNormals( const MeshPrimitiveEvaluator *evaluator, const MeshTopology *topology, std::vector<V3f> &normals )
+			:	m_evaluator( evaluator ), m_topology( topology ), m_normals( normals )
+		{
 		}
 
-		n.normalize();
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			const std::vector<V3f> &verts = m_evaluator->m_verts->readable();
+			const std::vector<int> &vertexIds = *(m_evaluator->m_meshVertexIds);
+			const std::vector<int> &offsets = m_topology->edgeFaceVertexOffsets();
+			const std::vector<int> &faceVertices = m_topology->edgeFaceVertices();
+			const std::vector<int> &faces = m_topology->faceVertexFaces();
 
-		assert(m_vertexAngleWeightedNormals);
+			for( size_t e = r.begin(); e != r.end(); ++e )
+			{
+				assert( offsets[e+1] - offsets[e] == 2 );
 
-		m_vertexAngleWeightedNormals->writable().push_back( n );
-	}
+				TriangleIndex triangle0 = faces[ faceVertices[ offsets[e] ] ];
+				TriangleIndex triangle1 = faces[ faceVertices[ offsets[e] + 1 ] ];
 
-	assert( m_vertexAngleWeightedNormals->readable().size() == m_verts->readable().size()  );
+				const Imath::V3f &p00 = verts[ vertexIds[ triangle0 * 3 + 0 ] ];
+				const Imath::V3f &p01 = verts[ vertexIds[ triangle0 * 3 + 1 ] ];
+				const Imath::V3f &p02 = verts[ vertexIds[ triangle0 * 3 + 2 ] ];
 
-	/// Calculate edge connectivity. For any given pair of (connected) vertices we want to be able to find the faces connected to that edge.
-	typedef std::map<Edge, std::vector<int> > EdgeConnectivity;
+				const Imath::V3f &p10 = verts[ vertexIds[ triangle1 * 3 + 0 ] ];
+				const Imath::V3f &p11 = verts[ vertexIds[ triangle1 * 3 + 1 ] ];
+				const Imath::V3f &p12 = verts[ vertexIds[ triangle1 * 3 + 2 ] ];
 
-	EdgeConnectivity edgeConnectivity;
+				m_normals[e] = ( triangleNormal( p00, p01, p02 ) + triangleNormal( p10, p11, p12 ) ) / 2.0f;
+			}
+		}
 
-	it = m_meshVertexIds->begin();
-	triangleIndex = 0;
-	while ( it != m_meshVertexIds->end() )
-	{
-		VertexIndex v0 = *it ++;
-		VertexIndex v1 = *it ++;
-		VertexIndex v2 = *it ++;
+	private :
 
-		edgeConnectivity[ Edge(v0, v1) ].push_back( triangleIndex );
-		edgeConnectivity[ Edge(v0, v2) ].push_back( triangleIndex );
-		edgeConnectivity[ Edge(v1, v2) ].push_back( triangleIndex );
+		const MeshPrimitiveEvaluator *m_evaluator;
+		const MeshTopology *m_topology;
+		std::vector<V3f> &m_normals;
 
-		/// Store the same edges going in the opposite direction, too. This doubles our (small) storage overhead but allows for faster lookups.
-		edgeConnectivity[ Edge(v1, v0) ].push_back( triangleIndex );
-		edgeConnectivity[ Edge(v2, v0) ].push_back( triangleIndex );
-		edgeConnectivity[ Edge(v2, v1) ].push_back( triangleIndex );
+};
 
-		triangleIndex ++;
+void MeshPrimitiveEvaluator::calculateAverageNormals() const
+{
+	assert( m_mesh );
+	
+	if( m_haveAverageNormals )
+	{
+		return;
 	}
 
-	/// Calculate the average edge normals
-	for (EdgeConnectivity::const_iterator it = edgeConnectivity.begin(); it != edgeConnectivity.end(); ++it)
+#ifndef NDEBUG
+	ConstIntVectorDataPtr verticesPerFace = m_mesh->verticesPerFace();
+	for (IntVectorData::ValueType::const_iterator it = verticesPerFace->readable().begin(); it != verticesPerFace->readable().end(); ++it )
+	{
+		assert( *it == 3 );
+	}
+#endif
+
+	/// The adjacency tables give us the triangles connected to each vertex and each edge.
+	ConstMeshTopologyPtr topology = MeshTopology::get( m_mesh.get() );
+
+	/// For any given pair of (connected) vertices we need exactly two faces connected to that edge.
+	const std::vector<int> &edgeOffsets = topology->edgeFaceVertexOffsets();
+	for( size_t e = 0, numEdges = topology->numEdges(); e < numEdges; ++e )
 	{
-		if (it->second.size() > 2)
+		const int numEdgeFaces = edgeOffsets[e+1] - edgeOffsets[e];
+		if( numEdgeFaces > 2 )
 		{
 			/// If there are more than 2 faces connected to any given edge then the mesh is non-manifold, which results in an exception.
 			throw Exception("Non-manifold mesh given to MeshPrimitiveImplicitSurfaceFunction");
 		}
-		else if (it->second.size() == 1)
+		else if( numEdgeFaces == 1 )
 		{
 			/// If there are less than 2 faces connected to any given edge then the mesh is not closed, which results in an exception.
 			throw Exception("Mesh given to MeshPrimitiveImplicitSurfaceFunction is not closed");
 		}
-		else
-		{
-			assert( it->second.size() == 2 );
-		}
-
-		TriangleIndex triangle0 = it->second[0];
-		TriangleIndex triangle1 = it->second[1];
-
-		VertexIndex v00 = (*m_meshVertexIds)[ triangle0 * 3 + 0 ];
-		VertexIndex v01 = (*m_meshVertexIds)[ triangle0 * 3 + 1 ];
-		VertexIndex v02 = (*m_meshVertexIds)[ triangle0 * 3 + 2 ];
-
-		VertexIndex v10 = (*m_meshVertexIds)[ triangle1 * 3 + 0 ];
-		VertexIndex v11 = (*m_meshVertexIds)[ triangle1 * 3 + 1 ];
-		VertexIndex v12 = (*m_meshVertexIds)[ triangle1 * 3 + 2 ];
-
-		const Imath::V3f &p00 = m_verts->readable()[ v00 ];
-		const Imath::V3f &p01 = m_verts->readable()[ v01 ];
-		const Imath::V3f &p02 = m_verts->readable()[ v02 ];
+	}
 
-		const Imath::V3f &p10 = m_verts->readable()[ v10 ];
-		const Imath::V3f &p11 = m_verts->readable()[ v11 ];
-		const Imath::V3f &p12 = m_verts->readable()[ v12 ];
+	/// Calculate "Angle-weighted pseudo-normal" for each vertex. A description of this, and proof of its validity for use in signed distance functions
+	/// can be found here: www.ann.jussieu.fr/~frey/papiers/PsNormTVCG.pdf
+	V3fVectorDataPtr vertexAngleWeightedNormals = new V3fVectorData();
+	vertexAngleWeightedNormals->writable().resize( m_verts->readable().size() );
+	tbb::parallel_for(
+		tbb::blocked_range<size_t>( 0, vertexAngleWeightedNormals->readable().size(), 1000 ),
+		VertexAngleWeightedNormals( this, topology.get(), vertexAngleWeightedNormals->writable() )
+	);
 
-		m_edgeAverageNormals[ it->first ] = ( triangleNormal( p00, p01, p02 ) + triangleNormal( p10, p11, p12 ) ) / 2.0f;
+	/// Calculate the average edge normals
+	std::vector<V3f> edgeAverageNormals( topology->numEdges() );
+	tbb::parallel_for(
+		tbb::blocked_range<size_t>( 0, edgeAverageNormals.size(), 1000 ),
+		EdgeAverageNormals( this, topology.get(), edgeAverageNormals )
+	);
+
+	/// We compute the normals before taking the lock, as a thread waiting on the lock
+	/// could otherwise be given one of our tasks, and deadlock. If several threads get
+	/// here at once they'll all compute the normals, but only the first one stores them.
+	NormalsMutex::scoped_lock lock( m_normalsMutex );
+	if( m_haveAverageNormals )
+	{
+		return;
 	}
 
+	m_topology = topology;
+	m_vertexAngleWeightedNormals = vertexAngleWeightedNormals;
+	m_edgeAverageNormals.swap( edgeAverageNormals );
 	m_haveAverageNormals = true;
 }
 
@@ -682,26 +706,25 @@ bool MeshPrimitiveEvaluator::signedDistance( const Imath::V3f &p, float &distanc
 			// Closest feature is an edge, so we need to use the average normal of the adjoining triangles
 
 			const V3i &triangleVertexIds = result->vertexIds();
-			Edge edge;
+			int edge = -1;
 
 			if ( region == 1 )
 			{
-				edge = Edge( triangleVertexIds[1], triangleVertexIds[2] );
+				edge = m_topology->edgeIndex( triangleVertexIds[1], triangleVertexIds[2] );
 			}
 			else if ( region == 3 )
 			{
-				edge = Edge( triangleVertexIds[0], triangleVertexIds[2] );
+				edge = m_topology->edgeIndex( triangleVertexIds[0], triangleVertexIds[2] );
 			}
 			else
 			{
 				assert( region == 5 );
-				edge = Edge( triangleVertexIds[0], triangleVertexIds[1] );
+				edge = m_topology->edgeIndex( triangleVertexIds[0], triangleVertexIds[1] );
 			}
 
-			EdgeAverageNormals::const_iterator it = m_edgeAverageNormals.find( edge );
-			assert (it != m_edgeAverageNormals.end() );
+			assert( edge >= 0 && edge < (int)m_edgeAverageNormals.size() );
 
-			const Imath::V3f &n = it->second;
+			const Imath::V3f &n = m_edgeAverageNormals[edge];
 			float planeConstant = n.dot( result->point() );
 			float sign = n.dot( p ) - planeConstant;
 			distance = (result->point() - p ).length() * (sign < Imath::limits<float>::epsilon() ? -1.0 : 1.0 );
@@ -766,13 +789,10 @@ bool MeshPrimitiveEvaluator::closestPoint( const V3f &p, PrimitiveEvaluator::Res
 		return false;
 	}
 
-	assert( m_tree );
-
 	Result *mr = static_cast<Result *>( result );
 
-	float maxDistSqrd = limits<float>::max();
-
-	closestPointWalk( m_tree->rootIndex(), p, maxDistSqrd, mr );
+	treeClosestPoint( p, mr );
+	completeResult( mr );
 
 	return true;
 }
@@ -802,19 +822,17 @@ bool MeshPrimitiveEvaluator::intersectionPoint( const Imath::V3f &origin, const
 		return false;
 	}
 
-	assert( m_tree );
-
 	Result *mr = static_cast<Result *>( result );
 
-	float maxDistSqrd = maxDistance * maxDistance;
-
 	Imath::Line3f ray;
 	ray.pos = origin;
 	ray.dir = direction.normalized();
 
-	bool hit = false;
-
-	intersectionPointWalk( m_tree->rootIndex(), ray, maxDistSqrd, mr, hit );
+	bool hit = treeIntersectionPoint( ray, maxDistance * maxDistance, mr );
+	if( hit )
+	{
+		completeResult( mr );
+	}
 	return hit;
 }
 
@@ -828,19 +846,54 @@ int MeshPrimitiveEvaluator::intersectionPoints( const Imath::V3f &origin, const
 		return 0;
 	}
 
-	assert( m_tree );
-
 	float maxDistSqrd = maxDistance * maxDistance;
 
 	Imath::Line3f ray;
 	ray.pos = origin;
 	ray.dir = direction.normalized();
 
-	intersectionPointsWalk( m_tree->rootIndex(), ray, maxDistSqrd, results );
+	if( m_bvh )
+	{
+		intersectionPointsWalk( *m_bvh, m_bvh->rootIndex(), ray, maxDistSqrd, results );
+	}
+	else
+	{
+		assert( m_tree );
+		intersectionPointsWalk( *m_tree, m_tree->rootIndex(), ray, maxDistSqrd, results );
+	}
 
 	return results.size();
 }
 
+void MeshPrimitiveEvaluator::treeClosestPoint( const Imath::V3f &p, Result *result ) const
+{
+	float closestDistanceSqrd = limits<float>::max();
+	if( m_bvh )
+	{
+		closestPointWalk( *m_bvh, m_bvh->rootIndex(), p, closestDistanceSqrd, result );
+	}
+	else
+	{
+		assert( m_tree );
+		closestPointWalk( *m_tree, m_tree->rootIndex(), p, closestDistanceSqrd, result );
+	}
+}
+
+bool MeshPrimitiveEvaluator::treeIntersectionPoint( const Imath::Line3f &ray, float maxDistSqrd, Result *result ) const
+{
+	bool hit = false;
+	if( m_bvh )
+	{
+		intersectionPointWalk( *m_bvh, m_bvh->rootIndex(), ray, maxDistSqrd, result, hit );
+	}
+	else
+	{
+		assert( m_tree );
+		intersectionPointWalk( *m_tree, m_tree->rootIndex(), ray, maxDistSqrd, result, hit );
+	}
+	return hit;
+}
+
 bool MeshPrimitiveEvaluator::barycentricPosition( unsigned int triangleIndex, const Imath::V3f &barycentricCoordinates, PrimitiveEvaluator::Result *result ) const
 {
 	if( triangleIndex > m_triangles.size() )
@@ -856,34 +909,307 @@ bool MeshPrimitiveEvaluator::barycentricPosition( unsigned int triangleIndex, co
 	size_t vertIdOffset = triangleIndex * 3;
 	r->m_vertexIds = Imath::V3i( (*m_meshVertexIds)[vertIdOffset], (*m_meshVertexIds)[vertIdOffset+1], (*m_meshVertexIds)[vertIdOffset+2] );
 
-	const Imath::V3f &p0 = m_verts->readable()[ r->m_vertexIds[0] ];
-	const Imath::V3f &p1 = m_verts->readable()[ r->m_vertexIds[1] ];
-	const Imath::V3f &p2 = m_verts->readable()[ r->m_vertexIds[2] ];
+	completeResult( r );
 
-	r->m_p = trianglePoint( p0, p1, p2, r->m_bary );
+	return true;
+}
+
+void MeshPrimitiveEvaluator::completeResult( Result *result ) const
+{
+	assert( result->m_vertexIds[0] < (int)( m_verts->readable().size() ) );
+	assert( result->m_vertexIds[1] < (int)( m_verts->readable().size() ) );
+	assert( result->m_vertexIds[2] < (int)( m_verts->readable().size() ) );
+
+	const Imath::V3f &p0 = m_verts->readable()[ result->m_vertexIds[0] ];
+	const Imath::V3f &p1 = m_verts->readable()[ result->m_vertexIds[1] ];
+	const Imath::V3f &p2 = m_verts->readable()[ result->m_vertexIds[2] ];
 
-	r->m_n = triangleNormal( p0, p1, p2 );
+	result->m_p = trianglePoint( p0, p1, p2, result->m_bary );
+
+	result->m_n = triangleNormal( p0, p1, p2 );
 
 	if( m_u.interpolation != PrimitiveVariable::Invalid && m_v.interpolation != PrimitiveVariable::Invalid )
 	{
-		r->m_uv = V2f(
-			r->floatPrimVar( m_u ),
-			r->floatPrimVar( m_v )
+		result->m_uv = V2f(
+			result->floatPrimVar( m_u ),
+			result->floatPrimVar( m_v )
 		);
 	}
-				
-	return true;
 }
 
-void MeshPrimitiveEvaluator::closestPointWalk( TriangleBoundTree::NodeIndex nodeIndex, const V3f &p, float &closestDistanceSqrd, Result *result ) const
+//////////////////////////////////////////////////////////////////////////
+// Batch queries
+//////////////////////////////////////////////////////////////////////////
+
+/// Base class for the functors used with tbb::parallel_for to evaluate
+/// batch queries. Each range of queries reuses a single Result, and the
+/// walks are called directly, so there is no per-query allocation or
+/// virtual dispatch. Only the quantities stored in BatchResults are computed.
+class MeshPrimitiveEvaluator::BatchQuery
+{
+
+	public :
+
+		BatchQuery( const MeshPrimitiveEvaluator *evaluator, BatchResults &results )
+			:	m_evaluator( evaluator ), m_results( results )
+		{
+		}
+
+	protected :
+
+		void setResult( size_t queryIndex, const Result *result ) const
+		{
+			const std::vector<V3f> &verts = m_evaluator->m_verts->readable();
+			const V3i &vertexIds = result->vertexIds();
+			const V3f &p0 = verts[vertexIds[0]];
+			const V3f &p1 = verts[vertexIds[1]];
+			const V3f &p2 = verts[vertexIds[2]];
+
+			m_results.triangleIndices[queryIndex] = result->triangleIndex();
+			m_results.barycentricCoordinates[queryIndex] = result->barycentricCoordinates();
+			m_results.points[queryIndex] = trianglePoint( p0, p1, p2, result->barycentricCoordinates() );
+			m_results.normals[queryIndex] = triangleNormal( p0, p1, p2 );
+		}
+
+		void setFailure( size_t queryIndex ) const
+		{
+			m_results.triangleIndices[queryIndex] = -1;
+			m_results.barycentricCoordinates[queryIndex] = V3f( 0 );
+			m_results.points[queryIndex] = V3f( 0 );
+			m_results.normals[queryIndex] = V3f( 0 );
+		}
+
+		const MeshPrimitiveEvaluator *m_evaluator;
+		BatchResults &m_results;
+
+};
+
+class MeshPrimitiveEvaluator::BatchClosestPoint : public MeshPrimitiveEvaluator::BatchQuery
+{
+
+	public :
+
+		BatchClosestPoint( const MeshPrimitiveEvaluator *evaluator, const std::vector<V3f> &points, BatchResults &results )
+			:	BatchQuery( evaluator, results ), m_points( points )
+		{
+		}
+
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			ResultPtr result = new Result;
+			for( size_t i = r.begin(); i != r.end(); ++i )
+			{
+				m_evaluator->treeClosestPoint( m_points[i], result.get() );
+				setResult( i, result.get() );
+			}
+		}
+
+	private :
+
+		const std::vector<V3f> &m_points;
+
+};
+
+class MeshPrimitiveEvaluator::BatchIntersectionPoint : public MeshPrimitiveEvaluator::BatchQuery
+{
+
+	public :
+
+		BatchIntersectionPoint( const MeshPrimitiveEvaluator *evaluator, const std::vector<V3f> &origins, const std::vector<V3f> &directions, float maxDistance, BatchResults &results )
+			:	BatchQuery( evaluator, results ), m_origins( origins ), m_directions( directions ), m_maxDistance( maxDistance )
+		{
+		}
+
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			ResultPtr result = new Result;
+			const float maxDistSqrd = m_maxDistance * m_maxDistance;
+			for( size_t i = r.begin(); i != r.end(); ++i )
+			{
+				Line3f ray;
+				ray.pos = m_origins[i];
+				ray.dir = m_directions[i].normalized();
+
+				if( m_evaluator->treeIntersectionPoint( ray, maxDistSqrd, result.get() ) )
+				{
+					setResult( i, result.get() );
+				}
+				else
+				{
+					setFailure( i );
+				}
+			}
+		}
+
+	private :
+
+		const std::vector<V3f> &m_origins;
+		const std::vector<V3f> &m_directions;
+		float m_maxDistance;
+
+};
+
+class MeshPrimitiveEvaluator::BatchPointAtUV : public MeshPrimitiveEvaluator::BatchQuery
+{
+
+	public :
+
+		BatchPointAtUV( const MeshPrimitiveEvaluator *evaluator, const std::vector<V2f> &uvs, BatchResults &results )
+			:	BatchQuery( evaluator, results ), m_uvs( uvs )
+		{
+		}
+
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			ResultPtr result = new Result;
+			const UVBoundTree::NodeIndex rootIndex = m_evaluator->m_uvTree->rootIndex();
+			for( size_t i = r.begin(); i != r.end(); ++i )
+			{
+				if( m_evaluator->pointAtUVWalk( rootIndex, m_uvs[i], result.get() ) )
+				{
+					setResult( i, result.get() );
+				}
+				else
+				{
+					setFailure( i );
+				}
+			}
+		}
+
+	private :
+
+		const std::vector<V2f> &m_uvs;
+
+};
+
+static void resizeBatchResults( MeshPrimitiveEvaluator::BatchResults &results, size_t size )
+{
+	results.triangleIndices.resize( size );
+	results.barycentricCoordinates.resize( size );
+	results.points.resize( size );
+	results.normals.resize( size );
+}
+
+void MeshPrimitiveEvaluator::batchClosestPoint( const std::vector<V3f> &points, BatchResults &results ) const
+{
+	resizeBatchResults( results, points.size() );
+	if( m_triangles.size() == 0 )
+	{
+		std::fill( results.triangleIndices.begin(), results.triangleIndices.end(), -1 );
+		return;
+	}
+
+	tbb::parallel_for( tbb::blocked_range<size_t>( 0, points.size(), 64 ), BatchClosestPoint( this, points, results ) );
+}
+
+void MeshPrimitiveEvaluator::batchIntersectionPoint( const std::vector<V3f> &origins, const std::vector<V3f> &directions, BatchResults &results, float maxDistance ) const
+{
+	if( origins.size() != directions.size() )
+	{
+		throw InvalidArgumentException( "MeshPrimitiveEvaluator::batchIntersectionPoint : origins and directions must be the same length" );
+	}
+
+	resizeBatchResults( results, origins.size() );
+	if( m_triangles.size() == 0 )
+	{
+		std::fill( results.triangleIndices.begin(), results.triangleIndices.end(), -1 );
+		return;
+	}
+
+	tbb::parallel_for( tbb::blocked_range<size_t>( 0, origins.size(), 64 ), BatchIntersectionPoint( this, origins, directions, maxDistance, results ) );
+}
+
+void MeshPrimitiveEvaluator::batchPointAtUV( const std::vector<V2f> &uvs, BatchResults &results ) const
+{
+	if ( ! m_uvTriangles.size() )
+	{
+		throw Exception("No uvs available for batchPointAtUV");
+	}
+
+	assert( m_uvTree );
+	resizeBatchResults( results, uvs.size() );
+	tbb::parallel_for( tbb::blocked_range<size_t>( 0, uvs.size(), 64 ), BatchPointAtUV( this, uvs, results ) );
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Deformation
+//////////////////////////////////////////////////////////////////////////
+
+class MeshPrimitiveEvaluator::UpdateTriangleBounds
+{
+
+	public :
+
+		UpdateTriangleBounds( MeshPrimitiveEvaluator *evaluator )
+			:	m_evaluator( evaluator )
+		{
+		}
+
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			const std::vector<V3f> &verts = m_evaluator->m_verts->readable();
+			const std::vector<int> &vertexIds = *(m_evaluator->m_meshVertexIds);
+			for( size_t i = r.begin(); i != r.end(); ++i )
+			{
+				Box3f &bound = m_evaluator->m_triangles[i];
+				bound.min = bound.max = verts[vertexIds[i*3]];
+				bound.extendBy( verts[vertexIds[i*3+1]] );
+				bound.extendBy( verts[vertexIds[i*3+2]] );
+			}
+		}
+
+	private :
+
+		MeshPrimitiveEvaluator *m_evaluator;
+
+};
+
+void MeshPrimitiveEvaluator::setPositions( ConstV3fVectorDataPtr positions )
 {
-	assert( m_tree );
+	if( !positions )
+	{
+		throw InvalidArgumentException( "No positions given to MeshPrimitiveEvaluator::setPositions" );
+	}
 
-	const TriangleBoundTree::Node &node = m_tree->node( nodeIndex );
+	if( positions->readable().size() != m_verts->readable().size() )
+	{
+		throw InvalidArgumentException( "MeshPrimitiveEvaluator::setPositions : Number of positions doesn't match the number of vertices in the mesh" );
+	}
+
+	// the mesh was copied by the constructor, so we're free to modify it.
+	V3fVectorDataPtr newPositions = positions->copy();
+	MeshPrimitive *mesh = const_cast<MeshPrimitive *>( m_mesh.get() );
+	mesh->variables["P"].data = newPositions;
+	m_verts = newPositions;
+
+	tbb::parallel_for( tbb::blocked_range<size_t>( 0, m_triangles.size(), 1000 ), UpdateTriangleBounds( this ) );
+
+	// the trees point to the elements of m_triangles, which we've updated in place,
+	// so we just need to recompute the bounds of their nodes.
+	if( m_bvh )
+	{
+		m_bvh->refit();
+	}
+	if( m_tree )
+	{
+		m_tree->refit();
+	}
+
+	m_haveMassProperties = false;
+	m_haveSurfaceArea = false;
+	m_haveAverageNormals = false;
+	m_edgeAverageNormals.clear();
+	m_vertexAngleWeightedNormals = 0;
+}
+
+template<typename Tree>
+void MeshPrimitiveEvaluator::closestPointWalk( const Tree &tree, typename Tree::NodeIndex nodeIndex, const V3f &p, float &closestDistanceSqrd, Result *result ) const
+{
+	const typename Tree::Node &node = tree.node( nodeIndex );
 	if( node.isLeaf() )
 	{
-		TriangleBoundTree::Iterator *permLast = node.permLast();
-		for( TriangleBoundTree::Iterator *perm = node.permFirst(); perm!=permLast; perm++ )
+		typename Tree::Iterator *permLast = node.permLast();
+		for( typename Tree::Iterator *perm = node.permFirst(); perm!=permLast; perm++ )
 		{
 			size_t triangleIndex = *perm - m_triangles.begin(); // triangle index is just the distance of the triangle from the beginning of the vector
 			size_t vertIdOffset = triangleIndex * 3;
@@ -908,22 +1234,6 @@ void MeshPrimitiveEvaluator::closestPointWalk( TriangleBoundTree::NodeIndex node
 				result->m_bary = bary;
 				result->m_vertexIds = vertexIds;
 				result->m_triangleIdx = triangleIndex;
-
-				if ( m_u.interpolation != PrimitiveVariable::Invalid && m_v.interpolation != PrimitiveVariable::Invalid )
-				{
-					result->m_uv = V2f(
-						result->floatPrimVar( m_u ),
-						result->floatPrimVar( m_v )
-					);
-				}
-
-				const Imath::V3f &p0 = m_verts->readable()[vertexIds[0]];
-				const Imath::V3f &p1 = m_verts->readable()[vertexIds[1]];
-				const Imath::V3f &p2 = m_verts->readable()[vertexIds[2]];
-
-				result->m_p = trianglePoint( p0, p1, p2, result->m_bary );
-
-				result->m_n = triangleNormal( p0, p1, p2 );
 			}
 		}
 	}
@@ -932,37 +1242,37 @@ void MeshPrimitiveEvaluator::closestPointWalk( TriangleBoundTree::NodeIndex node
 		/// Descend into the closest box first
 
 		float dHigh = vecDistance(
-			closestPointInBox( p, m_tree->node( TriangleBoundTree::highChildIndex( nodeIndex ) ).bound() ),
+			closestPointInBox( p, tree.node( tree.highChildIndex( nodeIndex ) ).bound() ),
 			p
 		);
 
 		float dLow = vecDistance(
-			closestPointInBox( p, m_tree->node( TriangleBoundTree::lowChildIndex( nodeIndex ) ).bound() ),
+			closestPointInBox( p, tree.node( tree.lowChildIndex( nodeIndex ) ).bound() ),
 			p
 		);
 
-		TriangleBoundTree::NodeIndex firstChild, secondChild;
+		typename Tree::NodeIndex firstChild, secondChild;
 
 		float dSecond;
 
 		if (dHigh < dLow)
 		{
-			firstChild = TriangleBoundTree::highChildIndex( nodeIndex );
-			secondChild = TriangleBoundTree::lowChildIndex( nodeIndex );
+			firstChild = tree.highChildIndex( nodeIndex );
+			secondChild = tree.lowChildIndex( nodeIndex );
 			dSecond = dLow;
 		}
 		else
 		{
-			firstChild = TriangleBoundTree::lowChildIndex( nodeIndex );
-			secondChild = TriangleBoundTree::highChildIndex( nodeIndex );
+			firstChild = tree.lowChildIndex( nodeIndex );
+			secondChild = tree.highChildIndex( nodeIndex );
 			dSecond = dHigh;
 		}
 
-		closestPointWalk( firstChild, p, closestDistanceSqrd, result );
+		closestPointWalk( tree, firstChild, p, closestDistanceSqrd, result );
 
 		if (dSecond * dSecond < closestDistanceSqrd )
 		{
-			closestPointWalk( secondChild, p, closestDistanceSqrd, result );
+			closestPointWalk( tree, secondChild, p, closestDistanceSqrd, result );
 		}
 	}
 }
@@ -1036,18 +1346,17 @@ bool MeshPrimitiveEvaluator::pointAtUVWalk( UVBoundTree::NodeIndex nodeIndex, co
 }
 
 
-bool MeshPrimitiveEvaluator::intersectionPointWalk( TriangleBoundTree::NodeIndex nodeIndex, const Imath::Line3f &ray, float &maxDistSqrd, Result *result, bool &hit ) const
+template<typename Tree>
+bool MeshPrimitiveEvaluator::intersectionPointWalk( const Tree &tree, typename Tree::NodeIndex nodeIndex, const Imath::Line3f &ray, float &maxDistSqrd, Result *result, bool &hit ) const
 {
-	assert( m_tree );
-
-	const TriangleBoundTree::Node &node = m_tree->node( nodeIndex );
+	const typename Tree::Node &node = tree.node( nodeIndex );
 
 	if( node.isLeaf() )
 	{
-		TriangleBoundTree::Iterator *permLast = node.permLast();
+		typename Tree::Iterator *permLast = node.permLast();
 		bool intersects = false;
 
-		for( TriangleBoundTree::Iterator *perm = node.permFirst(); perm!=permLast; perm++ )
+		for( typename Tree::Iterator *perm = node.permFirst(); perm!=permLast; perm++ )
 		{
 			size_t triangleIndex = *perm - m_triangles.begin(); // triangle index is just the distance of the triangle from the beginning of the vector
 			size_t vertIdOffset = triangleIndex * 3;
@@ -1076,18 +1385,6 @@ bool MeshPrimitiveEvaluator::intersectionPointWalk( TriangleBoundTree::NodeIndex
 					result->m_vertexIds = vertexIds;
 					result->m_triangleIdx = triangleIndex;
 
-					result->m_p = hitPoint;
-
-					if ( m_u.interpolation != PrimitiveVariable::Invalid && m_v.interpolation != PrimitiveVariable::Invalid )
-					{
-						result->m_uv = V2f(
-							result->floatPrimVar( m_u ),
-							result->floatPrimVar( m_v )
-						);
-					}
-
-					result->m_n = triangleNormal( p0, p1, p2 );
-
 					intersects = true;
 					hit = true;
 				}
@@ -1100,7 +1397,7 @@ bool MeshPrimitiveEvaluator::intersectionPointWalk( TriangleBoundTree::NodeIndex
 	{
 		V3f highHitPoint;
 		bool highHit = boxIntersects(
-			m_tree->node( TriangleBoundTree::highChildIndex( nodeIndex ) ).bound(),
+			tree.node( tree.highChildIndex( nodeIndex ) ).bound(),
 			ray.pos,
 			ray.dir,
 			highHitPoint
@@ -1108,7 +1405,7 @@ bool MeshPrimitiveEvaluator::intersectionPointWalk( TriangleBoundTree::NodeIndex
 
 		V3f lowHitPoint;
 		bool lowHit = boxIntersects(
-			m_tree->node( TriangleBoundTree::lowChildIndex( nodeIndex ) ).bound(),
+			tree.node( tree.lowChildIndex( nodeIndex ) ).bound(),
 			ray.pos,
 			ray.dir,
 			lowHitPoint
@@ -1148,46 +1445,46 @@ bool MeshPrimitiveEvaluator::intersectionPointWalk( TriangleBoundTree::NodeIndex
 			{
 				/// Descend into the closest intersection first
 
-				TriangleBoundTree::NodeIndex firstChild, secondChild;
+				typename Tree::NodeIndex firstChild, secondChild;
 				float dSecond;
 				if (dHigh < dLow)
 				{
-					firstChild = TriangleBoundTree::highChildIndex( nodeIndex );
-					secondChild = TriangleBoundTree::lowChildIndex( nodeIndex );
+					firstChild = tree.highChildIndex( nodeIndex );
+					secondChild = tree.lowChildIndex( nodeIndex );
 					dSecond = dLow;
 				}
 				else
 				{
-					firstChild = TriangleBoundTree::lowChildIndex( nodeIndex );
-					secondChild = TriangleBoundTree::highChildIndex( nodeIndex );
+					firstChild = tree.lowChildIndex( nodeIndex );
+					secondChild = tree.highChildIndex( nodeIndex );
 					dSecond = dHigh;
 				}
 
-				bool intersection = intersectionPointWalk( firstChild, ray, maxDistSqrd, result, hit );
+				bool intersection = intersectionPointWalk( tree, firstChild, ray, maxDistSqrd, result, hit );
 
 				if (intersection)
 				{
 					if ( dSecond < maxDistSqrd )
 					{
-						intersectionPointWalk( secondChild, ray, maxDistSqrd, result, hit );
+						intersectionPointWalk( tree, secondChild, ray, maxDistSqrd, result, hit );
 					}
 
 					return true;
 				}
 				else
 				{
-					return intersectionPointWalk( secondChild, ray, maxDistSqrd, result, hit );
+					return intersectionPointWalk( tree, secondChild, ray, maxDistSqrd, result, hit );
 				}
 			}
 			else
 			{
-				return intersectionPointWalk( TriangleBoundTree::lowChildIndex( nodeIndex ), ray, maxDistSqrd, result, hit );
+				return intersectionPointWalk( tree, tree.lowChildIndex( nodeIndex ), ray, maxDistSqrd, result, hit );
 			}
 
 		}
 		else if (highHit)
 		{
-			return intersectionPointWalk( TriangleBoundTree::highChildIndex( nodeIndex ), ray, maxDistSqrd, result, hit );
+			return intersectionPointWalk( tree, tree.highChildIndex( nodeIndex ), ray, maxDistSqrd, result, hit );
 		}
 
 
@@ -1196,17 +1493,16 @@ bool MeshPrimitiveEvaluator::intersectionPointWalk( TriangleBoundTree::NodeIndex
 
 }
 
-void MeshPrimitiveEvaluator::intersectionPointsWalk( TriangleBoundTree::NodeIndex nodeIndex, const Imath::Line3f &ray, float maxDistSqrd, std::vector<PrimitiveEvaluator::ResultPtr> &results ) const
+template<typename Tree>
+void MeshPrimitiveEvaluator::intersectionPointsWalk( const Tree &tree, typename Tree::NodeIndex nodeIndex, const Imath::Line3f &ray, float maxDistSqrd, std::vector<PrimitiveEvaluator::ResultPtr> &results ) const
 {
-	assert( m_tree );
-
-	const TriangleBoundTree::Node &node = m_tree->node( nodeIndex );
+	const typename Tree::Node &node = tree.node( nodeIndex );
 
 	if( node.isLeaf() )
 	{
-		TriangleBoundTree::Iterator *permLast = node.permLast();
+		typename Tree::Iterator *permLast = node.permLast();
 
-		for( TriangleBoundTree::Iterator *perm = node.permFirst(); perm!=permLast; perm++ )
+		for( typename Tree::Iterator *perm = node.permFirst(); perm!=permLast; perm++ )
 		{
 			size_t triangleIndex = *perm - m_triangles.begin(); // triangle index is just the distance of the triangle from the beginning of the vector
 			size_t vertIdOffset = triangleIndex * 3;
@@ -1258,7 +1554,7 @@ void MeshPrimitiveEvaluator::intersectionPointsWalk( TriangleBoundTree::NodeInde
 
 		/// Test highChild bound for intersection, descending into children if necessary
 		bool hit = boxIntersects(
-			m_tree->node( TriangleBoundTree::highChildIndex( nodeIndex ) ).bound(),
+			tree.node( tree.highChildIndex( nodeIndex ) ).bound(),
 			ray.pos,
 			ray.dir,
 			hitPoint
@@ -1266,12 +1562,12 @@ void MeshPrimitiveEvaluator::intersectionPointsWalk( TriangleBoundTree::NodeInde
 
 		if ( hit && vecDistance2( hitPoint, ray.pos ) < maxDistSqrd )
 		{
-			intersectionPointsWalk( TriangleBoundTree::highChildIndex( nodeIndex ), ray, maxDistSqrd, results );
+			intersectionPointsWalk( tree, tree.highChildIndex( nodeIndex ), ray, maxDistSqrd, results );
 		}
 
 		/// Test lowChild bound for intersection, descending into children if necessary
 		hit = boxIntersects(
-			m_tree->node( TriangleBoundTree::lowChildIndex( nodeIndex ) ).bound(),
+			tree.node( tree.lowChildIndex( nodeIndex ) ).bound(),
 			ray.pos,
 			ray.dir,
 			hitPoint
@@ -1279,7 +1575,7 @@ void MeshPrimitiveEvaluator::intersectionPointsWalk( TriangleBoundTree::NodeInde
 
 		if ( hit && vecDistance2( hitPoint, ray.pos ) < maxDistSqrd )
 		{
-			intersectionPointsWalk( TriangleBoundTree::lowChildIndex( nodeIndex ), ray, maxDistSqrd, results );
+			intersectionPointsWalk( tree, tree.lowChildIndex( nodeIndex ), ray, maxDistSqrd, results );
 		}
 	}
 }
@@ -1298,11 +1594,28 @@ const MeshPrimitiveEvaluator::TriangleBoundVector *MeshPrimitiveEvaluator::trian
 	return &m_triangles;
 }
 
+MeshPrimitiveEvaluator::TreeType MeshPrimitiveEvaluator::treeType() const
+{
+	return m_treeType;
+}
+
 const MeshPrimitiveEvaluator::TriangleBoundTree *MeshPrimitiveEvaluator::triangleBoundTree() const
 {
+	TreeMutex::scoped_lock lock( m_treeMutex );
+	if( !m_tree )
+	{
+		// the tree is typedefed with non-const iterators, but never modifies the bounds.
+		TriangleBoundVector &triangles = const_cast<TriangleBoundVector &>( m_triangles );
+		m_tree = new TriangleBoundTree( triangles.begin(), triangles.end() );
+	}
 	return m_tree;
 }
 
+const MeshPrimitiveEvaluator::TriangleBVH *MeshPrimitiveEvaluator::triangleBVH() const
+{
+	return m_bvh;
+}
+
 const MeshPrimitiveEvaluator::UVBoundVector *MeshPrimitiveEvaluator::uvBounds() const
 {
 	return m_uvTree ? &m_uvTriangles : 0;
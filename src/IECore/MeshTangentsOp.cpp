@@ -37,11 +37,14 @@
 
 #include "boost/format.hpp"
 
+#include "tbb/parallel_for.h"
+
 #include "IECore/DataCastOp.h"
 #include "IECore/Convert.h"
 #include "IECore/MeshTangentsOp.h"
 #include "IECore/DespatchTypedData.h"
 #include "IECore/CompoundParameter.h"
+#include "IECore/MeshTopology.h"
 
 using namespace IECore;
 using namespace std;
@@ -185,8 +188,8 @@ struct MeshTangentsOp::CalculateTangents
 {
 	typedef void ReturnType;
 
-	CalculateTangents( const vector<int> &vertsPerFace, const vector<int> &vertIds, const vector<float> &u, const vector<float> &v, const vector<int> &uvIndices, bool orthoTangents )
-		:	m_vertsPerFace( vertsPerFace ), m_vertIds( vertIds ), m_u( u ), m_v( v ), m_uvIds( uvIndices ), m_orthoTangents( orthoTangents )
+	CalculateTangents( const vector<int> &vertIds, const vector<float> &u, const vector<float> &v, const vector<int> &uvIndices, const MeshTopology *uvTopology, bool orthoTangents )
+		:	m_vertIds( vertIds ), m_u( u ), m_v( v ), m_uvIds( uvIndices ), m_uvTopology( uvTopology ), m_orthoTangents( orthoTangents )
 	{
 
 	}
@@ -195,133 +198,216 @@ struct MeshTangentsOp::CalculateTangents
 	ReturnType operator()( T * data )
 	{
 		typedef typename T::ValueType VecContainer;
-		typedef typename VecContainer::value_type Vec;
 
 		const VecContainer &points = data->readable();
-		
+
 		// the uvIndices array is indexed as with any other facevarying data. the values in the
 		// array specify the connectivity of the uvs - where two facevertices have the same index
 		// they are known to be sharing a uv. for each one of these unique indices we compute
 		// the tangents and normal, by accumulating all the tangents and normals for the faces
 		// that reference them. we then take this data and shuffle it back into facevarying
-		// primvars for the mesh.
-		int numUniqueTangents = 1 + *max_element( m_uvIds.begin(), m_uvIds.end() );
-		
-		VecContainer uTangents( numUniqueTangents, Vec( 0 ) );
-		VecContainer vTangents( numUniqueTangents, Vec( 0 ) );
-		VecContainer normals( numUniqueTangents, Vec( 0 ) );
-		
-		for( size_t faceIndex = 0; faceIndex < m_vertsPerFace.size() ; faceIndex++ )
-		{
-			
-			assert( m_vertsPerFace[faceIndex] == 3 );
-
-			// indices into the facevarying data for this face 
-			size_t fvi0 = faceIndex * 3;
-			size_t fvi1 = fvi0 + 1;
-			size_t fvi2 = fvi1 + 1;
-			assert( fvi2 < m_vertIds.size() );
-			assert( fvi2 < m_u.size() );
-			assert( fvi2 < m_v.size() );
-			
-			// positions for each vertex of this face
-			const Vec &p0 = points[ m_vertIds[ fvi0 ] ];
-			const Vec &p1 = points[ m_vertIds[ fvi1 ] ];
-			const Vec &p2 = points[ m_vertIds[ fvi2 ] ];
-
-			// uv coordinates for each vertex of this face
-			const Imath::V2f uv0( m_u[ fvi0 ], m_v[ fvi0 ] );
-			const Imath::V2f uv1( m_u[ fvi1 ], m_v[ fvi1 ] );
-			const Imath::V2f uv2( m_u[ fvi2 ], m_v[ fvi2 ] );
-
-			// compute tangents and normal for this face
-			const Vec e0 = p1 - p0;
-			const Vec e1 = p2 - p0;
-
-			const Imath::V2f e0uv = uv1 - uv0;
-			const Imath::V2f e1uv = uv2 - uv0;
-
-			Vec tangent   = ( e0 * -e1uv.y + e1 * e0uv.y ).normalized();
-			Vec bitangent = ( e0 * -e1uv.x + e1 * e0uv.x ).normalized();
-
-			Vec normal = (p2-p1).cross(p0-p1);
-			normal.normalize();
-
-			// and accumlate them into the computation so far
-			uTangents[ m_uvIds[fvi0] ] += tangent;
-			uTangents[ m_uvIds[fvi1] ] += tangent;
-			uTangents[ m_uvIds[fvi2] ] += tangent;
-			
-			vTangents[ m_uvIds[fvi0] ] += bitangent;
-			vTangents[ m_uvIds[fvi1] ] += bitangent;
-			vTangents[ m_uvIds[fvi2] ] += bitangent;
-			
-			normals[ m_uvIds[fvi0] ] += normal;
-			normals[ m_uvIds[fvi1] ] += normal;
-			normals[ m_uvIds[fvi2] ] += normal;
-			
-		}
+		// primvars for the mesh. the uv topology maps from each unique index back to the
+		// facevertices referencing it, so that the accumulation can be done in parallel
+		// by gathering from the faces.
+		const size_t numFaces = m_uvTopology->numFaces();
+		VecContainer faceUTangents( numFaces );
+		VecContainer faceVTangents( numFaces );
+		VecContainer faceNormals( numFaces );
+		tbb::parallel_for(
+			tbb::blocked_range<size_t>( 0, numFaces, 1000 ),
+			FaceTangents<VecContainer>( points, m_vertIds, m_u, m_v, faceUTangents, faceVTangents, faceNormals )
+		);
+
+		VecContainer uTangents( m_uvTopology->numVertices() );
+		VecContainer vTangents( m_uvTopology->numVertices() );
+		tbb::parallel_for(
+			tbb::blocked_range<size_t>( 0, uTangents.size(), 1000 ),
+			UniqueTangents<VecContainer>( faceUTangents, faceVTangents, faceNormals, m_uvTopology, m_orthoTangents, uTangents, vTangents )
+		);
 
-		// normalize and orthogonalize everything
-		for( size_t i = 0; i < uTangents.size(); i++ )
-		{
-			normals[i].normalize();
-
-			uTangents[i].normalize();
-			vTangents[i].normalize();
-
-			// Make uTangent/vTangent orthogonal to normal
-			uTangents[i] -= normals[i] * uTangents[i].dot( normals[i] );
-			vTangents[i] -= normals[i] * vTangents[i].dot( normals[i] );
-
-			uTangents[i].normalize();
-			vTangents[i].normalize();
-
-			if ( m_orthoTangents )
-			{
-				vTangents[i] -= uTangents[i] * vTangents[i].dot( uTangents[i] );
-				vTangents[i].normalize();
-			}
-		
-			// make things less sinister
-			if( uTangents[i].cross( vTangents[i] ).dot( normals[i] ) < 0.0f )
-			{
-				uTangents[i] *= -1.0f;
-			}
-		}
-		
 		// convert the tangents back to facevarying data and add that to the mesh
 		typename T::Ptr fvUD = new T();
 		typename T::Ptr fvVD = new T();
 		fvUTangentsData = fvUD;
 		fvVTangentsData = fvVD;
-		
+
 		VecContainer &fvUTangents = fvUD->writable();
 		VecContainer &fvVTangents = fvVD->writable();
 		fvUTangents.resize( m_uvIds.size() );
 		fvVTangents.resize( m_uvIds.size() );
-		
-		for( unsigned i=0; i<m_uvIds.size(); i++ )
-		{
-			fvUTangents[i] = uTangents[m_uvIds[i]];
-			fvVTangents[i] = vTangents[m_uvIds[i]];
-		}
+
+		tbb::parallel_for(
+			tbb::blocked_range<size_t>( 0, m_uvIds.size(), 1000 ),
+			FaceVaryingTangents<VecContainer>( uTangents, vTangents, m_uvIds, fvUTangents, fvVTangents )
+		);
 
 	}
-	
+
 	// this is the data filled in by operator() above, ready to be added onto the mesh
 	DataPtr fvUTangentsData;
 	DataPtr fvVTangentsData;
-	
+
 	private :
 
-		const vector<int> &m_vertsPerFace;
+		// computes the tangents and normal for each face
+		template<typename VecContainer>
+		struct FaceTangents
+		{
+			typedef typename VecContainer::value_type Vec;
+
+			FaceTangents( const VecContainer &points, const vector<int> &vertIds, const vector<float> &u, const vector<float> &v, VecContainer &uTangents, VecContainer &vTangents, VecContainer &normals )
+				:	m_points( points ), m_vertIds( vertIds ), m_u( u ), m_v( v ), m_uTangents( uTangents ), m_vTangents( vTangents ), m_normals( normals )
+			{
+			}
+
+			void operator()( const tbb::blocked_range<size_t> &r ) const
+			{
+				for( size_t faceIndex = r.begin(); faceIndex != r.end(); ++faceIndex )
+				{
+					// indices into the facevarying data for this face
+					size_t fvi0 = faceIndex * 3;
+					size_t fvi1 = fvi0 + 1;
+					size_t fvi2 = fvi1 + 1;
+					assert( fvi2 < m_vertIds.size() );
+					assert( fvi2 < m_u.size() );
+					assert( fvi2 < m_v.size() );
+
+					// positions for each vertex of this face
+					const Vec &p0 = m_points[ m_vertIds[ fvi0 ] ];
+					const Vec &p1 = m_points[ m_vertIds[ fvi1 ] ];
+					const Vec &p2 = m_points[ m_vertIds[ fvi2 ] ];
+
+					// uv coordinates for each vertex of this face
+					const Imath::V2f uv0( m_u[ fvi0 ], m_v[ fvi0 ] );
+					const Imath::V2f uv1( m_u[ fvi1 ], m_v[ fvi1 ] );
+					const Imath::V2f uv2( m_u[ fvi2 ], m_v[ fvi2 ] );
+
+					// compute tangents and normal for this face
+					const Vec e0 = p1 - p0;
+					const Vec e1 = p2 - p0;
+
+					const Imath::V2f e0uv = uv1 - uv0;
+					const Imath::V2f e1uv = uv2 - uv0;
+
+					m_uTangents[faceIndex] = ( e0 * -e1uv.y + e1 * e0uv.y ).normalized();
+					m_vTangents[faceIndex] = ( e0 * -e1uv.x + e1 * e0uv.x ).normalized();
+
+					Vec normal = (p2-p1).cross(p0-p1);
+					normal.normalize();
+					m_normals[faceIndex] = normal;
+				}
+			}
+
+			const VecContainer &m_points;
+			const vector<int> &m_vertIds;
+			const vector<float> &m_u;
+			const vector<float> &m_v;
+			VecContainer &m_uTangents;
+			VecContainer &m_vTangents;
+			VecContainer &m_normals;
+		};
+
+		// accumulates the face tangents for each unique uv index, and then
+		// normalizes and orthogonalizes them.
+		template<typename VecContainer>
+		struct UniqueTangents
+		{
+			typedef typename VecContainer::value_type Vec;
+
+			UniqueTangents( const VecContainer &faceUTangents, const VecContainer &faceVTangents, const VecContainer &faceNormals, const MeshTopology *uvTopology, bool orthoTangents, VecContainer &uTangents, VecContainer &vTangents )
+				:	m_faceUTangents( faceUTangents ), m_faceVTangents( faceVTangents ), m_faceNormals( faceNormals ),
+					m_offsets( uvTopology->vertexFaceVertexOffsets() ), m_faceVertices( uvTopology->vertexFaceVertices() ), m_faces( uvTopology->faceVertexFaces() ),
+					m_orthoTangents( orthoTangents ), m_uTangents( uTangents ), m_vTangents( vTangents )
+			{
+			}
+
+			void operator()( const tbb::blocked_range<size_t> &r ) const
+			{
+				for( size_t i = r.begin(); i != r.end(); ++i )
+				{
+					Vec uTangent( 0 );
+					Vec vTangent( 0 );
+					Vec normal( 0 );
+					for( int j = m_offsets[i]; j < m_offsets[i+1]; ++j )
+					{
+						const int f = m_faces[m_faceVertices[j]];
+						uTangent += m_faceUTangents[f];
+						vTangent += m_faceVTangents[f];
+						normal += m_faceNormals[f];
+					}
+
+					// normalize and orthogonalize everything
+					normal.normalize();
+
+					uTangent.normalize();
+					vTangent.normalize();
+
+					// Make uTangent/vTangent orthogonal to normal
+					uTangent -= normal * uTangent.dot( normal );
+					vTangent -= normal * vTangent.dot( normal );
+
+					uTangent.normalize();
+					vTangent.normalize();
+
+					if ( m_orthoTangents )
+					{
+						vTangent -= uTangent * vTangent.dot( uTangent );
+						vTangent.normalize();
+					}
+
+					// make things less sinister
+					if( uTangent.cross( vTangent ).dot( normal ) < 0.0f )
+					{
+						uTangent *= -1.0f;
+					}
+
+					m_uTangents[i] = uTangent;
+					m_vTangents[i] = vTangent;
+				}
+			}
+
+			const VecContainer &m_faceUTangents;
+			const VecContainer &m_faceVTangents;
+			const VecContainer &m_faceNormals;
+			const vector<int> &m_offsets;
+			const vector<int> &m_faceVertices;
+			const vector<int> &m_faces;
+			bool m_orthoTangents;
+			VecContainer &m_uTangents;
+			VecContainer &m_vTangents;
+		};
+
+		template<typename VecContainer>
+		struct FaceVaryingTangents
+		{
+			FaceVaryingTangents( const VecContainer &uTangents, const VecContainer &vTangents, const vector<int> &uvIds, VecContainer &fvUTangents, VecContainer &fvVTangents )
+				:	m_uTangents( uTangents ), m_vTangents( vTangents ), m_uvIds( uvIds ), m_fvUTangents( fvUTangents ), m_fvVTangents( fvVTangents )
+			{
+			}
+
+			void operator()( const tbb::blocked_range<size_t> &r ) const
+			{
+				for( size_t i = r.begin(); i != r.end(); ++i )
+				{
+					m_fvUTangents[i] = m_uTangents[m_uvIds[i]];
+					m_fvVTangents[i] = m_vTangents[m_uvIds[i]];
+				}
+			}
+
+			const VecContainer &m_uTangents;
+			const VecContainer &m_vTangents;
+			const vector<int> &m_uvIds;
+			VecContainer &m_fvUTangents;
+			VecContainer &m_fvVTangents;
+		};
+
 		const vector<int> &m_vertIds;
 		const vector<float> &m_u;
 		const vector<float> &m_v;
 		const vector<int> &m_uvIds;
+		const MeshTopology *m_uvTopology;
 		bool m_orthoTangents;
-		
+
 };
 
 struct MeshTangentsOp::HandleErrors
@@ -393,7 +479,11 @@ void MeshTangentsOp::modifyTypedPrimitive( MeshPrimitive * mesh, const CompoundO
 
 	bool orthoTangents = orthogonalizeTangentsParameter()->getTypedValue();
 
-	CalculateTangents f( vertsPerFace->readable(), mesh->vertexIds()->readable(), uData->readable(), vData->readable(), uvIndicesData->readable(), orthoTangents );
+	const vector<int> &uvIndices = uvIndicesData->readable();
+	const size_t numUniqueTangents = uvIndices.size() ? 1 + *max_element( uvIndices.begin(), uvIndices.end() ) : 0;
+	ConstMeshTopologyPtr uvTopology = MeshTopology::get( vertsPerFace, uvIndicesData.get(), numUniqueTangents );
+
+	CalculateTangents f( mesh->vertexIds()->readable(), uData->readable(), vData->readable(), uvIndices, uvTopology.get(), orthoTangents );
 
 	despatchTypedData<CalculateTangents, TypeTraits::IsFloatVec3VectorTypedData, HandleErrors>( pData, f );
 
@@ -0,0 +1,720 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include "boost/format.hpp"
+
+#include "tbb/parallel_for.h"
+#include "tbb/atomic.h"
+
+#include "IECore/MeshTopology.h"
+#include "IECore/MeshPrimitive.h"
+#include "IECore/ShardedLRUCache.h"
+#include "IECore/Exception.h"
+
+using namespace IECore;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////
+// Functors used to build the tables
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+// Applies the functor to the whole range, using multiple threads
+// if requested.
+template<typename F>
+void apply( const F &f, size_t size, bool parallel )
+{
+	if( parallel )
+	{
+		tbb::parallel_for( tbb::blocked_range<size_t>( 0, size, 1000 ), f );
+	}
+	else
+	{
+		f( tbb::blocked_range<size_t>( 0, size ) );
+	}
+}
+
+typedef vector<tbb::atomic<int> > AtomicIntVector;
+
+// Returns the tables held by the pointer, building them with the specified
+// method if they don't exist yet. We build without holding a lock, because
+// waiting on a lock while another thread builds the tables in parallel could
+// deadlock if that thread were to pick up our task. Concurrent first calls
+// may therefore build the tables redundantly, and only the first to finish
+// is kept.
+template<typename Tables>
+const Tables &lazyTables( tbb::atomic<Tables *> &tables, const MeshTopology &topology, void (MeshTopology::*build)( Tables & ) const )
+{
+	const Tables *existing = tables;
+	if( existing )
+	{
+		return *existing;
+	}
+
+	Tables *newTables = new Tables;
+	try
+	{
+		(topology.*build)( *newTables );
+	}
+	catch( ... )
+	{
+		delete newTables;
+		throw;
+	}
+
+	existing = tables.compare_and_swap( newTables, 0 );
+	if( existing )
+	{
+		delete newTables;
+		return *existing;
+	}
+	return *newTables;
+}
+
+} // namespace
+
+struct MeshTopology::FillFaceVertexFaces
+{
+	FillFaceVertexFaces( const vector<int> &faceOffsets, vector<int> &faceVertexFaces )
+		:	m_faceOffsets( faceOffsets ), m_faceVertexFaces( faceVertexFaces )
+	{
+	}
+
+	void operator()( const tbb::blocked_range<size_t> &r ) const
+	{
+		for( size_t f=r.begin(); f!=r.end(); ++f )
+		{
+			std::fill( m_faceVertexFaces.begin() + m_faceOffsets[f], m_faceVertexFaces.begin() + m_faceOffsets[f+1], (int)f );
+		}
+	}
+
+	private :
+
+		const vector<int> &m_faceOffsets;
+		vector<int> &m_faceVertexFaces;
+
+};
+
+struct MeshTopology::CountValences
+{
+	CountValences( const vector<int> &vertexIds, AtomicIntVector &valences, tbb::atomic<bool> &outOfRange )
+		:	m_vertexIds( vertexIds ), m_valences( valences ), m_outOfRange( outOfRange )
+	{
+	}
+
+	void operator()( const tbb::blocked_range<size_t> &r ) const
+	{
+		const int numVertices = m_valences.size();
+		for( size_t i=r.begin(); i!=r.end(); ++i )
+		{
+			const int v = m_vertexIds[i];
+			if( v < 0 || v >= numVertices )
+			{
+				m_outOfRange = true;
+				return;
+			}
+			++m_valences[v];
+		}
+	}
+
+	private :
+
+		const vector<int> &m_vertexIds;
+		AtomicIntVector &m_valences;
+		tbb::atomic<bool> &m_outOfRange;
+
+};
+
+struct MeshTopology::FillVertexFaceVertices
+{
+	FillVertexFaceVertices( const vector<int> &vertexIds, AtomicIntVector &cursors, vector<int> &vertexFaceVertices )
+		:	m_vertexIds( vertexIds ), m_cursors( cursors ), m_vertexFaceVertices( vertexFaceVertices )
+	{
+	}
+
+	void operator()( const tbb::blocked_range<size_t> &r ) const
+	{
+		for( size_t i=r.begin(); i!=r.end(); ++i )
+		{
+			m_vertexFaceVertices[m_cursors[m_vertexIds[i]]++] = i;
+		}
+	}
+
+	private :
+
+		const vector<int> &m_vertexIds;
+		AtomicIntVector &m_cursors;
+		vector<int> &m_vertexFaceVertices;
+
+};
+
+// The face-vertices for each vertex are written in whatever order the
+// threads happened to reach them, so we sort them to give a deterministic
+// result which matches the order of a serial traversal of the faces.
+struct MeshTopology::SortVertexFaceVertices
+{
+	SortVertexFaceVertices( const vector<int> &offsets, vector<int> &vertexFaceVertices )
+		:	m_offsets( offsets ), m_vertexFaceVertices( vertexFaceVertices )
+	{
+	}
+
+	void operator()( const tbb::blocked_range<size_t> &r ) const
+	{
+		for( size_t v=r.begin(); v!=r.end(); ++v )
+		{
+			std::sort( m_vertexFaceVertices.begin() + m_offsets[v], m_vertexFaceVertices.begin() + m_offsets[v+1] );
+		}
+	}
+
+	private :
+
+		const vector<int> &m_offsets;
+		vector<int> &m_vertexFaceVertices;
+
+};
+
+// Edges are owned by their lower vertex, so each task can build the edges for
+// a range of vertices independently. The half-edges around each vertex are
+// gathered from the vertex tables, and those running to a higher (or the same)
+// vertex are sorted by that vertex, so each run of equal vertices forms an edge.
+namespace
+{
+
+typedef std::pair<int, int> HalfEdge; // other vertex, face-vertex
+
+void ownedHalfEdges( const MeshTopology &topology, const vector<int> &vertexIds, int vertex, vector<HalfEdge> &halfEdges )
+{
+	halfEdges.clear();
+	const vector<int> &offsets = topology.vertexFaceVertexOffsets();
+	const vector<int> &faceVertices = topology.vertexFaceVertices();
+	for( int i=offsets[vertex]; i<offsets[vertex+1]; ++i )
+	{
+		const int faceVertex = faceVertices[i];
+		// the half-edge leaving the vertex
+		const int next = vertexIds[topology.nextFaceVertex( faceVertex )];
+		if( next >= vertex )
+		{
+			halfEdges.push_back( HalfEdge( next, faceVertex ) );
+		}
+		// and the half-edge arriving at it. the strict comparison
+		// avoids counting degenerate half-edges twice.
+		const int previousFaceVertex = topology.previousFaceVertex( faceVertex );
+		const int previous = vertexIds[previousFaceVertex];
+		if( previous > vertex )
+		{
+			halfEdges.push_back( HalfEdge( previous, previousFaceVertex ) );
+		}
+	}
+	std::sort( halfEdges.begin(), halfEdges.end() );
+}
+
+} // namespace
+
+struct MeshTopology::CountEdges
+{
+	CountEdges( const MeshTopology &topology, const vector<int> &vertexIds, vector<int> &numHalfEdges, vector<int> &numEdges )
+		:	m_topology( topology ), m_vertexIds( vertexIds ), m_numHalfEdges( numHalfEdges ), m_numEdges( numEdges )
+	{
+	}
+
+	void operator()( const tbb::blocked_range<size_t> &r ) const
+	{
+		vector<HalfEdge> halfEdges;
+		for( size_t v=r.begin(); v!=r.end(); ++v )
+		{
+			ownedHalfEdges( m_topology, m_vertexIds, v, halfEdges );
+			int numEdges = 0;
+			for( size_t i=0; i<halfEdges.size(); ++i )
+			{
+				if( i==0 || halfEdges[i].first != halfEdges[i-1].first )
+				{
+					numEdges++;
+				}
+			}
+			m_numHalfEdges[v] = halfEdges.size();
+			m_numEdges[v] = numEdges;
+		}
+	}
+
+	private :
+
+		const MeshTopology &m_topology;
+		const vector<int> &m_vertexIds;
+		vector<int> &m_numHalfEdges;
+		vector<int> &m_numEdges;
+
+};
+
+struct MeshTopology::FillEdges
+{
+	FillEdges( const MeshTopology &topology, const vector<int> &vertexIds, const vector<int> &halfEdgeOffsets, EdgeTables &tables )
+		:	m_topology( topology ), m_vertexIds( vertexIds ), m_halfEdgeOffsets( halfEdgeOffsets ), m_tables( tables )
+	{
+	}
+
+	void operator()( const tbb::blocked_range<size_t> &r ) const
+	{
+		vector<HalfEdge> halfEdges;
+		for( size_t v=r.begin(); v!=r.end(); ++v )
+		{
+			ownedHalfEdges( m_topology, m_vertexIds, v, halfEdges );
+			int edge = m_tables.vertexEdgeOffsets[v] - 1;
+			int edgeFaceVertex = m_halfEdgeOffsets[v];
+			for( size_t i=0; i<halfEdges.size(); ++i, ++edgeFaceVertex )
+			{
+				if( i==0 || halfEdges[i].first != halfEdges[i-1].first )
+				{
+					edge++;
+					m_tables.edges[edge] = Imath::V2i( v, halfEdges[i].first );
+					m_tables.edgeFaceVertexOffsets[edge] = edgeFaceVertex;
+				}
+				m_tables.edgeFaceVertices[edgeFaceVertex] = halfEdges[i].second;
+				m_tables.faceVertexEdges[halfEdges[i].second] = edge;
+			}
+		}
+	}
+
+	private :
+
+		const MeshTopology &m_topology;
+		const vector<int> &m_vertexIds;
+		const vector<int> &m_halfEdgeOffsets;
+		EdgeTables &m_tables;
+
+};
+
+struct MeshTopology::FillTriangles
+{
+	FillTriangles( const vector<int> &faceOffsets, TriangleTables &tables )
+		:	m_faceOffsets( faceOffsets ), m_tables( tables )
+	{
+	}
+
+	void operator()( const tbb::blocked_range<size_t> &r ) const
+	{
+		for( size_t f=r.begin(); f!=r.end(); ++f )
+		{
+			const int faceStart = m_faceOffsets[f];
+			const int numFaceVertices = m_faceOffsets[f+1] - faceStart;
+			int t = m_tables.faceTriangleOffsets[f];
+			for( int i=1; i<numFaceVertices-1; ++i, ++t )
+			{
+				m_tables.triangleFaces[t] = f;
+				m_tables.triangleFaceVertices[t*3] = faceStart;
+				m_tables.triangleFaceVertices[t*3+1] = faceStart + i;
+				m_tables.triangleFaceVertices[t*3+2] = faceStart + i + 1;
+			}
+		}
+	}
+
+	private :
+
+		const vector<int> &m_faceOffsets;
+		TriangleTables &m_tables;
+
+};
+
+//////////////////////////////////////////////////////////////////////////
+// MeshTopology
+//////////////////////////////////////////////////////////////////////////
+
+MeshTopology::MeshTopology( const IntVectorData *verticesPerFace, const IntVectorData *vertexIds, size_t numVertices, bool parallel )
+	:	m_parallel( parallel ), m_vertexIds( vertexIds->copy() )
+{
+	m_edgeTables = 0;
+	m_triangleTables = 0;
+
+	const vector<int> &verticesPerFaceReadable = verticesPerFace->readable();
+	const vector<int> &vertexIdsReadable = vertexIds->readable();
+
+	// face offsets
+
+	m_faceOffsets.resize( verticesPerFaceReadable.size() + 1 );
+	m_faceOffsets[0] = 0;
+	for( size_t f=0; f<verticesPerFaceReadable.size(); ++f )
+	{
+		if( verticesPerFaceReadable[f] < 0 )
+		{
+			throw InvalidArgumentException( "MeshTopology : Negative number of vertices in face." );
+		}
+		m_faceOffsets[f+1] = m_faceOffsets[f] + verticesPerFaceReadable[f];
+	}
+
+	if( (size_t)m_faceOffsets.back() != vertexIdsReadable.size() )
+	{
+		throw InvalidArgumentException( boost::str( boost::format( "MeshTopology : Number of vertexIds (%d) does not match the sum of verticesPerFace (%d)." ) % vertexIdsReadable.size() % m_faceOffsets.back() ) );
+	}
+
+	m_faceVertexFaces.resize( vertexIdsReadable.size() );
+	apply( FillFaceVertexFaces( m_faceOffsets, m_faceVertexFaces ), verticesPerFaceReadable.size(), parallel );
+
+	// vertex offsets
+
+	AtomicIntVector counts( numVertices );
+	for( AtomicIntVector::iterator it = counts.begin(); it != counts.end(); ++it )
+	{
+		*it = 0;
+	}
+
+	tbb::atomic<bool> outOfRange;
+	outOfRange = false;
+	apply( CountValences( vertexIdsReadable, counts, outOfRange ), vertexIdsReadable.size(), parallel );
+	if( outOfRange )
+	{
+		throw InvalidArgumentException( boost::str( boost::format( "MeshTopology : vertexIds out of range for %d vertices." ) % numVertices ) );
+	}
+
+	m_vertexFaceVertexOffsets.resize( numVertices + 1 );
+	m_vertexFaceVertexOffsets[0] = 0;
+	for( size_t v=0; v<numVertices; ++v )
+	{
+		m_vertexFaceVertexOffsets[v+1] = m_vertexFaceVertexOffsets[v] + counts[v];
+		// reuse the counts as the insertion cursors for each vertex
+		counts[v] = m_vertexFaceVertexOffsets[v];
+	}
+
+	m_vertexFaceVertices.resize( vertexIdsReadable.size() );
+	apply( FillVertexFaceVertices( vertexIdsReadable, counts, m_vertexFaceVertices ), vertexIdsReadable.size(), parallel );
+	if( parallel )
+	{
+		apply( SortVertexFaceVertices( m_vertexFaceVertexOffsets, m_vertexFaceVertices ), numVertices, parallel );
+	}
+}
+
+MeshTopology::~MeshTopology()
+{
+	delete m_edgeTables;
+	delete m_triangleTables;
+}
+
+size_t MeshTopology::numFaces() const
+{
+	return m_faceOffsets.size() - 1;
+}
+
+size_t MeshTopology::numVertices() const
+{
+	return m_vertexFaceVertexOffsets.size() - 1;
+}
+
+size_t MeshTopology::numFaceVertices() const
+{
+	return m_faceVertexFaces.size();
+}
+
+const std::vector<int> &MeshTopology::faceOffsets() const
+{
+	return m_faceOffsets;
+}
+
+const std::vector<int> &MeshTopology::faceVertexFaces() const
+{
+	return m_faceVertexFaces;
+}
+
+const std::vector<int> &MeshTopology::vertexFaceVertexOffsets() const
+{
+	return m_vertexFaceVertexOffsets;
+}
+
+const std::vector<int> &MeshTopology::vertexFaceVertices() const
+{
+	return m_vertexFaceVertices;
+}
+
+size_t MeshTopology::numEdges() const
+{
+	return edgeTables().edges.size();
+}
+
+const std::vector<Imath::V2i> &MeshTopology::edges() const
+{
+	return edgeTables().edges;
+}
+
+const std::vector<int> &MeshTopology::vertexEdgeOffsets() const
+{
+	return edgeTables().vertexEdgeOffsets;
+}
+
+const std::vector<int> &MeshTopology::faceVertexEdges() const
+{
+	return edgeTables().faceVertexEdges;
+}
+
+const std::vector<int> &MeshTopology::edgeFaceVertexOffsets() const
+{
+	return edgeTables().edgeFaceVertexOffsets;
+}
+
+const std::vector<int> &MeshTopology::edgeFaceVertices() const
+{
+	return edgeTables().edgeFaceVertices;
+}
+
+namespace
+{
+
+bool compareSecondVertex( const Imath::V2i &edge, int vertex )
+{
+	return edge[1] < vertex;
+}
+
+} // namespace
+
+int MeshTopology::edgeIndex( int vertex0, int vertex1 ) const
+{
+	if( vertex0 > vertex1 )
+	{
+		std::swap( vertex0, vertex1 );
+	}
+
+	if( vertex0 < 0 || vertex1 >= (int)numVertices() )
+	{
+		return -1;
+	}
+
+	const EdgeTables &tables = edgeTables();
+	vector<Imath::V2i>::const_iterator begin = tables.edges.begin() + tables.vertexEdgeOffsets[vertex0];
+	vector<Imath::V2i>::const_iterator end = tables.edges.begin() + tables.vertexEdgeOffsets[vertex0+1];
+	vector<Imath::V2i>::const_iterator it = std::lower_bound( begin, end, vertex1, compareSecondVertex );
+	if( it == end || (*it)[1] != vertex1 )
+	{
+		return -1;
+	}
+	return it - tables.edges.begin();
+}
+
+const MeshTopology::EdgeTables &MeshTopology::edgeTables() const
+{
+	return lazyTables( m_edgeTables, *this, &MeshTopology::buildEdgeTables );
+}
+
+void MeshTopology::buildEdgeTables( EdgeTables &tables ) const
+{
+	const vector<int> &vertexIds = m_vertexIds->readable();
+	const size_t numVertices = this->numVertices();
+
+	vector<int> numHalfEdges( numVertices );
+	vector<int> numEdges( numVertices );
+	apply( CountEdges( *this, vertexIds, numHalfEdges, numEdges ), numVertices, m_parallel );
+
+	vector<int> halfEdgeOffsets( numVertices + 1 );
+	tables.vertexEdgeOffsets.resize( numVertices + 1 );
+	halfEdgeOffsets[0] = tables.vertexEdgeOffsets[0] = 0;
+	for( size_t v=0; v<numVertices; ++v )
+	{
+		halfEdgeOffsets[v+1] = halfEdgeOffsets[v] + numHalfEdges[v];
+		tables.vertexEdgeOffsets[v+1] = tables.vertexEdgeOffsets[v] + numEdges[v];
+	}
+	assert( (size_t)halfEdgeOffsets.back() == vertexIds.size() );
+
+	const size_t numEdgesTotal = tables.vertexEdgeOffsets.back();
+	tables.edges.resize( numEdgesTotal );
+	tables.faceVertexEdges.resize( vertexIds.size() );
+	tables.edgeFaceVertexOffsets.resize( numEdgesTotal + 1 );
+	tables.edgeFaceVertexOffsets[numEdgesTotal] = vertexIds.size();
+	tables.edgeFaceVertices.resize( vertexIds.size() );
+	apply( FillEdges( *this, vertexIds, halfEdgeOffsets, tables ), numVertices, m_parallel );
+}
+
+size_t MeshTopology::numTriangles() const
+{
+	return triangleTables().triangleFaces.size();
+}
+
+const std::vector<int> &MeshTopology::faceTriangleOffsets() const
+{
+	return triangleTables().faceTriangleOffsets;
+}
+
+const std::vector<int> &MeshTopology::triangleFaces() const
+{
+	return triangleTables().triangleFaces;
+}
+
+const std::vector<int> &MeshTopology::triangleFaceVertices() const
+{
+	return triangleTables().triangleFaceVertices;
+}
+
+const MeshTopology::TriangleTables &MeshTopology::triangleTables() const
+{
+	return lazyTables( m_triangleTables, *this, &MeshTopology::buildTriangleTables );
+}
+
+void MeshTopology::buildTriangleTables( TriangleTables &tables ) const
+{
+	const size_t numFaces = this->numFaces();
+	tables.faceTriangleOffsets.resize( numFaces + 1 );
+	tables.faceTriangleOffsets[0] = 0;
+	for( size_t f=0; f<numFaces; ++f )
+	{
+		const int numFaceVertices = m_faceOffsets[f+1] - m_faceOffsets[f];
+		tables.faceTriangleOffsets[f+1] = tables.faceTriangleOffsets[f] + std::max( numFaceVertices - 2, 0 );
+	}
+
+	const size_t numTriangles = tables.faceTriangleOffsets.back();
+	tables.triangleFaces.resize( numTriangles );
+	tables.triangleFaceVertices.resize( numTriangles * 3 );
+	apply( FillTriangles( m_faceOffsets, tables ), numFaces, m_parallel );
+}
+
+size_t MeshTopology::memoryUsage() const
+{
+	size_t result = sizeof( *this ) + sizeof( int ) * (
+		m_faceOffsets.capacity() + m_faceVertexFaces.capacity() +
+		m_vertexFaceVertexOffsets.capacity() + m_vertexFaceVertices.capacity()
+	);
+
+	const EdgeTables *edgeTables = m_edgeTables;
+	if( edgeTables )
+	{
+		result += sizeof( EdgeTables ) + sizeof( Imath::V2i ) * edgeTables->edges.capacity() + sizeof( int ) * (
+			edgeTables->vertexEdgeOffsets.capacity() + edgeTables->faceVertexEdges.capacity() +
+			edgeTables->edgeFaceVertexOffsets.capacity() + edgeTables->edgeFaceVertices.capacity()
+		);
+	}
+
+	const TriangleTables *triangleTables = m_triangleTables;
+	if( triangleTables )
+	{
+		result += sizeof( TriangleTables ) + sizeof( int ) * (
+			triangleTables->faceTriangleOffsets.capacity() + triangleTables->triangleFaces.capacity() +
+			triangleTables->triangleFaceVertices.capacity()
+		);
+	}
+
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Cache
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+/// Keys are compared using the hash alone - the data is only used to compute
+/// the topology when it is not in the cache, and is never accessed from the
+/// keys stored by the cache.
+struct CacheKey
+{
+	CacheKey( const IntVectorData *v, const IntVectorData *i, size_t n )
+		:	hash( v->Object::hash() ), verticesPerFace( v ), vertexIds( i ), numVertices( n )
+	{
+		hash.append( vertexIds->Object::hash() );
+		hash.append( (uint64_t)numVertices );
+	}
+
+	bool operator == ( const CacheKey &other ) const
+	{
+		return hash == other.hash;
+	}
+
+	friend size_t hash_value( const CacheKey &key )
+	{
+		return tbb_hasher( key.hash );
+	}
+
+	MurmurHash hash;
+	const IntVectorData *verticesPerFace;
+	const IntVectorData *vertexIds;
+	size_t numVertices;
+};
+
+// The getter is only used when an entry is evicted between the call to
+// cached() and the call to get() in MeshTopology::get(). It builds the
+// topology serially, because the cache may be waited on by other threads
+// which could otherwise be given one of our tasks to run, and deadlock.
+ConstMeshTopologyPtr cacheGetter( const CacheKey &key, size_t &cost )
+{
+	ConstMeshTopologyPtr result = new MeshTopology( key.verticesPerFace, key.vertexIds, key.numVertices, false );
+	cost = result->memoryUsage();
+	return result;
+}
+
+typedef ShardedLRUCache<CacheKey, ConstMeshTopologyPtr> Cache;
+
+Cache &cache()
+{
+	static Cache c( cacheGetter, 500 * 1024 * 1024 );
+	return c;
+}
+
+} // namespace
+
+ConstMeshTopologyPtr MeshTopology::get( const IntVectorData *verticesPerFace, const IntVectorData *vertexIds, size_t numVertices )
+{
+	CacheKey key( verticesPerFace, vertexIds, numVertices );
+	Cache &c = cache();
+	if( !c.cached( key ) )
+	{
+		// Build in parallel outside of the cache. Concurrent requests for the same
+		// topology may do redundant work, but that's preferable to building serially.
+		ConstMeshTopologyPtr result = new MeshTopology( verticesPerFace, vertexIds, numVertices );
+		c.set( key, result, result->memoryUsage() );
+		return result;
+	}
+	return c.get( key );
+}
+
+ConstMeshTopologyPtr MeshTopology::get( const MeshPrimitive *mesh )
+{
+	return get( mesh->verticesPerFace(), mesh->vertexIds(), mesh->variableSize( PrimitiveVariable::Vertex ) );
+}
+
+void MeshTopology::setCacheMaxMemory( size_t maxMemory )
+{
+	cache().setMaxCost( maxMemory );
+}
+
+size_t MeshTopology::getCacheMaxMemory()
+{
+	return cache().getMaxCost();
+}
+
+size_t MeshTopology::cacheMemoryUsage()
+{
+	return cache().currentCost();
+}
+
+void MeshTopology::clearCache()
+{
+	cache().clear();
+}
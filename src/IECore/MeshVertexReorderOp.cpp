@@ -127,27 +127,27 @@ inline int index( int i, const int l )
 
 int MeshVertexReorderOp::faceDirection(	FaceId face, Edge edge )
 {
-	FaceToVerticesMap::const_iterator vit = m_faceToVerticesMap.find( face );
-	assert( vit != m_faceToVerticesMap.end() );
-	const VertexList &faceVertices = vit->second;
+	const std::vector<int> &offsets = m_topology->faceOffsets();
+	VertexList::const_iterator faceVerticesBegin = m_vertexIds->readable().begin() + offsets[face];
+	VertexList::const_iterator faceVerticesEnd = m_vertexIds->readable().begin() + offsets[face+1];
 
-	int numFaceVertices = faceVertices.size();
+	int numFaceVertices = faceVerticesEnd - faceVerticesBegin;
 
-	VertexList::const_iterator it = std::find( faceVertices.begin(), faceVertices.end(), edge.first );
-	assert( it != faceVertices.end() );
+	VertexList::const_iterator it = std::find( faceVerticesBegin, faceVerticesEnd, edge.first );
+	assert( it != faceVerticesEnd );
 
-	int edgeVertexOrigin = std::distance( faceVertices.begin(), it );
+	int edgeVertexOrigin = std::distance( faceVerticesBegin, it );
 
-	assert( faceVertices[ index( edgeVertexOrigin, numFaceVertices )] == edge.first );
+	assert( faceVerticesBegin[ index( edgeVertexOrigin, numFaceVertices )] == edge.first );
 
 	int direction = 0;
-	if ( faceVertices[ index( edgeVertexOrigin+1, numFaceVertices )] == edge.second )
+	if ( faceVerticesBegin[ index( edgeVertexOrigin+1, numFaceVertices )] == edge.second )
 	{
 		direction = 1;
 	}
 	else
 	{
-		assert( faceVertices[ index( edgeVertexOrigin-1, numFaceVertices )] == edge.second ) ;
+		assert( faceVerticesBegin[ index( edgeVertexOrigin-1, numFaceVertices )] == edge.second ) ;
 		direction = -1;
 	}
 
@@ -179,17 +179,17 @@ void MeshVertexReorderOp::visitFace(
 		return;
 	}
 
-	FaceToEdgesMap::const_iterator eit = m_faceToEdgesMap.find( currentFace );
-	assert( eit != m_faceToEdgesMap.end() );
-	const EdgeList &faceEdges = eit->second;
-
-	assert( faceEdges.size() >= 3 );
-
-	FaceToVerticesMap::const_iterator vit = m_faceToVerticesMap.find( currentFace );
-	assert( vit != m_faceToVerticesMap.end() );
-	const VertexList &faceVertices = vit->second;
+	const std::vector<int> &faceOffsets = m_topology->faceOffsets();
+	const VertexList faceVertices( m_vertexIds->readable().begin() + faceOffsets[currentFace], m_vertexIds->readable().begin() + faceOffsets[currentFace+1] );
 
 	int numFaceVertices = faceVertices.size();
+	assert( numFaceVertices >= 3 );
+
+	EdgeList faceEdges( numFaceVertices );
+	for ( int v = 0; v < numFaceVertices; v++ )
+	{
+		faceEdges[v] = Edge( faceVertices[v], faceVertices[( v + 1 ) % numFaceVertices] );
+	}
 
 	VertexList::const_iterator it = std::find( faceVertices.begin(), faceVertices.end(), currentEdge.first );
 	assert( it != faceVertices.end() );
@@ -240,7 +240,7 @@ void MeshVertexReorderOp::visitFace(
 	}
 
 	/// Create the "face-varying" mapping
-	int faceVaryingRemapStart = m_faceVaryingOffsets[ currentFace ];
+	int faceVaryingRemapStart = faceOffsets[ currentFace ];
 	int fvRelativeIdx = currentEdgeVertexOrigin;
 	for ( i = 0; i < numFaceVertices; i++ )
 	{
@@ -260,18 +260,24 @@ void MeshVertexReorderOp::visitFace(
 	}
 
 	/// Follow current face's edges in order, recursing onto adjacent faces
+	const std::vector<int> &edgeFaceVertexOffsets = m_topology->edgeFaceVertexOffsets();
+	const std::vector<int> &edgeFaceVertices = m_topology->edgeFaceVertices();
+	const std::vector<int> &faceVertexFaces = m_topology->faceVertexFaces();
 	for ( EdgeList::const_iterator edgeIt = faceEdgesSorted.begin(); edgeIt != faceEdgesSorted.end(); ++edgeIt )
 	{
 		Edge nextEdge( *edgeIt );
 
-		EdgeToConnectedFacesMap::const_iterator eit = m_edgeToConnectedFacesMap.find( nextEdge );
-		assert( eit != m_edgeToConnectedFacesMap.end() );
-		const FaceList &connectedFaces = eit->second;
+		int edgeIndex = m_topology->edgeIndex( nextEdge.first, nextEdge.second );
+		assert( edgeIndex >= 0 );
+		const int *connectedFaceVertices = &edgeFaceVertices[0] + edgeFaceVertexOffsets[edgeIndex];
+		const int numConnectedFaces = edgeFaceVertexOffsets[edgeIndex+1] - edgeFaceVertexOffsets[edgeIndex];
 
 		/// Recurse onto the face adjacent to the next edge
-		if ( connectedFaces.size() > 1 )
+		if ( numConnectedFaces > 1 )
 		{
-			int nextFace = ( connectedFaces[0] == currentFace ? connectedFaces[1] : connectedFaces[0] );
+			const FaceId connectedFace0 = faceVertexFaces[ connectedFaceVertices[0] ];
+			const FaceId connectedFace1 = faceVertexFaces[ connectedFaceVertices[1] ];
+			int nextFace = ( connectedFace0 == currentFace ? connectedFace1 : connectedFace0 );
 
 			if ( faceDirection( nextFace, nextEdge ) != faceVerticesDirection )
 			{
@@ -289,12 +295,6 @@ void MeshVertexReorderOp::buildInternalTopology( const MeshPrimitive * mesh )
 {
 	assert( mesh );
 
-	m_faceToEdgesMap.clear();
-	m_faceToVerticesMap.clear();
-	m_edgeToConnectedFacesMap.clear();
-	m_faceVaryingOffsets.clear();
-	m_vertexToFacesMap.clear();
-
 	m_numFaces = mesh->verticesPerFace()->readable().size();
 	m_numVerts = mesh->variableSize( PrimitiveVariable::Vertex );
 
@@ -303,45 +303,27 @@ void MeshVertexReorderOp::buildInternalTopology( const MeshPrimitive * mesh )
 		throw InvalidArgumentException( "MeshVertexReorderOp : Cannot reorder empty mesh." );
 	}
 
-	int vertOffset = 0;
-	int faceVaryingIdx = 0;
+	m_topology = MeshTopology::get( mesh );
+	m_vertexIds = mesh->vertexIds();
 
-	for ( int f = 0; f < m_numFaces; f++ )
+	const std::vector<int> &offsets = m_topology->edgeFaceVertexOffsets();
+	for ( size_t e = 0, numEdges = m_topology->numEdges(); e < numEdges; ++e )
 	{
-		int numFaceVertices = mesh->verticesPerFace()->readable()[f];
-		assert( numFaceVertices >= 3 );
-
-		m_faceVaryingOffsets.push_back( faceVaryingIdx );
-		faceVaryingIdx += numFaceVertices;
-
-		for ( int v = 0; v < numFaceVertices; v++ )
+		if ( offsets[e+1] - offsets[e] > 2 )
 		{
-			assert( vertOffset < ( int )mesh->vertexIds()->readable().size() );
-			int vertexId = mesh->vertexIds()->readable()[ vertOffset + v ];
-
-			assert( vertexId < m_numVerts );
-
-			m_vertexToFacesMap[ vertexId ].insert( f );
-
-			m_faceToVerticesMap[ f ].push_back( vertexId );
-
-			int nextVertexId = mesh->vertexIds()->readable()[ vertOffset + (( v + 1 ) % numFaceVertices )];
-
-			m_faceToEdgesMap[ f ].push_back( Edge( vertexId, nextVertexId ) );
-
-			m_edgeToConnectedFacesMap[ Edge( vertexId, nextVertexId )].push_back( f );
-			m_edgeToConnectedFacesMap[ Edge( nextVertexId, vertexId )].push_back( f );
+			throw InvalidArgumentException( "MeshVertexReorderOp : Cannot reorder non-manifold mesh." );
 		}
-
-		vertOffset += numFaceVertices;
 	}
+}
 
-	for ( EdgeToConnectedFacesMap::const_iterator it = m_edgeToConnectedFacesMap.begin(); it != m_edgeToConnectedFacesMap.end(); ++it )
+void MeshVertexReorderOp::vertexFaces( VertexId vertex, FaceSet &faces ) const
+{
+	const std::vector<int> &offsets = m_topology->vertexFaceVertexOffsets();
+	const std::vector<int> &faceVertices = m_topology->vertexFaceVertices();
+	const std::vector<int> &faceVertexFaces = m_topology->faceVertexFaces();
+	for ( int i = offsets[vertex]; i < offsets[vertex+1]; ++i )
 	{
-		if ( it->second.size() > 2 || it->second.size() == 0 )
-		{
-			throw InvalidArgumentException( "MeshVertexReorderOp : Cannot reorder non-manifold mesh." );
-		}
+		faces.insert( faces.end(), faceVertexFaces[ faceVertices[i] ] );
 	}
 }
 
@@ -364,7 +346,8 @@ void MeshVertexReorderOp::modifyTypedPrimitive( MeshPrimitive * mesh, const Comp
 
 	for ( int i = 0; i < 3; i++ )
 	{
-		if ( m_vertexToFacesMap.find( faceVtxSrc[i] ) == m_vertexToFacesMap.end() )
+		const std::vector<int> &offsets = m_topology->vertexFaceVertexOffsets();
+		if ( faceVtxSrc[i] < 0 || faceVtxSrc[i] >= m_numVerts || offsets[faceVtxSrc[i]] == offsets[faceVtxSrc[i]+1] )
 		{
 			throw InvalidArgumentException(
 			        ( boost::format( "MeshVertexReorderOp : Cannot find vertex %d" ) % faceVtxSrc[i] ).str()
@@ -374,9 +357,10 @@ void MeshVertexReorderOp::modifyTypedPrimitive( MeshPrimitive * mesh, const Comp
 
 	FaceSet tmp;
 
-	const FaceSet &vtx0Faces = m_vertexToFacesMap[ faceVtxSrc[0] ];
-	const FaceSet &vtx1Faces = m_vertexToFacesMap[ faceVtxSrc[1] ];
-	const FaceSet &vtx2Faces = m_vertexToFacesMap[ faceVtxSrc[2] ];
+	FaceSet vtx0Faces, vtx1Faces, vtx2Faces;
+	vertexFaces( faceVtxSrc[0], vtx0Faces );
+	vertexFaces( faceVtxSrc[1], vtx1Faces );
+	vertexFaces( faceVtxSrc[2], vtx2Faces );
 
 	std::set_intersection(
 	        vtx0Faces.begin(),  vtx0Faces.end(),
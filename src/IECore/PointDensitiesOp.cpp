@@ -42,6 +42,9 @@
 
 #include <cassert>
 
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
 using namespace IECore;
 using namespace Imath;
 using namespace std;
@@ -118,29 +121,61 @@ const DoubleParameter * PointDensitiesOp::multiplierParameter() const
 	return m_multiplierParameter;
 }
 
+namespace
+{
+
+template<typename T>
+class Densities
+{
+
+	public :
+
+		typedef KDTree<typename vector<Vec3<T> >::const_iterator > Tree;
+
+		Densities( const Tree &tree, const vector<Vec3<T> > &points, int numNeighbours, T multiplier, vector<T> &result )
+			:	m_tree( tree ), m_points( points ), m_numNeighbours( numNeighbours ), m_multiplier( multiplier ), m_result( result )
+		{
+		}
+
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			vector<typename Tree::Neighbour> neighbours;
+			for( size_t i=r.begin(); i!=r.end(); ++i )
+			{
+				m_tree.nearestNNeighbours( m_points[i], m_numNeighbours, neighbours );
+				T radius = ((*(neighbours.rbegin()->point)) - m_points[i]).length();
+				m_result[i] = m_multiplier / (radius*radius*radius);
+			}
+		}
+
+	private :
+
+		const Tree &m_tree;
+		const vector<Vec3<T> > &m_points;
+		int m_numNeighbours;
+		T m_multiplier;
+		vector<T> &m_result;
+
+};
+
+} // namespace
+
 /// This works by finding the nearest n neighbours, and returning n divided by the volume of the sphere containing them.
 template<typename T>
 static void densities( const vector<Vec3<T> > &points, int numNeighbours, T multiplier, vector<T> &result )
 {
-	typedef KDTree<typename vector<Vec3<T> >::const_iterator > Tree;
+	typedef typename Densities<T>::Tree Tree;
 
 	// factor constant parts of density calculation into the multiplier
 	multiplier *= (T)numNeighbours / ((4.0/3.0) * M_PI);
 
 	Tree tree( points.begin(), points.end() );
-	vector<typename Tree::Neighbour> neighbours;
 
 	result.resize( points.size() );
-	for( unsigned int i=0; i<points.size(); i++ )
-	{
-		tree.nearestNNeighbours( points[i], numNeighbours, neighbours );
-		T r = ((*(neighbours.rbegin()->point)) - points[i]).length();
-		result[i] = multiplier / (r*r*r);
-	}
+	tbb::parallel_for( tbb::blocked_range<size_t>( 0, points.size(), 100 ), Densities<T>( tree, points, numNeighbours, multiplier, result ) );
 }
 
 /// \todo Support 2d point types?
-/// \todo Threading?
 ObjectPtr PointDensitiesOp::doOperation( const CompoundObject * operands )
 {
 	const int numNeighbours = m_numNeighboursParameter->getNumericValue();
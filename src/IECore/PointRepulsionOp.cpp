@@ -38,6 +38,10 @@
 
 #include "boost/format.hpp"
 
+#include "tbb/atomic.h"
+#include "tbb/blocked_range.h"
+#include "tbb/parallel_for.h"
+
 #include "IECore/Reader.h"
 #include "IECore/ImagePrimitive.h"
 
@@ -205,106 +209,354 @@ const StringParameter * PointRepulsionOp::weightsNameParameter() const
 	return m_weightsNameParameter;
 }
 
-void PointRepulsionOp::getNearestPointsAndDensities( ImagePrimitiveEvaluator * imageEvaluator, const PrimitiveVariable &densityPrimVar, MeshPrimitiveEvaluator * meshEvaluator, const PrimitiveVariable &sPrimVar, const PrimitiveVariable &tPrimVar, std::vector<Imath::V3f> &points, std::vector<float> &densities )
+namespace
 {
-	densities.resize( points.size() );
 
-	PrimitiveEvaluator::ResultPtr meshResult = meshEvaluator->createResult();
-	PrimitiveEvaluator::ResultPtr imageResult = imageEvaluator->createResult();
+/// Snaps points onto the mesh and looks up the density at each, for use
+/// with tbb::parallel_for.
+class NearestPointsAndDensities
+{
 
-	for ( std::vector<Imath::V3f>::size_type p = 0; p < points.size(); p++ )
-	{
-		bool found = meshEvaluator->closestPoint( points[p], meshResult );
-		if ( !found )
+	public :
+
+		NearestPointsAndDensities( const ImagePrimitiveEvaluator *imageEvaluator, const PrimitiveVariable &densityPrimVar, const MeshPrimitiveEvaluator *meshEvaluator, const PrimitiveVariable &sPrimVar, const PrimitiveVariable &tPrimVar, std::vector<Imath::V3f> &points, std::vector<float> &densities, tbb::atomic<bool> &failed )
+			:	m_imageEvaluator( imageEvaluator ), m_densityPrimVar( densityPrimVar ), m_meshEvaluator( meshEvaluator ), m_sPrimVar( sPrimVar ), m_tPrimVar( tPrimVar ), m_points( points ), m_densities( densities ), m_failed( failed )
 		{
-			throw InvalidArgumentException( "PointRepulsionOp: Invaid mesh - closest point is undefined" );
 		}
 
-		points[p] = meshResult->point();
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			PrimitiveEvaluator::ResultPtr meshResult = m_meshEvaluator->createResult();
+			PrimitiveEvaluator::ResultPtr imageResult = m_imageEvaluator->createResult();
 
-		Imath::V2f uv(
-		        meshResult->floatPrimVar( sPrimVar ),
-		        meshResult->floatPrimVar( tPrimVar )
-		);
+			for ( size_t p = r.begin(); p != r.end(); ++p )
+			{
+				bool found = m_meshEvaluator->closestPoint( m_points[p], meshResult.get() );
+				if ( !found )
+				{
+					m_failed = true;
+					return;
+				}
 
-		/// \todo Texture repeat
-		float repeatU = 1.0;
-		float repeatV = 1.0;
+				m_points[p] = meshResult->point();
 
-		/// \todo Wrap modes
-		bool wrapU = true;
-		bool wrapV = true;
+				Imath::V2f uv(
+				        meshResult->floatPrimVar( m_sPrimVar ),
+				        meshResult->floatPrimVar( m_tPrimVar )
+				);
 
-		Imath::V2f placedUv(
-		        uv.x * repeatU,
-		        uv.y * repeatV
-		);
+				/// \todo Texture repeat
+				float repeatU = 1.0;
+				float repeatV = 1.0;
+
+				/// \todo Wrap modes
+				bool wrapU = true;
+				bool wrapV = true;
+
+				Imath::V2f placedUv(
+				        uv.x * repeatU,
+				        uv.y * repeatV
+				);
+
+				if ( wrapU )
+				{
+					placedUv.x = fmodf( placedUv.x, 1.0f );
+				}
 
-		if ( wrapU )
+				if ( wrapV )
+				{
+					placedUv.y = fmodf( placedUv.y, 1.0f );
+				}
+
+				m_imageEvaluator->pointAtUV( placedUv, imageResult.get() );
+
+				m_densities[p] = imageResult->floatPrimVar( m_densityPrimVar );
+			}
+		}
+
+	private :
+
+		const ImagePrimitiveEvaluator *m_imageEvaluator;
+		const PrimitiveVariable &m_densityPrimVar;
+		const MeshPrimitiveEvaluator *m_meshEvaluator;
+		const PrimitiveVariable &m_sPrimVar;
+		const PrimitiveVariable &m_tPrimVar;
+		std::vector<Imath::V3f> &m_points;
+		std::vector<float> &m_densities;
+		tbb::atomic<bool> &m_failed;
+
+};
+
+/// Accumulates the repulsive forces acting on each point, for use with tbb::parallel_for.
+class Forces
+{
+
+	public :
+
+		Forces( const Box3fBVH &tree, const std::vector<V3f> &points, const std::vector<float> &radii, const std::vector<Imath::Box3f> &bounds, std::vector<Imath::V3f> &forces, unsigned long seed, const std::vector<float> &densities, float densityInv )
+			:	m_tree( tree ), m_points( points ), m_radii( radii ), m_bounds( bounds ), m_forces( forces ), m_seed( seed ), m_densities( densities ), m_densityInv( densityInv )
 		{
-			placedUv.x = fmodf( placedUv.x, 1.0f );
 		}
 
-		if ( wrapV )
+		void operator()( const tbb::blocked_range<size_t> &r ) const
 		{
-			placedUv.y = fmodf( placedUv.y, 1.0f );
+			typedef std::vector<Box3fBVH::Iterator> Bounds;
+			Bounds approximateBounds;
+
+			for ( size_t p = r.begin(); p != r.end(); ++p )
+			{
+				// each point gets its own random sequence, so that the results don't depend
+				// on the order in which points are processed.
+				Rand48 generator( ( m_seed * m_points.size() + p ) * 2654435761u );
+
+				m_tree.intersectingBounds( m_bounds[p], approximateBounds );
+
+				for ( Bounds::const_iterator it = approximateBounds.begin(); it != approximateBounds.end(); ++it )
+				{
+					const size_t other = *it - m_bounds.begin();
+					assert( other < m_points.size() );
+					assert( other < m_radii.size() );
+
+					if ( p != other )
+					{
+						Imath::V3f separation = m_points[p] - m_points[other];
+
+						float dist = separation.length();
+
+						float densityDiff = 1.0f - fabsf( m_densities[p] * m_densityInv - m_densities[other] * m_densityInv );
+
+						if ( dist < m_radii[p] + m_radii[other] )
+						{
+							float overlap = m_radii[p] + m_radii[other] - dist;
+							assert( overlap >= 0.0f );
+							float overlapNorm = overlap / ( m_radii[p] + m_radii[other] );
+
+							if ( dist < 1.e-6f )
+							{
+								/// Points are incident, so force acts to move current point away from neighbour in a random direction
+								m_forces[ p ] += densityDiff * overlapNorm * solidSphereRand< V3f, Rand48 >( generator ) ;
+							}
+							else
+							{
+								/// Force acts to move current point away from neighbour along their line of separation
+								m_forces[ p ] += densityDiff * overlapNorm * separation.normalized() ;
+							}
+						}
+					}
+				}
+			}
 		}
 
-		imageEvaluator->pointAtUV( placedUv, imageResult );
+	private :
 
-		densities[p] = imageResult->floatPrimVar( densityPrimVar );
-	}
-}
+		const Box3fBVH &m_tree;
+		const std::vector<V3f> &m_points;
+		const std::vector<float> &m_radii;
+		const std::vector<Imath::Box3f> &m_bounds;
+		std::vector<Imath::V3f> &m_forces;
+		unsigned long m_seed;
+		const std::vector<float> &m_densities;
+		float m_densityInv;
+
+};
 
-void PointRepulsionOp::calculateForces( std::vector<V3f> &points, std::vector<float> &radii, std::vector<Imath::Box3f> &bounds, std::vector<Imath::V3f> &forces, Imath::Rand48 &generator, std::vector<float> &densities, float densityInv )
+/// Computes the radius and bound for each point, and zeroes the force accumulators.
+class RadiiAndBounds
 {
-	unsigned numPoints = points.size();
 
-	Box3fTree tree( bounds.begin(), bounds.end(), 16 );
+	public :
 
-	typedef std::vector< Box3fTree::Iterator> Bounds;
+		RadiiAndBounds( const std::vector<V3f> &points, const std::vector<float> &densities, std::vector<float> &radii, std::vector<Imath::Box3f> &bounds, std::vector<Imath::V3f> &forces )
+			:	m_points( points ), m_densities( densities ), m_radii( radii ), m_bounds( bounds ), m_forces( forces )
+		{
+		}
 
-	for ( std::vector<V3f>::size_type p = 0; p < numPoints; p++ )
-	{
-		Bounds approximateBounds;
-		tree.intersectingBounds( bounds[p], approximateBounds );
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			for ( size_t p = r.begin(); p != r.end(); ++p )
+			{
+				float pointsPerUnitArea = m_densities[ p ];
+
+				/// \todo More accurately determine the minimum permissible value for "pointsPerUnitArea"
+				float areaPerPoint = 1.0f / std::max( 0.01f, pointsPerUnitArea );
+
+				assert( p < m_radii.size() );
+
+				/// pi * r * r = area
+				/// Compensate for the fact that even at the densest possible packing (hexagonal), we only get pi/sqrt(12) ( ~ 0.9 ) efficiency,
+				/// by making each "circle" slightly larger by sqrt(12)/pi
+				m_radii[p] = sqrt( areaPerPoint / M_PI ) * sqrt( 12.0f ) / M_PI;
+
+				m_bounds[p] = Imath::Box3f(
+				                    Imath::V3f( m_points[p] - Imath::V3f( m_radii[p], m_radii[p], m_radii[p] ) ),
+				                    Imath::V3f( m_points[p] + Imath::V3f( m_radii[p], m_radii[p], m_radii[p] ) )
+				            );
+
+				/// Zero force accumulator
+				m_forces[p] = V3f( 0.0 );
+			}
+		}
 
-		for ( Bounds::const_iterator it = approximateBounds.begin(); it != approximateBounds.end(); ++it )
+	private :
+
+		const std::vector<V3f> &m_points;
+		const std::vector<float> &m_densities;
+		std::vector<float> &m_radii;
+		std::vector<Imath::Box3f> &m_bounds;
+		std::vector<Imath::V3f> &m_forces;
+
+};
+
+/// Advects each point by the force applied to it, remembering the old positions.
+class Advect
+{
+
+	public :
+
+		Advect( std::vector<V3f> &points, std::vector<V3f> &oldPoints, const std::vector<V3f> &forces, float magnitude )
+			:	m_points( points ), m_oldPoints( oldPoints ), m_forces( forces ), m_magnitude( magnitude )
 		{
-			const std::vector<V3f>::size_type other = *it - bounds.begin();
-			assert( other < numPoints );
-			assert( other < radii.size() );
+		}
 
-			if ( p != other )
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			for ( size_t p = r.begin(); p != r.end(); ++p )
 			{
-				Imath::V3f separation = points[p] - points[other];
+				m_oldPoints[p] = m_points[p];
+				m_points[p] += m_forces[p] * m_magnitude;
+			}
+		}
 
-				float dist = separation.length();
+	private :
 
-				float densityDiff = 1.0f - fabsf( densities[p] * densityInv - densities[other] * densityInv );
+		std::vector<V3f> &m_points;
+		std::vector<V3f> &m_oldPoints;
+		const std::vector<V3f> &m_forces;
+		float m_magnitude;
 
-				if ( dist < radii[p] + radii[other] )
-				{
-					float overlap = radii[p] + radii[other] - dist;
-					assert( overlap >= 0.0f );
-					float overlapNorm = overlap / ( radii[p] + radii[other] );
+};
+
+/// The number of points in each block for which ScaleForcesAndAdvect sums the energy.
+static const size_t g_energyBlockSize = 1024;
+
+/// Scales the forces according to the change in density, and advects the points from
+/// their old positions. The energy is summed separately for each block of
+/// g_energyBlockSize points, so that the total doesn't depend on the way the work is
+/// divided between threads.
+class ScaleForcesAndAdvect
+{
+
+	public :
 
-					if ( dist < 1.e-6f )
+		ScaleForcesAndAdvect( std::vector<V3f> &points, const std::vector<V3f> &oldPoints, std::vector<V3f> &forces, const std::vector<float> &originalDensities, const std::vector<float> &currentDensities, const std::vector<float> *weights, float magnitude, std::vector<float> &blockEnergies )
+			:	m_points( points ), m_oldPoints( oldPoints ), m_forces( forces ), m_originalDensities( originalDensities ), m_currentDensities( currentDensities ), m_weights( weights ), m_magnitude( magnitude ), m_blockEnergies( blockEnergies )
+		{
+		}
+
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			for ( size_t block = r.begin(); block != r.end(); ++block )
+			{
+				const size_t end = std::min( ( block + 1 ) * g_energyBlockSize, m_points.size() );
+				float energy = 0.0f;
+				for ( size_t p = block * g_energyBlockSize; p < end; ++p )
+				{
+					float denom = std::max( m_originalDensities[p], m_currentDensities[p] );
+					float scale = 1.0f;
+					if ( denom > 1.0e-6f )
 					{
-						/// Points are incident, so force acts to move current point away from neighbour in a random direction
-						forces[ p ] += densityDiff * overlapNorm * solidSphereRand< V3f, Rand48 >( generator ) ;
+						scale = fabsf( m_originalDensities[p] - m_currentDensities[p] ) / denom;
 					}
-					else
+					m_forces[p] *= 1.0f - scale;
+
+					if ( m_weights )
 					{
-						/// Force acts to move current point away from neighbour along their line of separation
-						forces[ p ] += densityDiff * overlapNorm * separation.normalized() ;
+						m_forces[p] *= (*m_weights)[ p ];
 					}
+
+					energy += m_forces[p].length();
+
+					/// Advect point by force applied to it
+					m_points[p] = m_oldPoints[p] + m_forces[p] * m_magnitude;
+				}
+				m_blockEnergies[block] = energy;
+			}
+		}
+
+	private :
+
+		std::vector<V3f> &m_points;
+		const std::vector<V3f> &m_oldPoints;
+		std::vector<V3f> &m_forces;
+		const std::vector<float> &m_originalDensities;
+		const std::vector<float> &m_currentDensities;
+		const std::vector<float> *m_weights;
+		float m_magnitude;
+		std::vector<float> &m_blockEnergies;
+
+};
+
+/// Finds the uvs of the closest points on the mesh.
+class ClosestUVs
+{
+
+	public :
+
+		ClosestUVs( const MeshPrimitiveEvaluator *meshEvaluator, const std::vector<V3f> &points, std::vector<float> *s, std::vector<float> *t )
+			:	m_meshEvaluator( meshEvaluator ), m_points( points ), m_s( s ), m_t( t )
+		{
+		}
+
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			PrimitiveEvaluator::ResultPtr meshResult = m_meshEvaluator->createResult();
+			for ( size_t p = r.begin(); p != r.end(); ++p )
+			{
+				bool found = m_meshEvaluator->closestPoint( m_points[p], meshResult.get() );
+				assert( found );
+				( void ) found;
+
+				if ( m_s )
+				{
+					(*m_s)[p] = meshResult->uv().x;
+				}
+				if ( m_t )
+				{
+					(*m_t)[p] = meshResult->uv().y;
 				}
 			}
 		}
+
+	private :
+
+		const MeshPrimitiveEvaluator *m_meshEvaluator;
+		const std::vector<V3f> &m_points;
+		std::vector<float> *m_s;
+		std::vector<float> *m_t;
+
+};
+
+} // namespace
+
+void PointRepulsionOp::getNearestPointsAndDensities( ImagePrimitiveEvaluator * imageEvaluator, const PrimitiveVariable &densityPrimVar, MeshPrimitiveEvaluator * meshEvaluator, const PrimitiveVariable &sPrimVar, const PrimitiveVariable &tPrimVar, std::vector<Imath::V3f> &points, std::vector<float> &densities )
+{
+	densities.resize( points.size() );
+
+	tbb::atomic<bool> failed;
+	failed = false;
+	tbb::parallel_for( tbb::blocked_range<size_t>( 0, points.size(), 100 ), NearestPointsAndDensities( imageEvaluator, densityPrimVar, meshEvaluator, sPrimVar, tPrimVar, points, densities, failed ) );
+
+	if ( failed )
+	{
+		throw InvalidArgumentException( "PointRepulsionOp: Invaid mesh - closest point is undefined" );
 	}
 }
 
+void PointRepulsionOp::calculateForces( const Box3fBVH &tree, const std::vector<V3f> &points, const std::vector<float> &radii, const std::vector<Imath::Box3f> &bounds, std::vector<Imath::V3f> &forces, unsigned long seed, const std::vector<float> &densities, float densityInv )
+{
+	tbb::parallel_for( tbb::blocked_range<size_t>( 0, points.size(), 100 ), Forces( tree, points, radii, bounds, forces, seed, densities, densityInv ) );
+}
+
 
 void PointRepulsionOp::modify( Object * object, const CompoundObject * operands )
 {
@@ -514,10 +766,17 @@ void PointRepulsionOp::modify( Object * object, const CompoundObject * operands
 	std::vector<float> radii( numPoints );
 	std::vector<Imath::V3f> oldPoints( numPoints );
 	std::vector<Imath::Box3f> bounds( numPoints );
+	const std::vector<Imath::Box3f> &constBounds = bounds;
+	std::vector<float> blockEnergies( ( numPoints + g_energyBlockSize - 1 ) / g_energyBlockSize );
+	const std::vector<float> *weightsVector = weights ? &weights->readable() : 0;
 
-	float lastEnergy = std::numeric_limits<float>::max();
+	/// The points only move a little in each iteration, so rather than rebuild the
+	/// tree each time, we refit it to the new bounds, and only rebuild it periodically
+	/// to stop it degrading.
+	const int treeRebuildInterval = 10;
+	Box3fBVH tree;
 
-	Rand48 generator( 1 );
+	float lastEnergy = std::numeric_limits<float>::max();
 
 	for ( int i = 0; i < numIterations; ++i )
 	{
@@ -537,66 +796,31 @@ void PointRepulsionOp::modify( Object * object, const CompoundObject * operands
 		}
 
 		/// Update radii, bounds, and force accumulator
-		for ( PointArray::size_type p = 0; p < numPoints; p++ )
-		{
-			float pointsPerUnitArea = originalDensities[ p ];
-
-			/// \todo More accurately determine the minimum permissible value for "pointsPerUnitArea"
-			float areaPerPoint = 1.0f / std::max( 0.01f, pointsPerUnitArea );
+		tbb::parallel_for( tbb::blocked_range<size_t>( 0, numPoints, 1000 ), RadiiAndBounds( points, originalDensities, radii, bounds, forces ) );
 
-			assert( p < radii.size() );
-
-			/// pi * r * r = area
-			/// Compensate for the fact that even at the densest possible packing (hexagonal), we only get pi/sqrt(12) ( ~ 0.9 ) efficiency,
-			/// by making each "circle" slightly larger by sqrt(12)/pi
-			radii[p] = sqrt( areaPerPoint / M_PI ) * sqrt( 12.0f ) / M_PI;
-
-			assert( p < radii.size() );
-			bounds[p] = Imath::Box3f(
-			                    Imath::V3f( points[p] - Imath::V3f( radii[p], radii[p], radii[p] ) ),
-			                    Imath::V3f( points[p] + Imath::V3f( radii[p], radii[p], radii[p] ) )
-			            );
-
-			/// Zero force accumulator
-			forces[p] = V3f( 0.0 );
+		if ( i % treeRebuildInterval == 0 )
+		{
+			tree.init( constBounds.begin(), constBounds.end() );
 		}
-
-		calculateForces( points, radii, bounds, forces, generator, originalDensities, textureArea / ( float )numPoints );
-
-		std::copy( points.begin(), points.end(), oldPoints.begin() );
-
-		float totalEnergy = 0.0f;
-		for ( PointArray::size_type p = 0; p < numPoints; p++ )
+		else
 		{
-			totalEnergy += forces[p].length();
-
-			/// Advect point by force applied to it
-			points[p] += forces[p] * magnitude;
+			tree.refit();
 		}
 
-		// Snap points back to mesh, and calculate new densities
-		getNearestPointsAndDensities( imageEvaluator, densityPrimVar, meshEvaluator, sIt->second, tIt->second, points, currentDensities );
+		calculateForces( tree, points, radii, bounds, forces, i, originalDensities, textureArea / ( float )numPoints );
 
-		totalEnergy = 0.0f;
-		for ( PointArray::size_type p = 0; p < numPoints; p++ )
-		{
-			float denom = std::max( originalDensities[p], currentDensities[p] );
-			float scale = 1.0f;
-			if ( denom > 1.0e-6f )
-			{
-				scale = fabsf( originalDensities[p] - currentDensities[p] ) / denom;
-			}
-			forces[p] *= 1.0f - scale;
+		/// Advect points by the forces applied to them
+		tbb::parallel_for( tbb::blocked_range<size_t>( 0, numPoints, 1000 ), Advect( points, oldPoints, forces, magnitude ) );
 
-			if ( weights )
-			{
-				forces[p] *= weights->readable()[ p ];
-			}
+		// Snap points back to mesh, and calculate new densities
+		getNearestPointsAndDensities( imageEvaluator, densityPrimVar, meshEvaluator, sIt->second, tIt->second, points, currentDensities );
 
-			totalEnergy += forces[p].length();
+		tbb::parallel_for( tbb::blocked_range<size_t>( 0, blockEnergies.size() ), ScaleForcesAndAdvect( points, oldPoints, forces, originalDensities, currentDensities, weightsVector, magnitude, blockEnergies ) );
 
-			/// Advect point by force applied to it
-			points[p] = oldPoints[p] + forces[p] * magnitude;
+		float totalEnergy = 0.0f;
+		for ( std::vector<float>::const_iterator it = blockEnergies.begin(); it != blockEnergies.end(); ++it )
+		{
+			totalEnergy += *it;
 		}
 
 		assert( totalEnergy >= 0.0f );
@@ -653,23 +877,10 @@ void PointRepulsionOp::modify( Object * object, const CompoundObject * operands
 
 		assert( sData || tData );
 
-		for ( PointArray::size_type p = 0; p < numPoints; p++ )
-		{
-			bool found = meshEvaluator->closestPoint( points[p], meshResult );
-			assert( found );
-			( void ) found;
-
-			if ( sData )
-			{
-				assert( p < sData->readable().size() );
-				sData->writable()[p] = meshResult->uv().x;
-			}
-			if ( tData )
-			{
-				assert( p < tData->readable().size() );
-				tData->writable()[p] = meshResult->uv().y;
-			}
-		}
+		tbb::parallel_for(
+			tbb::blocked_range<size_t>( 0, numPoints, 100 ),
+			ClosestUVs( meshEvaluator.get(), points, sData ? &sData->writable() : 0, tData ? &tData->writable() : 0 )
+		);
 
 		if ( sData )
 		{
@@ -256,6 +256,8 @@ void PointsPrimitiveEvaluator::buildTree()
 		return;
 	}
 	
-	m_tree.init( m_pVector->begin(), m_pVector->end() );
+	// we mustn't build in parallel while holding the lock, as the calling thread
+	// could steal a task which also needs the lock, and deadlock.
+	m_tree.init( m_pVector->begin(), m_pVector->end(), 4, false );
 	m_haveTree = true;
 }
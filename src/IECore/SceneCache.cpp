@@ -33,6 +33,11 @@
 //////////////////////////////////////////////////////////////////////////
 
 #include "tbb/concurrent_hash_map.h"
+#include "tbb/parallel_for.h"
+#include "tbb/mutex.h"
+#include "tbb/tbb_thread.h"
+#include "tbb/task.h"
+#include "boost/filesystem/operations.hpp"
 #include "OpenEXR/ImathBoxAlgo.h"
 #include "IECore/SceneCache.h"
 #include "IECore/FileIndexedIO.h"
@@ -44,6 +49,8 @@
 #include "IECore/TransformationMatrixData.h"
 #include "IECore/SharedSceneInterfaces.h"
 #include "IECore/MessageHandler.h"
+#include "IECore/MurmurHash.h"
+#include "IECore/ShardedLRUCache.h"
 
 using namespace IECore;
 using namespace Imath;
@@ -76,6 +83,20 @@ const SceneInterface::Name &SceneCache::animatedObjectPrimVarsAttribute = Intern
 
 typedef std::vector<double> SampleTimes;
 
+/// Sample times loaded by the reader. All the locations using the same sample times share
+/// one instance, which remembers the last interval found in it, so that queries at
+/// increasing times don't need to search the samples.
+struct SharedSampleTimes : public SampleTimes
+{
+	SharedSampleTimes()
+	{
+		lastCeilIndex = 0;
+	}
+
+	/// Index of the upper sample of the last interval found, or 0 if there is none.
+	mutable tbb::atomic<size_t> lastCeilIndex;
+};
+
 class SceneCache::Implementation : public RefCounted
 {
 	public :
@@ -211,6 +232,8 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 
 		ReaderImplementation( IndexedIOPtr io, SceneCache::Implementation *parent = 0) : SceneCache::Implementation( io ), m_parent(static_cast< ReaderImplementation* >( parent )), m_sampleTimesMap(0), m_boundSampleTimes(0), m_transformSampleTimes(0), m_objectSampleTimes(0)
 		{
+			m_locationHashState = UnknownHash;
+
 			if ( m_parent )
 			{
 				// use same map from the root
@@ -252,7 +275,7 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 			}
 		}
 
-		const SampleTimes &boundSampleTimes() const
+		const SharedSampleTimes &boundSampleTimes() const
 		{
 			if ( !m_boundSampleTimes )
 			{
@@ -267,7 +290,7 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 
 		double boundSampleTime( size_t sampleIndex ) const
 		{
-			const SampleTimes &sampleTimes = boundSampleTimes();
+			const SharedSampleTimes &sampleTimes = boundSampleTimes();
 			if ( sampleIndex >= sampleTimes.size() )
 			{
 				throw Exception( "Sample index out of bounds!" );
@@ -275,16 +298,30 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 			return sampleTimes[sampleIndex];
 		}
 
-		static inline double sampleInterval( const SampleTimes &sampleTimes, double time, size_t &floorIndex, size_t &ceilIndex )
+		static inline double sampleInterval( const SharedSampleTimes &sampleTimes, double time, size_t &floorIndex, size_t &ceilIndex )
 		{
-			SampleTimes::const_iterator it = sampleTimes.begin();
-			for ( ; it != sampleTimes.end(); it++ )
+			// find the first sample at or after the given time, trying the last
+			// interval found and the one following it before searching.
+			SampleTimes::const_iterator it;
+			size_t lastCeilIndex = sampleTimes.lastCeilIndex;
+			if ( lastCeilIndex && lastCeilIndex < sampleTimes.size() && sampleTimes[lastCeilIndex-1] < time && time <= sampleTimes[lastCeilIndex] )
+			{
+				it = sampleTimes.begin() + lastCeilIndex;
+			}
+			else if ( lastCeilIndex && lastCeilIndex + 1 < sampleTimes.size() && sampleTimes[lastCeilIndex] < time && time <= sampleTimes[lastCeilIndex+1] )
 			{
-				if ( time <= *it )
+				it = sampleTimes.begin() + lastCeilIndex + 1;
+				sampleTimes.lastCeilIndex = lastCeilIndex + 1;
+			}
+			else
+			{
+				it = std::lower_bound( sampleTimes.begin(), sampleTimes.end(), time );
+				if ( it != sampleTimes.begin() && it != sampleTimes.end() )
 				{
-					break;
+					sampleTimes.lastCeilIndex = it - sampleTimes.begin();
 				}
 			}
+
 			if ( it == sampleTimes.begin() )
 			{
 				ceilIndex = floorIndex = 0;
@@ -302,17 +339,26 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 
 		double boundSampleInterval( double time, size_t &floorIndex, size_t &ceilIndex ) const
 		{
-			const SampleTimes &sampleTimes = boundSampleTimes();
+			const SharedSampleTimes &sampleTimes = boundSampleTimes();
 			return sampleInterval( sampleTimes, time, floorIndex, ceilIndex );
 		}
 
 		size_t numBoundSamples() const
 		{
-			const SampleTimes &sampleTimes = boundSampleTimes();
+			const SharedSampleTimes &sampleTimes = boundSampleTimes();
 			return sampleTimes.size();
 		}
 
 		Imath::Box3d readBoundAtSample( size_t sampleIndex ) const
+		{
+			if ( ConstObjectPtr bound = cachedSample( boundEntry, sampleIndex ) )
+			{
+				return static_cast< const Box3dData * >( bound.get() )->readable();
+			}
+			return loadBoundAtSample( sampleIndex );
+		}
+
+		Imath::Box3d loadBoundAtSample( size_t sampleIndex ) const
 		{
 			IndexedIOPtr io = m_indexedIO->subdirectory( boundEntry, IndexedIO::NullIfMissing );
 			if ( !io )
@@ -336,6 +382,11 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 		{
 			size_t sample1, sample2;
 			double x = boundSampleInterval( time, sample1, sample2 );
+			return readBound( sample1, sample2, x );
+		}
+
+		Imath::Box3d readBound( size_t sample1, size_t sample2, double x ) const
+		{
 			if ( x == 0 )
 			{
 				return readBoundAtSample( sample1 );
@@ -352,7 +403,7 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 			return box;
 		}
 
-		inline const SampleTimes &transformSampleTimes() const
+		inline const SharedSampleTimes &transformSampleTimes() const
 		{
 			if ( !m_transformSampleTimes )
 			{
@@ -367,13 +418,13 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 
 		size_t numTransformSamples() const
 		{
-			const SampleTimes &sampleTimes = transformSampleTimes();
+			const SharedSampleTimes &sampleTimes = transformSampleTimes();
 			return sampleTimes.size();
 		}
 
 		double transformSampleTime( size_t sampleIndex ) const
 		{
-			const SampleTimes &sampleTimes = transformSampleTimes();
+			const SharedSampleTimes &sampleTimes = transformSampleTimes();
 			if ( sampleIndex >= sampleTimes.size() )
 			{
 				throw Exception( "Sample index out of bounds!" );
@@ -383,11 +434,20 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 
 		double transformSampleInterval( double time, size_t &floorIndex, size_t &ceilIndex ) const
 		{
-			const SampleTimes &sampleTimes = transformSampleTimes();
+			const SharedSampleTimes &sampleTimes = transformSampleTimes();
 			return sampleInterval( sampleTimes, time, floorIndex, ceilIndex );
 		}
 
 		DataPtr readTransformAtSample( size_t sampleIndex ) const
+		{
+			if ( ConstObjectPtr transform = cachedSample( transformEntry, sampleIndex ) )
+			{
+				return static_cast< const Data * >( transform.get() )->copy();
+			}
+			return loadTransformAtSample( sampleIndex );
+		}
+
+		DataPtr loadTransformAtSample( size_t sampleIndex ) const
 		{
 			IndexedIOPtr io = m_indexedIO->subdirectory( transformEntry, IndexedIO::NullIfMissing );
 			if ( !io )
@@ -406,13 +466,22 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 
 		Imath::M44d readTransformAsMatrixAtSample( size_t sampleIndex ) const
 		{
-			return dataToMatrix( readTransformAtSample( sampleIndex ) );
+			if ( ConstObjectPtr transform = cachedSample( transformEntry, sampleIndex ) )
+			{
+				return dataToMatrix( static_cast< const Data * >( transform.get() ) );
+			}
+			return dataToMatrix( loadTransformAtSample( sampleIndex ) );
 		}
 
 		DataPtr readTransform( double time ) const
 		{
 			size_t sample1, sample2;
 			double x = transformSampleInterval( time, sample1, sample2 );
+			return readTransform( sample1, sample2, x );
+		}
+
+		DataPtr readTransform( size_t sample1, size_t sample2, double x ) const
+		{
 			if ( x == 0 )
 			{
 				return readTransformAtSample( sample1 );
@@ -437,30 +506,53 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 			return dataToMatrix( readTransform( time ) );
 		}
 
-		inline const SampleTimes &attributeSampleTimes( const SceneCache::Name &name ) const
+		Imath::M44d readTransformAsMatrix( size_t sample1, size_t sample2, double x ) const
 		{
-			// \todo consider tbb::concurrent_hash_map instead
-			std::pair< AttributeSamplesMap::iterator, bool > it = m_attributeSampleTimes.insert( std::pair< IndexedIO::EntryID, SampleTimes* >( name, NULL ) );
-			if ( it.second )
+			if ( x == 0 )
+			{
+				return readTransformAsMatrixAtSample( sample1 );
+			}
+			if ( x == 1 )
 			{
-				it.first->second = restoreSampleTimes( attributesEntry, false, &name );
+				return readTransformAsMatrixAtSample( sample2 );
 			}
-			if ( !it.first->second )
+			return dataToMatrix( readTransform( sample1, sample2, x ) );
+		}
+
+		inline const SharedSampleTimes &attributeSampleTimes( const SceneCache::Name &name ) const
+		{
+			const SharedSampleTimes *sampleTimes = 0;
+			AttributeSamplesMap::const_accessor cit;
+			if ( m_attributeSampleTimes.find( cit, name ) )
+			{
+				sampleTimes = cit->second;
+			}
+			else
+			{
+				cit.release();
+				AttributeSamplesMap::accessor it;
+				if ( m_attributeSampleTimes.insert( it, name ) )
+				{
+					it->second = restoreSampleTimes( attributesEntry, false, &name );
+				}
+				sampleTimes = it->second;
+			}
+			if ( !sampleTimes )
 			{
 				throw Exception( ( boost::format( "No samples for attribute %s available" ) % name.value() ).str() );
 			}
-			return *(it.first->second);
+			return *sampleTimes;
 		}
 
 		size_t numAttributeSamples( const SceneCache::Name &name ) const
 		{
-			const SampleTimes &sampleTimes = attributeSampleTimes(name);
+			const SharedSampleTimes &sampleTimes = attributeSampleTimes(name);
 			return sampleTimes.size();
 		}
 
 		double attributeSampleTime( const SceneCache::Name &name, size_t sampleIndex ) const
 		{
-			const SampleTimes &sampleTimes = attributeSampleTimes( name );
+			const SharedSampleTimes &sampleTimes = attributeSampleTimes( name );
 			if ( sampleIndex >= sampleTimes.size() )
 			{
 				throw Exception( "Sample index out of bounds!" );
@@ -470,7 +562,7 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 
 		double attributeSampleInterval( const SceneCache::Name &name, double time, size_t &floorIndex, size_t &ceilIndex ) const
 		{
-			const SampleTimes &sampleTimes = attributeSampleTimes( name );
+			const SharedSampleTimes &sampleTimes = attributeSampleTimes( name );
 			return sampleInterval( sampleTimes, time, floorIndex, ceilIndex );
 		}
 
@@ -503,7 +595,7 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 			return attributeObj;
 		}
 
-		inline const SampleTimes &objectSampleTimes() const
+		inline const SharedSampleTimes &objectSampleTimes() const
 		{
 			if ( !m_objectSampleTimes )
 			{
@@ -514,13 +606,13 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 
 		size_t numObjectSamples() const
 		{
-			const SampleTimes &sampleTimes = objectSampleTimes();
+			const SharedSampleTimes &sampleTimes = objectSampleTimes();
 			return sampleTimes.size();
 		}
 
 		double objectSampleTime( size_t sampleIndex ) const
 		{
-			const SampleTimes &sampleTimes = objectSampleTimes();
+			const SharedSampleTimes &sampleTimes = objectSampleTimes();
 			if ( sampleIndex >= sampleTimes.size() )
 			{
 				throw Exception( "Sample index out of bounds!" );
@@ -530,11 +622,20 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 
 		double objectSampleInterval( double time, size_t &floorIndex, size_t &ceilIndex ) const
 		{
-			const SampleTimes &sampleTimes = objectSampleTimes();
+			const SharedSampleTimes &sampleTimes = objectSampleTimes();
 			return sampleInterval( sampleTimes, time, floorIndex, ceilIndex );
 		}
 
 		ObjectPtr readObjectAtSample( size_t sampleIndex ) const
+		{
+			if ( ConstObjectPtr object = cachedSample( objectEntry, sampleIndex ) )
+			{
+				return object->copy();
+			}
+			return loadObjectAtSample( sampleIndex );
+		}
+
+		ObjectPtr loadObjectAtSample( size_t sampleIndex ) const
 		{
 			return Object::load( m_indexedIO->subdirectory( objectEntry ), sampleEntry(sampleIndex) );
 		}
@@ -634,20 +735,327 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 			return reader;
 		}
 
+		/// The interval around a time in a set of sample times, as returned by sampleInterval().
+		struct SampleInterval
+		{
+			size_t floorIndex;
+			size_t ceilIndex;
+			double x;
+		};
+
+		typedef std::map< const SharedSampleTimes *, SampleInterval > SampleIntervals;
+
+		/// Returns the interval around the time in the given sample times, computing it only
+		/// the first time each distinct set of sample times is seen.
+		static const SampleInterval &sampleInterval( SampleIntervals &intervals, const SharedSampleTimes &sampleTimes, double time )
+		{
+			std::pair< SampleIntervals::iterator, bool > it = intervals.insert( SampleIntervals::value_type( &sampleTimes, SampleInterval() ) );
+			SampleInterval &interval = it.first->second;
+			if ( it.second )
+			{
+				interval.x = sampleInterval( sampleTimes, time, interval.floorIndex, interval.ceilIndex );
+			}
+			return interval;
+		}
+
+		void readBounds( const std::vector<Path> &paths, double time, std::vector<Imath::Box3d> &bounds )
+		{
+			SampleIntervals intervals;
+			bounds.resize( paths.size() );
+			for ( size_t i = 0; i < paths.size(); ++i )
+			{
+				SceneCache::ImplementationPtr impl = scene( paths[i], SceneInterface::ThrowIfMissing );
+				const ReaderImplementation *location = static_cast< const ReaderImplementation * >( impl.get() );
+				const SampleInterval &interval = sampleInterval( intervals, location->boundSampleTimes(), time );
+				bounds[i] = location->readBound( interval.floorIndex, interval.ceilIndex, interval.x );
+			}
+		}
+
+		void readTransformsAsMatrix( const std::vector<Path> &paths, double time, std::vector<Imath::M44d> &transforms )
+		{
+			SampleIntervals intervals;
+			transforms.resize( paths.size() );
+			for ( size_t i = 0; i < paths.size(); ++i )
+			{
+				SceneCache::ImplementationPtr impl = scene( paths[i], SceneInterface::ThrowIfMissing );
+				const ReaderImplementation *location = static_cast< const ReaderImplementation * >( impl.get() );
+				const SampleInterval &interval = sampleInterval( intervals, location->transformSampleTimes(), time );
+				transforms[i] = location->readTransformAsMatrix( interval.floorIndex, interval.ceilIndex, interval.x );
+			}
+		}
+
+		/// Key for the object cache shared by all the readers. Keys are compared using the hash alone -
+		/// the reader is only used to load the sample when it is not in the cache, and is never accessed
+		/// from the keys stored by the cache.
+		struct CacheKey
+		{
+			CacheKey( const ReaderImplementation *r, const MurmurHash &locationHash, const IndexedIO::EntryID &e, size_t s )
+				: hash( locationHash ), reader( r ), entry( e ), sample( s )
+			{
+				hash.append( entry );
+				hash.append( (uint64_t)sample );
+			}
+
+			bool operator == ( const CacheKey &other ) const
+			{
+				return hash == other.hash;
+			}
+
+			friend size_t hash_value( const CacheKey &key )
+			{
+				return tbb_hasher( key.hash );
+			}
+
+			MurmurHash hash;
+			const ReaderImplementation *reader;
+			IndexedIO::EntryID entry;
+			size_t sample;
+		};
+
+		typedef ShardedLRUCache< CacheKey, ConstObjectPtr > ObjectCache;
+
+		static ObjectCache &objectCache()
+		{
+			static ObjectCache cache( objectCacheGetter, 0 );
+			return cache;
+		}
+
+		static tbb::atomic<size_t> g_objectCacheLookups;
+		static tbb::atomic<size_t> g_objectCacheMisses;
+
+		/// Background task used by SceneCache::prefetch(). It loads the index of the
+		/// requested locations and passes all the entries at once to the IndexedIO,
+		/// so they can be prefetched in file order.
+		class PrefetchTask : public tbb::task
+		{
+			public :
+
+				PrefetchTask( ReaderImplementation *reader, const std::vector<Path> &paths, const std::vector<double> &times, unsigned entries )
+					: m_reader( reader ), m_paths( paths ), m_times( times ), m_entries( entries )
+				{
+				}
+
+				virtual tbb::task *execute()
+				{
+					try
+					{
+						std::vector<IndexedIO::EntryIDList> ioPaths;
+						for ( std::vector<Path>::const_iterator it = m_paths.begin(); it != m_paths.end(); ++it )
+						{
+							SceneCache::ImplementationPtr location = m_reader->scene( *it, SceneInterface::NullIfMissing );
+							if ( location )
+							{
+								static_cast< ReaderImplementation * >( location.get() )->prefetchPaths( m_times, m_entries, ioPaths );
+							}
+						}
+						m_reader->m_indexedIO->directory( IndexedIO::rootPath )->prefetch( ioPaths );
+					}
+					catch ( std::exception &e )
+					{
+						msg( Msg::Warning, "SceneCache::prefetch", e.what() );
+					}
+					return 0;
+				}
+
+			private :
+
+				ReaderImplementationPtr m_reader;
+				std::vector<Path> m_paths;
+				std::vector<double> m_times;
+				unsigned m_entries;
+		};
+
+		void prefetch( const std::vector<Path> &paths, const std::vector<double> &times, unsigned entries )
+		{
+			tbb::task::enqueue( *new( tbb::task::allocate_root() ) PrefetchTask( this, paths, times, entries ) );
+		}
+
 	private :
 	
 		// \todo Consider using concurrent_vector for constant access time.
-		typedef tbb::concurrent_hash_map< uint64_t, SampleTimes > SampleTimesMap;
-		typedef std::map< IndexedIO::EntryID, const SampleTimes* > AttributeSamplesMap;
+		/// Hashes EntryIDs by the address of their interned string.
+		struct EntryIDHashCompare
+		{
+			static size_t hash( const IndexedIO::EntryID &name )
+			{
+				return boost::hash<const char *>()( name.c_str() );
+			}
+
+			static bool equal( const IndexedIO::EntryID &a, const IndexedIO::EntryID &b )
+			{
+				return a == b;
+			}
+		};
+
+		typedef tbb::concurrent_hash_map< uint64_t, SharedSampleTimes > SampleTimesMap;
+		typedef tbb::concurrent_hash_map< IndexedIO::EntryID, const SharedSampleTimes*, EntryIDHashCompare > AttributeSamplesMap;
 
 		ReaderImplementationPtr m_parent;
 		mutable SampleTimesMap *m_sampleTimesMap;
 
 		/// pointers to values in m_sampleTimesMap.
-		mutable const SampleTimes *m_boundSampleTimes;
-		mutable const SampleTimes *m_transformSampleTimes;
+		mutable const SharedSampleTimes *m_boundSampleTimes;
+		mutable const SharedSampleTimes *m_transformSampleTimes;
 		mutable AttributeSamplesMap m_attributeSampleTimes;
-		mutable const SampleTimes *m_objectSampleTimes;
+		mutable const SharedSampleTimes *m_objectSampleTimes;
+
+		enum LocationHashState
+		{
+			UnknownHash,
+			ComputingHash,
+			ValidHash,
+			NoHash
+		};
+
+		mutable MurmurHash m_locationHash;
+		mutable tbb::atomic<LocationHashState> m_locationHashState;
+
+		/// Appends the IndexedIO paths (from the root of the file) of the requested entries at this location.
+		void prefetchPaths( const std::vector<double> &times, unsigned entries, std::vector<IndexedIO::EntryIDList> &paths ) const
+		{
+			IndexedIO::EntryIDList locationPath;
+			m_indexedIO->path( locationPath );
+
+			if ( ( entries & SceneInterface::PrefetchBound ) && m_indexedIO->hasEntry( boundEntry ) )
+			{
+				prefetchSamples( locationPath, boundEntry, boundSampleTimes(), times, paths );
+			}
+			if ( ( entries & SceneInterface::PrefetchTransform ) && m_indexedIO->hasEntry( transformEntry ) )
+			{
+				prefetchSamples( locationPath, transformEntry, transformSampleTimes(), times, paths );
+			}
+			if ( ( entries & SceneInterface::PrefetchObject ) && hasObject() )
+			{
+				prefetchSamples( locationPath, objectEntry, objectSampleTimes(), times, paths );
+			}
+			if ( entries & SceneInterface::PrefetchAttributes )
+			{
+				NameList attrs;
+				attributeNames( attrs );
+				locationPath.push_back( attributesEntry );
+				for ( NameList::const_iterator it = attrs.begin(); it != attrs.end(); ++it )
+				{
+					prefetchSamples( locationPath, *it, attributeSampleTimes( *it ), times, paths );
+				}
+			}
+		}
+
+		/// Appends the path of the entry, or of its samples around the given times.
+		static void prefetchSamples( const IndexedIO::EntryIDList &locationPath, const IndexedIO::EntryID &entry, const SharedSampleTimes &sampleTimes, const std::vector<double> &times, std::vector<IndexedIO::EntryIDList> &paths )
+		{
+			IndexedIO::EntryIDList entryPath( locationPath );
+			entryPath.push_back( entry );
+			if ( times.empty() )
+			{
+				paths.push_back( entryPath );
+				return;
+			}
+
+			entryPath.push_back( IndexedIO::EntryID() );
+			for ( std::vector<double>::const_iterator it = times.begin(); it != times.end(); ++it )
+			{
+				size_t floorIndex, ceilIndex;
+				sampleInterval( sampleTimes, *it, floorIndex, ceilIndex );
+				entryPath.back() = sampleEntry( floorIndex );
+				paths.push_back( entryPath );
+				if ( ceilIndex != floorIndex )
+				{
+					entryPath.back() = sampleEntry( ceilIndex );
+					paths.push_back( entryPath );
+				}
+			}
+		}
+
+		static ConstObjectPtr objectCacheGetter( const CacheKey &key, size_t &cost )
+		{
+			g_objectCacheMisses++;
+			ConstObjectPtr result = key.reader->loadSample( key.entry, key.sample );
+			cost = result->memoryUsage();
+			return result;
+		}
+
+		ObjectPtr loadSample( const IndexedIO::EntryID &entry, size_t sampleIndex ) const
+		{
+			if ( entry == boundEntry )
+			{
+				return new Box3dData( loadBoundAtSample( sampleIndex ) );
+			}
+			else if ( entry == transformEntry )
+			{
+				return loadTransformAtSample( sampleIndex );
+			}
+			return loadObjectAtSample( sampleIndex );
+		}
+
+		/// Returns the sample from the object cache, loading it if necessary. Returns 0 if the
+		/// cache is disabled or the file can't be cached.
+		ConstObjectPtr cachedSample( const IndexedIO::EntryID &entry, size_t sampleIndex ) const
+		{
+			ObjectCache &cache = objectCache();
+			if ( !cache.getMaxCost() )
+			{
+				return 0;
+			}
+			const MurmurHash *hash = locationHash();
+			if ( !hash )
+			{
+				return 0;
+			}
+			g_objectCacheLookups++;
+			return cache.get( CacheKey( this, *hash, entry, sampleIndex ) );
+		}
+
+		/// Returns a hash identifying this location across all the readers, made from the
+		/// file name, its modification time and the path in the file. Returns 0 if the scene
+		/// isn't stored in a file, in which case its samples are not cached.
+		/// The first thread to get here computes the hash while the others wait for it, and
+		/// m_locationHash is only written once, before the state is published.
+		const MurmurHash *locationHash() const
+		{
+			if ( m_locationHashState.compare_and_swap( ComputingHash, UnknownHash ) == UnknownHash )
+			{
+				MurmurHash hash;
+				bool cacheable = false;
+				if ( m_parent )
+				{
+					if ( const MurmurHash *parentHash = m_parent->locationHash() )
+					{
+						hash = *parentHash;
+						hash.append( m_indexedIO->currentEntryId() );
+						cacheable = true;
+					}
+				}
+				else if ( m_indexedIO->typeId() == FileIndexedIOTypeId )
+				{
+					try
+					{
+						const std::string file = fileName();
+						hash.append( file );
+						hash.append( (int64_t)boost::filesystem::last_write_time( file ) );
+						IndexedIO::EntryIDList path;
+						m_indexedIO->path( path );
+						for ( IndexedIO::EntryIDList::const_iterator it = path.begin(); it != path.end(); ++it )
+						{
+							hash.append( *it );
+						}
+						cacheable = true;
+					}
+					catch ( std::exception &e )
+					{
+						msg( Msg::Warning, "SceneCache", std::string( "Samples will not be cached : " ) + e.what() );
+					}
+				}
+				m_locationHash = hash;
+				m_locationHashState = cacheable ? ValidHash : NoHash;
+			}
+
+			LocationHashState state;
+			while( ( state = m_locationHashState ) == ComputingHash )
+			{
+				tbb::this_tbb_thread::yield();
+			}
+			return state == ValidHash ? &m_locationHash : 0;
+		}
 
 		IndexedIOPtr globalSampleTimes() const
 		{
@@ -658,7 +1066,7 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 			return m_indexedIO->parentDirectory()->subdirectory( sampleTimesEntry );
 		}
 
-		const SampleTimes *restoreSampleTimes( const IndexedIO::EntryID &childName, bool throwExceptions = false, const IndexedIO::EntryID *attribName = 0 ) const
+		const SharedSampleTimes *restoreSampleTimes( const IndexedIO::EntryID &childName, bool throwExceptions = false, const IndexedIO::EntryID *attribName = 0 ) const
 		{
 			IndexedIOPtr location = m_indexedIO->subdirectory( childName, IndexedIO::NullIfMissing );
 			if ( location && attribName )
@@ -690,16 +1098,18 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 			// change our reading location to the global location.
 			location = globalSampleTimes();
 			IndexedIO::Entry e = location->entry( sampleEntryId );
-			// adds an item to the map
-			SampleTimes times;
-			times.resize( e.arrayLength() );
-			double *ptrTimes = &times[0];
-			// and loads the sample times on to the map before returning
-			location->read( sampleEntryId, ptrTimes, times.size() );
+			// loads the sample times before adding them to the map, so
+			// a failed read doesn't leave an empty entry behind.
+			SampleTimes times( e.arrayLength() );
+			if ( times.size() )
+			{
+				double *ptrTimes = &times[0];
+				location->read( sampleEntryId, ptrTimes, times.size() );
+			}
 			SampleTimesMap::accessor it;
 			if ( m_sampleTimesMap->insert( it, sampleTimesIndex ) )
 			{
-				it->second = times;
+				it->second.swap( times );
 			}
 			return &(it->second);
 		}
@@ -709,7 +1119,7 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 		/// with identity transform.
 		static struct Defaults
 		{
-			SampleTimes implicitSample;
+			SharedSampleTimes implicitSample;
 			M44dDataPtr defaultTransform;
 			Imath::Box3d defaultBox;
 
@@ -724,6 +1134,8 @@ class SceneCache::ReaderImplementation : public SceneCache::Implementation
 };
 
 SceneCache::ReaderImplementation::Defaults SceneCache::ReaderImplementation::g_defaults;
+tbb::atomic<size_t> SceneCache::ReaderImplementation::g_objectCacheLookups;
+tbb::atomic<size_t> SceneCache::ReaderImplementation::g_objectCacheMisses;
 
 /// Writer implementation for SceneCache
 /// Each location keeps refcount pointers to their child locations, so they can always return the same (unfinished child) and when the root is destroyed, it
@@ -734,7 +1146,7 @@ class SceneCache::WriterImplementation : public SceneCache::Implementation
 
 		IE_CORE_DECLAREPTR( WriterImplementation )
 
-		WriterImplementation( IndexedIOPtr io, Implementation *parent = 0) : SceneCache::Implementation( io ), m_parent(static_cast< WriterImplementation* >( parent ))
+		WriterImplementation( IndexedIOPtr io, Implementation *parent = 0) : SceneCache::Implementation( io ), m_parent(static_cast< WriterImplementation* >( parent )), m_computedBounds( false )
 		{
 			if ( m_parent )
 			{
@@ -761,6 +1173,11 @@ class SceneCache::WriterImplementation : public SceneCache::Implementation
 				{
 					msg( Msg::Error, "SceneCache::~SceneCache", ( boost::format( "Corrupted file resulted from exception while flushing data: %s." ) % e.what() ).str() );
 				}
+				catch ( std::exception &e )
+				{
+					// exceptions thrown from the parallel bound computation may reach us as tbb::captured_exception
+					msg( Msg::Error, "SceneCache::~SceneCache", ( boost::format( "Corrupted file resulted from exception while flushing data: %s." ) % e.what() ).str() );
+				}
 				catch (...)
 				{
 					msg( Msg::Error, "SceneCache::~SceneCache", "Corrupted file resulted from unknown exception while flushing data." );
@@ -1005,6 +1422,8 @@ class SceneCache::WriterImplementation : public SceneCache::Implementation
 				writable();
 			}
 
+			tbb::mutex::scoped_lock lock( m_childrenMutex );
+
 			std::map< SceneCache::Name, WriterImplementationPtr >::const_iterator it = m_children.find( name );
 			if ( it != m_children.end() )
 			{
@@ -1029,6 +1448,7 @@ class SceneCache::WriterImplementation : public SceneCache::Implementation
 		SceneCache::ImplementationPtr createChild( const SceneCache::Name &name )
 		{
 			writable();
+			tbb::mutex::scoped_lock lock( m_childrenMutex );
 			IndexedIOPtr children = m_indexedIO->subdirectory( childrenEntry, IndexedIO::CreateIfMissing );
 			if ( children->hasEntry( name ) )
 			{
@@ -1254,71 +1674,55 @@ class SceneCache::WriterImplementation : public SceneCache::Implementation
 		}
 
 		// Called from the destructor of the root location. 
-		// It triggers flush recursivelly on all the child locations.
-		// It also sets m_sampleTimesMap to NULL which prevents further modification on this and all child scene interface objects through their call to writable().
-		// Responsible for writing missing data such as all the sample 
-		// times from object,transform,attributes and bounds. And also computes the 
-		// animated bounding boxes in case they were not explicitly writen.
-		//
+		// It computes the bounding boxes of all the locations in parallel and then
+		// stores the results recursively on all the child locations.
 		void flush()
 		{
-			/// first call flush recursively on children...
-			for ( std::map< SceneCache::Name, WriterImplementationPtr >::const_iterator cit = m_children.begin(); cit != m_children.end(); cit++ )
-			{
-				cit->second->flush();
-			}
+			computeBounds();
+			storeFlushedData();
+		}
 
-			IndexedIOPtr io;
-			// save the transform sample times
-			if ( m_transformSampleTimes.size() )
-			{
-				io = m_indexedIO->subdirectory( transformEntry, IndexedIO::CreateIfMissing );
-				storeSampleTimes( m_transformSampleTimes, io );
-			}
-			
-			// detect if topology or prim vars are animated
-			if ( !m_objectSampleTimes.empty() )
-			{
-				if ( m_animatedObjectTopology.second )
+		// Functor used by computeBounds() to process the child locations in parallel.
+		class ComputeBoundsTask
+		{
+			public :
+
+				ComputeBoundsTask( const std::vector< WriterImplementation * > &children ) : m_children( children )
 				{
-					writeAttribute( animatedObjectTopologyAttribute, new BoolData( true ), 0 );
 				}
-				else
+
+				void operator()( const tbb::blocked_range<size_t> &r ) const
 				{
-					InternedStringVectorDataPtr primVarData = new InternedStringVectorData();
-					std::vector<InternedString> &primVars = primVarData->writable();
-					for ( AnimatedPrimVarMap::iterator it = m_animatedObjectPrimVars.begin(); it != m_animatedObjectPrimVars.end(); ++it )
+					for ( size_t i = r.begin(); i != r.end(); ++i )
 					{
-						if ( it->second.second )
-						{
-							primVars.push_back( it->first );
-						}
+						m_children[i]->computeBounds();
 					}
-					
-					writeAttribute( animatedObjectPrimVarsAttribute, primVarData, 0 );
 				}
-			}
-			
-			// save the attribute sample times
-			if ( m_attributeSampleTimes.size() )
-			{
-				io = m_indexedIO->subdirectory( attributesEntry, IndexedIO::CreateIfMissing );
-				for ( AttributeSamplesMap::const_iterator it = m_attributeSampleTimes.begin(); it != m_attributeSampleTimes.end(); it++ )
-				{
-					storeSampleTimes( it->second, io->subdirectory( it->first, IndexedIO::CreateIfMissing ) );
-				}
-			}
-			// save the object sample times
-			if ( m_objectSampleTimes.size() )
+
+			private :
+
+				const std::vector< WriterImplementation * > &m_children;
+		};
+
+		// Computes the animated bounding boxes of this location and all the child locations
+		// in case they were not explicitly writen. It doesn't access the file, so the child 
+		// locations are processed in parallel, with tasks nested for each subtree.
+		void computeBounds()
+		{
+			/// first compute the bounds of all the children...
+			std::vector< WriterImplementation * > children;
+			children.reserve( m_children.size() );
+			for ( std::map< SceneCache::Name, WriterImplementationPtr >::const_iterator cit = m_children.begin(); cit != m_children.end(); cit++ )
 			{
-				io = m_indexedIO->subdirectory( objectEntry, IndexedIO::CreateIfMissing );
-				storeSampleTimes( m_objectSampleTimes, io );				
+				children.push_back( cit->second.get() );
 			}
+			tbb::parallel_for( tbb::blocked_range<size_t>( 0, children.size() ), ComputeBoundsTask( children ) );
+
 			// We have to compute the bounding box over time for the object and each child if there's no bound overrides writen.
-			bool computedBounds = false;
+			m_computedBounds = false;
 			if ( m_boundSampleTimes.size() == 0 )
 			{
-				computedBounds = true;
+				m_computedBounds = true;
 				for ( std::map< SceneCache::Name, WriterImplementationPtr >::const_iterator cit = m_children.begin(); cit != m_children.end(); cit++ )
 				{
 					const SampleTimes &childBoundTimes = cit->second->m_boundSampleTimes;
@@ -1473,13 +1877,75 @@ class SceneCache::WriterImplementation : public SceneCache::Implementation
 					accumulateBoxSamples( m_objectSampleTimes, m_objectSamples );
 				}
 			}
+		}
 
+		// Called by flush() after computeBounds(). It triggers the storage recursivelly on all the child locations.
+		// It also sets m_sampleTimesMap to NULL which prevents further modification on this and all child scene interface objects through their call to writable().
+		// Responsible for writing missing data such as all the sample 
+		// times from object,transform,attributes and bounds. And also the 
+		// animated bounding boxes in case they were not explicitly writen.
+		// All the writes to the file happen serially from here.
+		//
+		void storeFlushedData()
+		{
+			/// first call it recursively on children...
+			for ( std::map< SceneCache::Name, WriterImplementationPtr >::const_iterator cit = m_children.begin(); cit != m_children.end(); cit++ )
+			{
+				cit->second->storeFlushedData();
+			}
+
+			IndexedIOPtr io;
+			// save the transform sample times
+			if ( m_transformSampleTimes.size() )
+			{
+				io = m_indexedIO->subdirectory( transformEntry, IndexedIO::CreateIfMissing );
+				storeSampleTimes( m_transformSampleTimes, io );
+			}
+			
+			// detect if topology or prim vars are animated
+			if ( !m_objectSampleTimes.empty() )
+			{
+				if ( m_animatedObjectTopology.second )
+				{
+					writeAttribute( animatedObjectTopologyAttribute, new BoolData( true ), 0 );
+				}
+				else
+				{
+					InternedStringVectorDataPtr primVarData = new InternedStringVectorData();
+					std::vector<InternedString> &primVars = primVarData->writable();
+					for ( AnimatedPrimVarMap::iterator it = m_animatedObjectPrimVars.begin(); it != m_animatedObjectPrimVars.end(); ++it )
+					{
+						if ( it->second.second )
+						{
+							primVars.push_back( it->first );
+						}
+					}
+					
+					writeAttribute( animatedObjectPrimVarsAttribute, primVarData, 0 );
+				}
+			}
+			
+			// save the attribute sample times
+			if ( m_attributeSampleTimes.size() )
+			{
+				io = m_indexedIO->subdirectory( attributesEntry, IndexedIO::CreateIfMissing );
+				for ( AttributeSamplesMap::const_iterator it = m_attributeSampleTimes.begin(); it != m_attributeSampleTimes.end(); it++ )
+				{
+					storeSampleTimes( it->second, io->subdirectory( it->first, IndexedIO::CreateIfMissing ) );
+				}
+			}
+			// save the object sample times
+			if ( m_objectSampleTimes.size() )
+			{
+				io = m_indexedIO->subdirectory( objectEntry, IndexedIO::CreateIfMissing );
+				storeSampleTimes( m_objectSampleTimes, io );				
+			}
 			if ( m_boundSampleTimes.size() )
 			{
 				// save the bound sample times
 				io = m_indexedIO->subdirectory( boundEntry, IndexedIO::CreateIfMissing );
 				storeSampleTimes( m_boundSampleTimes, io );
-				if ( computedBounds )
+				if ( m_computedBounds )
 				{
 					// store computed bounds in file
 					uint64_t sampleIndex = 0;
@@ -1656,6 +2122,8 @@ class SceneCache::WriterImplementation : public SceneCache::Implementation
 
 		WriterImplementation* m_parent;
 		std::map< SceneCache::Name, WriterImplementationPtr > m_children;
+		// guards m_children, so different threads can create children of the same location.
+		tbb::mutex m_childrenMutex;
 
 		typedef std::map< SampleTimes, uint64_t > SampleTimesMap;
 		typedef std::map< SceneCache::Name, SampleTimes > AttributeSamplesMap;
@@ -1671,6 +2139,8 @@ class SceneCache::WriterImplementation : public SceneCache::Implementation
 		BoxSamples m_objectSamples;
 		// overwriting bounding boxes (or used during flush to compute the final bounding boxes).
 		BoxSamples m_boundSamples;
+		// true if m_boundSamples were computed by computeBounds() rather than explicitly writen.
+		bool m_computedBounds;
 		
 		typedef std::pair< MurmurHash, bool> AnimatedHashTest;
 		typedef std::map< SceneCache::Name, AnimatedHashTest > AnimatedPrimVarMap;
@@ -2058,6 +2528,56 @@ ConstSceneInterfacePtr SceneCache::scene( const Path &path, SceneCache::MissingB
 	return duplicate( impl );
 }
 
+void SceneCache::prefetch( const std::vector<Path> &paths, const std::vector<double> &times, unsigned entries ) const
+{
+	ReaderImplementation *reader = ReaderImplementation::reader( m_implementation.get() );
+	reader->prefetch( paths, times, entries );
+}
+
+void SceneCache::readBounds( const std::vector<Path> &paths, double time, std::vector<Imath::Box3d> &bounds ) const
+{
+	ReaderImplementation *reader = ReaderImplementation::reader( m_implementation.get() );
+	reader->readBounds( paths, time, bounds );
+}
+
+void SceneCache::readTransformsAsMatrix( const std::vector<Path> &paths, double time, std::vector<Imath::M44d> &transforms ) const
+{
+	ReaderImplementation *reader = ReaderImplementation::reader( m_implementation.get() );
+	reader->readTransformsAsMatrix( paths, time, transforms );
+}
+
+void SceneCache::setObjectCacheMaxMemory( size_t maxMemory )
+{
+	ReaderImplementation::objectCache().setMaxCost( maxMemory );
+}
+
+size_t SceneCache::getObjectCacheMaxMemory()
+{
+	return ReaderImplementation::objectCache().getMaxCost();
+}
+
+size_t SceneCache::objectCacheMemoryUsage()
+{
+	return ReaderImplementation::objectCache().currentCost();
+}
+
+void SceneCache::clearObjectCache()
+{
+	ReaderImplementation::objectCache().clear();
+	ReaderImplementation::g_objectCacheLookups = 0;
+	ReaderImplementation::g_objectCacheMisses = 0;
+}
+
+size_t SceneCache::objectCacheHits()
+{
+	return ReaderImplementation::g_objectCacheLookups - ReaderImplementation::g_objectCacheMisses;
+}
+
+size_t SceneCache::objectCacheMisses()
+{
+	return ReaderImplementation::g_objectCacheMisses;
+}
+
 SceneCachePtr SceneCache::duplicate( ImplementationPtr& impl ) const
 {
 	return new SceneCache( impl );
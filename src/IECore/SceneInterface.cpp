@@ -118,6 +118,10 @@ SceneInterface::~SceneInterface()
 {
 }
 
+void SceneInterface::prefetch( const std::vector<Path> &paths, const std::vector<double> &times, unsigned entries ) const
+{
+}
+
 void SceneInterface::pathToString( const SceneInterface::Path &p, std::string &path )
 {
 	if ( !p.size() )
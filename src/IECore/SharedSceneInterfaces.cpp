@@ -32,7 +32,7 @@
 //
 //////////////////////////////////////////////////////////////////////////
 
-#include "IECore/LRUCache.h"
+#include "IECore/ShardedLRUCache.h"
 #include "IECore/SharedSceneInterfaces.h"
 
 using namespace IECore;
@@ -41,7 +41,7 @@ using namespace IECore;
 // Cache implementation
 //////////////////////////////////////////////////////////////////////////////////////////
 
-typedef IECore::LRUCache< std::string, IECore::ConstSceneInterfacePtr > SceneLRUCache;
+typedef IECore::ShardedLRUCache< std::string, IECore::ConstSceneInterfacePtr > SceneLRUCache;
 
 class SharedSceneInterfaces::Cache : public SceneLRUCache
 {
@@ -36,6 +36,7 @@
 #include <list>
 #include <iostream>
 #include <cassert>
+#include <cstring>
 #include <map>
 #include <set>
 
@@ -47,6 +48,9 @@
 #include "boost/iostreams/filtering_stream.hpp"
 #include "boost/iostreams/stream.hpp"
 #include "boost/iostreams/filter/gzip.hpp"
+#include "boost/iostreams/filter/zlib.hpp"
+
+#include "tbb/atomic.h"
 
 #include "IECore/ByteOrder.h"
 #include "IECore/MemoryStream.h"
@@ -57,6 +61,8 @@
 
 #define HARDLINK				127
 #define SUBINDEX_DIR			126
+#define CODEC_SUBINDEX_DIR		125
+#define COMPRESSED_FILE			124
 
 static const Imf::Int64 g_unversionedMagicNumber = 0x0B00B1E5;
 static const Imf::Int64 g_versionedMagicNumber = 0xB00B1E50;
@@ -66,16 +72,26 @@ static const Imf::Int64 g_versionedMagicNumber = 0xB00B1E50;
 /// Version 5: introduced subindex as zipped data blocks (to reduce size of the main index). 
 ///            Hard links are represented as regular data nodes, that points to same data on file (no removal of data ever). 
 ///            Removed the linkCount field on the data nodes.
-static const Imf::Int64 g_currentVersion = 5;
+/// Version 6: introduced a codec for the main index, subindexes and data blocks (see StreamIndexedIO::Compression).
+///            Subindexes and data blocks that use a codec are marked with new entry types, so blocks written by
+///            previous versions remain readable in appended files. Files that only use the default Gzip index
+///            codec and uncompressed data blocks are still written as version 5, so older builds can read them.
+static const Imf::Int64 g_currentVersion = 6;
+static const Imf::Int64 g_defaultCodecsVersion = 5;
 
 /// FileFormat ::= Data Index IndexOffset Version MagicNumber
 /// Data ::= DataEntry*
-/// Index ::= zip(StringCache NodeTree FreePages)
+/// Index ::= Codec compress(StringCache NodeTree FreePages) ( Version >= 6 )
+///           zip(StringCache NodeTree FreePages) ( Version < 6 )
 
 /// DataEntry ::= Stores data from nodes: 
 ///                [Data nodes] binary data indexed by DataOffset/DataSize and 
-///                [Subindex]   SubIndexSize zip(NodeCount NodeTree*) indexed by SubIndexOffset.
-/// SubIndexSize :: = unsigned int - number of bytes in the zipped subindex that follows
+///                [Compressed data nodes] UncompressedSize compress(binary data) indexed by DataOffset/DataSize and
+///                [Subindex]   SubIndexSize zip(NodeCount NodeTree*) indexed by SubIndexOffset ( If EntryType == SUBINDEX_DIR )
+///                [Subindex]   SubIndexSize Codec compress(NodeCount NodeTree*) indexed by SubIndexOffset ( If EntryType == CODEC_SUBINDEX_DIR ).
+/// SubIndexSize :: = unsigned int - number of bytes in the subindex that follows
+/// UncompressedSize ::= int64 - number of bytes in the data block after decompression
+/// Codec ::= char ( value from StreamIndexedIO::Compression )
 
 /// StringCache ::= NumStrings String*
 /// NumStrings ::= int64
@@ -85,7 +101,8 @@ static const Imf::Int64 g_currentVersion = 5;
 /// NodeTree Node* ( A Directory node followed by it's child nodes )
 /// Node ::= EntryType EntryStringCacheID NodeCount ( if EntryType == Directory )
 ///          EntryType EntryStringCacheID DataType ArrayLength DataOffset DataSize ( if EntryType == File )
-///			 EntryType EntryStringCacheID SubIndexOffset ( If EntryType == SUBINDEX_DIR )
+///          EntryType EntryStringCacheID DataType ArrayLength Codec DataOffset DataSize ( if EntryType == COMPRESSED_FILE )
+///			 EntryType EntryStringCacheID SubIndexOffset ( If EntryType == SUBINDEX_DIR or CODEC_SUBINDEX_DIR )
 /// EntryType ::= char ( value from IndexedIO::EntryType )
 /// EntryStringCacheID ::= int64 ( index in StringCache )
 /// DataType ::= char ( value from IndexedIO::DataType )
@@ -107,6 +124,9 @@ static const Imf::Int64 g_currentVersion = 5;
 /// Version ::= int64 (file format version)
 /// MagicNumber ::= int64
 
+/// Maximum amount of data gathered in memory before being written to the file
+static const size_t g_maxPendingDataSize = 1024 * 1024;
+
 using namespace IECore;
 namespace io = boost::iostreams;
 
@@ -136,6 +156,49 @@ void readLittleEndian( F &f, T &n )
 	}
 }
 
+static void pushCompressor( io::filtering_ostream &stream, char compression )
+{
+	switch( compression )
+	{
+		case StreamIndexedIO::NoCompression :
+			break;
+		case StreamIndexedIO::Gzip :
+			stream.push( io::gzip_compressor() );
+			break;
+		case StreamIndexedIO::FastZlib :
+			stream.push( io::zlib_compressor( io::zlib::best_speed ) );
+			break;
+		default :
+			throw IOException( "StreamIndexedIO: Unknown compression codec!" );
+	}
+}
+
+static void pushDecompressor( io::filtering_istream &stream, char compression )
+{
+	switch( compression )
+	{
+		case StreamIndexedIO::NoCompression :
+			break;
+		case StreamIndexedIO::Gzip :
+			stream.push( io::gzip_decompressor() );
+			break;
+		case StreamIndexedIO::FastZlib :
+			stream.push( io::zlib_decompressor() );
+			break;
+		default :
+			throw IOException( "StreamIndexedIO: Unknown compression codec!" );
+	}
+}
+
+/// Closes all the filters and the device of a compressing stream, flushing the compressed data.
+static void closeStream( io::filtering_ostream &stream )
+{
+	while( !stream.empty() )
+	{
+		stream.pop();
+	}
+}
+
 class StreamIndexedIO::StringCache
 {
 	public:
@@ -321,6 +384,13 @@ class DataNode : public BaseNode
 		/// The size of this node's data chunk within the file
 		Imf::Int64 m_size;
 
+		/// The codec used for this node's data chunk
+		char m_compression;
+
+		DataNode() : m_compression( StreamIndexedIO::NoCompression )
+		{
+		}
+
 		IndexedIO::EntryType entryType() const
 		{
 			return IndexedIO::File;
@@ -342,11 +412,15 @@ class StreamIndexedIO::Node : public BaseNode
 			LoadedSubIndex,
 		};
 
-		SubIndexMode m_subindex;
+		/// Atomic so that loaded subindexes can be queried without locking.
+		tbb::atomic<SubIndexMode> m_subindex;
 
 		/// The offset in the file to this node's subindex block if m_subindex is not NoSubIndex.
 		Imf::Int64 m_offset;
 
+		/// False for subindexes written prior to version 6, which have no codec and are always gzipped.
+		bool m_subindexHasCodec;
+
 		/// A shared pointer to the main file index
 		StreamIndexedIO::Index* m_idx;
 
@@ -437,12 +511,51 @@ class StreamIndexedIO::Index : public RefCounted
 		/// read the subindex that contains the children of the given node
 		void readNodeFromSubIndex( Node *n );
 
+		/// Files opened for writing may be modified from several threads at once, provided
+		/// each thread writes to its own directories. Their index is guarded by the stream
+		/// mutex, which this function acquires. Read only files are never modified, apart
+		/// from readNodeFromSubIndex() which does its own locking, so nothing is locked for them.
+		void lockForWriting( StreamIndexedIO::StreamFile::MutexLock &lock ) const;
+
+		/// Writes any pending data blocks to the file, so they can be read back.
+		void syncPendingData();
+
+		/// Offsets and sizes of data blocks in the file.
+		typedef std::vector< std::pair< Imf::Int64, Imf::Int64 > > DataBlocks;
+
+		/// Appends the data blocks of the given node and all its descendants, loading their subindexes as needed.
+		void collectDataBlocks( Node *n, DataBlocks &blocks );
+
+		/// Asks the stream to prefetch the given data blocks, in file order and merging nearby blocks.
+		void prefetchDataBlocks( DataBlocks &blocks );
+
+		/// Stores the data for the given node, compressing it according to the data compression settings.
+		void writeData( DataNode *n, const char *data, unsigned long size );
+
+		/// Reads the uncompressed data of the given node into a buffer of the given size.
+		/// Throws if the data doesn't have exactly that size.
+		void readData( const DataNode *n, char *buffer, Imf::Int64 size );
+
+		/// Returns the uncompressed data of the given node, returning its size in size.
+		/// The result is valid until the next call from the same thread.
+		const char *readData( const DataNode *n, Imf::Int64 &size );
+
+		void setIndexCompression( StreamIndexedIO::Compression compression );
+		StreamIndexedIO::Compression getIndexCompression() const;
+
+		void setDataCompression( StreamIndexedIO::Compression compression, size_t minSize );
+		StreamIndexedIO::Compression getDataCompression() const;
+
 	protected:
 
 		NodePtr m_root;
 
 		Imf::Int64 m_version;
 
+		/// Set once anything in the file needs version 6 to be read back (a codec byte
+		/// ahead of a subindex or data block), so write() knows which version to stamp.
+		bool m_usesCodecs;
+
 		bool m_hasChanged;
 
 		Imf::Int64 m_offset;
@@ -455,10 +568,37 @@ class StreamIndexedIO::Index : public RefCounted
 		typedef std::map< std::pair<MurmurHash,unsigned int>, Imf::Int64 > HashToDataMap;
 		HashToDataMap m_hashToDataMap;
 
+		/// The block that stores some uncompressed data, possibly compressed.
+		struct DataBlock
+		{
+			Imf::Int64 m_offset;
+			Imf::Int64 m_size;
+			char m_compression;
+		};
+
+		/// Maps the hash of uncompressed data to the block storing it, so data written
+		/// again isn't compressed again only for writeUniqueData() to discard it.
+		typedef std::map< std::pair<MurmurHash,unsigned long>, DataBlock > UncompressedHashToDataMap;
+		UncompressedHashToDataMap m_uncompressedHashToDataMap;
+
 		StringCache m_stringCache;
 
 		StreamIndexedIO::StreamFilePtr m_stream;
 
+		StreamIndexedIO::Compression m_indexCompression;
+		StreamIndexedIO::Compression m_dataCompression;
+		size_t m_dataCompressionMinSize;
+
+		bool m_writable;
+
+		/// Data blocks appended contiguously to the file are gathered here and written
+		/// in one go, rather than seeking and writing the stream for each of them.
+		Imf::Int64 m_pendingOffset;
+		std::vector<char> m_pendingData;
+
+		/// Writes m_pendingData to the file. Must be called with the lock held.
+		void flushPendingData();
+
 		struct FreePage;
 
 		typedef std::map< Imf::Int64, FreePage* > FreePagesOffsetMap;
@@ -508,6 +648,9 @@ class StreamIndexedIO::Index : public RefCounted
 
 		void recursiveSetSubIndex( Node *n );
 
+		/// Decompresses a compressed data block read from the file into a buffer of the given size.
+		void decompressData( const DataNode *n, const char *block, char *buffer, Imf::Int64 size ) const;
+
 };
 
 ///////////////////////////////////////////////
@@ -516,8 +659,9 @@ class StreamIndexedIO::Index : public RefCounted
 //
 ///////////////////////////////////////////////
 
-StreamIndexedIO::Node::Node(Index* index) : BaseNode(), m_subindex(NoSubIndex), m_offset(0), m_idx(index), m_parent(0)
+StreamIndexedIO::Node::Node(Index* index) : BaseNode(), m_offset(0), m_subindexHasCodec(true), m_idx(index), m_parent(0)
 {
+	m_subindex = NoSubIndex;
 }
 
 StreamIndexedIO::Node::~Node()
@@ -547,11 +691,15 @@ void StreamIndexedIO::Node::registerChild( BaseNode* c )
 
 bool StreamIndexedIO::Node::hasChild( const IndexedIO::EntryID &name ) const
 {
+	StreamFile::MutexLock lock;
+	m_idx->lockForWriting( lock );
 	return m_children.find( name ) != m_children.end();
 }
 
 BaseNode* StreamIndexedIO::Node::child( const IndexedIO::EntryID &name ) const
 {
+	StreamFile::MutexLock lock;
+	m_idx->lockForWriting( lock );
 	ChildMap::const_iterator cit = m_children.find( name );
 	if (cit == m_children.end())
 	{
@@ -570,7 +718,7 @@ StreamIndexedIO::Node* StreamIndexedIO::Node::child( const IndexedIO::EntryID &n
 		{
 			n = static_cast< Node *>( p );
 			
-			if ( loadChildren && n->m_subindex )
+			if ( loadChildren && n->m_subindex == SavedSubIndex )
 			{
 				m_idx->readNodeFromSubIndex( n );
 			}
@@ -595,6 +743,9 @@ DataNode* StreamIndexedIO::Node::dataChild( const IndexedIO::EntryID &name ) con
 
 StreamIndexedIO::Node* StreamIndexedIO::Node::addChild( const IndexedIO::EntryID &childName )
 {
+	StreamFile::MutexLock lock;
+	m_idx->lockForWriting( lock );
+
 	if ( m_subindex )
 	{
 		throw Exception( "Cannot modify the file at current location! It was already committed to the file." );
@@ -622,6 +773,9 @@ StreamIndexedIO::Node* StreamIndexedIO::Node::addChild( const IndexedIO::EntryID
 
 DataNode* StreamIndexedIO::Node::addDataChild( const IndexedIO::EntryID &childName )
 {
+	StreamFile::MutexLock lock;
+	m_idx->lockForWriting( lock );
+
 	if ( m_subindex )
 	{
 		throw Exception( "Cannot modify the file at current location! It was already committed to the file." );
@@ -665,6 +819,9 @@ const IndexedIO::EntryID &StreamIndexedIO::Node::name() const
 
 void StreamIndexedIO::Node::childNames( IndexedIO::EntryIDList &names ) const
 {
+	StreamFile::MutexLock lock;
+	m_idx->lockForWriting( lock );
+
 	names.clear();
 	names.reserve( m_children.size() );
 	for ( ChildMap::const_iterator cit = m_children.begin(); cit != m_children.end(); cit++ )
@@ -675,6 +832,9 @@ void StreamIndexedIO::Node::childNames( IndexedIO::EntryIDList &names ) const
 
 void StreamIndexedIO::Node::childNames( IndexedIO::EntryIDList &names, IndexedIO::EntryType type ) const
 {
+	StreamFile::MutexLock lock;
+	m_idx->lockForWriting( lock );
+
 	names.clear();
 	names.reserve( m_children.size() );
 	
@@ -692,6 +852,9 @@ void StreamIndexedIO::Node::childNames( IndexedIO::EntryIDList &names, IndexedIO
 
 void StreamIndexedIO::Node::removeChild( const IndexedIO::EntryID &childName, bool throwException )
 {
+	StreamFile::MutexLock lock;
+	m_idx->lockForWriting( lock );
+
 	ChildMap::iterator it = m_children.find( childName );
 	if ( it == m_children.end() )
 	{
@@ -721,7 +884,9 @@ void StreamIndexedIO::Node::removeChild( const IndexedIO::EntryID &childName, bo
 //
 ///////////////////////////////////////////////
 
-StreamIndexedIO::Index::Index( StreamIndexedIO::StreamFilePtr stream ) : m_root(0), m_version(g_currentVersion), m_hasChanged(false), m_offset(0), m_next(0), m_stream(stream)
+StreamIndexedIO::Index::Index( StreamIndexedIO::StreamFilePtr stream ) : m_root(0), m_version(g_currentVersion), m_usesCodecs(false), m_hasChanged(false), m_offset(0), m_next(0), m_stream(stream),
+	m_indexCompression( StreamIndexedIO::Gzip ), m_dataCompression( StreamIndexedIO::NoCompression ), m_dataCompressionMinSize( 4096 ),
+	m_writable( stream->openMode() & ( IndexedIO::Write | IndexedIO::Append ) ), m_pendingOffset(0)
 {
 	m_stringCache.add(IndexedIO::rootName);
 }
@@ -741,6 +906,9 @@ StreamIndexedIO::Index::~Index()
 
 void StreamIndexedIO::Index::flush()
 {
+	StreamFile::MutexLock lock;
+	lockForWriting( lock );
+
 	if ( m_hasChanged )
 	{
 		Imf::Int64 end = write();
@@ -788,11 +956,23 @@ void StreamIndexedIO::Index::openStream()
 
 		if (m_version >= 2 )
 		{
+			Imf::Int64 indexSize = end - m_offset;
+			char codec = StreamIndexedIO::Gzip;
+			if ( m_version >= 6 )
+			{
+				f.read( &codec, sizeof(char) );
+				indexSize -= sizeof(char);
+				// keep the codec when appending to the file
+				m_indexCompression = (StreamIndexedIO::Compression)codec;
+				// subindexes we won't load may hold blocks using a codec
+				m_usesCodecs = true;
+			}
+
 			io::filtering_istream decompressingStream;
-			char *compressedIndex = new char[ end - m_offset ];
-			f.read( compressedIndex, end - m_offset );
-			MemoryStreamSource source( compressedIndex, end - m_offset, true );
-			decompressingStream.push( io::gzip_decompressor() );
+			char *compressedIndex = new char[ indexSize ];
+			f.read( compressedIndex, indexSize );
+			MemoryStreamSource source( compressedIndex, indexSize, true );
+			pushDecompressor( decompressingStream, codec );
 			decompressingStream.push( source );
 			assert( decompressingStream.is_complete() );
 
@@ -973,12 +1153,18 @@ BaseNode *StreamIndexedIO::Index::readNode( F &f )
 
 	IndexedIO::EntryType entryType = (IndexedIO::EntryType)t;
 	StreamIndexedIO::Node::SubIndexMode subindex = StreamIndexedIO::Node::NoSubIndex;
+	bool compressedFile = false;
 
-	if ( t == SUBINDEX_DIR )
+	if ( t == SUBINDEX_DIR || t == CODEC_SUBINDEX_DIR )
 	{
 		entryType = IndexedIO::Directory;
 		subindex = StreamIndexedIO::Node::SavedSubIndex;
 	}
+	else if ( t == COMPRESSED_FILE )
+	{
+		entryType = IndexedIO::File;
+		compressedFile = true;
+	}
 
 	Imf::Int64 stringId;
 	readLittleEndian(f,stringId);
@@ -999,6 +1185,10 @@ BaseNode *StreamIndexedIO::Index::readNode( F &f )
 		n->m_name = m_stringCache.findById( stringId );
 		n->m_dataType = dataType;
 		n->m_arrayLength = static_cast<unsigned long>( arrayLength );
+		if ( compressedFile )
+		{
+			f.read( &n->m_compression, sizeof(char) );
+		}
 		readLittleEndian( f,n->m_offset );
 		readLittleEndian( f,n->m_size );
 		return n;
@@ -1008,6 +1198,7 @@ BaseNode *StreamIndexedIO::Index::readNode( F &f )
 		Node *n = new Node( this );
 		n->m_name = m_stringCache.findById( stringId );
 		n->m_subindex = subindex;
+		n->m_subindexHasCodec = ( t != SUBINDEX_DIR );
 
 		if ( subindex )
 		{
@@ -1126,7 +1317,7 @@ void StreamIndexedIO::Index::read( F &f )
 template < typename F >
 void StreamIndexedIO::Index::writeDataNode( DataNode *node, F &f )
 {
-	char t = node->entryType();
+	char t = ( node->m_compression ? COMPRESSED_FILE : node->entryType() );
 	f.write( &t, sizeof(char) );
 
 	Imf::Int64 id = m_stringCache.find( node->m_name );
@@ -1140,6 +1331,12 @@ void StreamIndexedIO::Index::writeDataNode( DataNode *node, F &f )
 		writeLittleEndian<F,Imf::Int64>( f, node->m_arrayLength );
 	}
 
+	if ( node->m_compression )
+	{
+		f.write( &node->m_compression, sizeof(char) );
+		m_usesCodecs = true;
+	}
+
 	writeLittleEndian(f, node->m_offset);
 	writeLittleEndian(f, node->m_size);
 }
@@ -1147,7 +1344,12 @@ void StreamIndexedIO::Index::writeDataNode( DataNode *node, F &f )
 template < typename F >
 void StreamIndexedIO::Index::writeNode( Node *node, F &f )
 {
-	char t = ( node->m_subindex ? SUBINDEX_DIR : IndexedIO::Directory );
+	char t = IndexedIO::Directory;
+	if ( node->m_subindex )
+	{
+		t = ( node->m_subindexHasCodec ? CODEC_SUBINDEX_DIR : SUBINDEX_DIR );
+		m_usesCodecs = m_usesCodecs || node->m_subindexHasCodec;
+	}
 	f.write( &t, sizeof(char) );
 
 	Imf::Int64 id = m_stringCache.find( node->m_name );
@@ -1184,6 +1386,8 @@ Imf::Int64 StreamIndexedIO::Index::write()
 {
 	StreamIndexedIO::StreamFile &f = *m_stream;
 
+	flushPendingData();
+
 	/// Write index at end
 	std::streampos indexStart = m_next;
 	
@@ -1193,7 +1397,7 @@ Imf::Int64 StreamIndexedIO::Index::write()
 
 	MemoryStreamSink sink;
 	io::filtering_ostream compressingStream;
-	compressingStream.push( io::gzip_compressor() );
+	pushCompressor( compressingStream, m_indexCompression );
 	compressingStream.push( sink );
 	assert( compressingStream.is_complete() );
 
@@ -1215,8 +1419,7 @@ Imf::Int64 StreamIndexedIO::Index::write()
 	}
 
 	/// To synchronize/close, etc.
-	compressingStream.pop();
-	compressingStream.pop();
+	closeStream( compressingStream );
 
 	char *data=0;
 	std::streamsize sz;
@@ -1224,10 +1427,17 @@ Imf::Int64 StreamIndexedIO::Index::write()
 	assert( data );
 	assert( sz > 0 );
 
+	Imf::Int64 version = g_defaultCodecsVersion;
+	if ( m_usesCodecs || m_indexCompression != StreamIndexedIO::Gzip )
+	{
+		version = g_currentVersion;
+		char codec = m_indexCompression;
+		f.write( &codec, sizeof(char) );
+	}
 	f.write( data, sz );
 
 	writeLittleEndian( f, m_offset );
-	writeLittleEndian( f, g_currentVersion );
+	writeLittleEndian( f, version );
 	writeLittleEndian( f, g_versionedMagicNumber );
 
 	m_hasChanged = false;
@@ -1430,12 +1640,7 @@ void StreamIndexedIO::Index::addFreePage(  Imf::Int64 offset, Imf::Int64 sz )
 
 Imf::Int64 StreamIndexedIO::Index::writeUniqueData( const char *data, unsigned int size, bool prefixSize )
 {
-	m_hasChanged = true;
-
-	/// Find next writable location
-	Imf::Int64 loc;
-
-	// compute hash for the data
+	// compute hash for the data before locking, so concurrent writers only serialize the bookkeeping
 	MurmurHash hash;
 	hash.append( data, size );
 
@@ -1446,6 +1651,11 @@ Imf::Int64 StreamIndexedIO::Index::writeUniqueData( const char *data, unsigned i
 		totalSize += sizeof( unsigned int );
 	}
 
+	StreamFile::MutexLock lock;
+	lockForWriting( lock );
+
+	m_hasChanged = true;
+
 	// see if it's already stored by another node..
 	std::pair< HashToDataMap::iterator,bool > ret = m_hashToDataMap.insert( HashToDataMap::value_type( std::pair< MurmurHash,Imf::Int64>(hash,totalSize), 0 ) );
 	if ( !ret.second )
@@ -1455,23 +1665,123 @@ Imf::Int64 StreamIndexedIO::Index::writeUniqueData( const char *data, unsigned i
 	}
 
 	/// New data, find next writable location.
-	loc = allocate( totalSize );
+	Imf::Int64 loc = allocate( totalSize );
 	ret.first->second = loc;
 
-	/// Seek 'write' pointer to writable location
-	m_stream->seekp( loc, std::ios::beg );
+	if ( loc != m_pendingOffset + m_pendingData.size() || m_pendingData.size() + totalSize > g_maxPendingDataSize )
+	{
+		flushPendingData();
+		m_pendingOffset = loc;
+	}
+
+	if ( totalSize > g_maxPendingDataSize )
+	{
+		/// Seek 'write' pointer to writable location
+		m_stream->seekp( loc, std::ios::beg );
+
+		if ( prefixSize )
+		{
+			writeLittleEndian( *m_stream, size );
+		}
+
+		/// Write data
+		m_stream->write( data, size );
+
+		m_pendingOffset = loc + totalSize;
+		return loc;
+	}
+
+	/// Gather the block with the previous ones
+	size_t pendingSize = m_pendingData.size();
+	m_pendingData.resize( pendingSize + totalSize );
+	char *pending = &m_pendingData[ pendingSize ];
 
 	if ( prefixSize )
 	{
-		writeLittleEndian( *m_stream, size );
+		unsigned int sizeLE = ( bigEndian() ? reverseBytes<>( size ) : size );
+		memcpy( pending, &sizeLE, sizeof( unsigned int ) );
+		pending += sizeof( unsigned int );
 	}
 
-	/// Write data
-	m_stream->write( data, size );
+	memcpy( pending, data, size );
 
 	return loc;
 }
 
+void StreamIndexedIO::Index::flushPendingData()
+{
+	if ( m_pendingData.empty() )
+	{
+		return;
+	}
+
+	m_stream->seekp( m_pendingOffset, std::ios::beg );
+	m_stream->write( &m_pendingData[0], m_pendingData.size() );
+	m_pendingOffset += m_pendingData.size();
+	m_pendingData.clear();
+}
+
+void StreamIndexedIO::Index::syncPendingData()
+{
+	if ( m_writable )
+	{
+		StreamFile::MutexLock lock( m_stream->mutex() );
+		flushPendingData();
+	}
+}
+
+void StreamIndexedIO::Index::collectDataBlocks( Node *n, DataBlocks &blocks )
+{
+	IndexedIO::EntryIDList names;
+	n->childNames( names );
+	for ( IndexedIO::EntryIDList::const_iterator it = names.begin(); it != names.end(); ++it )
+	{
+		if ( const DataNode *dataNode = n->dataChild( *it ) )
+		{
+			blocks.push_back( DataBlocks::value_type( dataNode->m_offset, dataNode->m_size ) );
+		}
+		else if ( Node *childNode = n->child( *it, true ) )
+		{
+			collectDataBlocks( childNode, blocks );
+		}
+	}
+}
+
+void StreamIndexedIO::Index::prefetchDataBlocks( DataBlocks &blocks )
+{
+	if ( blocks.empty() )
+	{
+		return;
+	}
+
+	syncPendingData();
+
+	/// blocks closer than this are prefetched together
+	const Imf::Int64 maxGap = 64 * 1024;
+
+	std::sort( blocks.begin(), blocks.end() );
+	Imf::Int64 begin = blocks[0].first;
+	Imf::Int64 end = begin + blocks[0].second;
+	for ( DataBlocks::const_iterator it = blocks.begin() + 1; it != blocks.end(); ++it )
+	{
+		if ( it->first > end + maxGap )
+		{
+			m_stream->prefetch( begin, end - begin );
+			begin = it->first;
+		}
+		end = std::max( end, it->first + it->second );
+	}
+	m_stream->prefetch( begin, end - begin );
+}
+
+void StreamIndexedIO::Index::lockForWriting( StreamIndexedIO::StreamFile::MutexLock &lock ) const
+{
+	if ( m_writable )
+	{
+		lock.acquire( m_stream->mutex() );
+	}
+}
+
 void StreamIndexedIO::Index::deallocateWalk( BaseNode* n )
 {
 	assert(n);
@@ -1520,11 +1830,23 @@ void StreamIndexedIO::Index::commitNodeToSubIndex( Node *n )
 		return;
 	}
 
+	StreamFile::MutexLock lock;
+	lockForWriting( lock );
+
 	if ( n->m_subindex == Node::NoSubIndex )
 	{
+		/// the codec is stored uncompressed at the start of the block, unless it's
+		/// the default Gzip, which is written the same way as in version 5 files.
+		bool hasCodec = ( m_indexCompression != StreamIndexedIO::Gzip );
 		MemoryStreamSink sink;
+		if ( hasCodec )
+		{
+			char codec = m_indexCompression;
+			sink.write( &codec, sizeof(char) );
+		}
+
 		io::filtering_ostream compressingStream;
-		compressingStream.push( io::gzip_compressor() );
+		pushCompressor( compressingStream, m_indexCompression );
 		compressingStream.push( sink );
 		assert( compressingStream.is_complete() );
 
@@ -1548,8 +1870,7 @@ void StreamIndexedIO::Index::commitNodeToSubIndex( Node *n )
 			}
 		}
 
-		compressingStream.pop();
-		compressingStream.pop();
+		closeStream( compressingStream );
 
 		char *data=0;
 		std::streamsize sz;
@@ -1557,6 +1878,7 @@ void StreamIndexedIO::Index::commitNodeToSubIndex( Node *n )
 		unsigned int subindexSize = sz;
 
 		n->m_offset = writeUniqueData( data, subindexSize, true );
+		n->m_subindexHasCodec = hasCodec;
 
 		// set all child nodes as committed to a subindex (this also makes them read-only)
 		recursiveSetSubIndex( n );
@@ -1568,47 +1890,273 @@ void StreamIndexedIO::Index::commitNodeToSubIndex( Node *n )
 
 void StreamIndexedIO::Index::readNodeFromSubIndex( Node *n )
 {
-	if ( n->m_subindex == Node::NoSubIndex )
+	if ( n->m_subindex != Node::SavedSubIndex )
 	{
 		return;
 	}
 
-	/// guarantees thread safe access to the file and also to the m_subindex variable
-	StreamFile::MutexLock lock( m_stream->mutex() );
+	syncPendingData();
 
-	if ( n->m_subindex == Node::LoadedSubIndex )
-	{
-		return;
-	}
-	
-	m_stream->seekg( n->m_offset, std::ios::beg );
+	/// The subindex is read and decompressed without holding any locks, so threads
+	/// loading different subindexes don't serialise. In the rare case where two threads
+	/// load the same subindex concurrently, the first one to finish wins and the other
+	/// result is discarded.
 
 	unsigned int subindexSize = 0;
-	readLittleEndian( *m_stream, subindexSize );
+	const char *data = m_stream->mappedData( n->m_offset, sizeof( unsigned int ) );
+	if ( data )
+	{
+		// decompress straight from the mapped file
+		subindexSize = *reinterpret_cast< const unsigned int * >( data );
+		if ( bigEndian() )
+		{
+			subindexSize = reverseBytes<>( subindexSize );
+		}
+		data = m_stream->mappedData( n->m_offset + sizeof( unsigned int ), subindexSize );
+	}
+	else
+	{
+		m_stream->pread( (char *)&subindexSize, sizeof( unsigned int ), n->m_offset );
+		if ( bigEndian() )
+		{
+			subindexSize = reverseBytes<>( subindexSize );
+		}
+		char *buffer = m_stream->threadBuffer( subindexSize );
+		m_stream->pread( buffer, subindexSize, n->m_offset + sizeof( unsigned int ) );
+		data = buffer;
+	}
 
-	char *data = m_stream->ioBuffer(subindexSize);
-	m_stream->read( data, subindexSize );
+	char codec = StreamIndexedIO::Gzip;
+	if ( n->m_subindexHasCodec )
+	{
+		if ( !subindexSize )
+		{
+			throw IOException( "StreamIndexedIO: Invalid subindex block!" );
+		}
+		codec = data[0];
+		data++;
+		subindexSize--;
+	}
 
 	io::filtering_istream decompressingStream;
-	MemoryStreamSource source( data, subindexSize, false );
-	decompressingStream.push( io::gzip_decompressor() );
+	MemoryStreamSource source( const_cast< char * >( data ), subindexSize, false );
+	pushDecompressor( decompressingStream, codec );
 	decompressingStream.push( source );
 	assert( decompressingStream.is_complete() );
 
 	unsigned int nodeCount = 0;
 
 	readLittleEndian( decompressingStream, nodeCount );
-	
+
+	std::vector< BaseNodePtr > children;
+	children.reserve( nodeCount );
 	for ( unsigned int i = 0; i < nodeCount; i++ )
 	{
-		BaseNode *child = readNode( decompressingStream );
-		n->registerChild( child );
+		children.push_back( readNode( decompressingStream ) );
+	}
+
+	/// guarantees thread safe publishing of the children and the m_subindex variable
+	StreamFile::MutexLock lock( m_stream->mutex() );
+
+	if ( n->m_subindex == Node::LoadedSubIndex )
+	{
+		return;
+	}
+
+	for ( std::vector< BaseNodePtr >::const_iterator it = children.begin(); it != children.end(); ++it )
+	{
+		n->registerChild( it->get() );
 	}
 
-	/// mark the node as loaded from subindex
+	/// mark the node as loaded from subindex. From now on the children
+	/// are never modified, so they can be accessed without locking.
 	n->m_subindex = Node::LoadedSubIndex;
 }
 
+void StreamIndexedIO::Index::writeData( DataNode *n, const char *data, unsigned long size )
+{
+	if ( m_dataCompression == StreamIndexedIO::NoCompression || size < m_dataCompressionMinSize )
+	{
+		n->m_compression = StreamIndexedIO::NoCompression;
+		n->m_offset = writeUniqueData( data, size );
+		n->m_size = size;
+		return;
+	}
+
+	MurmurHash hash;
+	hash.append( data, size );
+	std::pair< MurmurHash, unsigned long > key( hash, size );
+
+	{
+		StreamFile::MutexLock lock;
+		lockForWriting( lock );
+		UncompressedHashToDataMap::const_iterator it = m_uncompressedHashToDataMap.find( key );
+		if ( it != m_uncompressedHashToDataMap.end() )
+		{
+			// we already saved this data, so we don't compress it again
+			n->m_compression = it->second.m_compression;
+			n->m_offset = it->second.m_offset;
+			n->m_size = it->second.m_size;
+			return;
+		}
+	}
+
+	/// the uncompressed size is stored at the start of the block
+	MemoryStreamSink sink;
+	writeLittleEndian<MemoryStreamSink,Imf::Int64>( sink, size );
+
+	io::filtering_ostream compressingStream;
+	pushCompressor( compressingStream, m_dataCompression );
+	compressingStream.push( sink );
+	compressingStream.write( data, size );
+	closeStream( compressingStream );
+
+	char *compressedData = 0;
+	std::streamsize compressedSize;
+	sink.get( compressedData, compressedSize );
+
+	if ( compressedSize < (std::streamsize)size )
+	{
+		n->m_compression = m_dataCompression;
+		n->m_offset = writeUniqueData( compressedData, compressedSize );
+		n->m_size = compressedSize;
+	}
+	else
+	{
+		/// not worth compressing
+		n->m_compression = StreamIndexedIO::NoCompression;
+		n->m_offset = writeUniqueData( data, size );
+		n->m_size = size;
+	}
+
+	DataBlock block;
+	block.m_offset = n->m_offset;
+	block.m_size = n->m_size;
+	block.m_compression = n->m_compression;
+
+	StreamFile::MutexLock lock;
+	lockForWriting( lock );
+	m_uncompressedHashToDataMap.insert( UncompressedHashToDataMap::value_type( key, block ) );
+}
+
+void StreamIndexedIO::Index::decompressData( const DataNode *n, const char *block, char *buffer, Imf::Int64 size ) const
+{
+	if ( n->m_size < sizeof( Imf::Int64 ) )
+	{
+		throw IOException( "StreamIndexedIO: Invalid compressed data block!" );
+	}
+
+	Imf::Int64 uncompressedSize;
+	memcpy( &uncompressedSize, block, sizeof( Imf::Int64 ) );
+	if ( bigEndian() )
+	{
+		uncompressedSize = reverseBytes<>( uncompressedSize );
+	}
+
+	if ( uncompressedSize != size )
+	{
+		throw IOException( "StreamIndexedIO: Unexpected size for compressed data block!" );
+	}
+
+	io::filtering_istream decompressingStream;
+	MemoryStreamSource source( const_cast< char * >( block ) + sizeof( Imf::Int64 ), n->m_size - sizeof( Imf::Int64 ), false );
+	pushDecompressor( decompressingStream, n->m_compression );
+	decompressingStream.push( source );
+	decompressingStream.read( buffer, size );
+
+	if ( (Imf::Int64)decompressingStream.gcount() != size )
+	{
+		throw IOException( "StreamIndexedIO: Failed to decompress data block!" );
+	}
+}
+
+void StreamIndexedIO::Index::readData( const DataNode *n, char *buffer, Imf::Int64 size )
+{
+	syncPendingData();
+
+	if ( !n->m_compression )
+	{
+		if ( size != n->m_size )
+		{
+			throw IOException( "StreamIndexedIO: Unexpected size for data block!" );
+		}
+		m_stream->pread( buffer, size, n->m_offset );
+		return;
+	}
+
+	const char *block = m_stream->mappedData( n->m_offset, n->m_size );
+	if ( !block )
+	{
+		char *blockBuffer = m_stream->threadBuffer( n->m_size );
+		m_stream->pread( blockBuffer, n->m_size, n->m_offset );
+		block = blockBuffer;
+	}
+	decompressData( n, block, buffer, size );
+}
+
+const char *StreamIndexedIO::Index::readData( const DataNode *n, Imf::Int64 &size )
+{
+	syncPendingData();
+
+	const char *block = m_stream->mappedData( n->m_offset, n->m_size );
+	if ( !block )
+	{
+		char *blockBuffer = m_stream->threadBuffer( n->m_size );
+		m_stream->pread( blockBuffer, n->m_size, n->m_offset );
+		block = blockBuffer;
+	}
+
+	if ( !n->m_compression )
+	{
+		size = n->m_size;
+		return block;
+	}
+
+	if ( n->m_size < sizeof( Imf::Int64 ) )
+	{
+		throw IOException( "StreamIndexedIO: Invalid compressed data block!" );
+	}
+	memcpy( &size, block, sizeof( Imf::Int64 ) );
+	if ( bigEndian() )
+	{
+		size = reverseBytes<>( size );
+	}
+
+	char *buffer = m_stream->threadBuffer( size, 1 );
+	decompressData( n, block, buffer, size );
+	return buffer;
+}
+
+void StreamIndexedIO::Index::setIndexCompression( StreamIndexedIO::Compression compression )
+{
+	if ( compression < StreamIndexedIO::NoCompression || compression > StreamIndexedIO::FastZlib )
+	{
+		throw InvalidArgumentException( "StreamIndexedIO: Unknown compression codec!" );
+	}
+	m_indexCompression = compression;
+	m_hasChanged = true;
+}
+
+StreamIndexedIO::Compression StreamIndexedIO::Index::getIndexCompression() const
+{
+	return m_indexCompression;
+}
+
+void StreamIndexedIO::Index::setDataCompression( StreamIndexedIO::Compression compression, size_t minSize )
+{
+	if ( compression < StreamIndexedIO::NoCompression || compression > StreamIndexedIO::FastZlib )
+	{
+		throw InvalidArgumentException( "StreamIndexedIO: Unknown compression codec!" );
+	}
+	m_dataCompression = compression;
+	m_dataCompressionMinSize = minSize;
+}
+
+StreamIndexedIO::Compression StreamIndexedIO::Index::getDataCompression() const
+{
+	return m_dataCompression;
+}
+
 ///////////////////////////////////////////////
 //
 // StreamIndexedIO::Index (end)
@@ -1621,7 +2169,7 @@ void StreamIndexedIO::Index::readNodeFromSubIndex( Node *n )
 //
 ///////////////////////////////////////////////
 
-StreamIndexedIO::StreamFile::StreamFile( IndexedIO::OpenMode mode ) : m_openmode(mode), m_stream(0), m_ioBufferLen(0), m_ioBuffer(0)
+StreamIndexedIO::StreamFile::StreamFile( IndexedIO::OpenMode mode ) : m_openmode(mode), m_stream(0), m_mappedData(0), m_mappedSize(0), m_ioBufferLen(0), m_ioBuffer(0)
 {
 	IndexedIO::validateOpenMode(m_openmode);
 }
@@ -1669,6 +2217,39 @@ char *StreamIndexedIO::StreamFile::ioBuffer( unsigned long size )
 	return m_ioBuffer;
 }
 
+char *StreamIndexedIO::StreamFile::threadBuffer( unsigned long size, unsigned int slot )
+{
+	assert( slot < 2 );
+	std::vector<char> &buffer = m_threadBuffers.local().slots[slot];
+	if ( buffer.size() < size || buffer.empty() )
+	{
+		buffer.resize( std::max( size, 1UL ) );
+	}
+	return &buffer[0];
+}
+
+const char *StreamIndexedIO::StreamFile::mappedData( Imf::Int64 pos, Imf::Int64 size ) const
+{
+	if ( !m_mappedData )
+	{
+		return 0;
+	}
+
+	if ( pos + size > m_mappedSize )
+	{
+		throw IOException( ( boost::format( "StreamIndexedIO: Data block at %d with %d bytes lies outside of the file!" ) % pos % size ).str() );
+	}
+
+	return m_mappedData + pos;
+}
+
+void StreamIndexedIO::StreamFile::setMappedData( const char *data, size_t size )
+{
+	assert( m_openmode & IndexedIO::Read );
+	m_mappedData = data;
+	m_mappedSize = size;
+}
+
 StreamIndexedIO::StreamFile::Mutex & StreamIndexedIO::StreamFile::mutex()
 {
 	return m_mutex;
@@ -1737,6 +2318,23 @@ void StreamIndexedIO::StreamFile::write( const char *buffer, size_t size )
 	m_stream->write( buffer, size );
 }
 
+void StreamIndexedIO::StreamFile::pread( char *buffer, size_t size, Imf::Int64 pos )
+{
+	if ( const char *mapped = mappedData( pos, size ) )
+	{
+		memcpy( buffer, mapped, size );
+		return;
+	}
+
+	MutexLock lock( m_mutex );
+	m_stream->seekg( pos, std::ios::beg );
+	m_stream->read( buffer, size );
+}
+
+void StreamIndexedIO::StreamFile::prefetch( Imf::Int64 pos, Imf::Int64 size )
+{
+}
+
 ///////////////////////////////////////////////
 //
 // StreamIndexedIO::StreamFile (end)
@@ -2078,6 +2676,63 @@ void StreamIndexedIO::commit()
 	m_node->m_idx->commitNodeToSubIndex( m_node );
 }
 
+void StreamIndexedIO::prefetch( const std::vector<IndexedIO::EntryIDList> &paths ) const
+{
+	Index::DataBlocks blocks;
+	for ( std::vector<IndexedIO::EntryIDList>::const_iterator pIt = paths.begin(); pIt != paths.end(); ++pIt )
+	{
+		const IndexedIO::EntryIDList &path = *pIt;
+		if ( path.empty() )
+		{
+			m_node->m_idx->collectDataBlocks( m_node.get(), blocks );
+			continue;
+		}
+
+		Node *node = m_node.get();
+		IndexedIO::EntryIDList::const_iterator nIt = path.begin();
+		for ( ; node && nIt + 1 != path.end(); ++nIt )
+		{
+			node = node->child( *nIt, true );
+		}
+		if ( !node )
+		{
+			continue;
+		}
+
+		if ( const DataNode *dataNode = node->dataChild( *nIt ) )
+		{
+			blocks.push_back( Index::DataBlocks::value_type( dataNode->m_offset, dataNode->m_size ) );
+		}
+		else if ( Node *childNode = node->child( *nIt, true ) )
+		{
+			m_node->m_idx->collectDataBlocks( childNode, blocks );
+		}
+	}
+	m_node->m_idx->prefetchDataBlocks( blocks );
+}
+
+void StreamIndexedIO::setIndexCompression( Compression compression )
+{
+	writable( currentEntryId() );
+	m_node->m_idx->setIndexCompression( compression );
+}
+
+StreamIndexedIO::Compression StreamIndexedIO::getIndexCompression() const
+{
+	return m_node->m_idx->getIndexCompression();
+}
+
+void StreamIndexedIO::setDataCompression( Compression compression, size_t minSize )
+{
+	writable( currentEntryId() );
+	m_node->m_idx->setDataCompression( compression, minSize );
+}
+
+StreamIndexedIO::Compression StreamIndexedIO::getDataCompression() const
+{
+	return m_node->m_idx->getDataCompression();
+}
+
 void StreamIndexedIO::write(const IndexedIO::EntryID &name, const InternedString *x, unsigned long arrayLength)
 {
 	writable(name);
@@ -2094,24 +2749,27 @@ void StreamIndexedIO::write(const IndexedIO::EntryID &name, const InternedString
 	unsigned long size = IndexedIO::DataSizeTraits<Imf::Int64 *>::size(constIds, arrayLength);
 	IndexedIO::DataType dataType = IndexedIO::InternedStringArray;
 
-	char *data = streamFile().ioBuffer(size);
+	char *data = streamFile().threadBuffer(size);
 	assert(data);
 
 	Index *index = m_node->m_idx;
 
 	StringCache &stringCache = index->stringCache();
 
-	for ( unsigned long i = 0; i < arrayLength; i++ )
 	{
-		ids[i] = stringCache.find( x[i], false /* create entry if missing */ );
+		StreamFile::MutexLock lock;
+		index->lockForWriting( lock );
+		for ( unsigned long i = 0; i < arrayLength; i++ )
+		{
+			ids[i] = stringCache.find( x[i], false /* create entry if missing */ );
+		}
 	}
 
 	IndexedIO::DataFlattenTraits<Imf::Int64*>::flatten(constIds, arrayLength, data);
 
 	node->m_dataType = dataType;
 	node->m_arrayLength = arrayLength;
-	node->m_offset = index->writeUniqueData( data, size );
-	node->m_size = size;
+	index->writeData( node, data, size );
 
 	delete [] ids;
 }
@@ -2129,20 +2787,12 @@ void StreamIndexedIO::read(const IndexedIO::EntryID &name, InternedString *&x, u
 	}
 
 	Imf::Int64 *ids = new Imf::Int64[arrayLength];
-	Imf::Int64 size = node->m_size;
-	StreamIndexedIO::StreamFile &f = streamFile();
-	{
-		StreamFile::MutexLock lock( f.mutex() );
-		f.seekg( node->m_offset, std::ios::beg );
-
 #ifdef IE_CORE_LITTLE_ENDIAN
-		// raw read
-		f.read( (char*)ids, size );
-	}
+	// raw read
+	m_node->m_idx->readData( node, (char*)ids, arrayLength * sizeof( Imf::Int64 ) );
 #else
-		char *data = f.ioBuffer(size);
-		f.read( data, size );
-	}
+	Imf::Int64 size = 0;
+	const char *data = m_node->m_idx->readData( node, size );
 	IndexedIO::DataFlattenTraits<Imf::Int64*>::unflatten( data, ids, arrayLength );
 #endif
 
@@ -2171,14 +2821,13 @@ void StreamIndexedIO::write(const IndexedIO::EntryID &name, const T *x, unsigned
 		unsigned long size = IndexedIO::DataSizeTraits<T*>::size(x, arrayLength);
 		IndexedIO::DataType dataType = IndexedIO::DataTypeTraits<T*>::type();
 
-		char *data = streamFile().ioBuffer(size);
+		char *data = streamFile().threadBuffer(size);
 		assert(data);
 		IndexedIO::DataFlattenTraits<T*>::flatten(x, arrayLength, data);
 
 		node->m_dataType = dataType;
 		node->m_arrayLength = arrayLength;
-		node->m_offset = m_node->m_idx->writeUniqueData( data, size );
-		node->m_size = size;
+		m_node->m_idx->writeData( node, data, size );
 	}
 
 	else
@@ -2201,8 +2850,7 @@ void StreamIndexedIO::rawWrite(const IndexedIO::EntryID &name, const T *x, unsig
 
 		node->m_dataType = dataType;
 		node->m_arrayLength = arrayLength;
-		node->m_offset = m_node->m_idx->writeUniqueData( (char*)x, size );
-		node->m_size = size;
+		m_node->m_idx->writeData( node, (const char*)x, size );
 	}
 	else
 	{
@@ -2222,14 +2870,13 @@ void StreamIndexedIO::write(const IndexedIO::EntryID &name, const T &x)
 		unsigned long size = IndexedIO::DataSizeTraits<T>::size(x);
 		IndexedIO::DataType dataType = IndexedIO::DataTypeTraits<T>::type();
 
-		char *data = streamFile().ioBuffer(size);
+		char *data = streamFile().threadBuffer(size);
 		assert(data);
 		IndexedIO::DataFlattenTraits<T>::flatten(x, data);
 
 		node->m_dataType = dataType;
 		node->m_arrayLength = 0;
-		node->m_offset = m_node->m_idx->writeUniqueData( data, size );
-		node->m_size = size;
+		m_node->m_idx->writeData( node, data, size );
 	}
 	else
 	{
@@ -2251,8 +2898,7 @@ void StreamIndexedIO::rawWrite(const IndexedIO::EntryID &name, const T &x)
 
 		node->m_dataType = dataType;
 		node->m_arrayLength = 0;
-		node->m_offset = m_node->m_idx->writeUniqueData( (char*)&x, size );
-		node->m_size = size;
+		m_node->m_idx->writeData( node, (const char*)&x, size );
 	}
 	else
 	{
@@ -2273,15 +2919,9 @@ void StreamIndexedIO::read(const IndexedIO::EntryID &name, T *&x, unsigned long
 		throw IOException( "StreamIndexedIO: Entry not found '" + name.value() + "'" );
 	}
 
-	StreamIndexedIO::StreamFile &f = streamFile();
-	Imf::Int64 size = node->m_size;
-	{
-		StreamFile::MutexLock lock( f.mutex() );
-		char *data = f.ioBuffer(size);
-		f.seekg( node->m_offset, std::ios::beg );
-		f.read( data, size );
-		IndexedIO::DataFlattenTraits<T*>::unflatten( data, x, arrayLength );
-	}
+	Imf::Int64 size = 0;
+	const char *data = m_node->m_idx->readData( node, size );
+	IndexedIO::DataFlattenTraits<T*>::unflatten( data, x, arrayLength );
 }
 
 template<typename T>
@@ -2297,18 +2937,12 @@ void StreamIndexedIO::rawRead(const IndexedIO::EntryID &name, T *&x, unsigned lo
 		throw IOException( "StreamIndexedIO: Entry not found '" + name.value() + "'" );
 	}
 
-	Imf::Int64 size = node->m_size;
 	if (!x)
 	{
 		x = new T[arrayLength];
 	}
 
-	StreamIndexedIO::StreamFile &f = streamFile();
-	{
-		StreamFile::MutexLock lock( f.mutex() );
-		f.seekg( node->m_offset, std::ios::beg );
-		f.read( (char*)x, size );
-	}
+	m_node->m_idx->readData( node, (char*)x, arrayLength * sizeof( T ) );
 }
 
 template<typename T>
@@ -2324,15 +2958,9 @@ void StreamIndexedIO::read(const IndexedIO::EntryID &name, T &x) const
 		throw IOException( "StreamIndexedIO: Entry not found '" + name.value() + "'" );
 	}
 
-	Imf::Int64 size = node->m_size;
-	StreamIndexedIO::StreamFile &f = streamFile();
-	{
-		StreamFile::MutexLock lock( f.mutex() );
-		char *data = f.ioBuffer(size);
-		f.seekg( node->m_offset, std::ios::beg );
-		f.read( data, size );
-		IndexedIO::DataFlattenTraits<T>::unflatten( data, x );
-	}
+	Imf::Int64 size = 0;
+	const char *data = m_node->m_idx->readData( node, size );
+	IndexedIO::DataFlattenTraits<T>::unflatten( data, x );
 }
 
 template<typename T>
@@ -2348,13 +2976,7 @@ void StreamIndexedIO::rawRead(const IndexedIO::EntryID &name, T &x) const
 		throw IOException( "StreamIndexedIO: Entry not found '" + name.value() + "'" );
 	}
 
-	Imf::Int64 size = node->m_size;
-	StreamIndexedIO::StreamFile &f = streamFile();
-	{
-		StreamFile::MutexLock lock( f.mutex() );
-		f.seekg( node->m_offset, std::ios::beg );
-		f.read( (char*)&x, size );
-	}
+	m_node->m_idx->readData( node, (char*)&x, sizeof( T ) );
 }
 
 #ifdef IE_CORE_LITTLE_ENDIAN
@@ -46,6 +46,7 @@
 #include "IECore/MessageHandler.h"
 #include "IECore/ImagePrimitive.h"
 #include "IECore/FileNameParameter.h"
+#include "IECore/CompoundParameter.h"
 #include "IECore/private/ScopedTIFFErrorHandler.h"
 #include "IECore/BoxOps.h"
 #include "IECore/ScaledDataConversion.h"
@@ -69,6 +70,7 @@ TIFFImageReader::TIFFImageReader()
 		:	ImageReader( "Reads Tagged Image File Format (TIFF) files" ),
 		m_tiffImage( 0 ), m_currentDirectoryIndex( 0 ), m_numDirectories( 1 ), m_haveDirectory( false )
 {
+	constructParameters();
 }
 
 TIFFImageReader::TIFFImageReader( const string &fileName )
@@ -76,6 +78,7 @@ TIFFImageReader::TIFFImageReader( const string &fileName )
 		m_tiffImage( 0 ), m_currentDirectoryIndex( 0 ), m_numDirectories( 1 ), m_haveDirectory( false )
 {
 	m_fileNameParameter->setTypedValue(fileName);
+	constructParameters();
 }
 
 TIFFImageReader::~TIFFImageReader()
@@ -87,6 +90,18 @@ TIFFImageReader::~TIFFImageReader()
 	}
 }
 
+void TIFFImageReader::constructParameters()
+{
+	m_mipLevelParameter = new IntParameter(
+		"mipLevel",
+		"The resolution level to read from mipmapped files where each level is stored in a separate directory. "
+		"This is added to the directory index specified with setDirectory().",
+		0,
+		0
+	);
+	parameters()->addParameter( m_mipLevelParameter );
+}
+
 bool TIFFImageReader::canRead( const string &fileName )
 {
 	// attempt to open the file
@@ -179,7 +194,7 @@ bool TIFFImageReader::isComplete()
 		/// compression methods support random access to the image data.
 		ScopedTIFFErrorHandler errorHandler;
 
-		readBuffer();
+		readBuffer( m_dataWindow );
 
 		return !errorHandler.hasError();
 	}
@@ -292,16 +307,16 @@ DataPtr TIFFImageReader::readTypedChannel( const std::string &name, const Box2i
 	data.resize( area );
 
 	int dataWidth = 1 + dataWindow.size().x;
-	int bufferDataWidth = 1 + m_dataWindow.size().x;
+	int bufferDataWidth = 1 + m_bufferWindow.size().x;
 
 	ScaledDataConversion<T, V> converter;
 
 	int dataY = 0;
-	for ( int y = dataWindow.min.y - m_dataWindow.min.y ; y <= dataWindow.max.y - m_dataWindow.min.y ; ++y, ++dataY )
+	for ( int y = dataWindow.min.y - m_bufferWindow.min.y ; y <= dataWindow.max.y - m_bufferWindow.min.y ; ++y, ++dataY )
 	{
 		int dataX = 0;
 
-		for ( int x = dataWindow.min.x - m_dataWindow.min.x;  x <= dataWindow.max.x - m_dataWindow.min.x ; ++x, ++dataX  )
+		for ( int x = dataWindow.min.x - m_bufferWindow.min.x;  x <= dataWindow.max.x - m_bufferWindow.min.x ; ++x, ++dataX  )
 		{
 			const T* buf = reinterpret_cast< T* >( & m_buffer[0] );
 			assert( buf );
@@ -322,9 +337,9 @@ DataPtr TIFFImageReader::readChannel( const std::string &name, const Imath::Box2
 {
 	readCurrentDirectory( true );
 
-	if ( m_buffer.size() == 0 )
+	if ( m_buffer.size() == 0 || boxIntersection( m_bufferWindow, dataWindow ) != dataWindow )
 	{
-		readBuffer();
+		readBuffer( dataWindow );
 	}
 
 	if ( m_sampleFormat == SAMPLEFORMAT_IEEEFP )
@@ -389,25 +404,31 @@ DataPtr TIFFImageReader::readChannel( const std::string &name, const Imath::Box2
 	}
 }
 
-void TIFFImageReader::readBuffer()
+void TIFFImageReader::readBuffer( const Box2i &region )
 {
 	assert( m_tiffImage );
 	assert( m_haveDirectory );
+	assert( boxIntersection( m_dataWindow, region ) == region );
 
 	int width = boxSize( m_dataWindow ).x + 1;
 	int height = boxSize( m_dataWindow ).y + 1;
 
+	// the region relative to the top left of the image, which is how libtiff addresses pixels
+	Box2i imageRegion( region.min - m_dataWindow.min, region.max - m_dataWindow.min );
+
 	// \todo Currently, we only support PLANARCONFIG_CONTIG for TIFFTAG_PLANARCONFIG.
 	assert( m_planarConfig ==  PLANARCONFIG_CONTIG );
-	std::vector<unsigned char>::size_type bufLineSize = (size_t)( (float)m_bitsPerSample / 8 * m_samplesPerPixel * width );
-	std::vector<unsigned char>::size_type bufSize = bufLineSize * height;
+	std::vector<unsigned char>::size_type pixelSize = (size_t)( (float)m_bitsPerSample / 8 * m_samplesPerPixel );
+	std::vector<unsigned char>::size_type bufLineSize = pixelSize * ( imageRegion.size().x + 1 );
+	std::vector<unsigned char>::size_type bufSize = bufLineSize * ( imageRegion.size().y + 1 );
 	assert( bufSize );
+	m_buffer.clear();
 	m_buffer.resize( bufSize, 0 );
+	m_bufferWindow = region;
 
 	if ( TIFFIsTiled( m_tiffImage ) )
 	{
 		tsize_t tileSize = TIFFTileSize( m_tiffImage );
-		ttile_t numTiles = TIFFNumberOfTiles( m_tiffImage );
 
 		/// Create a buffer to hold an individual tile
 		int tileWidth = tiffField<uint32>( TIFFTAG_TILEWIDTH );
@@ -422,64 +443,73 @@ void TIFFImageReader::readBuffer()
 			throw IOException( ( boost::format("TIFFImageReader: Unsupported value (%d) for TIFFTAG_TILELENGTH while reading %s") % tileLength % fileName() ).str() );
 		}
 
-		std::vector<unsigned char>::size_type pixelSize = (size_t)( (float)m_bitsPerSample / 8 * m_samplesPerPixel );
 		std::vector<unsigned char>::size_type tileLineSize = pixelSize * tileWidth;
 		std::vector<unsigned char>::size_type tileBufSize = tileLineSize * tileLength;
 		std::vector<unsigned char> tileBuffer;
 		tileBuffer.resize( tileBufSize, 0 );
 
-		int x = 0;
-		int y = 0;
-
-		/// Read each tile
-		for ( ttile_t tile = 0; tile < numTiles; tile++ )
+		/// Read each tile overlapping the region
+		for ( int tileY = ( imageRegion.min.y / tileLength ) * tileLength; tileY <= imageRegion.max.y; tileY += tileLength )
 		{
-			tsize_t imageOffset = y * bufLineSize + x * ( bufLineSize / width );
-			int result = TIFFReadEncodedTile( m_tiffImage, tile, &tileBuffer[0], tileSize );
-
-			if ( result == -1 )
+			for ( int tileX = ( imageRegion.min.x / tileWidth ) * tileWidth; tileX <= imageRegion.max.x; tileX += tileWidth )
 			{
-				throw IOException( (boost::format( "TIFFImageReader: Error on tile number %d while reading %s") % tile % fileName() ).str() );
-			}
-
-			/// Copy the tile into its rightful place in the image buffer.
-			/// We have to be careful here as the image might not be an exact
-			/// multiple of tiles, in which case we can't copy the tiles round the
-			/// edges in their entirety as that would give us buffer overruns.
-			int rowsToCopy = min( tileLength, height - y );
-			int columnsToCopy = min( (int)tileWidth, width - x );
-			tsize_t tileOffset = 0;
-			for ( int l = 0; l < rowsToCopy; l ++)
-			{
-				memcpy( &m_buffer[0] + imageOffset, &tileBuffer[0] + tileOffset, pixelSize * columnsToCopy );
-				imageOffset += bufLineSize;
-				tileOffset += tileLineSize;
-			}
+				ttile_t tile = TIFFComputeTile( m_tiffImage, tileX, tileY, 0, 0 );
+				int result = TIFFReadEncodedTile( m_tiffImage, tile, &tileBuffer[0], tileSize );
 
-			x = x + tileWidth;
+				if ( result == -1 )
+				{
+					throw IOException( (boost::format( "TIFFImageReader: Error on tile number %d while reading %s") % tile % fileName() ).str() );
+				}
 
-			if ( x >= width )
-			{
-				x = 0;
-				y += tileLength;
+				/// Copy the part of the tile inside the region into its rightful place in the buffer.
+				/// We have to be careful here as the image might not be an exact multiple of tiles,
+				/// in which case the tiles round the edges contain padding we mustn't copy.
+				int minX = max( tileX, imageRegion.min.x );
+				int maxX = min( min( tileX + tileWidth, width ) - 1, imageRegion.max.x );
+				int minY = max( tileY, imageRegion.min.y );
+				int maxY = min( min( tileY + tileLength, height ) - 1, imageRegion.max.y );
+
+				tsize_t imageOffset = ( minY - imageRegion.min.y ) * bufLineSize + ( minX - imageRegion.min.x ) * pixelSize;
+				tsize_t tileOffset = ( minY - tileY ) * tileLineSize + ( minX - tileX ) * pixelSize;
+				for ( int y = minY; y <= maxY; y++ )
+				{
+					memcpy( &m_buffer[0] + imageOffset, &tileBuffer[0] + tileOffset, pixelSize * ( maxX - minX + 1 ) );
+					imageOffset += bufLineSize;
+					tileOffset += tileLineSize;
+				}
 			}
 		}
 	}
 	else
 	{
+		int rowsPerStrip = min( tiffFieldDefaulted<uint32>( TIFFTAG_ROWSPERSTRIP ), (uint32)height );
+		std::vector<unsigned char>::size_type stripLineSize = pixelSize * width;
 		tsize_t stripSize = TIFFStripSize( m_tiffImage );
-		tsize_t imageOffset = 0;
-		tstrip_t numStrips = TIFFNumberOfStrips( m_tiffImage );
-		for ( tstrip_t strip = 0; strip < numStrips; strip++ )
+		std::vector<unsigned char> stripBuffer;
+		stripBuffer.resize( stripSize, 0 );
+
+		/// Read each strip overlapping the region
+		for ( tstrip_t strip = imageRegion.min.y / rowsPerStrip; strip <= (tstrip_t)( imageRegion.max.y / rowsPerStrip ); strip++ )
 		{
-			tsize_t result = TIFFReadEncodedStrip( m_tiffImage, strip, &m_buffer[0] + imageOffset, stripSize );
+			tsize_t result = TIFFReadEncodedStrip( m_tiffImage, strip, &stripBuffer[0], stripSize );
 
 			if ( result == -1 )
 			{
 				throw IOException( (boost::format( "TIFFImageReader: Error on strip number %d while reading %s") % strip % fileName() ).str() );
 			}
 
-			imageOffset += result;
+			int stripY = strip * rowsPerStrip;
+			int minY = max( stripY, imageRegion.min.y );
+			int maxY = min( stripY + rowsPerStrip - 1, imageRegion.max.y );
+
+			tsize_t imageOffset = ( minY - imageRegion.min.y ) * bufLineSize;
+			tsize_t stripOffset = ( minY - stripY ) * stripLineSize + imageRegion.min.x * pixelSize;
+			for ( int y = minY; y <= maxY; y++ )
+			{
+				memcpy( &m_buffer[0] + imageOffset, &stripBuffer[0] + stripOffset, bufLineSize );
+				imageOffset += bufLineSize;
+				stripOffset += stripLineSize;
+			}
 		}
 	}
 }
@@ -570,13 +600,20 @@ bool TIFFImageReader::readCurrentDirectory( bool throwOnFailure )
 	{
 		ScopedTIFFErrorHandler errorHandler;
 
-		if ( m_haveDirectory && m_currentDirectoryIndex == TIFFCurrentDirectory( m_tiffImage ) )
+		unsigned int directoryIndex = m_currentDirectoryIndex + m_mipLevelParameter->getNumericValue();
+		if ( directoryIndex >= m_numDirectories )
+		{
+			throw InvalidArgumentException( ( boost::format( "TIFFImageReader: Cannot read mip level %d from directory %d of %d in \"%s\"" ) % m_mipLevelParameter->getNumericValue() % (m_currentDirectoryIndex+1) % m_numDirectories % fileName() ).str() );
+		}
+
+		if ( m_haveDirectory && directoryIndex == TIFFCurrentDirectory( m_tiffImage ) )
 		{
 			return true;
 		}
 		else
 		{
-			int res = TIFFSetDirectory( m_tiffImage, m_currentDirectoryIndex );
+			m_haveDirectory = false;
+			int res = TIFFSetDirectory( m_tiffImage, directoryIndex );
 			if ( res != 1 )
 			{
 				return false;
@@ -651,6 +688,7 @@ bool TIFFImageReader::readCurrentDirectory( bool throwOnFailure )
 		uint16 numExtraSamples;
 		uint16 *extraSamples;
 		TIFFGetFieldDefaulted( m_tiffImage, TIFFTAG_EXTRASAMPLES, &numExtraSamples, &extraSamples);
+		m_extraSamples.clear();
 		for ( unsigned int i = 0; i < numExtraSamples; i++ )
 		{
 			m_extraSamples.push_back( extraSamples[i] );
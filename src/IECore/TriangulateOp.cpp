@@ -32,13 +32,18 @@
 //
 //////////////////////////////////////////////////////////////////////////
 
+#include "tbb/parallel_for.h"
+#include "tbb/atomic.h"
+
 #include "IECore/CompoundObject.h"
 #include "IECore/MeshPrimitive.h"
+#include "IECore/MeshTopology.h"
 #include "IECore/TriangulateOp.h"
 #include "IECore/DespatchTypedData.h"
 #include "IECore/TriangleAlgo.h"
 #include "IECore/Exception.h"
 #include "IECore/CompoundParameter.h"
+#include "IECore/GeometricTypedData.h"
 
 using namespace IECore;
 
@@ -88,40 +93,76 @@ const BoolParameter * TriangulateOp::throwExceptionsParameter() const
 	return m_throwExceptionsParameter;
 }
 
-/// A functor for use with despatchTypedData, which copies elements from another vector, as specified by an array of indices into that data
+/// A functor for use with despatchTypedData, which gathers elements from the data, as specified by an array of indices into that data
 struct TriangleDataRemap
 {
-	typedef size_t ReturnType;
+	typedef DataPtr ReturnType;
 
-	TriangleDataRemap( const std::vector<int> &indices ) : m_other(0), m_indices( indices )
+	TriangleDataRemap( const std::vector<int> &indices ) : m_indices( indices )
 	{
 	}
 
-	const Data * m_other;
 	const std::vector<int> &m_indices;
 
 	template<typename T>
-	size_t operator() ( T * data )
+	DataPtr operator() ( const T * data )
 	{
 		assert( data );
-		typename T::ValueType &dataWritable = data->writable();
-		
-		const T * otherData = runTimeCast<const T, const Data>( m_other );
-		assert( otherData );
-		const typename T::ValueType &otherDataReadable = otherData->readable();
+		typename T::Ptr result = new T;
+		copyInterpretation( data, result.get() );
+		gather( data->readable(), result->writable() );
+		assert( result->readable().size() == m_indices.size() );
+		return result;
+	}
 
-		dataWritable.clear();
-		dataWritable.reserve( m_indices.size() );
+	private :
 
-		for ( std::vector<int>::const_iterator it = m_indices.begin(); it != m_indices.end(); ++it )
+		template<typename T>
+		void copyInterpretation( const T *source, T *result ) const
 		{
-			dataWritable.push_back( otherDataReadable[ *it ] );
 		}
 
-		assert( dataWritable.size() == m_indices.size() );
+		template<typename T>
+		void copyInterpretation( const GeometricTypedData<T> *source, GeometricTypedData<T> *result ) const
+		{
+			result->setInterpretation( source->getInterpretation() );
+		}
+
+		template<typename Container>
+		struct Gather
+		{
+			Gather( const Container &source, const std::vector<int> &indices, Container &result )
+				:	m_source( source ), m_indices( indices ), m_result( result )
+			{
+			}
+
+			void operator()( const tbb::blocked_range<size_t> &r ) const
+			{
+				for( size_t i = r.begin(); i != r.end(); ++i )
+				{
+					m_result[i] = m_source[m_indices[i]];
+				}
+			}
+
+			const Container &m_source;
+			const std::vector<int> &m_indices;
+			Container &m_result;
+		};
+
+		template<typename Container>
+		void gather( const Container &source, Container &result ) const
+		{
+			result.resize( m_indices.size() );
+			tbb::parallel_for( tbb::blocked_range<size_t>( 0, m_indices.size(), 1000 ), Gather<Container>( source, m_indices, result ) );
+		}
+
+		// the elements of std::vector<bool> share storage, so can't be written concurrently.
+		void gather( const std::vector<bool> &source, std::vector<bool> &result ) const
+		{
+			result.resize( m_indices.size() );
+			Gather<std::vector<bool> >( source, m_indices, result )( tbb::blocked_range<size_t>( 0, m_indices.size() ) );
+		}
 
-		return dataWritable.size();
-	}
 };
 
 /// A simple class to allow TriangulateOp to operate on either V3fVectorData or V3dVectorData using
@@ -139,192 +180,183 @@ struct TriangulateOp::TriangulateFn
 	{
 	}
 
-	template<typename T>
-	ReturnType operator()( T * p )
+	/// Returns a description of the problem if the face can't be triangulated
+	/// as a simple fan, and 0 otherwise.
+	template<typename Vec>
+	static const char *validateFace( const std::vector<Vec> &pReadable, const std::vector<int> &vertexIdsReadable, int faceVertexIdStart, int numFaceVerts, float tolerance )
 	{
-		typedef typename T::ValueType::value_type Vec;
-
-		const typename T::ValueType &pReadable = p->readable();
-
-		MeshPrimitivePtr meshCopy = m_mesh->copy();
-
-		ConstIntVectorDataPtr verticesPerFace = m_mesh->verticesPerFace();
-		const std::vector<int> &verticesPerFaceReadable = verticesPerFace->readable();
-		ConstIntVectorDataPtr vertexIds = m_mesh->vertexIds();
-		const std::vector<int> &vertexIdsReadable = vertexIds->readable();
-
-		IntVectorDataPtr newVertexIds = new IntVectorData();
-		std::vector<int> &newVertexIdsWritable = newVertexIds->writable();
-		newVertexIdsWritable.reserve( vertexIdsReadable.size() );
+		if ( numFaceVerts <= 3 )
+		{
+			return 0;
+		}
 
-		IntVectorDataPtr newVerticesPerFace = new IntVectorData();
-		std::vector<int> &newVerticesPerFaceWritable = newVerticesPerFace->writable();
-		newVerticesPerFaceWritable.reserve( verticesPerFaceReadable.size() );
+		const int v0 = vertexIdsReadable[ faceVertexIdStart + 0 ];
+		const Vec firstTriangleNormal = triangleNormal( pReadable[ v0 ], pReadable[ vertexIdsReadable[ faceVertexIdStart + 1 ] ], pReadable[ vertexIdsReadable[ faceVertexIdStart + 2 ] ] );
 
-		std::vector<int> faceVaryingIndices;
-		std::vector<int> uniformIndices;
-		int faceVertexIdStart = 0;
-		int faceIdx = 0;
-		for ( IntVectorData::ValueType::const_iterator it = verticesPerFaceReadable.begin(); it != verticesPerFaceReadable.end(); ++it, ++faceIdx )
+		/// Convexivity test - for each edge, all other vertices must be on the same "side" of it
+		for (int i = 0; i < numFaceVerts - 1; i++)
 		{
-			int numFaceVerts = *it;
+			const int edgeStartIndex = faceVertexIdStart + i + 0;
+			const int edgeStart = vertexIdsReadable[ edgeStartIndex ];
 
-			if ( numFaceVerts > 3 )
-			{
-				/// For the time being, just do a simple triangle fan.
+			const int edgeEndIndex = faceVertexIdStart + i + 1;
+			const int edgeEnd = vertexIdsReadable[ edgeEndIndex ];
 
-				const int i0 = faceVertexIdStart + 0;
-				const int v0 = vertexIdsReadable[ i0 ];
+			const Vec edge = pReadable[ edgeEnd ] - pReadable[ edgeStart ];
+			const float edgeLength = edge.length();
 
-				int i1 = faceVertexIdStart + 1;
-				int i2 = faceVertexIdStart + 2;
-				int v1 = vertexIdsReadable[ i1 ];
-				int v2 = vertexIdsReadable[ i2 ];
+			if (edgeLength > tolerance)
+			{
+				const Vec edgeDirection = edge / edgeLength;
 
-				const Vec firstTriangleNormal = triangleNormal( pReadable[ v0 ], pReadable[ v1 ], pReadable[ v2 ] );
+				/// Construct a plane whose normal is perpendicular to both the edge and the polygon's normal
+				const Vec planeNormal = edgeDirection.cross( firstTriangleNormal );
+				const float planeConstant = planeNormal.dot( pReadable[ edgeStart ] );
 
-				if (m_throwExceptions)
+				int sign = 0;
+				bool first = true;
+				for (int j = 0; j < numFaceVerts; j++)
 				{
-					/// Convexivity test - for each edge, all other vertices must be on the same "side" of it
-					for (int i = 0; i < numFaceVerts - 1; i++)
-					{
-						const int edgeStartIndex = faceVertexIdStart + i + 0;
-						const int edgeStart = vertexIdsReadable[ edgeStartIndex ];
-
-						const int edgeEndIndex = faceVertexIdStart + i + 1;
-						const int edgeEnd = vertexIdsReadable[ edgeEndIndex ];
+					const int testVertexIndex = faceVertexIdStart + j;
+					const int testVertex = vertexIdsReadable[ testVertexIndex ];
 
-						const Vec edge = pReadable[ edgeEnd ] - pReadable[ edgeStart ];
-						const float edgeLength = edge.length();
+					if ( testVertex != edgeStart && testVertex != edgeEnd )
+					{
+						float signedDistance = planeNormal.dot( pReadable[ testVertex ] ) - planeConstant;
 
-						if (edgeLength > m_tolerance)
+						if ( fabs(signedDistance) > tolerance)
 						{
-							const Vec edgeDirection = edge / edgeLength;
-
-							/// Construct a plane whose normal is perpendicular to both the edge and the polygon's normal
-							const Vec planeNormal = edgeDirection.cross( firstTriangleNormal );
-							const float planeConstant = planeNormal.dot( pReadable[ edgeStart ] );
-
-							int sign = 0;
-							bool first = true;
-							for (int j = 0; j < numFaceVerts; j++)
+							int thisSign = 1;
+							if ( signedDistance < 0.0 )
+							{
+								thisSign = -1;
+							}
+							if (first)
 							{
-								const int testVertexIndex = faceVertexIdStart + j;
-								const int testVertex = vertexIdsReadable[ testVertexIndex ];
-
-								if ( testVertex != edgeStart && testVertex != edgeEnd )
-								{
-									float signedDistance = planeNormal.dot( pReadable[ testVertex ] ) - planeConstant;
-
-									if ( fabs(signedDistance) > m_tolerance)
-									{
-										int thisSign = 1;
-										if ( signedDistance < 0.0 )
-										{
-											thisSign = -1;
-										}
-										if (first)
-										{
-											sign = thisSign;
-											first = false;
-										}
-										else if ( thisSign != sign )
-										{
-											assert( sign != 0 );
-											throw InvalidArgumentException("TriangulateOp cannot deal with concave polygons");
-										}
-									}
-								}
+								sign = thisSign;
+								first = false;
+							}
+							else if ( thisSign != sign )
+							{
+								assert( sign != 0 );
+								return "TriangulateOp cannot deal with concave polygons";
 							}
 						}
 					}
 				}
+			}
+		}
 
-				for (int i = 1; i < numFaceVerts - 1; i++)
-				{
-					i1 = faceVertexIdStart + ( (i + 0) % numFaceVerts );
-					i2 = faceVertexIdStart + ( (i + 1) % numFaceVerts );
-					v1 = vertexIdsReadable[ i1 ];
-					v2 = vertexIdsReadable[ i2 ];
+		/// Planarity test - each triangle of the fan must face the same way as the first
+		for (int i = 1; i < numFaceVerts - 1; i++)
+		{
+			const int v1 = vertexIdsReadable[ faceVertexIdStart + i ];
+			const int v2 = vertexIdsReadable[ faceVertexIdStart + i + 1 ];
 
-					if ( m_throwExceptions && fabs( triangleNormal( pReadable[ v0 ], pReadable[ v1 ], pReadable[ v2 ] ).dot( firstTriangleNormal ) - 1.0 ) > m_tolerance )
-					{
-						throw InvalidArgumentException("TriangulateOp cannot deal with non-planar polygons");
-					}
+			if ( fabs( triangleNormal( pReadable[ v0 ], pReadable[ v1 ], pReadable[ v2 ] ).dot( firstTriangleNormal ) - 1.0 ) > tolerance )
+			{
+				return "TriangulateOp cannot deal with non-planar polygons";
+			}
+		}
 
-					/// Create a new triangle
-					newVerticesPerFaceWritable.push_back( 3 );
+		return 0;
+	}
 
-					/// Triangulate the vertices
-					newVertexIdsWritable.push_back( v0 );
-					newVertexIdsWritable.push_back( v1 );
-					newVertexIdsWritable.push_back( v2 );
+	/// Finds the first face which can't be triangulated, validating the faces in parallel.
+	template<typename Vec>
+	struct ValidateFaces
+	{
+		ValidateFaces( const std::vector<Vec> &p, const std::vector<int> &vertexIds, const std::vector<int> &faceOffsets, float tolerance, tbb::atomic<int> &firstInvalidFace )
+			:	m_p( p ), m_vertexIds( vertexIds ), m_faceOffsets( faceOffsets ), m_tolerance( tolerance ), m_firstInvalidFace( firstInvalidFace )
+		{
+		}
 
-					/// Store the indices required to rebuild the facevarying primvars
-					faceVaryingIndices.push_back( i0 );
-					faceVaryingIndices.push_back( i1 );
-					faceVaryingIndices.push_back( i2 );
+		void operator()( const tbb::blocked_range<size_t> &r ) const
+		{
+			for( size_t f = r.begin(); f != r.end(); ++f )
+			{
+				if( (int)f >= m_firstInvalidFace )
+				{
+					return;
+				}
 
-					uniformIndices.push_back( faceIdx );
+				if( validateFace( m_p, m_vertexIds, m_faceOffsets[f], m_faceOffsets[f+1] - m_faceOffsets[f], m_tolerance ) )
+				{
+					int current = m_firstInvalidFace;
+					while( (int)f < current )
+					{
+						const int previous = m_firstInvalidFace.compare_and_swap( f, current );
+						if( previous == current )
+						{
+							break;
+						}
+						current = previous;
+					}
+					return;
 				}
 			}
-			else
-			{
-				assert( numFaceVerts == 3 );
+		}
 
-				int i0 = faceVertexIdStart + 0;
-				int i1 = faceVertexIdStart + 1;
-				int i2 = faceVertexIdStart + 2;
+		const std::vector<Vec> &m_p;
+		const std::vector<int> &m_vertexIds;
+		const std::vector<int> &m_faceOffsets;
+		float m_tolerance;
+		tbb::atomic<int> &m_firstInvalidFace;
+	};
 
-				newVerticesPerFaceWritable.push_back( 3 );
+	template<typename T>
+	ReturnType operator()( T * p )
+	{
+		typedef typename T::ValueType::value_type Vec;
 
-				/// Copy across the vertexId data
-				newVertexIdsWritable.push_back( vertexIdsReadable[ i0 ] );
-				newVertexIdsWritable.push_back( vertexIdsReadable[ i1 ] );
-				newVertexIdsWritable.push_back( vertexIdsReadable[ i2 ] );
+		const typename T::ValueType &pReadable = p->readable();
 
-				/// Store the indices required to rebuild the facevarying primvars
-				faceVaryingIndices.push_back( i0 );
-				faceVaryingIndices.push_back( i1 );
-				faceVaryingIndices.push_back( i2 );
+		/// The fan triangulation depends only on the topology, so is cached along
+		/// with the rest of the MeshTopology tables, and shared by all meshes with
+		/// the same topology.
+		ConstMeshTopologyPtr topology = MeshTopology::get( m_mesh );
+		ConstIntVectorDataPtr vertexIds = m_mesh->vertexIds();
+		const std::vector<int> &vertexIdsReadable = vertexIds->readable();
 
-				uniformIndices.push_back( faceIdx );
+		if ( m_throwExceptions )
+		{
+			const std::vector<int> &faceOffsets = topology->faceOffsets();
+			const int numFaces = topology->numFaces();
+			tbb::atomic<int> firstInvalidFace;
+			firstInvalidFace = numFaces;
+			tbb::parallel_for(
+				tbb::blocked_range<size_t>( 0, numFaces, 1000 ),
+				ValidateFaces<Vec>( pReadable, vertexIdsReadable, faceOffsets, m_tolerance, firstInvalidFace )
+			);
+
+			if ( firstInvalidFace < numFaces )
+			{
+				const int f = firstInvalidFace;
+				throw InvalidArgumentException( validateFace( pReadable, vertexIdsReadable, faceOffsets[f], faceOffsets[f+1] - faceOffsets[f], m_tolerance ) );
 			}
-
-			faceVertexIdStart += numFaceVerts;
 		}
 
+		const std::vector<int> &triangleFaceVertices = topology->triangleFaceVertices();
+		TriangleDataRemap varyingRemap( triangleFaceVertices );
+		TriangleDataRemap uniformRemap( topology->triangleFaces() );
+
+		IntVectorDataPtr newVertexIds = runTimeCast<IntVectorData>( varyingRemap( vertexIds.get() ) );
+		IntVectorDataPtr newVerticesPerFace = new IntVectorData( std::vector<int>( topology->numTriangles(), 3 ) );
+
 		m_mesh->setTopology( newVerticesPerFace, newVertexIds, m_mesh->interpolation() );
 
-		/// Rebuild all the facevarying primvars, using the list of indices into the old data we created above.
-		assert( faceVaryingIndices.size() == newVertexIds->readable().size() );
-		TriangleDataRemap varyingRemap( faceVaryingIndices );
-		TriangleDataRemap uniformRemap( uniformIndices );
+		/// Rebuild all the facevarying and uniform primvars, using the triangle tables to index into the old data.
 		for ( PrimitiveVariableMap::iterator it = m_mesh->variables.begin(); it != m_mesh->variables.end(); ++it )
 		{
 			if ( it->second.interpolation == PrimitiveVariable::FaceVarying )
 			{
  				assert( it->second.data );
-				varyingRemap.m_other = it->second.data;
-				DataPtr data = it->second.data->copy();
-
-				size_t primVarSize = despatchTypedData<TriangleDataRemap, TypeTraits::IsVectorTypedData>( data, varyingRemap );
-				assert( primVarSize == faceVaryingIndices.size() );
-				(void)primVarSize;
-
-				it->second.data = data;
+				it->second.data = despatchTypedData<TriangleDataRemap, TypeTraits::IsVectorTypedData>( it->second.data, varyingRemap );
 			}
 			else if ( it->second.interpolation == PrimitiveVariable::Uniform )
 			{
  				assert( it->second.data );
-				uniformRemap.m_other = it->second.data;
-				DataPtr data = it->second.data->copy();
-
-				size_t primVarSize = despatchTypedData<TriangleDataRemap, TypeTraits::IsVectorTypedData>( data, uniformRemap );
-				assert( primVarSize == uniformIndices.size() );
-				(void)primVarSize;
-
-				it->second.data = data;
+				it->second.data = despatchTypedData<TriangleDataRemap, TypeTraits::IsVectorTypedData>( it->second.data, uniformRemap );
 			}
 		}
 
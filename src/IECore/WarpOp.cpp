@@ -32,8 +32,17 @@
 //
 //////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <limits>
+
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range2d.h"
+
+#include "OpenEXR/ImathMath.h"
+
 #include "IECore/WarpOp.h"
 #include "IECore/Interpolator.h"
+#include "IECore/CubicBasis.h"
 #include "IECore/DespatchTypedData.h"
 #include "IECore/TypeTraits.h"
 #include "IECore/CompoundParameter.h"
@@ -50,6 +59,8 @@ WarpOp::WarpOp( const std::string &description )
 	IntParameter::PresetsContainer filterPresets;
 	filterPresets.push_back( IntParameter::Preset( "None", WarpOp::None ) );
 	filterPresets.push_back( IntParameter::Preset( "Bilinear", WarpOp::Bilinear ) );
+	filterPresets.push_back( IntParameter::Preset( "Cubic", WarpOp::Cubic ) );
+	filterPresets.push_back( IntParameter::Preset( "Lanczos", WarpOp::Lanczos ) );
 	m_filterParameter = new IntParameter(
 		"filter",
 		"Defines the filter to be used on the warped coordinates.",
@@ -78,115 +89,280 @@ const IntParameter * WarpOp::filterParameter() const
 	return m_filterParameter;
 }
 
-struct WarpOp::Warp
+//////////////////////////////////////////////////////////////////////////
+// Filtering
+//////////////////////////////////////////////////////////////////////////
+
+namespace
 {
-	typedef void ReturnType;
 
-	Warp( WarpOp * warp, WarpOp::FilterType filter, const Imath::Box2i &warpedDataWindow, const Imath::Box2i &originalDataWindow )
-		:	m_warpOp( warp ), m_filter( filter ), m_outputDataWindow( warpedDataWindow ), m_inputDataWindow( originalDataWindow )
+// The size of the square tiles in which the output is processed.
+const int g_tileSize = 64;
+
+// Returns the number of input pixels contributing to an output pixel
+// along each axis.
+int filterWidth( WarpOp::FilterType filter )
+{
+	switch( filter )
 	{
+		case WarpOp::None :
+			return 1;
+		case WarpOp::Bilinear :
+			return 2;
+		case WarpOp::Cubic :
+			return 4;
+		case WarpOp::Lanczos :
+			return 6;
+		default :
+			throw Exception( "Invalid filter type!" );
 	}
+}
 
-	inline void computePixelCoordinates( float x, float y, int &x1, int &y1, int &x2, int &y2, float &ratioX, float &ratioY )
+float lanczos( float x )
+{
+	if( x == 0.0f )
 	{
-		Imath::V2f inPos = m_warpOp->warp( Imath::V2f( x, y ) );
-		x1 = int(inPos.x);
-		y1 = int(inPos.y);
-		if ( x1 > inPos.x )
-		{
-			ratioX = x1 - inPos.x;
-			x2 = x1;
-			x1--;
-		}
-		else
-		{
-			x2 = x1 + 1;
-			ratioX = inPos.x - x1;
-		}
-		if ( y1 > inPos.y )
-		{
-			ratioY = y1 - inPos.y;
-			y2 = y1;
-			y1--;
-		}
-		else
+		return 1.0f;
+	}
+	if( Imath::Math<float>::fabs( x ) >= 3.0f )
+	{
+		return 0.0f;
+	}
+	const float px = M_PI * x;
+	return 3.0f * Imath::Math<float>::sin( px ) * Imath::Math<float>::sin( px / 3.0f ) / ( px * px );
+}
+
+// Computes the first input pixel contributing to position p along one axis,
+// and filterWidth( filter ) weights for it and the following pixels. Pixel
+// values are considered to lie at integer positions.
+void filterWeights( WarpOp::FilterType filter, float p, int &first, float *weights )
+{
+	if( filter == WarpOp::None )
+	{
+		first = int( p );
+		weights[0] = 1.0f;
+		return;
+	}
+
+	const float f = Imath::Math<float>::floor( p );
+	const float t = p - f;
+	switch( filter )
+	{
+		case WarpOp::Bilinear :
+			first = int( f );
+			weights[0] = 1.0f - t;
+			weights[1] = t;
+			break;
+		case WarpOp::Cubic :
+			first = int( f ) - 1;
+			CubicBasis<float>::catmullRom().coefficients( t, weights[0], weights[1], weights[2], weights[3] );
+			break;
+		default :
 		{
-			y2 = y1 + 1;
-			ratioY = inPos.y - y1;
+			first = int( f ) - 2;
+			float sum = 0.0f;
+			for( int i = 0; i < 6; ++i )
+			{
+				weights[i] = lanczos( t - float( i - 2 ) );
+				sum += weights[i];
+			}
+			for( int i = 0; i < 6; ++i )
+			{
+				weights[i] /= sum;
+			}
 		}
-		x1 -= m_inputDataWindow.min.x;
-		y1 -= m_inputDataWindow.min.y;
-		x2 -= m_inputDataWindow.min.x;
-		y2 -= m_inputDataWindow.min.y;
+	}
+}
+
+inline int clampIndex( int i, int size )
+{
+	return i < 0 ? 0 : ( i >= size ? size - 1 : i );
+}
+
+// Converts a filtered value back to the channel type, clamping
+// integer types to their range to avoid wraparound from the
+// negative lobes of the Cubic and Lanczos filters.
+template<typename V>
+inline V filteredValue( double v )
+{
+	if( std::numeric_limits<V>::is_integer )
+	{
+		v = std::max( v, (double)std::numeric_limits<V>::min() );
+		v = std::min( v, (double)std::numeric_limits<V>::max() );
+	}
+	return (V)v;
+}
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////////
+// Tiled resampling
+//////////////////////////////////////////////////////////////////////////
+
+struct WarpOp::Channel
+{
+	ConstDataPtr input;
+	DataPtr output;
+};
+
+struct WarpOp::AllocateChannel
+{
+	typedef DataPtr ReturnType;
+
+	AllocateChannel( size_t size )
+		:	m_size( size )
+	{
 	}
 
-	template<typename V>
-	inline V clampXY( const std::vector<V> &buffer, int x, int y, int width, int height ) const
+	template<typename T>
+	ReturnType operator()( T * data )
+	{
+		typename T::Ptr result = new T;
+		result->writable().resize( m_size );
+		return result;
+	}
+
+	private :
+
+		size_t m_size;
+};
+
+// Resamples one channel over a tile, using the positions and weights
+// computed by the Tile.
+struct WarpOp::ResampleTile
+{
+	typedef void ReturnType;
+
+	ResampleTile( WarpOp::FilterType filter, const tbb::blocked_range2d<int> &range, const Imath::Box2i &outputDataWindow, const Imath::Box2i &inputDataWindow, const std::vector<Imath::V2i> &origins, const std::vector<float> &weights )
+		:	input( 0 ), m_filter( filter ), m_range( range ), m_outputDataWindow( outputDataWindow ), m_inputDataWindow( inputDataWindow ), m_origins( origins ), m_weights( weights )
 	{
-		x = ( x < 0 ? 0 : ( x >= width ? width - 1 : x ));
-		y = ( y < 0 ? 0 : ( y >= height ? height - 1 : y ));
-		return buffer[ x + y * width ];
 	}
 
 	template<typename T>
 	ReturnType operator()( T * data )
 	{
-		typedef typename T::ValueType Container;
-		typedef typename Container::value_type V;
-		typedef typename Container::iterator It;
-		typename T::Ptr inData = data->copy();
-		const Container &inBuffer = inData->readable();
-		unsigned int outputWidth = m_outputDataWindow.size().x + 1;
-		unsigned int inputWidth = m_inputDataWindow.size().x + 1;
-		unsigned int inputHeight = m_inputDataWindow.size().y + 1;
-		Container &outBuffer = data->writable();
-		outBuffer.resize( outputWidth * (m_outputDataWindow.size().y + 1) );
-		int x1, x2, y1, y2;
-		float ratioX, ratioY;
-		unsigned pixelIndex=0;
-		double r1, r2, r;
-
-		switch( m_filter )
+		typedef typename T::ValueType::value_type V;
+
+		const std::vector<V> &inBuffer = static_cast<const T *>( input )->readable();
+		std::vector<V> &outBuffer = data->writable();
+
+		const int inputWidth = m_inputDataWindow.size().x + 1;
+		const int inputHeight = m_inputDataWindow.size().y + 1;
+		const int outputWidth = m_outputDataWindow.size().x + 1;
+		const int width = filterWidth( m_filter );
+
+		size_t i = 0;
+		for( int y = m_range.rows().begin(); y != m_range.rows().end(); ++y )
 		{
-		case WarpOp::None:
-			for( int y=m_outputDataWindow.min.y; y<=m_outputDataWindow.max.y; y++ )
+			size_t pixelIndex = ( y - m_outputDataWindow.min.y ) * outputWidth + m_range.cols().begin() - m_outputDataWindow.min.x;
+			for( int x = m_range.cols().begin(); x != m_range.cols().end(); ++x, ++i, ++pixelIndex )
 			{
-				for( int x=m_outputDataWindow.min.x; x<=m_outputDataWindow.max.x; x++, pixelIndex++ )
+				const Imath::V2i &origin = m_origins[i];
+				const float *weightsX = &m_weights[i*width*2];
+				const float *weightsY = weightsX + width;
+
+				switch( m_filter )
 				{
-					Imath::V2f inPos = m_warpOp->warp( Imath::V2f( x, y ) );
-					x1 = int(inPos.x) - m_inputDataWindow.min.x;
-					y1 = int(inPos.y) - m_inputDataWindow.min.y;
-					outBuffer[pixelIndex] = clampXY<V>( inBuffer, x1, y1, inputWidth, inputHeight);
+					case WarpOp::None :
+						outBuffer[pixelIndex] = inBuffer[clampIndex( origin.x, inputWidth ) + clampIndex( origin.y, inputHeight ) * inputWidth];
+						break;
+
+					case WarpOp::Bilinear :
+					{
+						const int x1 = clampIndex( origin.x, inputWidth );
+						const int x2 = clampIndex( origin.x + 1, inputWidth );
+						const int y1 = clampIndex( origin.y, inputHeight ) * inputWidth;
+						const int y2 = clampIndex( origin.y + 1, inputHeight ) * inputWidth;
+						double r1, r2, r;
+						LinearInterpolator<double>()( (double)inBuffer[x1+y1], (double)inBuffer[x2+y1], weightsX[1], r1 );
+						LinearInterpolator<double>()( (double)inBuffer[x1+y2], (double)inBuffer[x2+y2], weightsX[1], r2 );
+						LinearInterpolator<double>()( r1, r2, weightsY[1], r );
+						outBuffer[pixelIndex] = (V)r;
+						break;
+					}
+
+					default :
+					{
+						// separable evaluation - filter each row in x, then combine the rows in y
+						double r = 0;
+						for( int j = 0; j < width; ++j )
+						{
+							const V *row = &inBuffer[clampIndex( origin.y + j, inputHeight ) * inputWidth];
+							double rowSum = 0;
+							for( int k = 0; k < width; ++k )
+							{
+								rowSum += weightsX[k] * (double)row[clampIndex( origin.x + k, inputWidth )];
+							}
+							r += weightsY[j] * rowSum;
+						}
+						outBuffer[pixelIndex] = filteredValue<V>( r );
+					}
 				}
 			}
-			break;
+		}
+	}
 
-		case WarpOp::Bilinear:
-			for( int y=m_outputDataWindow.min.y; y<=m_outputDataWindow.max.y; y++ )
+	const Data *input;
+
+	private :
+
+		WarpOp::FilterType m_filter;
+		const tbb::blocked_range2d<int> &m_range;
+		const Imath::Box2i &m_outputDataWindow;
+		const Imath::Box2i &m_inputDataWindow;
+		const std::vector<Imath::V2i> &m_origins;
+		const std::vector<float> &m_weights;
+};
+
+// Computes the warped positions and filter weights for a tile of the
+// output, and then resamples all the channels using them.
+class WarpOp::Tile
+{
+
+	public :
+
+		Tile( const WarpOp *warpOp, WarpOp::FilterType filter, const Imath::Box2i &outputDataWindow, const Imath::Box2i &inputDataWindow, const std::vector<Channel> &channels )
+			:	m_warpOp( warpOp ), m_filter( filter ), m_outputDataWindow( outputDataWindow ), m_inputDataWindow( inputDataWindow ), m_channels( channels )
+		{
+		}
+
+		void operator()( const tbb::blocked_range2d<int> &range ) const
+		{
+			const int width = filterWidth( m_filter );
+			const size_t numPixels = range.rows().size() * range.cols().size();
+
+			std::vector<Imath::V2i> origins( numPixels );
+			std::vector<float> weights( numPixels * width * 2 );
+
+			size_t i = 0;
+			for( int y = range.rows().begin(); y != range.rows().end(); ++y )
 			{
-				for( int x=m_outputDataWindow.min.x; x<=m_outputDataWindow.max.x; x++, pixelIndex++ )
+				for( int x = range.cols().begin(); x != range.cols().end(); ++x, ++i )
 				{
-					computePixelCoordinates( x, y, x1, y1, x2, y2, ratioX, ratioY );
-					LinearInterpolator<double>()( (double)clampXY<V>( inBuffer, x1, y1, inputWidth, inputHeight ),
-												  (double)clampXY<V>( inBuffer, x2, y1, inputWidth, inputHeight ), ratioX, r1 );
-					LinearInterpolator<double>()( (double)clampXY<V>( inBuffer, x1, y2, inputWidth, inputHeight ),
-												  (double)clampXY<V>( inBuffer, x2, y2, inputWidth, inputHeight ), ratioX, r2 );
-					LinearInterpolator<double>()( r1, r2, ratioY, r );
-					outBuffer[pixelIndex] = (V)r;
+					const Imath::V2f p = m_warpOp->warp( Imath::V2f( x, y ) );
+					float *pixelWeights = &weights[i*width*2];
+					filterWeights( m_filter, p.x, origins[i].x, pixelWeights );
+					filterWeights( m_filter, p.y, origins[i].y, pixelWeights + width );
+					origins[i] -= m_inputDataWindow.min;
 				}
 			}
-			break;
 
-		default:
-			throw Exception("Invalid filter type!");
+			ResampleTile resample( m_filter, range, m_outputDataWindow, m_inputDataWindow, origins, weights );
+			for( std::vector<Channel>::const_iterator it = m_channels.begin(); it != m_channels.end(); ++it )
+			{
+				resample.input = it->input.get();
+				despatchTypedData<ResampleTile, TypeTraits::IsNumericVectorTypedData>( it->output, resample );
+			}
 		}
-	}
 
 	private :
-		WarpOp * m_warpOp;
+
+		const WarpOp *m_warpOp;
 		WarpOp::FilterType m_filter;
-		Imath::Box2i m_outputDataWindow;
-		Imath::Box2i m_inputDataWindow;
+		const Imath::Box2i &m_outputDataWindow;
+		const Imath::Box2i &m_inputDataWindow;
+		const std::vector<Channel> &m_channels;
+
 };
 
 void WarpOp::modifyTypedPrimitive( ImagePrimitive * image, const CompoundObject * operands )
@@ -196,7 +372,8 @@ void WarpOp::modifyTypedPrimitive( ImagePrimitive * image, const CompoundObject
 	begin( operands );
 	Imath::Box2i newDataWindow = warpedDataWindow( originalDataWindow );
 	std::string error;
-	Warp w( this, (FilterType)m_filterParameter->getNumericValue(), newDataWindow, originalDataWindow );
+	AllocateChannel allocate( ( newDataWindow.size().x + 1 ) * ( newDataWindow.size().y + 1 ) );
+	std::vector<Channel> channels;
 	for( PrimitiveVariableMap::iterator it = image->variables.begin(); it != image->variables.end(); it++ )
 	{
 		if( it->second.interpolation!=PrimitiveVariable::Vertex &&
@@ -210,8 +387,20 @@ void WarpOp::modifyTypedPrimitive( ImagePrimitive * image, const CompoundObject
 		{
 			throw Exception( error );
 		}
-		despatchTypedData<Warp, TypeTraits::IsNumericVectorTypedData>( it->second.data, w );
+
+		Channel channel;
+		channel.input = it->second.data;
+		channel.output = despatchTypedData<AllocateChannel, TypeTraits::IsNumericVectorTypedData>( it->second.data, allocate );
+		it->second.data = channel.output;
+		channels.push_back( channel );
 	}
+
+	Tile tile( this, (FilterType)m_filterParameter->getNumericValue(), newDataWindow, originalDataWindow, channels );
+	tbb::parallel_for(
+		tbb::blocked_range2d<int>( newDataWindow.min.y, newDataWindow.max.y + 1, g_tileSize, newDataWindow.min.x, newDataWindow.max.x + 1, g_tileSize ),
+		tile
+	);
+
 	end();
 	image->setDataWindow( newDataWindow );
 }
@@ -36,6 +36,7 @@
 
 #include "IECore/ColorTransformOp.h"
 #include "IECore/CompoundObject.h"
+#include "IECore/Primitive.h"
 #include "IECorePython/RunTimeTypedBinding.h"
 #include "IECorePython/Wrapper.h"
 #include "IECorePython/ScopedGILLock.h"
@@ -79,6 +80,13 @@ class ColorTransformOpWrap : public ColorTransformOp, public Wrapper<ColorTransf
 			}
 		};
 
+		virtual bool isTransformThreadSafe() const
+		{
+			// the python transform() can't be called from other threads while the
+			// thread calling operate() holds the GIL.
+			return false;
+		}
+
 		virtual void end()
 		{
 			ScopedGILLock gilLock;
@@ -92,12 +100,23 @@ class ColorTransformOpWrap : public ColorTransformOp, public Wrapper<ColorTransf
 };
 IE_CORE_DECLAREPTR( ColorTransformOpWrap );
 
+static void transformChain( const list &ops, Primitive *primitive )
+{
+	std::vector<ColorTransformOp *> o;
+	for( long i = 0; i < len( ops ); i++ )
+	{
+		o.push_back( extract<ColorTransformOp *>( ops[i] ) );
+	}
+	ColorTransformOp::transformChain( o, primitive );
+}
+
 void bindColorTransformOp()
 {
 	using boost::python::arg;
 
 	RunTimeTypedClass<ColorTransformOp, ColorTransformOpWrapPtr>( "ColorTransformOp" )
 		.def( init<const std::string &>( ( arg( "description" ) ) ) )
+		.def( "transformChain", &transformChain ).staticmethod( "transformChain" )
 	;
 
 }
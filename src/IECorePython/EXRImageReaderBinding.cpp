@@ -52,6 +52,9 @@ void bindEXRImageReader()
 		.def( init<>() )
 		.def( init<const std::string &>() )
 		.def( "canRead", &EXRImageReader::canRead ).staticmethod( "canRead" )
+		.def( "numMipLevels", &EXRImageReader::numMipLevels )
+		.def( "setNumThreads", &EXRImageReader::setNumThreads ).staticmethod( "setNumThreads" )
+		.def( "getNumThreads", &EXRImageReader::getNumThreads ).staticmethod( "getNumThreads" )
 	;
 
 }
@@ -37,6 +37,7 @@
 #include "IECore/Exception.h"
 
 #include "IECore/ImplicitSurfaceFunction.h"
+#include "IECore/VectorTypedData.h"
 #include "IECorePython/Wrapper.h"
 #include "IECorePython/RefCountedBinding.h"
 #include "IECorePython/ScopedGILLock.h"
@@ -82,12 +83,29 @@ class ImplicitWrap :
 
 };
 
+template<typename T>
+static typename TypedData<std::vector<typename T::Value> >::Ptr getValues( T &f, const TypedData<std::vector<typename T::Point> > *points )
+{
+	typedef TypedData<std::vector<typename T::Value> > ValueVectorData;
+
+	const std::vector<typename T::Point> &p = points->readable();
+	typename ValueVectorData::Ptr result = new ValueVectorData;
+	result->writable().resize( p.size() );
+	if( p.size() )
+	{
+		f.getValues( &p[0], p.size(), &result->writable()[0] );
+	}
+
+	return result;
+}
+
 template<typename T>
 void bindImplicit( const char *name )
 {
 	RefCountedClass<T, RefCounted, typename ImplicitWrap<T>::Ptr >( name )
 		.def( init<> () )
 		.def( "getValue", pure_virtual( &T::getValue ) )
+		.def( "getValues", &getValues<T> )
 	;
 }
 
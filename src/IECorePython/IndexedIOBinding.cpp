@@ -407,7 +407,24 @@ void bindIndexedIOBase()
 
 void bindStreamIndexedIO()
 {
-	IECorePython::RunTimeTypedClass<StreamIndexedIO>();
+	IECorePython::RunTimeTypedClass<StreamIndexedIO> streamIndexedIOClass;
+
+	{
+		scope s( streamIndexedIOClass );
+
+		enum_< StreamIndexedIO::Compression >("Compression")
+			.value("NoCompression", StreamIndexedIO::NoCompression)
+			.value("Gzip", StreamIndexedIO::Gzip)
+			.value("FastZlib", StreamIndexedIO::FastZlib)
+		;
+	}
+
+	streamIndexedIOClass
+		.def( "setIndexCompression", &StreamIndexedIO::setIndexCompression )
+		.def( "getIndexCompression", &StreamIndexedIO::getIndexCompression )
+		.def( "setDataCompression", &StreamIndexedIO::setDataCompression, ( arg( "compression" ), arg( "minSize" ) = 4096 ) )
+		.def( "getDataCompression", &StreamIndexedIO::getDataCompression )
+	;
 }
 
 void bindFileIndexedIO()
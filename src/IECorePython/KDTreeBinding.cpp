@@ -46,6 +46,7 @@
 #include "IECore/VectorTypedData.h"
 
 #include "IECorePython/KDTreeBinding.h"
+#include "IECorePython/ScopedGILRelease.h"
 
 using namespace boost::python;
 using namespace IECore;
@@ -162,6 +163,57 @@ struct KDTreeWrapper
 		return indices;
 	}
 
+	IntVectorDataPtr batchNearestNeighbour( const PointData *points )
+	{
+		assert(m_tree);
+
+		std::vector<typename T::Iterator> nearestNeighbours;
+		{
+			ScopedGILRelease gilRelease;
+			m_tree->batchNearestNeighbour( points->readable(), nearestNeighbours );
+		}
+
+		IntVectorDataPtr indices = new IntVectorData();
+		std::vector<int> &writableIndices = indices->writable();
+		writableIndices.reserve( nearestNeighbours.size() );
+		for( typename std::vector<typename T::Iterator>::const_iterator it = nearestNeighbours.begin(); it != nearestNeighbours.end(); ++it )
+		{
+			writableIndices.push_back( std::distance( m_points->readable().begin(), *it ) );
+		}
+
+		return indices;
+	}
+
+	/// Returns the indices of the neighbours for all points, with numNeighbours
+	/// consecutive entries per point. Unused entries are set to -1.
+	IntVectorDataPtr batchNearestNNeighbours( const PointData *points, unsigned int numNeighbours )
+	{
+		assert(m_tree);
+
+		std::vector<typename T::Neighbour> nearNeighbours;
+		{
+			ScopedGILRelease gilRelease;
+			m_tree->batchNearestNNeighbours( points->readable(), numNeighbours, nearNeighbours );
+		}
+
+		IntVectorDataPtr indices = new IntVectorData();
+		std::vector<int> &writableIndices = indices->writable();
+		writableIndices.reserve( nearNeighbours.size() );
+		for( typename std::vector<typename T::Neighbour>::const_iterator it = nearNeighbours.begin(); it != nearNeighbours.end(); ++it )
+		{
+			if( it->point == m_points->readable().end() )
+			{
+				writableIndices.push_back( -1 );
+			}
+			else
+			{
+				writableIndices.push_back( std::distance( m_points->readable().begin(), it->point ) );
+			}
+		}
+
+		return indices;
+	}
+
 };
 
 
@@ -174,6 +226,8 @@ void bindKDTree(const char *bindName)
 		.def("nearestNeighbours", &KDTreeWrapper<T>::nearestNeighbours )
 		.def("nearestNNeighbours", &KDTreeWrapper<T>::nearestNNeighbours )
 		.def("enclosedPoints", &KDTreeWrapper<T>::enclosedPoints )
+		.def("batchNearestNeighbour", &KDTreeWrapper<T>::batchNearestNeighbour )
+		.def("batchNearestNNeighbours", &KDTreeWrapper<T>::batchNearestNNeighbours )
 		;
 }
 
@@ -35,9 +35,12 @@
 #include "boost/python.hpp"
 
 #include "IECore/MeshPrimitiveEvaluator.h"
+#include "IECore/VectorTypedData.h"
+#include "IECore/CompoundData.h"
 #include "IECorePython/MeshPrimitiveEvaluatorBinding.h"
 #include "IECorePython/RunTimeTypedBinding.h"
 #include "IECorePython/RefCountedBinding.h"
+#include "IECorePython/ScopedGILRelease.h"
 
 using namespace IECore;
 using namespace boost::python;
@@ -52,17 +55,81 @@ static bool barycentricPosition( const MeshPrimitiveEvaluator &e, unsigned int t
 	return e.barycentricPosition( t, b, r );
 }
 
+static CompoundDataPtr batchResultsToData( MeshPrimitiveEvaluator::BatchResults &results )
+{
+	CompoundDataPtr data = new CompoundData;
+	IntVectorDataPtr triangleIndices = new IntVectorData;
+	triangleIndices->writable().swap( results.triangleIndices );
+	data->writable()["triangleIndex"] = triangleIndices;
+	V3fVectorDataPtr barycentricCoordinates = new V3fVectorData;
+	barycentricCoordinates->writable().swap( results.barycentricCoordinates );
+	data->writable()["barycentricCoordinates"] = barycentricCoordinates;
+	V3fVectorDataPtr points = new V3fVectorData;
+	points->writable().swap( results.points );
+	data->writable()["P"] = points;
+	V3fVectorDataPtr normals = new V3fVectorData;
+	normals->writable().swap( results.normals );
+	data->writable()["N"] = normals;
+	return data;
+}
+
+static CompoundDataPtr batchClosestPoint( const MeshPrimitiveEvaluator &e, ConstV3fVectorDataPtr points )
+{
+	MeshPrimitiveEvaluator::BatchResults results;
+	{
+		ScopedGILRelease gilRelease;
+		e.batchClosestPoint( points->readable(), results );
+	}
+	return batchResultsToData( results );
+}
+
+static CompoundDataPtr batchIntersectionPoint( const MeshPrimitiveEvaluator &e, ConstV3fVectorDataPtr origins, ConstV3fVectorDataPtr directions, float maxDistance )
+{
+	MeshPrimitiveEvaluator::BatchResults results;
+	{
+		ScopedGILRelease gilRelease;
+		e.batchIntersectionPoint( origins->readable(), directions->readable(), results, maxDistance );
+	}
+	return batchResultsToData( results );
+}
+
+static CompoundDataPtr batchPointAtUV( const MeshPrimitiveEvaluator &e, ConstV2fVectorDataPtr uvs )
+{
+	MeshPrimitiveEvaluator::BatchResults results;
+	{
+		ScopedGILRelease gilRelease;
+		e.batchPointAtUV( uvs->readable(), results );
+	}
+	return batchResultsToData( results );
+}
+
+static void setPositions( MeshPrimitiveEvaluator &e, ConstV3fVectorDataPtr positions )
+{
+	ScopedGILRelease gilRelease;
+	e.setPositions( positions );
+}
+
 void bindMeshPrimitiveEvaluator()
 {
 	object m = RunTimeTypedClass<MeshPrimitiveEvaluator>()
-		.def( init< MeshPrimitivePtr > () )
+		.def( init< MeshPrimitivePtr, optional<MeshPrimitiveEvaluator::TreeType> > () )
+		.def( "treeType", &MeshPrimitiveEvaluator::treeType )
 		.def( "barycentricPosition", &barycentricPosition )
 		.def( "uvBound", &MeshPrimitiveEvaluator::uvBound )	
+		.def( "batchClosestPoint", &batchClosestPoint )
+		.def( "batchIntersectionPoint", &batchIntersectionPoint, ( arg( "origins" ), arg( "directions" ), arg( "maxDistance" ) = Imath::limits<float>::max() ) )
+		.def( "batchPointAtUV", &batchPointAtUV )
+		.def( "setPositions", &setPositions )
 	;
 
 	{
 		scope ms( m );
 
+		enum_<MeshPrimitiveEvaluator::TreeType>( "TreeType" )
+			.value( "KDTree", MeshPrimitiveEvaluator::KDTreeType )
+			.value( "BVH", MeshPrimitiveEvaluator::BVHType )
+		;
+
 		RefCountedClass<MeshPrimitiveEvaluator::Result, PrimitiveEvaluator::Result>( "Result" )
 			.def( "triangleIndex", &MeshPrimitiveEvaluator::Result::triangleIndex )
 			.def( "barycentricCoordinates", &MeshPrimitiveEvaluator::Result::barycentricCoordinates, return_value_policy<copy_const_reference>() )
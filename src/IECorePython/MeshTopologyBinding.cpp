@@ -0,0 +1,115 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "boost/python.hpp"
+#include "boost/python/make_constructor.hpp"
+
+#include "IECore/MeshTopology.h"
+#include "IECore/MeshPrimitive.h"
+
+#include "IECorePython/MeshTopologyBinding.h"
+#include "IECorePython/RefCountedBinding.h"
+#include "IECorePython/ScopedGILRelease.h"
+
+using namespace boost::python;
+using namespace IECore;
+
+namespace IECorePython
+{
+
+static MeshTopologyPtr construct( ConstIntVectorDataPtr verticesPerFace, ConstIntVectorDataPtr vertexIds, size_t numVertices, bool parallel )
+{
+	ScopedGILRelease gilRelease;
+	return new MeshTopology( verticesPerFace.get(), vertexIds.get(), numVertices, parallel );
+}
+
+static MeshTopologyPtr getFromData( ConstIntVectorDataPtr verticesPerFace, ConstIntVectorDataPtr vertexIds, size_t numVertices )
+{
+	ScopedGILRelease gilRelease;
+	return constPointerCast<MeshTopology>( MeshTopology::get( verticesPerFace.get(), vertexIds.get(), numVertices ) );
+}
+
+static MeshTopologyPtr getFromMesh( ConstMeshPrimitivePtr mesh )
+{
+	ScopedGILRelease gilRelease;
+	return constPointerCast<MeshTopology>( MeshTopology::get( mesh.get() ) );
+}
+
+template<const std::vector<int> &(MeshTopology::*F)() const>
+static IntVectorDataPtr table( const MeshTopology &topology )
+{
+	return new IntVectorData( (topology.*F)() );
+}
+
+static V2iVectorDataPtr edges( const MeshTopology &topology )
+{
+	ScopedGILRelease gilRelease;
+	return new V2iVectorData( topology.edges() );
+}
+
+void bindMeshTopology()
+{
+	RefCountedClass<MeshTopology, RefCounted>( "MeshTopology" )
+		.def( "__init__", make_constructor( &construct, default_call_policies(), ( arg_( "verticesPerFace" ), arg_( "vertexIds" ), arg_( "numVertices" ), arg_( "parallel" ) = true ) ) )
+		.def( "numFaces", &MeshTopology::numFaces )
+		.def( "numVertices", &MeshTopology::numVertices )
+		.def( "numFaceVertices", &MeshTopology::numFaceVertices )
+		.def( "faceOffsets", &table<&MeshTopology::faceOffsets> )
+		.def( "faceVertexFaces", &table<&MeshTopology::faceVertexFaces> )
+		.def( "vertexFaceVertexOffsets", &table<&MeshTopology::vertexFaceVertexOffsets> )
+		.def( "vertexFaceVertices", &table<&MeshTopology::vertexFaceVertices> )
+		.def( "nextFaceVertex", &MeshTopology::nextFaceVertex )
+		.def( "previousFaceVertex", &MeshTopology::previousFaceVertex )
+		.def( "numEdges", &MeshTopology::numEdges )
+		.def( "edges", &edges )
+		.def( "vertexEdgeOffsets", &table<&MeshTopology::vertexEdgeOffsets> )
+		.def( "faceVertexEdges", &table<&MeshTopology::faceVertexEdges> )
+		.def( "edgeFaceVertexOffsets", &table<&MeshTopology::edgeFaceVertexOffsets> )
+		.def( "edgeFaceVertices", &table<&MeshTopology::edgeFaceVertices> )
+		.def( "edgeIndex", &MeshTopology::edgeIndex )
+		.def( "numTriangles", &MeshTopology::numTriangles )
+		.def( "faceTriangleOffsets", &table<&MeshTopology::faceTriangleOffsets> )
+		.def( "triangleFaces", &table<&MeshTopology::triangleFaces> )
+		.def( "triangleFaceVertices", &table<&MeshTopology::triangleFaceVertices> )
+		.def( "memoryUsage", &MeshTopology::memoryUsage )
+		.def( "get", &getFromData, ( arg_( "verticesPerFace" ), arg_( "vertexIds" ), arg_( "numVertices" ) ) )
+		.def( "get", &getFromMesh, ( arg_( "mesh" ) ) ).staticmethod( "get" )
+		.def( "setCacheMaxMemory", &MeshTopology::setCacheMaxMemory ).staticmethod( "setCacheMaxMemory" )
+		.def( "getCacheMaxMemory", &MeshTopology::getCacheMaxMemory ).staticmethod( "getCacheMaxMemory" )
+		.def( "cacheMemoryUsage", &MeshTopology::cacheMemoryUsage ).staticmethod( "cacheMemoryUsage" )
+		.def( "clearCache", &MeshTopology::clearCache ).staticmethod( "clearCache" )
+	;
+}
+
+} // namespace IECorePython
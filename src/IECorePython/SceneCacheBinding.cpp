@@ -38,6 +38,7 @@
 
 #include "IECore/SceneCache.h"
 #include "IECorePython/RunTimeTypedBinding.h"
+#include "IECorePython/IECoreBinding.h"
 
 using namespace boost::python;
 using namespace IECore;
@@ -55,11 +56,62 @@ static SceneCachePtr constructor2( IECore::IndexedIOPtr indexedIO )
 	return new SceneCache( indexedIO );
 }
 
+static void listToPaths( list l, std::vector<SceneInterface::Path> &paths )
+{
+	int numPaths = IECorePython::len( l );
+	paths.resize( numPaths );
+	for ( int i = 0; i < numPaths; i++ )
+	{
+		list path = extract< list >( l[i] );
+		int pathLen = IECorePython::len( path );
+		for ( int j = 0; j < pathLen; j++ )
+		{
+			paths[i].push_back( extract< std::string >( path[j] )() );
+		}
+	}
+}
+
+static list readBounds( const SceneCache &m, list pathList, double time )
+{
+	std::vector<SceneInterface::Path> paths;
+	listToPaths( pathList, paths );
+	std::vector<Imath::Box3d> bounds;
+	m.readBounds( paths, time, bounds );
+	list result;
+	for ( std::vector<Imath::Box3d>::const_iterator it = bounds.begin(); it != bounds.end(); ++it )
+	{
+		result.append( *it );
+	}
+	return result;
+}
+
+static list readTransformsAsMatrix( const SceneCache &m, list pathList, double time )
+{
+	std::vector<SceneInterface::Path> paths;
+	listToPaths( pathList, paths );
+	std::vector<Imath::M44d> transforms;
+	m.readTransformsAsMatrix( paths, time, transforms );
+	list result;
+	for ( std::vector<Imath::M44d>::const_iterator it = transforms.begin(); it != transforms.end(); ++it )
+	{
+		result.append( *it );
+	}
+	return result;
+}
+
 void bindSceneCache()
 {
 	RunTimeTypedClass<SceneCache>()
 		.def( "__init__", make_constructor( &constructor ), "Opens a scene file for read or write." )
 		.def( "__init__", make_constructor( &constructor2 ), "Opens a scene from a previously opened file handle." )
+		.def( "readBounds", &readBounds )
+		.def( "readTransformsAsMatrix", &readTransformsAsMatrix )
+		.def( "setObjectCacheMaxMemory", &SceneCache::setObjectCacheMaxMemory ).staticmethod( "setObjectCacheMaxMemory" )
+		.def( "getObjectCacheMaxMemory", &SceneCache::getObjectCacheMaxMemory ).staticmethod( "getObjectCacheMaxMemory" )
+		.def( "objectCacheMemoryUsage", &SceneCache::objectCacheMemoryUsage ).staticmethod( "objectCacheMemoryUsage" )
+		.def( "clearObjectCache", &SceneCache::clearObjectCache ).staticmethod( "clearObjectCache" )
+		.def( "objectCacheHits", &SceneCache::objectCacheHits ).staticmethod( "objectCacheHits" )
+		.def( "objectCacheMisses", &SceneCache::objectCacheMisses ).staticmethod( "objectCacheMisses" )
 	;
 }
 
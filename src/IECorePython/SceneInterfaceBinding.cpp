@@ -171,6 +171,23 @@ void writeTags( SceneInterface &m, list tagList )
 	m.writeTags(v);	
 }
 
+void prefetch( const SceneInterface &m, list pathList, list timeList, unsigned entries )
+{
+	int numPaths = IECorePython::len( pathList );
+	std::vector<SceneInterface::Path> paths( numPaths );
+	for ( int i = 0; i < numPaths; i++ )
+	{
+		listToNameList( extract< list >( pathList[i] )(), paths[i] );
+	}
+	int numTimes = IECorePython::len( timeList );
+	std::vector<double> times( numTimes );
+	for ( int i = 0; i < numTimes; i++ )
+	{
+		times[i] = extract< double >( timeList[i] )();
+	}
+	m.prefetch( paths, times, entries );
+}
+
 void bindSceneInterface()
 {
 	SceneInterfacePtr (SceneInterface::*nonConstChild)(const SceneInterface::Name &, SceneInterface::MissingBehaviour) = &SceneInterface::child;
@@ -188,6 +205,15 @@ void bindSceneInterface()
 			.value("CreateIfMissing", SceneInterface::CreateIfMissing)
 			.export_values()
 		;
+
+		enum_< SceneInterface::PrefetchEntries > ("PrefetchEntries")
+			.value("PrefetchBound", SceneInterface::PrefetchBound)
+			.value("PrefetchTransform", SceneInterface::PrefetchTransform)
+			.value("PrefetchAttributes", SceneInterface::PrefetchAttributes)
+			.value("PrefetchObject", SceneInterface::PrefetchObject)
+			.value("PrefetchAll", SceneInterface::PrefetchAll)
+			.export_values()
+		;
 	}
 
 	// now we've defined the nested types, we're able to define the methods for
@@ -219,6 +245,7 @@ void bindSceneInterface()
 		.def( "child", nonConstChild, ( arg( "name" ), arg( "missingBehaviour" ) = SceneInterface::ThrowIfMissing ) )
 		.def( "createChild", &SceneInterface::createChild )
 		.def( "scene", &nonConstScene, ( arg( "path" ), arg( "missingBehaviour" ) = SceneInterface::ThrowIfMissing ) )
+		.def( "prefetch", prefetch, ( arg( "paths" ), arg( "times" ) = list(), arg( "entries" ) = (unsigned)SceneInterface::PrefetchAll ) )
 
 		.def( "pathToString", pathToString ).staticmethod("pathToString")
 		.def( "stringToPath", stringToPath ).staticmethod("stringToPath")
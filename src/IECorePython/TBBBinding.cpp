@@ -0,0 +1,79 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2014, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "boost/python.hpp"
+
+#include "tbb/task_scheduler_init.h"
+
+#include "IECorePython/TBBBinding.h"
+
+using namespace boost::python;
+
+namespace IECorePython
+{
+
+static object enterContext( object init )
+{
+	return init;
+}
+
+static bool exitContext( tbb::task_scheduler_init &init, object excType, object excValue, object traceback )
+{
+	if( init.is_active() )
+	{
+		init.terminate();
+	}
+	return false; // don't suppress exceptions
+}
+
+void bindTBB()
+{
+
+	class_<tbb::task_scheduler_init, boost::noncopyable> initClass( "tbb_task_scheduler_init", no_init );
+	initClass
+		.def( init<int>( ( arg( "max_threads" ) = int( tbb::task_scheduler_init::automatic ) ) ) )
+		.def( "initialize", (void (tbb::task_scheduler_init::*)( int ))&tbb::task_scheduler_init::initialize, ( arg( "max_threads" ) = int( tbb::task_scheduler_init::automatic ) ) )
+		.def( "terminate", &tbb::task_scheduler_init::terminate )
+		.def( "is_active", &tbb::task_scheduler_init::is_active )
+		.def( "default_num_threads", &tbb::task_scheduler_init::default_num_threads ).staticmethod( "default_num_threads" )
+		.def( "__enter__", &enterContext )
+		.def( "__exit__", &exitContext )
+	;
+
+	initClass.attr( "automatic" ) = int( tbb::task_scheduler_init::automatic );
+	initClass.attr( "deferred" ) = int( tbb::task_scheduler_init::deferred );
+
+}
+
+} // namespace IECorePython
@@ -321,6 +321,8 @@
 #include "IECorePython/LensModelBinding.h"
 #include "IECorePython/StandardRadialLensModelBinding.h"
 #include "IECorePython/LensDistortOpBinding.h"
+#include "IECorePython/MeshTopologyBinding.h"
+#include "IECorePython/TBBBinding.h"
 #include "IECore/IECore.h"
 
 using namespace IECorePython;
@@ -644,6 +646,8 @@ BOOST_PYTHON_MODULE(_IECore)
 	bindLensModel();
 	bindStandardRadialLensModel();
 	bindLensDistortOp();
+	bindMeshTopology();
+	bindTBB();
 
 	def( "majorVersion", &IECore::majorVersion );
 	def( "minorVersion", &IECore::minorVersion );
@@ -190,6 +190,11 @@ void TruelightColorTransformOp::transform( Imath::Color3f &color ) const
 	}
 }
 
+bool TruelightColorTransformOp::isTransformThreadSafe() const
+{
+	return false;
+}
+
 void TruelightColorTransformOp::maybeWarn() const
 {
 	assert( m_instance );
@@ -269,6 +269,8 @@ from SceneCacheTest import SceneCacheTest
 from LinkedSceneTest import LinkedSceneTest
 from StandardRadialLensModelTest import StandardRadialLensModelTest
 from LensDistortOpTest import LensDistortOpTest
+from MeshTopologyTest import MeshTopologyTest
+from PointRepulsionOpTest import PointRepulsionOpTest
 
 if IECore.withASIO() :
 	from DisplayDriverTest import *
@@ -0,0 +1,223 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include "OpenEXR/ImathRandom.h"
+
+#include "IECore/BoundingVolumeHierarchy.h"
+#include "IECore/BoxOps.h"
+
+#include "BoundingVolumeHierarchyTest.h"
+
+using namespace boost;
+using namespace boost::unit_test;
+using namespace Imath;
+
+namespace IECore
+{
+
+template<typename Bound>
+struct BoundingVolumeHierarchyTest
+{
+
+	typedef std::vector<Bound> BoundVector;
+	typedef BoundingVolumeHierarchy<typename BoundVector::const_iterator> BVH;
+	typedef typename BoxTraits<Bound>::BaseType Vec;
+
+	static Vec randomVec( Rand32 &rand, float size )
+	{
+		Vec result;
+		for( unsigned i = 0; i < VectorTraits<Vec>::dimensions(); i++ )
+		{
+			VectorTraits<Vec>::set( result, i, rand.nextf( -size, size ) );
+		}
+		return result;
+	}
+
+	static BoundVector randomBounds( unsigned numBounds )
+	{
+		Rand32 rand( numBounds );
+		BoundVector result;
+		for( unsigned i = 0; i < numBounds; i++ )
+		{
+			Bound b;
+			Vec center = randomVec( rand, 10 );
+			b.extendBy( center + randomVec( rand, 0.5 ) );
+			b.extendBy( center + randomVec( rand, 0.5 ) );
+			result.push_back( b );
+		}
+		return result;
+	}
+
+	/// Checks that each bound appears in exactly one leaf, and that each
+	/// node's bound contains everything below it.
+	static void checkNode( const BVH &bvh, typename BVH::NodeIndex nodeIndex, std::vector<int> &leafCounts, const BoundVector &bounds )
+	{
+		const typename BVH::Node &node = bvh.node( nodeIndex );
+		if( node.isLeaf() )
+		{
+			for( typename BVH::Iterator *perm = node.permFirst(); perm != node.permLast(); perm++ )
+			{
+				BOOST_CHECK( boxContains( node.bound(), **perm ) );
+				leafCounts[*perm - bounds.begin()]++;
+			}
+		}
+		else
+		{
+			BOOST_CHECK( boxContains( node.bound(), bvh.node( bvh.lowChildIndex( nodeIndex ) ).bound() ) );
+			BOOST_CHECK( boxContains( node.bound(), bvh.node( bvh.highChildIndex( nodeIndex ) ).bound() ) );
+			checkNode( bvh, bvh.lowChildIndex( nodeIndex ), leafCounts, bounds );
+			checkNode( bvh, bvh.highChildIndex( nodeIndex ), leafCounts, bounds );
+		}
+	}
+
+	void testStructure( unsigned numBounds )
+	{
+		BoundVector bounds = randomBounds( numBounds );
+		BVH bvh( bounds.begin(), bounds.end() );
+
+		BOOST_CHECK( bvh.numNodes() <= std::max( 2 * numBounds, 2u ) - 1 );
+
+		std::vector<int> leafCounts( numBounds, 0 );
+		checkNode( bvh, bvh.rootIndex(), leafCounts, bounds );
+		BOOST_CHECK( std::count( leafCounts.begin(), leafCounts.end(), 1 ) == (int)numBounds );
+	}
+
+	void testIntersectingBounds( unsigned numBounds )
+	{
+		BoundVector bounds = randomBounds( numBounds );
+		BVH bvh( bounds.begin(), bounds.end() );
+		checkIntersectingBounds( bvh, bounds );
+	}
+
+	/// Checks intersectingBounds() against a brute force search.
+	static void checkIntersectingBounds( const BVH &bvh, const BoundVector &bounds )
+	{
+		Rand32 rand( 1 );
+		std::vector<typename BoundVector::const_iterator> found;
+		for( unsigned i = 0; i < 100; i++ )
+		{
+			Bound query;
+			query.extendBy( randomVec( rand, 10 ) );
+			query.extendBy( randomVec( rand, 10 ) );
+
+			unsigned numFound = bvh.intersectingBounds( query, found );
+			BOOST_CHECK_EQUAL( numFound, found.size() );
+			std::sort( found.begin(), found.end() );
+
+			unsigned numExpected = 0;
+			for( typename BoundVector::const_iterator it = bounds.begin(); it != bounds.end(); ++it )
+			{
+				if( boxIntersects( *it, query ) )
+				{
+					numExpected++;
+					BOOST_CHECK( std::binary_search( found.begin(), found.end(), it ) );
+				}
+			}
+			BOOST_CHECK_EQUAL( numFound, numExpected );
+		}
+	}
+
+	void testSmall()
+	{
+		testStructure( 0 );
+		testStructure( 1 );
+		testStructure( 10 );
+		testIntersectingBounds( 10 );
+	}
+
+	void testLarge()
+	{
+		// large enough that the build is performed in parallel
+		testStructure( 50000 );
+		testIntersectingBounds( 50000 );
+	}
+
+	void testRefit()
+	{
+		BoundVector bounds = randomBounds( 50000 );
+		BVH bvh( bounds.begin(), bounds.end() );
+
+		// move the bounds in place, so the node bounds are out of date
+		Rand32 rand( 2 );
+		for( typename BoundVector::iterator it = bounds.begin(); it != bounds.end(); ++it )
+		{
+			const Vec offset = randomVec( rand, 1 );
+			*it = Bound( it->min * 1.5 + offset, it->max * 1.5 + offset );
+		}
+
+		bvh.refit();
+
+		std::vector<int> leafCounts( bounds.size(), 0 );
+		checkNode( bvh, bvh.rootIndex(), leafCounts, bounds );
+		BOOST_CHECK( std::count( leafCounts.begin(), leafCounts.end(), 1 ) == (int)bounds.size() );
+		checkIntersectingBounds( bvh, bounds );
+	}
+
+	void testCoincidentBounds()
+	{
+		BoundVector bounds( 1000, Bound( Vec( 0 ), Vec( 1 ) ) );
+		BVH bvh( bounds.begin(), bounds.end() );
+		std::vector<int> leafCounts( bounds.size(), 0 );
+		checkNode( bvh, bvh.rootIndex(), leafCounts, bounds );
+		BOOST_CHECK( std::count( leafCounts.begin(), leafCounts.end(), 1 ) == (int)bounds.size() );
+	}
+
+};
+
+template<typename Bound>
+struct BoundingVolumeHierarchyTestSuite : public boost::unit_test::test_suite
+{
+
+	BoundingVolumeHierarchyTestSuite( const char *name ) : boost::unit_test::test_suite( name )
+	{
+		boost::shared_ptr<BoundingVolumeHierarchyTest<Bound> > instance( new BoundingVolumeHierarchyTest<Bound>() );
+
+		add( BOOST_CLASS_TEST_CASE( &BoundingVolumeHierarchyTest<Bound>::testSmall, instance ) );
+		add( BOOST_CLASS_TEST_CASE( &BoundingVolumeHierarchyTest<Bound>::testLarge, instance ) );
+		add( BOOST_CLASS_TEST_CASE( &BoundingVolumeHierarchyTest<Bound>::testCoincidentBounds, instance ) );
+		add( BOOST_CLASS_TEST_CASE( &BoundingVolumeHierarchyTest<Bound>::testRefit, instance ) );
+	}
+
+};
+
+void addBoundingVolumeHierarchyTest( boost::unit_test::test_suite *test )
+{
+	test->add( new BoundingVolumeHierarchyTestSuite<Imath::Box3f>( "BoundingVolumeHierarchyTestSuiteBox3f" ) );
+	test->add( new BoundingVolumeHierarchyTestSuite<Imath::Box2f>( "BoundingVolumeHierarchyTestSuiteBox2f" ) );
+	test->add( new BoundingVolumeHierarchyTestSuite<Imath::Box3d>( "BoundingVolumeHierarchyTestSuiteBox3d" ) );
+}
+
+} // namespace IECore
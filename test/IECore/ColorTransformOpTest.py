@@ -195,6 +195,72 @@ class TestPythonColorTransformOp( unittest.TestCase ) :
 		self.assertEqual( o.numTransforms, 1 )
 		self.assertEqual( o.numEnds, 1 )
 
+	def testManyElements( self ) :
+
+		# enough elements to be split into several batches
+		n = 2000
+		p = PointsPrimitive( n )
+
+		r = FloatVectorData( range( 0, n ) )
+		g = FloatVectorData( [ x * 2 for x in range( 0, n ) ] )
+		b = FloatVectorData( [ x * 3 for x in range( 0, n ) ] )
+		a = FloatVectorData( [ 0.5 ] * n )
+
+		p["R"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Vertex, r )
+		p["G"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Vertex, g )
+		p["B"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Vertex, b )
+		p["A"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Vertex, a )
+
+		o = AddOp()
+		pp = o( input=p )
+
+		self.assertEqual( o.numBegins, 1 )
+		self.assertEqual( o.numTransforms, n )
+		self.assertEqual( o.numEnds, 1 )
+
+		self.assertEqual( pp["R"].data, FloatVectorData( [ x + 0.5 for x in r ] ) )
+		self.assertEqual( pp["G"].data, FloatVectorData( [ x + 1 for x in g ] ) )
+		self.assertEqual( pp["B"].data, FloatVectorData( [ x + 1.5 for x in b ] ) )
+
+	def testTransformChain( self ) :
+
+		p = PointsPrimitive( 2 )
+
+		cs = Color3fVectorData( [ Color3f( 1, 2, 3 ), Color3f( 10, 11, 12 ) ] )
+		p["Cs"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Vertex, cs )
+		p["A"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Vertex, FloatVectorData( [ 0.5, 0.25 ] ) )
+
+		o1 = AddOp()
+		o2 = AddOp()
+		o2.add = Color3f( 10, 20, 30 )
+
+		expected = o2( input = o1( input = p ) )
+
+		pp = p.copy()
+		ColorTransformOp.transformChain( [ o1, o2 ], pp )
+		self.assertEqual( pp, expected )
+
+		for o in ( o1, o2 ) :
+			self.assertEqual( o.numBegins, 2 )
+			self.assertEqual( o.numTransforms, 4 )
+			self.assertEqual( o.numEnds, 2 )
+
+		# disabled ops should be skipped
+
+		o2["enable"].setTypedValue( False )
+		pp = p.copy()
+		ColorTransformOp.transformChain( [ o1, o2 ], pp )
+		self.assertEqual( pp, o1( input = p ) )
+		self.assertEqual( o2.numBegins, 2 )
+
+		# end() should be called for every op even if one fails
+
+		o2["enable"].setTypedValue( True )
+		o2.raiseException = True
+		self.assertRaises( RuntimeError, ColorTransformOp.transformChain, [ o1, o2 ], p.copy() )
+		self.assertEqual( o1.numBegins, o1.numEnds )
+		self.assertEqual( o2.numBegins, o2.numEnds )
+
 if __name__ == "__main__":
 	unittest.main()
 
@@ -51,7 +51,9 @@
 #include "IECore/LinearToSRGBDataConversion.h"
 #include "IECore/Rec709ToLinearDataConversion.h"
 #include "IECore/LinearToRec709DataConversion.h"
+#include "IECore/PanalogToLinearDataConversion.h"
 #include "IECore/CompoundDataConversion.h"
+#include "IECore/TabulatedDataConversion.h"
 
 using namespace Imath;
 
@@ -107,6 +109,39 @@ struct DataConversionTest
 		}
 	}
 
+	template<typename C>
+	void testTabulatedIntegral()
+	{
+		typedef typename C::FromType F;
+
+		C c;
+		TabulatedDataConversion<C> t( c );
+
+		/// Verify that the table reproduces the conversion for every input
+		for ( int i = std::numeric_limits<F>::min(); i <= std::numeric_limits<F>::max(); i++ )
+		{
+			BOOST_CHECK_EQUAL( t( F( i ) ), c( F( i ) ) );
+		}
+	}
+
+	template<typename C>
+	void testTabulatedHalf()
+	{
+		C c;
+		TabulatedDataConversion<C> t( c );
+
+		/// Verify that the table reproduces the conversion for every input
+		for ( unsigned i = 0; i < 65536; i++ )
+		{
+			half f;
+			f.setBits( i );
+			if ( !f.isNan() )
+			{
+				BOOST_CHECK_EQUAL( t( f ), c( f ) );
+			}
+		}
+	}
+
 	template<typename F, typename T>
 	void testSignedScaled()
 	{
@@ -144,6 +179,7 @@ struct DataConversionTestSuite : public boost::unit_test::test_suite
 		testSRGBLinear( instance );
 		testRec709Linear( instance );
 		testSignedScaled( instance );
+		testTabulated( instance );
 	}
 
 	void testCineonLinear( boost::shared_ptr<DataConversionTest> instance )
@@ -174,6 +210,24 @@ struct DataConversionTestSuite : public boost::unit_test::test_suite
 		add( BOOST_CLASS_TEST_CASE( &DataConversionTest::testRec709Linear<half>, instance ) );
 	}
 
+	void testTabulated( boost::shared_ptr<DataConversionTest> instance )
+	{
+		void (DataConversionTest::*fn)() = 0;
+
+		fn = &DataConversionTest::testTabulatedIntegral< ScaledDataConversion<unsigned char, float> >;
+		add( BOOST_CLASS_TEST_CASE( fn, instance ) );
+		fn = &DataConversionTest::testTabulatedIntegral< ScaledDataConversion<char, double> >;
+		add( BOOST_CLASS_TEST_CASE( fn, instance ) );
+		fn = &DataConversionTest::testTabulatedIntegral< PanalogToLinearDataConversion<unsigned short, float> >;
+		add( BOOST_CLASS_TEST_CASE( fn, instance ) );
+		fn = &DataConversionTest::testTabulatedIntegral< ScaledDataConversion<short, float> >;
+		add( BOOST_CLASS_TEST_CASE( fn, instance ) );
+		fn = &DataConversionTest::testTabulatedHalf< SRGBToLinearDataConversion<half, float> >;
+		add( BOOST_CLASS_TEST_CASE( fn, instance ) );
+		fn = &DataConversionTest::testTabulatedHalf< LinearToRec709DataConversion<half, double> >;
+		add( BOOST_CLASS_TEST_CASE( fn, instance ) );
+	}
+
 	void testSignedScaled( boost::shared_ptr<DataConversionTest> instance )
 	{
 		void (DataConversionTest::*fn)() = 0;
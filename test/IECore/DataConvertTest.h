@@ -43,6 +43,7 @@
 #include "IECore/IECore.h"
 #include "IECore/DataConvert.h"
 #include "IECore/CineonToLinearDataConversion.h"
+#include "IECore/SRGBToLinearDataConversion.h"
 
 namespace IECore
 {
@@ -71,6 +72,36 @@ struct DataConvertTest
 		BOOST_CHECK_CLOSE( (float)to->readable()[512], 0.257f, 0.05f );
 	}
 
+	template<typename F, typename T>
+	void testExpensiveVectorData()
+	{
+		typedef typename F::ValueType::value_type FromValueType;
+		typedef typename T::ValueType::value_type ToValueType;
+		typedef SRGBToLinearDataConversion< FromValueType, ToValueType > Conv;
+
+		/// Sizes either side of the point at which DataConvert switches to a lookup table
+		const size_t sizes[] = { 1000, 70000 };
+		for ( unsigned s = 0; s < 2; s++ )
+		{
+			typename F::Ptr from = new F();
+			from->writable().resize( sizes[s] );
+			for ( size_t i = 0; i < sizes[s]; i++ )
+			{
+				from->writable()[i] = FromValueType( float( i % 2000 ) / 1000.0f - 0.5f );
+			}
+
+			typename T::Ptr to = DataConvert< F, T, Conv >()( from );
+			BOOST_CHECK( to );
+			BOOST_CHECK_EQUAL( to->readable().size(), sizes[s] );
+
+			Conv conv;
+			for ( size_t i = 0; i < sizes[s]; i++ )
+			{
+				BOOST_CHECK_EQUAL( to->readable()[i], conv( from->readable()[i] ) );
+			}
+		}
+	}
+
 	template<typename F, typename T>
 	void testSimpleData()
 	{
@@ -106,6 +137,12 @@ struct DataConvertTestSuite : public boost::unit_test::test_suite
 
 		fn = &DataConvertTest::testVectorData< ShortVectorData, DoubleVectorData >;
 		add( BOOST_CLASS_TEST_CASE( fn, instance ) );
+
+		fn = &DataConvertTest::testExpensiveVectorData< HalfVectorData, FloatVectorData >;
+		add( BOOST_CLASS_TEST_CASE( fn, instance ) );
+
+		fn = &DataConvertTest::testExpensiveVectorData< FloatVectorData, FloatVectorData >;
+		add( BOOST_CLASS_TEST_CASE( fn, instance ) );
 	}
 
 	void testSimpleData( boost::shared_ptr<DataConvertTest> instance )
@@ -101,6 +101,24 @@ class TestGradeColorTransformOp( unittest.TestCase ) :
 		imgNew = grade( input = rampImg )
 		self.assertEqual( rampImg, imgNew )
 
+	def testTransformChain( self ) :
+
+		rampImg = Reader.create( "test/IECore/data/exrFiles/ramp.exr" )()
+
+		grade1 = Grade()
+		grade1['gain'] = Color3f( 1.5, 2, 0.5 )
+		grade1['gamma'] = Color3f( 1.2, 1, 0.5 )
+
+		grade2 = Grade()
+		grade2['offset'] = Color3f( -0.2, 0.1, 0 )
+		grade2['blackClamp'] = True
+		grade2['whiteClamp'] = True
+
+		expected = grade2( input = grade1( input = rampImg ) )
+
+		ColorTransformOp.transformChain( [ grade1, grade2 ], rampImg )
+		self.assertEqual( rampImg, expected )
+
 	def tearDown( self ):
 		if os.path.exists( self.testImgName ):
 			os.remove( self.testImgName )
@@ -74,7 +74,11 @@
 #include "InternedStringTest.h"
 #include "RefCountedThreadingTest.h"
 #include "CurvesPrimitiveEvaluatorThreadingTest.h"
+#include "MeshPrimitiveEvaluatorTest.h"
+#include "BoundingVolumeHierarchyTest.h"
 #include "LRUCacheThreadingTest.h"
+#include "StreamIndexedIOThreadingTest.h"
+#include "SceneCacheThreadingTest.h"
 #include "CompoundDataTest.h"
 #include "CompoundObjectTest.h"
 
@@ -118,7 +122,11 @@ test_suite* init_unit_test_suite( int argc, char* argv[] )
 		addInternedStringTest(test);
 		addRefCountedThreadingTest(test);
 		addCurvesPrimitiveEvaluatorThreadingTest(test);
+		addMeshPrimitiveEvaluatorTest(test);
+		addBoundingVolumeHierarchyTest(test);
 		addLRUCacheThreadingTest(test);
+		addStreamIndexedIOThreadingTest(test);
+		addSceneCacheThreadingTest(test);
 		addCompoundDataTest(test);
 		addCompoundObjectTest(test);
 	}
@@ -55,6 +55,46 @@ class TestImplicitSurfaceFunction( unittest.TestCase ) :
 
 		self.assertEqual( a.getValue( V3f(1,1,1) ), 0.5 )
 
+		values = a.getValues( V3fVectorData( [ V3f( 0, 0, 0 ), V3f( 1, 1, 1 ), V3f( 2, 2, 2 ) ] ) )
+		self.assertEqual( values, FloatVectorData( [ 0.5, 0.5, 0.5 ] ) )
+
+	def testBlobbyGetValues( self ) :
+
+		r = Rand32()
+
+		points = V3fVectorData()
+		radius = DoubleVectorData()
+		strength = DoubleVectorData()
+		for i in range( 0, 200 ) :
+			points.append( r.nextV3f() * 10 )
+			radius.append( 0.5 + r.nextf() )
+			strength.append( 0.5 + r.nextf() )
+
+		f = BlobbyImplicitSurfaceFunctionV3ff( points, radius, strength )
+
+		# a grid, which is evaluated coherently, followed by scattered points
+		samples = V3fVectorData()
+		for z in range( 0, 20 ) :
+			for y in range( 0, 20 ) :
+				for x in range( 0, 20 ) :
+					samples.append( V3f( x, y, z ) * 0.5 - V3f( 0.5, 0.5, 0.5 ) )
+		for i in range( 0, 1000 ) :
+			samples.append( r.nextV3f() * 11 - V3f( 0.5, 0.5, 0.5 ) )
+
+		values = f.getValues( samples )
+		self.assertEqual( len( values ), len( samples ) )
+
+		numNonZero = 0
+		for i in range( 0, len( samples ) ) :
+			expected = f.getValue( samples[i] )
+			self.assertAlmostEqual( values[i], expected, 4 )
+			if expected > 0 :
+				numNonZero += 1
+
+		self.failUnless( numNonZero > 100 )
+
+		self.assertEqual( len( f.getValues( V3fVectorData() ) ), 0 )
+
 
 
 
@@ -38,6 +38,7 @@ import os
 import unittest
 import math
 import random
+import struct
 
 from IECore import *
 
@@ -573,6 +574,126 @@ class TestFileIndexedIO(unittest.TestCase):
 		self.failIf(fv is gv)
 		self.assertEqual(fv, gv)
 
+	def testReadOnlyMatchesAppend(self):
+		"""Test FileIndexedIO reads in Read mode (memory mapped) match Append mode"""
+
+		data = {
+			"floats" : FloatVectorData( [ random.random() for i in range( 0, 10000 ) ] ),
+			"ints" : IntVectorData( range( 0, 10000 ) ),
+			"strings" : StringVectorData( [ "a", "bb", "ccc" ] ),
+			"interned" : InternedStringVectorData( [ "x", "y", "z" ] ),
+			"float" : FloatData( 2.5 ),
+			"string" : StringData( "s" ),
+		}
+
+		f = FileIndexedIO("./test/FileIndexedIO.fio", [], IndexedIO.OpenMode.Write)
+		for i in range( 0, 10 ) :
+			g = f.subdirectory( "sub%d" % i, IndexedIO.MissingBehaviour.CreateIfMissing )
+			for name, value in data.items() :
+				g.write( name, value )
+			g.commit()
+		del g, f
+
+		for mode in ( IndexedIO.OpenMode.Read, IndexedIO.OpenMode.Append ) :
+			f = FileIndexedIO("./test/FileIndexedIO.fio", [], mode)
+			for i in range( 0, 10 ) :
+				g = f.subdirectory( "sub%d" % i )
+				for name, value in data.items() :
+					self.assertEqual( g.read( name ), value )
+			del g, f
+
+	def testCompression(self):
+		"""Test FileIndexedIO index and data compression codecs"""
+
+		data = {
+			"floats" : FloatVectorData( [ random.random() for i in range( 0, 10000 ) ] ),
+			"zeros" : IntVectorData( [ 0 ] * 10000 ),
+			"strings" : StringVectorData( [ "a", "bb", "ccc" ] * 1000 ),
+			"interned" : InternedStringVectorData( [ "x", "y", "z" ] * 1000 ),
+			"float" : FloatData( 2.5 ),
+		}
+
+		codecs = ( StreamIndexedIO.Compression.NoCompression, StreamIndexedIO.Compression.Gzip, StreamIndexedIO.Compression.FastZlib )
+		for indexCodec in codecs :
+			for dataCodec in codecs :
+
+				f = FileIndexedIO("./test/FileIndexedIO.fio", [], IndexedIO.OpenMode.Write)
+				f.setIndexCompression( indexCodec )
+				f.setDataCompression( dataCodec, minSize = 16 )
+				self.assertEqual( f.getIndexCompression(), indexCodec )
+				self.assertEqual( f.getDataCompression(), dataCodec )
+				for i in range( 0, 5 ) :
+					g = f.subdirectory( "sub%d" % i, IndexedIO.MissingBehaviour.CreateIfMissing )
+					for name, value in data.items() :
+						g.write( name, value )
+					g.commit()
+				del g, f
+
+				for mode in ( IndexedIO.OpenMode.Read, IndexedIO.OpenMode.Append ) :
+					f = FileIndexedIO("./test/FileIndexedIO.fio", [], mode)
+					self.assertEqual( f.getIndexCompression(), indexCodec )
+					for i in range( 0, 5 ) :
+						g = f.subdirectory( "sub%d" % i )
+						for name, value in data.items() :
+							self.assertEqual( g.read( name ), value )
+					del g, f
+
+	def testCompressionVersion(self):
+		"""Test FileIndexedIO only writes format version 6 when a non-default codec is used"""
+
+		def fileVersion() :
+			f = open( "./test/FileIndexedIO.fio", "rb" )
+			f.seek( -16, os.SEEK_END )
+			version = struct.unpack( "<q", f.read( 8 ) )[0]
+			f.close()
+			return version
+
+		Compression = StreamIndexedIO.Compression
+		for indexCodec, dataCodec, version in (
+			( Compression.Gzip, Compression.NoCompression, 5 ),
+			( Compression.FastZlib, Compression.NoCompression, 6 ),
+			( Compression.Gzip, Compression.FastZlib, 6 ),
+		) :
+
+			f = FileIndexedIO("./test/FileIndexedIO.fio", [], IndexedIO.OpenMode.Write)
+			f.setIndexCompression( indexCodec )
+			f.setDataCompression( dataCodec, minSize = 16 )
+			g = f.subdirectory( "sub", IndexedIO.MissingBehaviour.CreateIfMissing )
+			g.write( "zeros", IntVectorData( [ 0 ] * 1000 ) )
+			g.commit()
+			del g, f
+
+			self.assertEqual( fileVersion(), version )
+
+			f = FileIndexedIO("./test/FileIndexedIO.fio", [], IndexedIO.OpenMode.Read)
+			self.assertEqual( f.subdirectory( "sub" ).read( "zeros" ), IntVectorData( [ 0 ] * 1000 ) )
+			del f
+
+	def testDataDeduplication(self):
+		"""Test FileIndexedIO stores identical data blocks only once"""
+
+		values = FloatVectorData( [ random.random() for i in range( 0, 100000 ) ] )
+		blockSize = 4 * len( values )
+
+		for dataCodec in ( StreamIndexedIO.Compression.NoCompression, StreamIndexedIO.Compression.FastZlib ) :
+
+			f = FileIndexedIO("./test/FileIndexedIO.fio", [], IndexedIO.OpenMode.Write)
+			f.setDataCompression( dataCodec )
+			for i in range( 0, 50 ) :
+				g = f.subdirectory( "sub%d" % i, IndexedIO.MissingBehaviour.CreateIfMissing )
+				g.write( "values", values )
+				g.write( "id", IntData( i ) )
+			del g, f
+
+			self.failUnless( os.path.getsize( "./test/FileIndexedIO.fio" ) < 2 * blockSize )
+
+			f = FileIndexedIO("./test/FileIndexedIO.fio", [], IndexedIO.OpenMode.Read)
+			for i in range( 0, 50 ) :
+				g = f.subdirectory( "sub%d" % i )
+				self.assertEqual( g.read( "values" ), values )
+				self.assertEqual( g.read( "id" ), IntData( i ) )
+			del g, f
+
 	def setUp( self ):
 
 		if os.path.isfile("./test/FileIndexedIO.fio") :
@@ -110,6 +110,24 @@ class TestKDTree:
 						d = (self.points[i] - testPoint).length()
 						self.assert_( d > furthestNeighbourDistance )
 
+	def doBatchQueries( self, numPoints ) :
+
+		self.makeTree( numPoints )
+
+		nearest = self.tree.batchNearestNeighbour( self.points )
+		self.assertEqual( len( nearest ), numPoints )
+		for i in range( 0, numPoints ) :
+			self.assertEqual( nearest[i], self.tree.nearestNeighbour( self.points[i] ) )
+
+		for n in self.numNeighbours :
+
+			neighbours = self.tree.batchNearestNNeighbours( self.points, n )
+			self.assertEqual( len( neighbours ), numPoints * n )
+			for i in range( 0, numPoints ) :
+				expected = list( self.tree.nearestNNeighbours( self.points[i], n ) )
+				expected += [ -1 ] * ( n - len( expected ) )
+				self.assertEqual( list( neighbours[i*n:(i+1)*n] ), expected )
+
 	def doEnclosedPoints( self, numPoints ) :
 	
 		self.makeTree( numPoints )
@@ -177,6 +195,12 @@ class TestKDTreeV2f(unittest.TestCase, TestKDTree):
 		for t in self.treeSizes:
 			self.doEnclosedPoints(t)		
 
+	def testBatchQueries(self):
+		"""Test KDTreeV2f batch queries"""
+
+		for t in self.treeSizes:
+			self.doBatchQueries(t)
+
 class TestKDTreeV2d(unittest.TestCase, TestKDTree):
 
 	def makeTree(self, numPoints):
@@ -225,6 +249,12 @@ class TestKDTreeV2d(unittest.TestCase, TestKDTree):
 		for t in self.treeSizes:
 			self.doEnclosedPoints(t)		
 
+	def testBatchQueries(self):
+		"""Test KDTreeV2d batch queries"""
+
+		for t in self.treeSizes:
+			self.doBatchQueries(t)
+
 class TestKDTreeV3f(unittest.TestCase, TestKDTree):
 
 	def makeTree(self, numPoints):
@@ -273,6 +303,12 @@ class TestKDTreeV3f(unittest.TestCase, TestKDTree):
 		for t in self.treeSizes:
 			self.doEnclosedPoints(t)		
 
+	def testBatchQueries(self):
+		"""Test KDTreeV3f batch queries"""
+
+		for t in self.treeSizes:
+			self.doBatchQueries(t)
+
 class TestKDTreeV3d(unittest.TestCase, TestKDTree):
 
 	def makeTree(self, numPoints):
@@ -321,6 +357,12 @@ class TestKDTreeV3d(unittest.TestCase, TestKDTree):
 		for t in self.treeSizes:
 			self.doEnclosedPoints(t)		
 
+	def testBatchQueries(self):
+		"""Test KDTreeV3d batch queries"""
+
+		for t in self.treeSizes:
+			self.doBatchQueries(t)
+
 
 if __name__ == "__main__":
 	unittest.main()
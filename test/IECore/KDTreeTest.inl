@@ -192,4 +192,77 @@ void KDTreeTest<T>::testNearestNNeighours()
 
 }
 
+template<typename T>
+void KDTreeTest<T>::testBatchQueries()
+{
+	PointVector queryPoints( m_numPoints );
+	for( unsigned int i=0; i<m_numPoints; i++ )
+	{
+		for( unsigned int j = 0; j < VectorTraits< T >::dimensions(); j++ )
+		{
+			queryPoints[i][j] = m_randGen.nextf( -0.5, 1.5 );
+		}
+	}
+
+	// batch results should be identical to individual queries
+	IteratorVector nearestNeighbours;
+	m_tree->batchNearestNeighbour( queryPoints, nearestNeighbours );
+	BOOST_CHECK_EQUAL( nearestNeighbours.size(), queryPoints.size() );
+	for( unsigned int i=0; i<queryPoints.size(); i++ )
+	{
+		BOOST_CHECK( nearestNeighbours[i] == m_tree->nearestNeighbour( queryPoints[i] ) );
+	}
+
+	const unsigned int numNeighbours = 5;
+	NeighbourVector batchNeighbours;
+	NeighbourVector nearNeighbours;
+	m_tree->batchNearestNNeighbours( queryPoints, numNeighbours, batchNeighbours );
+	BOOST_CHECK_EQUAL( batchNeighbours.size(), queryPoints.size() * numNeighbours );
+	for( unsigned int i=0; i<queryPoints.size(); i++ )
+	{
+		m_tree->nearestNNeighbours( queryPoints[i], numNeighbours, nearNeighbours );
+		BOOST_CHECK_EQUAL( nearNeighbours.size(), numNeighbours );
+		for( unsigned int j=0; j<numNeighbours; j++ )
+		{
+			BOOST_CHECK( batchNeighbours[i*numNeighbours+j].point == nearNeighbours[j].point );
+			BOOST_CHECK_EQUAL( batchNeighbours[i*numNeighbours+j].distSquared, nearNeighbours[j].distSquared );
+		}
+	}
+
+	// asking for more neighbours than there are points should pad the results
+	Tree smallTree( m_points.begin(), m_points.begin() + 2 );
+	smallTree.batchNearestNNeighbours( queryPoints, 3, batchNeighbours );
+	BOOST_CHECK_EQUAL( batchNeighbours.size(), queryPoints.size() * 3 );
+	for( unsigned int i=0; i<queryPoints.size(); i++ )
+	{
+		BOOST_CHECK( batchNeighbours[i*3].point != m_points.begin() + 2 );
+		BOOST_CHECK( batchNeighbours[i*3+1].point != m_points.begin() + 2 );
+		BOOST_CHECK( batchNeighbours[i*3+2].point == m_points.begin() + 2 );
+	}
+}
+
+template<typename T>
+void KDTreeTest<T>::testParallelBuild()
+{
+	// enough points to make sure we exercise the parallel build
+	PointVector points( 100000 );
+	for( size_t i=0; i<points.size(); i++ )
+	{
+		for( unsigned int j = 0; j < VectorTraits< T >::dimensions(); j++ )
+		{
+			points[i][j] = m_randGen.nextf();
+		}
+	}
+
+	Tree serialTree( points.begin(), points.end(), 4, false );
+	Tree parallelTree( points.begin(), points.end(), 4, true );
+
+	BOOST_CHECK_EQUAL( serialTree.numNodes(), parallelTree.numNodes() );
+	for( size_t i=0; i<points.size(); i+=7 )
+	{
+		BOOST_CHECK( parallelTree.nearestNeighbour( points[i] ) == points.begin() + i );
+		BOOST_CHECK( serialTree.nearestNeighbour( points[i] ) == points.begin() + i );
+	}
+}
+
 }
@@ -34,9 +34,14 @@
 
 #include <iostream>
 
+#include "boost/format.hpp"
+
 #include "tbb/tbb.h"
+#include "tbb/task_scheduler_init.h"
+#include "tbb/tbb_thread.h"
 
 #include "IECore/LRUCache.h"
+#include "IECore/ShardedLRUCache.h"
 #include "IECore/SimpleTypedData.h"
 
 #include "LRUCacheThreadingTest.h"
@@ -51,12 +56,13 @@ namespace IECore
 struct LRUCacheThreadingTest
 {
 		
+	template<typename Cache>
 	struct GetFromCache
 	{
 		public :
 		
-			GetFromCache( LRUCache<int, IntDataPtr> &cache )
-				:	m_cache( cache )
+			GetFromCache( Cache &cache, size_t numKeys = 0 )
+				:	m_cache( cache ), m_numKeys( numKeys )
 			{
 			}
 			
@@ -64,15 +70,17 @@ struct LRUCacheThreadingTest
 			{
 				for( size_t i=r.begin(); i!=r.end(); ++i )
 				{
-					IntDataPtr k = m_cache.get( i );
+					int key = m_numKeys ? i % m_numKeys : i;
+					IntDataPtr k = m_cache.get( key );
 					// can't use boost unit test assertions from threads
-					assert( k->readable() == (int)i );
+					assert( k->readable() == key );
 				}
 			}
 			
 		private :
 		
-			LRUCache<int, IntDataPtr> &m_cache;
+			Cache &m_cache;
+			size_t m_numKeys;
 			
 	};
 
@@ -86,7 +94,89 @@ struct LRUCacheThreadingTest
 	{
 		LRUCache<int, IntDataPtr> cache( get, 1000 );
 		
-		parallel_for( blocked_range<size_t>( 0, 10000 ), GetFromCache( cache ) );
+		parallel_for( blocked_range<size_t>( 0, 10000 ), GetFromCache< LRUCache<int, IntDataPtr> >( cache ) );
+	}
+
+	void testSharded()
+	{
+		ShardedLRUCache<int, IntDataPtr> cache( get, 1000 );
+
+		parallel_for( blocked_range<size_t>( 0, 10000 ), GetFromCache< ShardedLRUCache<int, IntDataPtr> >( cache ) );
+		BOOST_CHECK( cache.currentCost() <= 1000 );
+
+		// concurrent gets of a small set of keys, mostly hits.
+		parallel_for( blocked_range<size_t>( 0, 100000 ), GetFromCache< ShardedLRUCache<int, IntDataPtr> >( cache, 50 ) );
+		BOOST_CHECK( cache.currentCost() <= 1000 );
+		for( int i = 0; i < 50; ++i )
+		{
+			BOOST_CHECK_EQUAL( cache.get( i )->readable(), i );
+		}
+	}
+
+	template<typename Cache>
+	static double timeHits( Cache &cache, size_t numKeys )
+	{
+		tick_count t0 = tick_count::now();
+		parallel_for( blocked_range<size_t>( 0, 2000000 ), GetFromCache<Cache>( cache, numKeys ) );
+		return ( tick_count::now() - t0 ).seconds();
+	}
+
+	/// Times cache hits using a single thread. This is run in a thread of its own,
+	/// because task_scheduler_init has no effect on a thread which has already used
+	/// the scheduler, as the earlier tests have.
+	template<typename Cache>
+	struct TimeSerialHits
+	{
+		public :
+
+			TimeSerialHits( Cache &cache, size_t numKeys, double &time )
+				:	m_cache( cache ), m_numKeys( numKeys ), m_time( time )
+			{
+			}
+
+			void operator()() const
+			{
+				task_scheduler_init init( 1 );
+				m_time = timeHits( m_cache, m_numKeys );
+			}
+
+		private :
+
+			Cache &m_cache;
+			size_t m_numKeys;
+			double &m_time;
+
+	};
+
+	template<typename Cache>
+	static double timeSerialHits( Cache &cache, size_t numKeys )
+	{
+		double result = 0;
+		tbb_thread thread( TimeSerialHits<Cache>( cache, numKeys, result ) );
+		thread.join();
+		return result;
+	}
+
+	/// Compares the cost of concurrent cache hits between LRUCache and ShardedLRUCache.
+	/// Only correctness is asserted, timings are reported as test messages.
+	void testContention()
+	{
+		const size_t numKeys = 100;
+
+		LRUCache<int, IntDataPtr> lruCache( get, numKeys * 10 );
+		ShardedLRUCache<int, IntDataPtr> shardedCache( get, numKeys * 10 );
+
+		double lruSerialTime = timeSerialHits( lruCache, numKeys );
+		double shardedSerialTime = timeSerialHits( shardedCache, numKeys );
+
+		double lruParallelTime = timeHits( lruCache, numKeys );
+		double shardedParallelTime = timeHits( shardedCache, numKeys );
+
+		BOOST_CHECK_EQUAL( lruCache.currentCost(), numKeys * 10 );
+		BOOST_CHECK_EQUAL( shardedCache.currentCost(), numKeys * 10 );
+
+		BOOST_TEST_MESSAGE( boost::format( "LRUCache hits : serial %fs, parallel %fs" ) % lruSerialTime % lruParallelTime );
+		BOOST_TEST_MESSAGE( boost::format( "ShardedLRUCache hits : serial %fs, parallel %fs" ) % shardedSerialTime % shardedParallelTime );
 	}
 };
 
@@ -99,6 +189,8 @@ struct LRUCacheThreadingTestSuite : public boost::unit_test::test_suite
 		boost::shared_ptr<LRUCacheThreadingTest> instance( new LRUCacheThreadingTest() );
 
 		add( BOOST_CLASS_TEST_CASE( &LRUCacheThreadingTest::test, instance ) );
+		add( BOOST_CLASS_TEST_CASE( &LRUCacheThreadingTest::testSharded, instance ) );
+		add( BOOST_CLASS_TEST_CASE( &LRUCacheThreadingTest::testContention, instance ) );
 	}
 };
 
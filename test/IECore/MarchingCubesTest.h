@@ -40,6 +40,7 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <algorithm>
 
 #include "boost/test/unit_test.hpp"
 #include "boost/test/floating_point_comparison.hpp"
@@ -121,6 +122,120 @@ struct MarchingCubesTest
 		delete fn;
 	}
 
+	void testParallelSphere()
+	{
+		typedef MarchingCubes<SphereIsoSurfaceFn, MeshPrimitiveBuilder > Cubes;
+		typedef IntrusivePtr<Cubes> CubesPtr;
+
+		const Box3f bound( V3f(-1,-1,-1),V3f(1,1,1) );
+		const V3i res( 30, 31, 32 );
+
+		SphereIsoSurfaceFn::Ptr fn = new SphereIsoSurfaceFn( 0.5 );
+
+		MeshPrimitiveBuilder::Ptr builder = new MeshPrimitiveBuilder();
+		CubesPtr c = new Cubes( fn, builder );
+		c->march( bound, res );
+		MeshPrimitivePtr expected = builder->mesh();
+
+		const std::vector<std::vector<V3f> > expectedTriangles = sortedTriangles( expected.get() );
+		const std::vector<PositionAndNormal> expectedVertices = sortedVertices( expected.get() );
+
+		const int blockSizes[] = { 1, 3, 16, 100 };
+		const int blocksInFlight[] = { 1, 4, 64 };
+		for( int i = 0; i < 4; ++i )
+		{
+			for( int j = 0; j < 3; ++j )
+			{
+				builder = new MeshPrimitiveBuilder();
+				c = new Cubes( fn, builder );
+				c->parallelMarch( bound, res, 0.0f, blockSizes[i], blocksInFlight[j] );
+				MeshPrimitivePtr result = builder->mesh();
+
+				BOOST_CHECK_EQUAL( result->numFaces(), expected->numFaces() );
+
+				// the vertices are numbered differently from march(), so we compare the
+				// triangles by their vertex positions.
+				BOOST_CHECK( sortedTriangles( result.get() ) == expectedTriangles );
+
+				// every vertex must have the position and normal of one from march().
+				const std::vector<PositionAndNormal> vertices = sortedVertices( result.get() );
+				BOOST_CHECK_EQUAL( vertices.size(), expectedVertices.size() );
+				BOOST_CHECK( vertices == expectedVertices );
+
+				// and must be used by a triangle.
+				std::vector<int> useCounts( vertices.size(), 0 );
+				const std::vector<int> &vertexIds = result->vertexIds()->readable();
+				for( std::vector<int>::const_iterator it = vertexIds.begin(); it != vertexIds.end(); ++it )
+				{
+					BOOST_REQUIRE( *it >= 0 && *it < (int)useCounts.size() );
+					useCounts[*it]++;
+				}
+				BOOST_CHECK( std::find( useCounts.begin(), useCounts.end(), 0 ) == useCounts.end() );
+			}
+		}
+
+		delete fn;
+	}
+
+	static bool lessThan( const V3f &a, const V3f &b )
+	{
+		return a.x < b.x || ( a.x == b.x && ( a.y < b.y || ( a.y == b.y && a.z < b.z ) ) );
+	}
+
+	static bool triangleLessThan( const std::vector<V3f> &a, const std::vector<V3f> &b )
+	{
+		return std::lexicographical_compare( a.begin(), a.end(), b.begin(), b.end(), lessThan );
+	}
+
+	/// Returns the vertex positions of each triangle of a mesh, starting from the smallest
+	/// position so as to keep the winding order, and sorted so that meshes can be compared
+	/// regardless of the numbering of their vertices.
+	static std::vector<std::vector<V3f> > sortedTriangles( const MeshPrimitive *mesh )
+	{
+		const std::vector<V3f> &p = runTimeCast<const V3fVectorData>( mesh->variables.find( "P" )->second.data )->readable();
+		const std::vector<int> &vertexIds = mesh->vertexIds()->readable();
+		BOOST_CHECK_EQUAL( vertexIds.size(), mesh->numFaces() * 3 );
+
+		std::vector<std::vector<V3f> > result;
+		for( size_t i = 0; i + 2 < vertexIds.size(); i += 3 )
+		{
+			std::vector<V3f> triangle( 3 );
+			for( int j = 0; j < 3; ++j )
+			{
+				triangle[j] = p[vertexIds[i+j]];
+			}
+			std::rotate( triangle.begin(), std::min_element( triangle.begin(), triangle.end(), lessThan ), triangle.end() );
+			result.push_back( triangle );
+		}
+
+		std::sort( result.begin(), result.end(), triangleLessThan );
+		return result;
+	}
+
+	typedef std::pair<V3f, V3f> PositionAndNormal;
+
+	static bool positionLessThan( const PositionAndNormal &a, const PositionAndNormal &b )
+	{
+		return lessThan( a.first, b.first );
+	}
+
+	/// Returns the position and normal of each vertex of a mesh, sorted by position.
+	static std::vector<PositionAndNormal> sortedVertices( const MeshPrimitive *mesh )
+	{
+		const std::vector<V3f> &p = runTimeCast<const V3fVectorData>( mesh->variables.find( "P" )->second.data )->readable();
+		const std::vector<V3f> &n = runTimeCast<const V3fVectorData>( mesh->variables.find( "N" )->second.data )->readable();
+		BOOST_REQUIRE_EQUAL( p.size(), n.size() );
+
+		std::vector<PositionAndNormal> result;
+		for( size_t i = 0; i < p.size(); ++i )
+		{
+			result.push_back( PositionAndNormal( p[i], n[i] ) );
+		}
+
+		std::sort( result.begin(), result.end(), positionLessThan );
+		return result;
+	}
+
 	void testPerlinNoise()
 	{
 		typedef MarchingCubes<PerlinNoiseV3ff, MeshPrimitiveBuilder > Cubes;
@@ -159,6 +274,7 @@ struct MarchingCubesTestSuite : public boost::unit_test::test_suite
 		static boost::shared_ptr<MarchingCubesTest> instance(new MarchingCubesTest());
 
 		add( BOOST_CLASS_TEST_CASE( &MarchingCubesTest::testSphere, instance ) );
+		add( BOOST_CLASS_TEST_CASE( &MarchingCubesTest::testParallelSphere, instance ) );
 		add( BOOST_CLASS_TEST_CASE( &MarchingCubesTest::testPerlinNoise, instance ) );
 	}
 
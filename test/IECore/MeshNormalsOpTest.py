@@ -92,5 +92,36 @@ class MeshNormalsOpTest( unittest.TestCase ) :
 			self.assert_( normals[i].dot( p ) > 0.99 )
 			self.assert_( normals[i].dot( p ) < 1.01 )
 
+	def testDeformingMesh( self ) :
+
+		m = MeshPrimitive.createPlane( Box2f( V2f( -1 ), V2f( 1 ) ), V2i( 50 ) )
+		r = Rand32()
+
+		for frame in range( 0, 3 ) :
+
+			p = m["P"].data.copy()
+			for i in range( 0, p.size() ) :
+				p[i] = p[i] + r.nextV3f() * 0.01
+			m["P"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Vertex, p )
+
+			mm = MeshNormalsOp()( input=m )
+
+			# compute the normals by accumulating face normals serially
+			expectedNormals = [ V3f( 0 ) ] * p.size()
+			faceVertex = 0
+			vertexIds = m.vertexIds
+			for numVertices in m.verticesPerFace :
+				p0 = p[vertexIds[faceVertex]]
+				p1 = p[vertexIds[faceVertex+1]]
+				p2 = p[vertexIds[faceVertex+2]]
+				n = (p2-p1).cross( p0-p1 ).normalized()
+				for i in range( 0, numVertices ) :
+					expectedNormals[vertexIds[faceVertex]] = expectedNormals[vertexIds[faceVertex]] + n
+					faceVertex += 1
+
+			normals = mm["N"].data
+			for i in range( 0, normals.size() ) :
+				self.failUnless( normals[i].equalWithAbsError( expectedNormals[i].normalized(), 0.00001 ) )
+
 if __name__ == "__main__":
     unittest.main()
@@ -374,6 +374,122 @@ class TestMeshPrimitiveEvaluator( unittest.TestCase ) :
 					hits = mpe.intersectionPoints( origin, direction )
 					self.failIf( hits )
 
+	def testBatchQueries( self ) :
+
+		m = MeshPrimitive.createPlane( Box2f( V2f( -1 ), V2f( 1 ) ), V2i( 10 ) )
+		m = TriangulateOp()( input = m )
+		e = MeshPrimitiveEvaluator( m )
+		r = e.createResult()
+
+		random.seed( 10 )
+		points = V3fVectorData( [ V3f( random.uniform( -2, 2 ), random.uniform( -2, 2 ), random.uniform( -2, 2 ) ) for i in range( 0, 1000 ) ] )
+
+		results = e.batchClosestPoint( points )
+		self.assertEqual( len( results["triangleIndex"] ), len( points ) )
+		for i, p in enumerate( points ) :
+			self.failUnless( e.closestPoint( p, r ) )
+			self.assertEqual( results["triangleIndex"][i], r.triangleIndex() )
+			self.failUnless( results["barycentricCoordinates"][i].equalWithAbsError( r.barycentricCoordinates(), 0.00001 ) )
+			self.failUnless( results["P"][i].equalWithAbsError( r.point(), 0.00001 ) )
+			self.failUnless( results["N"][i].equalWithAbsError( r.normal(), 0.00001 ) )
+
+		origins = V3fVectorData( [ V3f( p.x, p.y, 1 ) for p in points ] )
+		directions = V3fVectorData( [ V3f( 0, 0, -1 ) ] * len( points ) )
+		results = e.batchIntersectionPoint( origins, directions )
+		for i, o in enumerate( origins ) :
+			hit = e.intersectionPoint( o, directions[i], r )
+			self.assertEqual( results["triangleIndex"][i] != -1, hit )
+			if hit :
+				self.assertEqual( results["triangleIndex"][i], r.triangleIndex() )
+				self.failUnless( results["P"][i].equalWithAbsError( r.point(), 0.00001 ) )
+
+		results = e.batchIntersectionPoint( origins, directions, 0.5 )
+		self.assertEqual( list( results["triangleIndex"] ), [ -1 ] * len( points ) )
+
+		self.assertRaises( Exception, e.batchIntersectionPoint, origins, V3fVectorData() )
+
+		uvs = V2fVectorData( [ V2f( random.uniform( -0.5, 1.5 ), random.uniform( -0.5, 1.5 ) ) for i in range( 0, 1000 ) ] )
+		results = e.batchPointAtUV( uvs )
+		for i, uv in enumerate( uvs ) :
+			hit = e.pointAtUV( uv, r )
+			self.assertEqual( results["triangleIndex"][i] != -1, hit )
+			if hit :
+				self.failUnless( results["P"][i].equalWithAbsError( r.point(), 0.00001 ) )
+
+	def testTreeTypes( self ) :
+
+		m = MeshPrimitive.createPlane( Box2f( V2f( -1 ), V2f( 1 ) ), V2i( 20 ) )
+		m = TriangulateOp()( input = m )
+
+		kd = MeshPrimitiveEvaluator( m, MeshPrimitiveEvaluator.TreeType.KDTree )
+		bvh = MeshPrimitiveEvaluator( m, MeshPrimitiveEvaluator.TreeType.BVH )
+		self.assertEqual( kd.treeType(), MeshPrimitiveEvaluator.TreeType.KDTree )
+		self.assertEqual( bvh.treeType(), MeshPrimitiveEvaluator.TreeType.BVH )
+		self.assertEqual( MeshPrimitiveEvaluator( m ).treeType(), MeshPrimitiveEvaluator.TreeType.BVH )
+
+		r1 = kd.createResult()
+		r2 = bvh.createResult()
+
+		random.seed( 20 )
+		for i in range( 0, 1000 ) :
+
+			p = V3f( random.uniform( -2, 2 ), random.uniform( -2, 2 ), random.uniform( -2, 2 ) )
+			self.failUnless( kd.closestPoint( p, r1 ) )
+			self.failUnless( bvh.closestPoint( p, r2 ) )
+			self.failUnless( r1.point().equalWithAbsError( r2.point(), 0.00001 ) )
+
+			d = V3f( 0, 0, -1 if p.z > 0 else 1 )
+			h1 = kd.intersectionPoint( p, d, r1 )
+			h2 = bvh.intersectionPoint( p, d, r2 )
+			self.assertEqual( h1, h2 )
+			if h1 :
+				self.failUnless( r1.point().equalWithAbsError( r2.point(), 0.00001 ) )
+
+			self.assertEqual( len( kd.intersectionPoints( p, d ) ), len( bvh.intersectionPoints( p, d ) ) )
+
+	def testSetPositions( self ) :
+
+		m = MeshPrimitive.createPlane( Box2f( V2f( -1 ), V2f( 1 ) ), V2i( 20 ) )
+		m = TriangulateOp()( input = m )
+
+		for treeType in ( MeshPrimitiveEvaluator.TreeType.KDTree, MeshPrimitiveEvaluator.TreeType.BVH ) :
+
+			e = MeshPrimitiveEvaluator( m, treeType )
+			e.surfaceArea()
+			e.signedDistance( V3f( 0, 0, 1 ) )
+
+			deformed = m.copy()
+			p = deformed["P"].data
+			for i in range( 0, p.size() ) :
+				p[i] = V3f( p[i].x * 2, p[i].y, math.sin( p[i].x * 3 ) )
+
+			e.setPositions( p )
+			self.assertEqual( e.mesh()["P"].data, p )
+			self.assertRaises( Exception, e.setPositions, V3fVectorData( [ V3f( 0 ) ] ) )
+
+			e2 = MeshPrimitiveEvaluator( deformed, treeType )
+			self.assertAlmostEqual( e.surfaceArea(), e2.surfaceArea(), 4 )
+
+			r1 = e.createResult()
+			r2 = e2.createResult()
+
+			random.seed( 30 )
+			for i in range( 0, 1000 ) :
+
+				p = V3f( random.uniform( -3, 3 ), random.uniform( -2, 2 ), random.uniform( -2, 2 ) )
+				self.failUnless( e.closestPoint( p, r1 ) )
+				self.failUnless( e2.closestPoint( p, r2 ) )
+				self.failUnless( r1.point().equalWithAbsError( r2.point(), 0.00001 ) )
+
+				d = V3f( 0, 0, -1 if p.z > 0 else 1 )
+				h1 = e.intersectionPoint( p, d, r1 )
+				h2 = e2.intersectionPoint( p, d, r2 )
+				self.assertEqual( h1, h2 )
+				if h1 :
+					self.failUnless( r1.point().equalWithAbsError( r2.point(), 0.00001 ) )
+
+				self.assertAlmostEqual( e.signedDistance( p ), e2.signedDistance( p ), 4 )
+
 if __name__ == "__main__":
 	unittest.main()
 
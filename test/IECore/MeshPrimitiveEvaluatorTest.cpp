@@ -0,0 +1,308 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+
+#include "boost/format.hpp"
+
+#include "tbb/tbb.h"
+
+#include "OpenEXR/ImathRandom.h"
+
+#include "IECore/MeshPrimitiveEvaluator.h"
+#include "IECore/MeshPrimitive.h"
+
+#include "MeshPrimitiveEvaluatorTest.h"
+
+using namespace boost;
+using namespace boost::unit_test;
+using namespace tbb;
+using namespace Imath;
+
+namespace IECore
+{
+
+struct MeshPrimitiveEvaluatorTest
+{
+
+	static const unsigned g_numTriangles = 100000;
+	static const unsigned g_numQueries = 200000;
+
+	MeshPrimitiveEvaluatorPtr makeEvaluator( MeshPrimitiveEvaluator::TreeType treeType = MeshPrimitiveEvaluator::BVHType )
+	{
+		Rand32 rand( 10 );
+
+		IntVectorDataPtr verticesPerFaceData = new IntVectorData;
+		IntVectorDataPtr vertexIdsData = new IntVectorData;
+		V3fVectorDataPtr pointsData = new V3fVectorData;
+		std::vector<int> &verticesPerFace = verticesPerFaceData->writable();
+		std::vector<int> &vertexIds = vertexIdsData->writable();
+		std::vector<V3f> &points = pointsData->writable();
+
+		for( unsigned triangleIndex = 0; triangleIndex < g_numTriangles; triangleIndex++ )
+		{
+			V3f center( rand.nextf( -10, 10 ), rand.nextf( -10, 10 ), rand.nextf( -10, 10 ) );
+			verticesPerFace.push_back( 3 );
+			for( unsigned i = 0; i < 3; i++ )
+			{
+				vertexIds.push_back( points.size() );
+				points.push_back( center + V3f( rand.nextf( -0.1, 0.1 ), rand.nextf( -0.1, 0.1 ), rand.nextf( -0.1, 0.1 ) ) );
+			}
+		}
+
+		MeshPrimitivePtr mesh = new MeshPrimitive( verticesPerFaceData, vertexIdsData, "linear", pointsData );
+		return new MeshPrimitiveEvaluator( mesh, treeType );
+	}
+
+	std::vector<V3f> makePoints()
+	{
+		Rand32 rand( 20 );
+		std::vector<V3f> result;
+		for( unsigned i = 0; i < g_numQueries; i++ )
+		{
+			result.push_back( V3f( rand.nextf( -12, 12 ), rand.nextf( -12, 12 ), rand.nextf( -12, 12 ) ) );
+		}
+		return result;
+	}
+
+	/// Compares batchClosestPoint() against the equivalent calls to closestPoint(),
+	/// checking the results match and reporting the timings of both.
+	void testBatchClosestPoint()
+	{
+		MeshPrimitiveEvaluatorPtr evaluator = makeEvaluator();
+		std::vector<V3f> points = makePoints();
+
+		tick_count t0 = tick_count::now();
+		std::vector<int> triangleIndices;
+		std::vector<V3f> closestPoints;
+		for( std::vector<V3f>::const_iterator it = points.begin(); it != points.end(); ++it )
+		{
+			PrimitiveEvaluator::ResultPtr result = evaluator->createResult();
+			evaluator->closestPoint( *it, result.get() );
+			triangleIndices.push_back( static_cast<MeshPrimitiveEvaluator::Result *>( result.get() )->triangleIndex() );
+			closestPoints.push_back( result->point() );
+		}
+		double perQueryTime = ( tick_count::now() - t0 ).seconds();
+
+		MeshPrimitiveEvaluator::BatchResults results;
+		double serialBatchTime;
+		{
+			task_scheduler_init init( 1 );
+			t0 = tick_count::now();
+			evaluator->batchClosestPoint( points, results );
+			serialBatchTime = ( tick_count::now() - t0 ).seconds();
+		}
+
+		t0 = tick_count::now();
+		evaluator->batchClosestPoint( points, results );
+		double parallelBatchTime = ( tick_count::now() - t0 ).seconds();
+
+		BOOST_CHECK_EQUAL( results.triangleIndices.size(), points.size() );
+		BOOST_CHECK_EQUAL( results.points.size(), points.size() );
+		for( size_t i = 0; i < points.size(); i++ )
+		{
+			BOOST_CHECK_EQUAL( results.triangleIndices[i], triangleIndices[i] );
+			BOOST_CHECK( results.points[i].equalWithAbsError( closestPoints[i], 0.00001f ) );
+		}
+
+		BOOST_TEST_MESSAGE( boost::format( "MeshPrimitiveEvaluator closest points : per query %fs, batch serial %fs, batch parallel %fs" ) % perQueryTime % serialBatchTime % parallelBatchTime );
+	}
+
+	/// As above, but for batchIntersectionPoint().
+	void testBatchIntersectionPoint()
+	{
+		MeshPrimitiveEvaluatorPtr evaluator = makeEvaluator();
+		std::vector<V3f> origins = makePoints();
+		std::vector<V3f> directions;
+		for( std::vector<V3f>::const_iterator it = origins.begin(); it != origins.end(); ++it )
+		{
+			directions.push_back( -*it );
+		}
+
+		tick_count t0 = tick_count::now();
+		std::vector<int> triangleIndices;
+		for( size_t i = 0; i < origins.size(); i++ )
+		{
+			PrimitiveEvaluator::ResultPtr result = evaluator->createResult();
+			if( evaluator->intersectionPoint( origins[i], directions[i], result.get() ) )
+			{
+				triangleIndices.push_back( static_cast<MeshPrimitiveEvaluator::Result *>( result.get() )->triangleIndex() );
+			}
+			else
+			{
+				triangleIndices.push_back( -1 );
+			}
+		}
+		double perQueryTime = ( tick_count::now() - t0 ).seconds();
+
+		MeshPrimitiveEvaluator::BatchResults results;
+		t0 = tick_count::now();
+		evaluator->batchIntersectionPoint( origins, directions, results );
+		double batchTime = ( tick_count::now() - t0 ).seconds();
+
+		BOOST_CHECK_EQUAL( results.triangleIndices.size(), origins.size() );
+		BOOST_CHECK( results.triangleIndices == triangleIndices );
+
+		BOOST_TEST_MESSAGE( boost::format( "MeshPrimitiveEvaluator intersection points : per query %fs, batch %fs" ) % perQueryTime % batchTime );
+	}
+
+	/// Checks that queries give the same results using either type of tree, and
+	/// reports the time taken to build each tree and to perform the queries.
+	void testTreeTypes()
+	{
+		tick_count t0 = tick_count::now();
+		MeshPrimitiveEvaluatorPtr kdEvaluator = makeEvaluator( MeshPrimitiveEvaluator::KDTreeType );
+		double kdBuildTime = ( tick_count::now() - t0 ).seconds();
+
+		t0 = tick_count::now();
+		MeshPrimitiveEvaluatorPtr bvhEvaluator = makeEvaluator( MeshPrimitiveEvaluator::BVHType );
+		double bvhBuildTime = ( tick_count::now() - t0 ).seconds();
+
+		BOOST_CHECK( kdEvaluator->triangleBVH() == 0 );
+		BOOST_CHECK( bvhEvaluator->triangleBVH() != 0 );
+		BOOST_CHECK( bvhEvaluator->triangleBoundTree() != 0 );
+
+		std::vector<V3f> points = makePoints();
+		std::vector<V3f> directions;
+		for( std::vector<V3f>::const_iterator it = points.begin(); it != points.end(); ++it )
+		{
+			directions.push_back( -*it );
+		}
+
+		MeshPrimitiveEvaluator::BatchResults kdResults, bvhResults;
+
+		t0 = tick_count::now();
+		kdEvaluator->batchClosestPoint( points, kdResults );
+		double kdClosestTime = ( tick_count::now() - t0 ).seconds();
+
+		t0 = tick_count::now();
+		bvhEvaluator->batchClosestPoint( points, bvhResults );
+		double bvhClosestTime = ( tick_count::now() - t0 ).seconds();
+
+		for( size_t i = 0; i < points.size(); i++ )
+		{
+			BOOST_CHECK_CLOSE( ( kdResults.points[i] - points[i] ).length(), ( bvhResults.points[i] - points[i] ).length(), 0.001f );
+		}
+
+		t0 = tick_count::now();
+		kdEvaluator->batchIntersectionPoint( points, directions, kdResults );
+		double kdIntersectionTime = ( tick_count::now() - t0 ).seconds();
+
+		t0 = tick_count::now();
+		bvhEvaluator->batchIntersectionPoint( points, directions, bvhResults );
+		double bvhIntersectionTime = ( tick_count::now() - t0 ).seconds();
+
+		for( size_t i = 0; i < points.size(); i++ )
+		{
+			BOOST_CHECK_EQUAL( kdResults.triangleIndices[i] == -1, bvhResults.triangleIndices[i] == -1 );
+			if( kdResults.triangleIndices[i] != -1 && bvhResults.triangleIndices[i] != -1 )
+			{
+				BOOST_CHECK_CLOSE( ( kdResults.points[i] - points[i] ).length(), ( bvhResults.points[i] - points[i] ).length(), 0.001f );
+			}
+		}
+
+		BOOST_TEST_MESSAGE( boost::format( "MeshPrimitiveEvaluator KDTree : build %fs, closest points %fs, intersection points %fs" ) % kdBuildTime % kdClosestTime % kdIntersectionTime );
+		BOOST_TEST_MESSAGE( boost::format( "MeshPrimitiveEvaluator BVH : build %fs, closest points %fs, intersection points %fs" ) % bvhBuildTime % bvhClosestTime % bvhIntersectionTime );
+	}
+
+	/// Checks that updating the positions of an existing evaluator gives the
+	/// same results as constructing a new one, and reports the timings of both.
+	void testSetPositions()
+	{
+		for( int treeType = MeshPrimitiveEvaluator::KDTreeType; treeType <= MeshPrimitiveEvaluator::BVHType; treeType++ )
+		{
+			MeshPrimitiveEvaluatorPtr evaluator = makeEvaluator( (MeshPrimitiveEvaluator::TreeType)treeType );
+			// make sure the lazily computed properties are computed before we deform
+			evaluator->surfaceArea();
+			evaluator->volume();
+			evaluator->triangleBoundTree();
+
+			ConstV3fVectorDataPtr positions = evaluator->mesh()->variableData<V3fVectorData>( "P" );
+			V3fVectorDataPtr deformedPositions = new V3fVectorData;
+			Rand32 rand( 30 );
+			for( std::vector<V3f>::const_iterator it = positions->readable().begin(); it != positions->readable().end(); ++it )
+			{
+				deformedPositions->writable().push_back( *it * 1.2f + V3f( rand.nextf( -0.2, 0.2 ), rand.nextf( -0.2, 0.2 ), rand.nextf( -0.2, 0.2 ) ) );
+			}
+
+			MeshPrimitivePtr deformedMesh = evaluator->mesh()->copy();
+			deformedMesh->variables["P"].data = deformedPositions;
+
+			tick_count t0 = tick_count::now();
+			MeshPrimitiveEvaluatorPtr newEvaluator = new MeshPrimitiveEvaluator( deformedMesh, (MeshPrimitiveEvaluator::TreeType)treeType );
+			double constructTime = ( tick_count::now() - t0 ).seconds();
+
+			t0 = tick_count::now();
+			evaluator->setPositions( deformedPositions );
+			double setPositionsTime = ( tick_count::now() - t0 ).seconds();
+
+			BOOST_CHECK( evaluator->mesh()->variableData<V3fVectorData>( "P" )->readable() == deformedPositions->readable() );
+			BOOST_CHECK_CLOSE( evaluator->surfaceArea(), newEvaluator->surfaceArea(), 0.001f );
+			BOOST_CHECK_CLOSE( evaluator->volume(), newEvaluator->volume(), 0.001f );
+
+			std::vector<V3f> points = makePoints();
+			MeshPrimitiveEvaluator::BatchResults results, newResults;
+			evaluator->batchClosestPoint( points, results );
+			newEvaluator->batchClosestPoint( points, newResults );
+			for( size_t i = 0; i < points.size(); i++ )
+			{
+				BOOST_CHECK_CLOSE( ( results.points[i] - points[i] ).length(), ( newResults.points[i] - points[i] ).length(), 0.001f );
+			}
+
+			BOOST_TEST_MESSAGE( boost::format( "MeshPrimitiveEvaluator %s : construct %fs, setPositions %fs" ) % ( treeType == MeshPrimitiveEvaluator::BVHType ? "BVH" : "KDTree" ) % constructTime % setPositionsTime );
+		}
+	}
+
+};
+
+struct MeshPrimitiveEvaluatorTestSuite : public boost::unit_test::test_suite
+{
+
+	MeshPrimitiveEvaluatorTestSuite() : boost::unit_test::test_suite( "MeshPrimitiveEvaluatorTestSuite" )
+	{
+		boost::shared_ptr<MeshPrimitiveEvaluatorTest> instance( new MeshPrimitiveEvaluatorTest() );
+
+		add( BOOST_CLASS_TEST_CASE( &MeshPrimitiveEvaluatorTest::testBatchClosestPoint, instance ) );
+		add( BOOST_CLASS_TEST_CASE( &MeshPrimitiveEvaluatorTest::testBatchIntersectionPoint, instance ) );
+		add( BOOST_CLASS_TEST_CASE( &MeshPrimitiveEvaluatorTest::testTreeTypes, instance ) );
+		add( BOOST_CLASS_TEST_CASE( &MeshPrimitiveEvaluatorTest::testSetPositions, instance ) );
+	}
+};
+
+void addMeshPrimitiveEvaluatorTest( boost::unit_test::test_suite *test )
+{
+	test->add( new MeshPrimitiveEvaluatorTestSuite( ) );
+}
+
+} // namespace IECore
@@ -0,0 +1,165 @@
+##########################################################################
+#
+#  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+#
+#  Redistribution and use in source and binary forms, with or without
+#  modification, are permitted provided that the following conditions are
+#  met:
+#
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#
+#     * Neither the name of Image Engine Design nor the names of any
+#       other contributors to this software may be used to endorse or
+#       promote products derived from this software without specific prior
+#       written permission.
+#
+#  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+#  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+#  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+#  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+#  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+#  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+#  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+#  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+#  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+#  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+#  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+##########################################################################
+
+import unittest
+import IECore
+
+class MeshTopologyTest( unittest.TestCase ) :
+
+	def testTables( self ) :
+
+		# two quads sharing an edge
+		#
+		# 3---4---5
+		# |   |   |
+		# 0---1---2
+
+		verticesPerFace = IECore.IntVectorData( [ 4, 4 ] )
+		vertexIds = IECore.IntVectorData( [ 0, 1, 4, 3, 1, 2, 5, 4 ] )
+
+		for parallel in ( True, False ) :
+
+			t = IECore.MeshTopology( verticesPerFace, vertexIds, 6, parallel )
+
+			self.assertEqual( t.numFaces(), 2 )
+			self.assertEqual( t.numVertices(), 6 )
+			self.assertEqual( t.numFaceVertices(), 8 )
+
+			self.assertEqual( t.faceOffsets(), IECore.IntVectorData( [ 0, 4, 8 ] ) )
+			self.assertEqual( t.faceVertexFaces(), IECore.IntVectorData( [ 0, 0, 0, 0, 1, 1, 1, 1 ] ) )
+			self.assertEqual( t.vertexFaceVertexOffsets(), IECore.IntVectorData( [ 0, 1, 3, 4, 5, 7, 8 ] ) )
+			self.assertEqual( t.vertexFaceVertices(), IECore.IntVectorData( [ 0, 1, 4, 5, 3, 2, 7, 6 ] ) )
+
+	def testEdges( self ) :
+
+		# 3---4---5
+		# |   |   |
+		# 0---1---2
+
+		verticesPerFace = IECore.IntVectorData( [ 4, 4 ] )
+		vertexIds = IECore.IntVectorData( [ 0, 1, 4, 3, 1, 2, 5, 4 ] )
+
+		for parallel in ( True, False ) :
+
+			t = IECore.MeshTopology( verticesPerFace, vertexIds, 6, parallel )
+
+			self.assertEqual( t.nextFaceVertex( 0 ), 1 )
+			self.assertEqual( t.nextFaceVertex( 3 ), 0 )
+			self.assertEqual( t.previousFaceVertex( 4 ), 7 )
+			self.assertEqual( t.previousFaceVertex( 6 ), 5 )
+
+			self.assertEqual( t.numEdges(), 7 )
+			self.assertEqual(
+				t.edges(),
+				IECore.V2iVectorData( [
+					IECore.V2i( 0, 1 ), IECore.V2i( 0, 3 ), IECore.V2i( 1, 2 ), IECore.V2i( 1, 4 ),
+					IECore.V2i( 2, 5 ), IECore.V2i( 3, 4 ), IECore.V2i( 4, 5 )
+				] )
+			)
+			self.assertEqual( t.vertexEdgeOffsets(), IECore.IntVectorData( [ 0, 2, 4, 5, 6, 7, 7 ] ) )
+			self.assertEqual( t.faceVertexEdges(), IECore.IntVectorData( [ 0, 3, 5, 1, 2, 4, 6, 3 ] ) )
+			self.assertEqual( t.edgeFaceVertexOffsets(), IECore.IntVectorData( [ 0, 1, 2, 3, 5, 6, 7, 8 ] ) )
+			self.assertEqual( t.edgeFaceVertices(), IECore.IntVectorData( [ 0, 3, 4, 1, 7, 5, 2, 6 ] ) )
+
+			self.assertEqual( t.edgeIndex( 1, 4 ), 3 )
+			self.assertEqual( t.edgeIndex( 4, 1 ), 3 )
+			self.assertEqual( t.edgeIndex( 0, 4 ), -1 )
+			self.assertEqual( t.edgeIndex( 0, 10 ), -1 )
+
+	def testTriangles( self ) :
+
+		verticesPerFace = IECore.IntVectorData( [ 4, 3, 2, 5 ] )
+		vertexIds = IECore.IntVectorData( [ 0, 1, 2, 3, 1, 4, 2, 4, 5, 4, 5, 6, 7, 2 ] )
+
+		for parallel in ( True, False ) :
+
+			t = IECore.MeshTopology( verticesPerFace, vertexIds, 8, parallel )
+
+			self.assertEqual( t.numTriangles(), 6 )
+			self.assertEqual( t.faceTriangleOffsets(), IECore.IntVectorData( [ 0, 2, 3, 3, 6 ] ) )
+			self.assertEqual( t.triangleFaces(), IECore.IntVectorData( [ 0, 0, 1, 3, 3, 3 ] ) )
+			self.assertEqual(
+				t.triangleFaceVertices(),
+				IECore.IntVectorData( [ 0, 1, 2, 0, 2, 3, 4, 5, 6, 9, 10, 11, 9, 11, 12, 9, 12, 13 ] )
+			)
+
+	def testParallelMatchesSerial( self ) :
+
+		m = IECore.MeshPrimitive.createPlane( IECore.Box2f( IECore.V2f( -1 ), IECore.V2f( 1 ) ), IECore.V2i( 300 ) )
+
+		t1 = IECore.MeshTopology( m.verticesPerFace, m.vertexIds, m.variableSize( IECore.PrimitiveVariable.Interpolation.Vertex ), True )
+		t2 = IECore.MeshTopology( m.verticesPerFace, m.vertexIds, m.variableSize( IECore.PrimitiveVariable.Interpolation.Vertex ), False )
+
+		self.assertEqual( t1.faceOffsets(), t2.faceOffsets() )
+		self.assertEqual( t1.faceVertexFaces(), t2.faceVertexFaces() )
+		self.assertEqual( t1.vertexFaceVertexOffsets(), t2.vertexFaceVertexOffsets() )
+		self.assertEqual( t1.vertexFaceVertices(), t2.vertexFaceVertices() )
+		self.assertEqual( t1.edges(), t2.edges() )
+		self.assertEqual( t1.faceVertexEdges(), t2.faceVertexEdges() )
+		self.assertEqual( t1.edgeFaceVertexOffsets(), t2.edgeFaceVertexOffsets() )
+		self.assertEqual( t1.edgeFaceVertices(), t2.edgeFaceVertices() )
+
+	def testInvalidTopology( self ) :
+
+		verticesPerFace = IECore.IntVectorData( [ 3 ] )
+
+		self.assertRaises( Exception, IECore.MeshTopology, verticesPerFace, IECore.IntVectorData( [ 0, 1 ] ), 3 )
+		self.assertRaises( Exception, IECore.MeshTopology, verticesPerFace, IECore.IntVectorData( [ 0, 1, 3 ] ), 3 )
+		self.assertRaises( Exception, IECore.MeshTopology, verticesPerFace, IECore.IntVectorData( [ 0, -1, 2 ] ), 3 )
+
+	def testCache( self ) :
+
+		IECore.MeshTopology.clearCache()
+		self.assertEqual( IECore.MeshTopology.cacheMemoryUsage(), 0 )
+
+		m = IECore.MeshPrimitive.createPlane( IECore.Box2f( IECore.V2f( -1 ), IECore.V2f( 1 ) ), IECore.V2i( 10 ) )
+		t = IECore.MeshTopology.get( m )
+		self.assertEqual( IECore.MeshTopology.cacheMemoryUsage(), t.memoryUsage() )
+
+		# meshes with the same topology should share the same tables, even
+		# if their points differ.
+		m2 = m.copy()
+		m2["P"] = IECore.PrimitiveVariable( IECore.PrimitiveVariable.Interpolation.Vertex, IECore.V3fVectorData( [ IECore.V3f( 0 ) ] * m.variableSize( IECore.PrimitiveVariable.Interpolation.Vertex ) ) )
+		self.failUnless( IECore.MeshTopology.get( m2 ).isSame( t ) )
+		self.failUnless( IECore.MeshTopology.get( m.verticesPerFace, m.vertexIds, m.variableSize( IECore.PrimitiveVariable.Interpolation.Vertex ) ).isSame( t ) )
+
+		m3 = IECore.MeshPrimitive.createPlane( IECore.Box2f( IECore.V2f( -1 ), IECore.V2f( 1 ) ), IECore.V2i( 11 ) )
+		self.failIf( IECore.MeshTopology.get( m3 ).isSame( t ) )
+
+		IECore.MeshTopology.clearCache()
+		self.failIf( IECore.MeshTopology.get( m ).isSame( t ) )
+		IECore.MeshTopology.clearCache()
+
+if __name__ == "__main__":
+	unittest.main()
@@ -0,0 +1,118 @@
+##########################################################################
+#
+#  Copyright (c) 2014, Image Engine Design Inc. All rights reserved.
+#
+#  Redistribution and use in source and binary forms, with or without
+#  modification, are permitted provided that the following conditions are
+#  met:
+#
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#
+#     * Neither the name of Image Engine Design nor the names of any
+#       other contributors to this software may be used to endorse or
+#       promote products derived from this software without specific prior
+#       written permission.
+#
+#  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+#  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+#  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+#  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+#  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+#  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+#  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+#  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+#  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+#  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+#  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+##########################################################################
+
+import re
+import random
+import threading
+import unittest
+import IECore
+
+class PointRepulsionOpTest( unittest.TestCase ) :
+
+	def __inputs( self ) :
+
+		mesh = IECore.MeshPrimitive.createPlane( IECore.Box2f( IECore.V2f( 0 ), IECore.V2f( 1 ) ), IECore.V2i( 4 ) )
+
+		window = IECore.Box2i( IECore.V2i( 0 ), IECore.V2i( 7 ) )
+		image = IECore.ImagePrimitive( window, window )
+		image["Y"] = IECore.PrimitiveVariable( IECore.PrimitiveVariable.Interpolation.Vertex, IECore.FloatVectorData( [ 1.0 ] * 64 ) )
+
+		# start with the points bunched up in the middle of the plane, so
+		# that they have somewhere to be pushed to.
+		r = random.Random( 0 )
+		p = IECore.V3fVectorData()
+		for i in range( 0, 3000 ) :
+			p.append( IECore.V3f( 0.4 + r.random() * 0.2, 0.4 + r.random() * 0.2, 0 ) )
+
+		points = IECore.PointsPrimitive( p )
+
+		return mesh, image, points
+
+	def __repulse( self, numThreads, numIterations ) :
+
+		# tbb only honours the thread count for a thread which doesn't have a
+		# scheduler yet, so each run happens in a thread of its own.
+		mesh, image, points = self.__inputs()
+		results = {}
+		def f() :
+			with IECore.tbb_task_scheduler_init( numThreads ) :
+				with IECore.CapturingMessageHandler() as mh :
+					results["points"] = IECore.PointRepulsionOp()(
+						input = points,
+						mesh = mesh,
+						image = image,
+						channelName = "Y",
+						numIterations = numIterations,
+						magnitude = 0.005,
+					)
+				results["messages"] = mh.messages
+
+		thread = threading.Thread( target = f )
+		thread.start()
+		thread.join()
+
+		return results["points"], results["messages"]
+
+	def testThreadCountIndependence( self ) :
+
+		reference, messages = self.__repulse( 1, 20 )
+		self.assertEqual( reference["P"].data.size(), 3000 )
+
+		for numThreads in ( 2, 4, IECore.tbb_task_scheduler_init.automatic ) :
+			points, messages = self.__repulse( numThreads, 20 )
+			self.assertEqual( points["P"].data, reference["P"].data )
+			self.assertEqual( points["width"].data, reference["width"].data )
+
+	def testEnergyDecreases( self ) :
+
+		points, messages = self.__repulse( IECore.tbb_task_scheduler_init.automatic, 20 )
+
+		energies = []
+		for m in messages :
+			match = re.match( r"Residual error after iteration \d+ : (\S+)", m.message )
+			if m.level == IECore.Msg.Level.Info and match :
+				energies.append( float( match.group( 1 ) ) )
+
+		self.assertEqual( len( energies ), 20 )
+		self.failUnless( energies[-1] < energies[0] )
+
+		# and the points should have been pushed apart, while staying on the plane.
+		bound = points.bound()
+		self.failUnless( bound.size().x > 0.2 )
+		self.failUnless( bound.size().y > 0.2 )
+		for p in points["P"].data :
+			self.assertAlmostEqual( p.z, 0, 5 )
+
+if __name__ == "__main__":
+	unittest.main()
@@ -636,6 +636,122 @@ class SceneCacheTest( unittest.TestCase ) :
 		self.assertTrue( B.hasTag( "ObjectType:SpherePrimitive" ) )
 		self.assertTrue( d.hasTag( "ObjectType:SpherePrimitive" ) )
 
+	def testPrefetch( self ) :
+
+		box = IECore.MeshPrimitive.createBox( IECore.Box3f( IECore.V3f( 0 ), IECore.V3f( 1 ) ) )
+
+		m = IECore.SceneCache( "/tmp/test.scc", IECore.IndexedIO.OpenMode.Write )
+		a = m.createChild( "a" )
+		b = a.createChild( "b" )
+		for t in range( 0, 10 ) :
+			a.writeTransform( IECore.M44dData( IECore.M44d.createTranslated( IECore.V3d( t, 0, 0 ) ) ), t )
+			a.writeAttribute( "w", IECore.IntData( t ), t )
+			b.writeObject( box, t )
+
+		self.assertRaises( RuntimeError, m.prefetch, [ [ "a" ] ] )
+
+		del m, a, b
+
+		m = IECore.SceneCache( "/tmp/test.scc", IECore.IndexedIO.OpenMode.Read )
+		m.prefetch( [ [ "a" ], [ "a", "b" ], [ "missing" ] ], [ 2.5, 7 ] )
+		m.prefetch( [ [ "a" ] ], entries = IECore.SceneInterface.PrefetchEntries.PrefetchTransform )
+		m.prefetch( [ [ "a", "b" ] ] )
+
+		a = m.child( "a" )
+		b = a.child( "b" )
+		for t in range( 0, 10 ) :
+			self.assertEqual( a.readTransformAsMatrix( t ), IECore.M44d.createTranslated( IECore.V3d( t, 0, 0 ) ) )
+			self.assertEqual( a.readAttribute( "w", t ), IECore.IntData( t ) )
+			self.assertEqual( b.readObject( t ), box )
+
+	def testSampleIntervals( self ) :
+
+		m = IECore.SceneCache( "/tmp/test.scc", IECore.IndexedIO.OpenMode.Write )
+		children = []
+		for i in range( 0, 5 ) :
+			c = m.createChild( str( i ) )
+			for t in range( 0, 100 ) :
+				c.writeTransform( IECore.M44dData( IECore.M44d.createTranslated( IECore.V3d( i, t, 0 ) ) ), t / 10.0 )
+				c.writeAttribute( "w", IECore.DoubleData( t ), t / 10.0 )
+			c.writeObject( IECore.SpherePrimitive( i + 1 ), 0 )
+			children.append( c )
+		del m, c, children
+
+		m = IECore.SceneCache( "/tmp/test.scc", IECore.IndexedIO.OpenMode.Read )
+		children = [ m.child( str( i ) ) for i in range( 0, 5 ) ]
+		paths = [ [ str( i ) ] for i in range( 0, 5 ) ]
+
+		# sequential, backwards and random access all find the same intervals
+		times = [ t / 40.0 for t in range( -10, 420 ) ]
+		times = times + list( reversed( times ) ) + [ 5.0, 0.05, 9.9, 3.33, 3.34, 10.5, -1 ]
+		for time in times :
+			expectedTime = min( max( time, 0 ), 9.9 )
+			for i, c in enumerate( children ) :
+				self.assertTrue( c.readTransformAsMatrix( time ).equalWithAbsError( IECore.M44d.createTranslated( IECore.V3d( i, expectedTime * 10, 0 ) ), 1e-6 ) )
+				self.assertAlmostEqual( c.readAttribute( "w", time ).value, expectedTime * 10, 6 )
+
+			transforms = m.readTransformsAsMatrix( paths, time )
+			bounds = m.readBounds( paths, time )
+			self.assertEqual( len( transforms ), 5 )
+			self.assertEqual( len( bounds ), 5 )
+			for i, c in enumerate( children ) :
+				self.assertEqual( transforms[i], c.readTransformAsMatrix( time ) )
+				self.assertEqual( bounds[i], c.readBound( time ) )
+
+		self.assertRaises( RuntimeError, m.readBounds, [ [ "0" ], [ "missing" ] ], 0 )
+
+	def testObjectCache( self ) :
+
+		box = IECore.MeshPrimitive.createBox( IECore.Box3f( IECore.V3f( 0 ), IECore.V3f( 1 ) ) )
+
+		m = IECore.SceneCache( "/tmp/test.scc", IECore.IndexedIO.OpenMode.Write )
+		a = m.createChild( "a" )
+		a.writeTransform( IECore.M44dData( IECore.M44d.createTranslated( IECore.V3d( 1, 0, 0 ) ) ), 0 )
+		a.writeObject( box, 0 )
+		del m, a
+
+		self.assertEqual( IECore.SceneCache.getObjectCacheMaxMemory(), 0 )
+		IECore.SceneCache.setObjectCacheMaxMemory( 100 * 1024 * 1024 )
+		try :
+
+			IECore.SceneCache.clearObjectCache()
+			self.assertEqual( IECore.SceneCache.objectCacheMemoryUsage(), 0 )
+
+			a = IECore.SceneCache( "/tmp/test.scc", IECore.IndexedIO.OpenMode.Read ).child( "a" )
+			o = a.readObjectAtSample( 0 )
+			self.assertEqual( o, box )
+			self.assertEqual( IECore.SceneCache.objectCacheMisses(), 1 )
+			self.assertEqual( IECore.SceneCache.objectCacheHits(), 0 )
+			self.assertEqual( IECore.SceneCache.objectCacheMemoryUsage(), box.memoryUsage() )
+
+			# modifying the returned object must not affect the cached one
+			o["P"].data[0] = IECore.V3f( 10 )
+
+			# a different reader of the same file shares the cache
+			b = IECore.SceneCache( "/tmp/test.scc", IECore.IndexedIO.OpenMode.Read ).child( "a" )
+			self.assertEqual( b.readObjectAtSample( 0 ), box )
+			self.assertEqual( IECore.SceneCache.objectCacheMisses(), 1 )
+			self.assertEqual( IECore.SceneCache.objectCacheHits(), 1 )
+
+			self.assertEqual( b.readTransformAsMatrix( 0 ), IECore.M44d.createTranslated( IECore.V3d( 1, 0, 0 ) ) )
+			self.assertEqual( a.readTransformAsMatrix( 0 ), IECore.M44d.createTranslated( IECore.V3d( 1, 0, 0 ) ) )
+			self.assertEqual( b.readBound( 0 ), a.readBound( 0 ) )
+			self.assertEqual( IECore.SceneCache.objectCacheMisses(), 3 )
+			self.assertEqual( IECore.SceneCache.objectCacheHits(), 3 )
+
+			IECore.SceneCache.clearObjectCache()
+			self.assertEqual( IECore.SceneCache.objectCacheMemoryUsage(), 0 )
+			self.assertEqual( IECore.SceneCache.objectCacheHits(), 0 )
+			self.assertEqual( IECore.SceneCache.objectCacheMisses(), 0 )
+
+		finally :
+
+			IECore.SceneCache.setObjectCacheMaxMemory( 0 )
+
+		self.assertEqual( IECore.SceneCache.objectCacheMemoryUsage(), 0 )
+		self.assertEqual( a.readObjectAtSample( 0 ), box )
+		self.assertEqual( IECore.SceneCache.objectCacheMisses(), 0 )
+
 if __name__ == "__main__":
 	unittest.main()
 
@@ -0,0 +1,309 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <vector>
+
+#include "boost/format.hpp"
+
+#include "tbb/tbb.h"
+#include "tbb/task_scheduler_init.h"
+#include "tbb/tbb_thread.h"
+
+#include "OpenEXR/ImathMatrix.h"
+
+#include "IECore/SceneCache.h"
+#include "IECore/SimpleTypedData.h"
+#include "IECore/MeshPrimitive.h"
+
+#include "SceneCacheThreadingTest.h"
+
+using namespace boost;
+using namespace boost::unit_test;
+using namespace tbb;
+using namespace Imath;
+
+namespace IECore
+{
+
+struct SceneCacheThreadingTest
+{
+
+	static const size_t childrenPerGroup = 100;
+	static const size_t numSamples = 4;
+
+	/// Writes a group of leaf locations under the root. The leaves have animated
+	/// bounds and rotations, so closing the file has to compute the animated
+	/// bounds of all the groups and of the root.
+	static void writeGroup( SceneInterface *root, size_t g, bool writeObjects = false )
+	{
+		SceneInterfacePtr group = root->createChild( ( boost::format( "g%d" ) % g ).str() );
+		for( size_t c = 0; c < childrenPerGroup; ++c )
+		{
+			SceneInterfacePtr leaf = group->createChild( ( boost::format( "c%d" ) % c ).str() );
+			for( size_t s = 0; s < numSamples; ++s )
+			{
+				double time = s;
+				M44d m;
+				m.setEulerAngles( V3d( 0, time * 0.3, 0 ) );
+				m.setTranslation( V3d( g, c, time ) );
+				leaf->writeTransform( new M44dData( m ), time );
+				if( writeObjects )
+				{
+					leaf->writeObject( MeshPrimitive::createBox( Box3f( V3f( -1 ), V3f( 1 + time ) ) ), time );
+				}
+				else
+				{
+					leaf->writeBound( Box3d( V3d( -1 ), V3d( 1 + time ) ), time );
+				}
+			}
+		}
+	}
+
+	/// Creates a two level hierarchy with the given number of leaf locations,
+	/// returning the root without closing the file.
+	static SceneCachePtr createScene( const std::string &fileName, size_t numLocations )
+	{
+		SceneCachePtr root = new SceneCache( fileName, IndexedIO::Write );
+		for( size_t g = 0; g < numLocations / childrenPerGroup; ++g )
+		{
+			writeGroup( root.get(), g );
+		}
+		return root;
+	}
+
+	struct WriteGroups
+	{
+		public :
+
+			WriteGroups( SceneCachePtr root )
+				:	m_root( root )
+			{
+			}
+
+			void operator()( const blocked_range<size_t> &r ) const
+			{
+				for( size_t g=r.begin(); g!=r.end(); ++g )
+				{
+					writeGroup( m_root.get(), g, true );
+				}
+			}
+
+		private :
+
+			SceneCachePtr m_root;
+
+	};
+
+	/// Returns the time taken to close the file by releasing the root location.
+	static double timeClose( SceneCachePtr &root )
+	{
+		tick_count t0 = tick_count::now();
+		root = 0;
+		return ( tick_count::now() - t0 ).seconds();
+	}
+
+	/// Writes a scene and times its close using a single thread. This is run in a
+	/// thread of its own, because task_scheduler_init has no effect on a thread
+	/// which has already used the scheduler.
+	struct SerialClose
+	{
+		public :
+
+			SerialClose( const std::string &fileName, size_t numLocations, double &time )
+				:	m_fileName( fileName ), m_numLocations( numLocations ), m_time( time )
+			{
+			}
+
+			void operator()() const
+			{
+				task_scheduler_init init( 1 );
+				SceneCachePtr root = createScene( m_fileName, m_numLocations );
+				m_time = timeClose( root );
+			}
+
+		private :
+
+			std::string m_fileName;
+			size_t m_numLocations;
+			double &m_time;
+
+	};
+
+	/// Writes and closes the same scene with a single thread and with all the available
+	/// ones, returning the close times.
+	static void closeSerialAndParallel( const std::string &serialFileName, const std::string &parallelFileName, size_t numLocations, double &serialTime, double &parallelTime )
+	{
+		tbb_thread serialThread( SerialClose( serialFileName, numLocations, serialTime ) );
+		serialThread.join();
+
+		SceneCachePtr root = createScene( parallelFileName, numLocations );
+		parallelTime = timeClose( root );
+	}
+
+	/// Closes a file with a single thread and with all the available ones, and
+	/// checks that both compute the same animated bounds for the root and groups.
+	void testParallelClose()
+	{
+		const std::string serialFileName = "test/IECore/sceneCacheThreadingSerial.scc";
+		const std::string parallelFileName = "test/IECore/sceneCacheThreadingParallel.scc";
+		const size_t numLocations = 2000;
+
+		double serialTime, parallelTime;
+		closeSerialAndParallel( serialFileName, parallelFileName, numLocations, serialTime, parallelTime );
+
+		ConstSceneCachePtr serial = new SceneCache( serialFileName, IndexedIO::Read );
+		ConstSceneCachePtr parallel = new SceneCache( parallelFileName, IndexedIO::Read );
+		for( size_t s = 0; s < numSamples; ++s )
+		{
+			BOOST_CHECK( serial->readBound( s ) == parallel->readBound( s ) );
+		}
+		BOOST_CHECK( !parallel->readBound( 0 ).isEmpty() );
+
+		SceneInterface::NameList groups;
+		parallel->childNames( groups );
+		BOOST_CHECK_EQUAL( groups.size(), numLocations / childrenPerGroup );
+		for( SceneInterface::NameList::const_iterator it = groups.begin(); it != groups.end(); ++it )
+		{
+			ConstSceneInterfacePtr serialGroup = serial->child( *it );
+			ConstSceneInterfacePtr parallelGroup = parallel->child( *it );
+			for( size_t s = 0; s < numSamples; ++s )
+			{
+				BOOST_CHECK( serialGroup->readBound( s ) == parallelGroup->readBound( s ) );
+			}
+		}
+
+		serial = 0;
+		parallel = 0;
+		std::remove( serialFileName.c_str() );
+		std::remove( parallelFileName.c_str() );
+	}
+
+	/// Measures the time taken to close files of increasing location count, with
+	/// a single thread and with all the available ones. The counts are kept small
+	/// so that the suite stays quick - increase them for a more useful benchmark.
+	void testCloseTime()
+	{
+		const std::string serialFileName = "test/IECore/sceneCacheThreadingSerial.scc";
+		const std::string parallelFileName = "test/IECore/sceneCacheThreadingParallel.scc";
+
+		const size_t locationCounts[] = { 1000, 10000 };
+		for( size_t i = 0; i < sizeof( locationCounts ) / sizeof( size_t ); ++i )
+		{
+			const size_t numLocations = locationCounts[i];
+
+			double serialTime, parallelTime;
+			closeSerialAndParallel( serialFileName, parallelFileName, numLocations, serialTime, parallelTime );
+
+			ConstSceneCachePtr serial = new SceneCache( serialFileName, IndexedIO::Read );
+			ConstSceneCachePtr parallel = new SceneCache( parallelFileName, IndexedIO::Read );
+			for( size_t s = 0; s < numSamples; ++s )
+			{
+				BOOST_CHECK( serial->readBound( s ) == parallel->readBound( s ) );
+			}
+			serial = 0;
+			parallel = 0;
+
+			BOOST_TEST_MESSAGE( boost::format( "SceneCache close with %d locations : serial %fs, parallel %fs, speedup %.2fx" ) % numLocations % serialTime % parallelTime % ( serialTime / parallelTime ) );
+		}
+
+		std::remove( serialFileName.c_str() );
+		std::remove( parallelFileName.c_str() );
+	}
+
+	/// Writes sibling subtrees of one file from many threads, and checks the
+	/// result matches the same file written from a single thread.
+	void testConcurrentWrites()
+	{
+		const std::string serialFileName = "test/IECore/sceneCacheThreadingSerial.scc";
+		const std::string parallelFileName = "test/IECore/sceneCacheThreadingParallel.scc";
+		const size_t numGroups = 50;
+
+		SceneCachePtr root = new SceneCache( serialFileName, IndexedIO::Write );
+		WriteGroups serialWriter( root );
+		serialWriter( blocked_range<size_t>( 0, numGroups ) );
+		root = 0;
+
+		root = new SceneCache( parallelFileName, IndexedIO::Write );
+		tick_count t0 = tick_count::now();
+		parallel_for( blocked_range<size_t>( 0, numGroups, 1 ), WriteGroups( root ) );
+		root = 0;
+		double parallelTime = ( tick_count::now() - t0 ).seconds();
+
+		ConstSceneCachePtr serial = new SceneCache( serialFileName, IndexedIO::Read );
+		ConstSceneCachePtr parallel = new SceneCache( parallelFileName, IndexedIO::Read );
+
+		SceneInterface::NameList groups;
+		parallel->childNames( groups );
+		BOOST_CHECK_EQUAL( groups.size(), numGroups );
+		for( size_t s = 0; s < numSamples; ++s )
+		{
+			BOOST_CHECK( serial->readBound( s ) == parallel->readBound( s ) );
+		}
+
+		ConstSceneInterfacePtr leaf = parallel->child( "g7" )->child( "c13" );
+		ConstObjectPtr object = leaf->readObject( 2 );
+		ConstObjectPtr expectedObject = MeshPrimitive::createBox( Box3f( V3f( -1 ), V3f( 3 ) ) );
+		BOOST_CHECK( object->isEqualTo( expectedObject ) );
+
+		serial = 0;
+		parallel = 0;
+		leaf = 0;
+		std::remove( serialFileName.c_str() );
+		std::remove( parallelFileName.c_str() );
+
+		BOOST_TEST_MESSAGE( boost::format( "SceneCache parallel writes of %d locations : %fs" ) % ( numGroups * childrenPerGroup ) % parallelTime );
+	}
+
+};
+
+struct SceneCacheThreadingTestSuite : public boost::unit_test::test_suite
+{
+
+	SceneCacheThreadingTestSuite() : boost::unit_test::test_suite( "SceneCacheThreadingTestSuite" )
+	{
+		boost::shared_ptr<SceneCacheThreadingTest> instance( new SceneCacheThreadingTest() );
+
+		add( BOOST_CLASS_TEST_CASE( &SceneCacheThreadingTest::testParallelClose, instance ) );
+		add( BOOST_CLASS_TEST_CASE( &SceneCacheThreadingTest::testCloseTime, instance ) );
+		add( BOOST_CLASS_TEST_CASE( &SceneCacheThreadingTest::testConcurrentWrites, instance ) );
+	}
+};
+
+void addSceneCacheThreadingTest( boost::unit_test::test_suite *test )
+{
+	test->add( new SceneCacheThreadingTestSuite( ) );
+}
+
+} // namespace IECore
@@ -0,0 +1,218 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  Copyright (c) 2013, Image Engine Design Inc. All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of Image Engine Design nor the names of any
+//       other contributors to this software may be used to endorse or
+//       promote products derived from this software without specific prior
+//       written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+//  IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+//  THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+//  PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//  CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+//  EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+//  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+//  PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+//  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+//  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <vector>
+
+#include "boost/format.hpp"
+
+#include "tbb/tbb.h"
+
+#include "IECore/FileIndexedIO.h"
+
+#include "StreamIndexedIOThreadingTest.h"
+
+using namespace boost;
+using namespace boost::unit_test;
+using namespace tbb;
+
+namespace IECore
+{
+
+struct StreamIndexedIOThreadingTest
+{
+
+	static const size_t numDirectories = 2000;
+	static const size_t arrayLength = 20000;
+
+	struct ReadFromFile
+	{
+		public :
+
+			ReadFromFile( ConstIndexedIOPtr io, tbb::atomic<int> &errors )
+				:	m_io( io ), m_errors( errors )
+			{
+			}
+
+			void operator()( const blocked_range<size_t> &r ) const
+			{
+				std::vector<float> values( arrayLength );
+				for( size_t i=r.begin(); i!=r.end(); ++i )
+				{
+					ConstIndexedIOPtr d = m_io->subdirectory( directoryName( i ) );
+					float *v = &values[0];
+					d->read( "values", v, arrayLength );
+					unsigned int id = 0;
+					d->read( "id", id );
+					// can't use boost unit test assertions from threads
+					if( id != i || v[0] != (float)i || v[arrayLength-1] != (float)i )
+					{
+						++m_errors;
+					}
+				}
+			}
+
+		private :
+
+			ConstIndexedIOPtr m_io;
+			tbb::atomic<int> &m_errors;
+
+	};
+
+	struct WriteToFile
+	{
+		public :
+
+			WriteToFile( IndexedIOPtr io )
+				:	m_io( io )
+			{
+			}
+
+			void operator()( const blocked_range<size_t> &r ) const
+			{
+				std::vector<float> values( arrayLength );
+				for( size_t i=r.begin(); i!=r.end(); ++i )
+				{
+					IndexedIOPtr d = m_io->subdirectory( directoryName( i ), IndexedIO::CreateIfMissing );
+					std::fill( values.begin(), values.end(), (float)i );
+					d->write( "values", &values[0], arrayLength );
+					d->write( "id", (unsigned int)i );
+					// half of the directories are committed, and the other half stay in the main index
+					if( i % 2 )
+					{
+						d->commit();
+					}
+				}
+			}
+
+		private :
+
+			IndexedIOPtr m_io;
+
+	};
+
+	static IndexedIO::EntryID directoryName( size_t i )
+	{
+		return ( boost::format( "d%d" ) % i ).str();
+	}
+
+	void write( const std::string &fileName )
+	{
+		IndexedIOPtr io = new FileIndexedIO( fileName, IndexedIO::rootPath, IndexedIO::Write );
+		std::vector<float> values( arrayLength );
+		for( size_t i = 0; i < numDirectories; ++i )
+		{
+			IndexedIOPtr d = io->subdirectory( directoryName( i ), IndexedIO::CreateIfMissing );
+			std::fill( values.begin(), values.end(), (float)i );
+			d->write( "values", &values[0], arrayLength );
+			d->write( "id", (unsigned int)i );
+			d->commit();
+		}
+	}
+
+	/// Reads every directory of one file serially and then from many threads,
+	/// reporting the speedup. Each pass opens the file afresh so that the
+	/// subindexes are loaded concurrently too.
+	void testConcurrentReads()
+	{
+		const std::string fileName = "test/IECore/streamIndexedIOThreading.fio";
+		write( fileName );
+
+		tbb::atomic<int> errors;
+		errors = 0;
+
+		ConstIndexedIOPtr io = new FileIndexedIO( fileName, IndexedIO::rootPath, IndexedIO::Read );
+		tick_count t0 = tick_count::now();
+		ReadFromFile( io, errors )( blocked_range<size_t>( 0, numDirectories ) );
+		double serialTime = ( tick_count::now() - t0 ).seconds();
+
+		io = new FileIndexedIO( fileName, IndexedIO::rootPath, IndexedIO::Read );
+		t0 = tick_count::now();
+		parallel_for( blocked_range<size_t>( 0, numDirectories, 10 ), ReadFromFile( io, errors ) );
+		double parallelTime = ( tick_count::now() - t0 ).seconds();
+
+		io = 0;
+		std::remove( fileName.c_str() );
+
+		BOOST_CHECK_EQUAL( (int)errors, 0 );
+		BOOST_TEST_MESSAGE( boost::format( "StreamIndexedIO reads : serial %fs, parallel %fs, speedup %.2fx" ) % serialTime % parallelTime % ( serialTime / parallelTime ) );
+	}
+
+	/// Writes the directories of one file from many threads, and checks they
+	/// can all be read back.
+	void testConcurrentWrites()
+	{
+		const std::string fileName = "test/IECore/streamIndexedIOThreading.fio";
+
+		IndexedIOPtr io = new FileIndexedIO( fileName, IndexedIO::rootPath, IndexedIO::Write );
+		tick_count t0 = tick_count::now();
+		parallel_for( blocked_range<size_t>( 0, numDirectories, 10 ), WriteToFile( io ) );
+		io = 0;
+		double parallelTime = ( tick_count::now() - t0 ).seconds();
+
+		tbb::atomic<int> errors;
+		errors = 0;
+
+		ConstIndexedIOPtr readIO = new FileIndexedIO( fileName, IndexedIO::rootPath, IndexedIO::Read );
+		IndexedIO::EntryIDList names;
+		readIO->entryIds( names );
+		BOOST_CHECK_EQUAL( names.size(), numDirectories );
+		ReadFromFile( readIO, errors )( blocked_range<size_t>( 0, numDirectories ) );
+		readIO = 0;
+		std::remove( fileName.c_str() );
+
+		BOOST_CHECK_EQUAL( (int)errors, 0 );
+		BOOST_TEST_MESSAGE( boost::format( "StreamIndexedIO parallel writes : %fs" ) % parallelTime );
+	}
+
+};
+
+struct StreamIndexedIOThreadingTestSuite : public boost::unit_test::test_suite
+{
+
+	StreamIndexedIOThreadingTestSuite() : boost::unit_test::test_suite( "StreamIndexedIOThreadingTestSuite" )
+	{
+		boost::shared_ptr<StreamIndexedIOThreadingTest> instance( new StreamIndexedIOThreadingTest() );
+
+		add( BOOST_CLASS_TEST_CASE( &StreamIndexedIOThreadingTest::testConcurrentReads, instance ) );
+		add( BOOST_CLASS_TEST_CASE( &StreamIndexedIOThreadingTest::testConcurrentWrites, instance ) );
+	}
+};
+
+void addStreamIndexedIOThreadingTest( boost::unit_test::test_suite *test )
+{
+	test->add( new StreamIndexedIOThreadingTestSuite( ) );
+}
+
+} // namespace IECore
@@ -390,6 +390,62 @@ class TestTIFFReader(unittest.TestCase):
 
 		self.failIf( res.value )
 		
+	def testTiledRegionRead( self ) :
+
+		r = TIFFImageReader( "test/IECore/data/tiff/tilesWithLeftovers.tif" )
+		r['colorSpace'] = 'linear'
+		iWhole = r.read()
+		width = iWhole.dataWindow.size().x + 1
+
+		# regions which start and end part way through tiles, including the leftovers at the edges
+		for region in [
+			Box2i( V2i( 5, 3 ), V2i( 20, 40 ) ),
+			Box2i( V2i( 60, 70 ), V2i( 69, 79 ) ),
+			Box2i( V2i( 0, 0 ), V2i( 0, 79 ) ),
+		] :
+
+			r.parameters()["dataWindow"].setTypedValue( region )
+			iRegion = r.read()
+			self.assertEqual( iRegion.dataWindow, region )
+
+			regionWidth = region.size().x + 1
+			for c in iRegion.keys() :
+				for y in range( region.min.y, region.max.y + 1 ) :
+					for x in range( region.min.x, region.max.x + 1 ) :
+						self.assertEqual(
+							iRegion[c].data[(y-region.min.y)*regionWidth + x - region.min.x],
+							iWhole[c].data[y*width + x]
+						)
+
+	def testMipLevel( self ) :
+
+		r = TIFFImageReader( "test/IECore/data/tiff/problem.tdl" )
+		self.assertEqual( r["mipLevel"].getNumericValue(), 0 )
+
+		for i in range( 0, r.numDirectories() ) :
+
+			r["mipLevel"].setNumericValue( 0 )
+			r.setDirectory( i )
+			expected = r.read()
+
+			r.setDirectory( 0 )
+			r["mipLevel"].setNumericValue( i )
+			self.assertEqual( r.dataWindow(), expected.dataWindow )
+			self.assertEqual( r.read(), expected )
+
+		r["mipLevel"].setNumericValue( r.numDirectories() )
+		self.assertRaises( RuntimeError, r.read )
+
+		# the mip level is relative to the chosen directory
+
+		r = TIFFImageReader( "test/IECore/data/tiff/uvMap.multiRes.32bit.tif" )
+		r.setDirectory( 1 )
+		r["mipLevel"].setNumericValue( 2 )
+		self.assertEqual( r.read().dataWindow, Box2i( V2i( 0 ), V2i( 127, 63 ) ) )
+
+		r["mipLevel"].setNumericValue( 9 )
+		self.assertRaises( RuntimeError, r.dataWindow )
+
 	def testReadWithIncorrectExtension( self ) :
 	
 		shutil.copyfile( "test/IECore/data/tiff/uvMap.512x256.8bit.tif", "test/IECore/data/tiff/uvMap.512x256.8bit.dpx" )
@@ -264,5 +264,65 @@ class TestTriangulateOp( unittest.TestCase ) :
 	
 		self.assertEqual( m.interpolation, "catmullClark" )
 
+	def testPrimVarRemapping( self ) :
+
+		# a quad, a triangle and a pentagon, all flat
+		verticesPerFace = IntVectorData( [ 4, 3, 5 ] )
+		vertexIds = IntVectorData( [ 0, 1, 2, 3, 1, 4, 2, 4, 5, 6, 7, 2 ] )
+		P = V3fVectorData( [
+			V3f( 0, 0, 0 ), V3f( 1, 0, 0 ), V3f( 1, 1, 0 ), V3f( 0, 1, 0 ),
+			V3f( 2, 0, 0 ), V3f( 3, 0, 0 ), V3f( 3, 1, 0 ), V3f( 2.5, 1.5, 0 ),
+		] )
+
+		m = MeshPrimitive( verticesPerFace, vertexIds )
+		m["P"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Vertex, P )
+		m["fv"] = PrimitiveVariable( PrimitiveVariable.Interpolation.FaceVarying, IntVectorData( range( 0, 12 ) ) )
+		m["fvBool"] = PrimitiveVariable( PrimitiveVariable.Interpolation.FaceVarying, BoolVectorData( [ True, False ] * 6 ) )
+		m["u"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Uniform, StringVectorData( [ "a", "b", "c" ] ) )
+		m["N"] = PrimitiveVariable( PrimitiveVariable.Interpolation.FaceVarying, V3fVectorData( [ V3f( 0, 0, 1 ) ] * 12, GeometricData.Interpretation.Normal ) )
+
+		result = TriangulateOp()( input = m )
+		self.assert_( result.arePrimitiveVariablesValid() )
+
+		self.assertEqual( result.verticesPerFace, IntVectorData( [ 3 ] * 6 ) )
+		self.assertEqual( result.vertexIds, IntVectorData( [ 0, 1, 2, 0, 2, 3, 1, 4, 2, 4, 5, 6, 4, 6, 7, 4, 7, 2 ] ) )
+		self.assertEqual( result["P"].data, P )
+		self.assertEqual( result["fv"].data, IntVectorData( [ 0, 1, 2, 0, 2, 3, 4, 5, 6, 7, 8, 9, 7, 9, 10, 7, 10, 11 ] ) )
+		self.assertEqual( result["fvBool"].data, BoolVectorData( [ bool( i % 2 == 0 ) for i in result["fv"].data ] ) )
+		self.assertEqual( result["u"].data, StringVectorData( [ "a", "a", "b", "c", "c", "c" ] ) )
+		self.assertEqual( result["N"].data, V3fVectorData( [ V3f( 0, 0, 1 ) ] * 18, GeometricData.Interpretation.Normal ) )
+		self.assertEqual( result["N"].data.getInterpretation(), GeometricData.Interpretation.Normal )
+
+		# a deformed mesh with the same topology must give the same result
+		m2 = m.copy()
+		m2["P"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Vertex, V3fVectorData( [ p * 2 for p in P ] ) )
+		result2 = TriangulateOp()( input = m2 )
+		self.assertEqual( result2.vertexIds, result.vertexIds )
+		self.assertEqual( result2["fv"].data, result["fv"].data )
+
+	def testFirstInvalidFaceIsReported( self ) :
+
+		# many valid quads followed by a concave face, and then a non-planar one
+		m = MeshPrimitive.createPlane( Box2f( V2f( -1 ), V2f( 1 ) ), V2i( 100 ) )
+		numPoints = len( m["P"].data )
+		P = m["P"].data.copy()
+		P.extend( [ V3f( 0, 0, 1 ), V3f( 1, 0, 1 ), V3f( 0.25, 0.25, 1 ), V3f( 0, 1, 1 ) ] )
+		P.extend( [ V3f( 0, 0, 2 ), V3f( 1, 0, 2 ), V3f( 1, 1, 3 ), V3f( 0, 1, 2 ) ] )
+
+		verticesPerFace = m.verticesPerFace.copy()
+		verticesPerFace.extend( IntVectorData( [ 4, 4 ] ) )
+		vertexIds = m.vertexIds.copy()
+		vertexIds.extend( IntVectorData( range( numPoints, numPoints + 8 ) ) )
+
+		m = MeshPrimitive( verticesPerFace, vertexIds )
+		m["P"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Vertex, P )
+
+		try :
+			TriangulateOp()( input = m )
+		except Exception, e :
+			self.failUnless( "concave" in str( e ) )
+		else :
+			self.fail( "Expected exception" )
+
 if __name__ == "__main__":
     unittest.main()
@@ -64,6 +64,55 @@ class testUVDistortOp( unittest.TestCase ) :
 		self.assert_( ImageDiffOp()( imageA = resultImg, imageB = resultImg2, maxError = 0.02 ).value )
 		self.assert_( not ImageDiffOp()( imageA = img, imageB = resultImg2, maxError = 0.015 ).value )
 
+	def testFilters( self ):
+		"""Testing that the higher quality filters give results close to the bilinear filter."""
+
+		uvImg = Reader.create( "test/IECore/data/exrFiles/undistorted_21mm_uv.exr" )()
+		img = Reader.create( "test/IECore/data/jpg/21mm.jpg" )()
+
+		op = UVDistortOp()
+		bilinearImg = op( input = img, uvMap = uvImg )
+
+		for filter in ( "Cubic", "Lanczos" ) :
+
+			op["filter"].setValue( filter )
+			filteredImg = op( input = img, uvMap = uvImg )
+
+			self.assertEqual( filteredImg.dataWindow, bilinearImg.dataWindow )
+			self.assertEqual( set( filteredImg.keys() ), set( bilinearImg.keys() ) )
+			self.assert_( ImageDiffOp()( imageA = bilinearImg, imageB = filteredImg, maxError = 0.02 ).value )
+
+	def testFiltersWithIdentityMap( self ):
+		"""Testing that the interpolating filters reproduce the input when sampling at pixel positions."""
+
+		window = Box2i( V2i( 0 ), V2i( 39, 19 ) )
+		img = ImagePrimitive( window, window )
+		uvMap = ImagePrimitive( window, window )
+
+		r = random.Random( 10 )
+		R = FloatVectorData()
+		U = FloatVectorData()
+		V = FloatVectorData()
+		for y in range( 0, 20 ) :
+			for x in range( 0, 40 ) :
+				R.append( r.random() )
+				U.append( x / 39.0 )
+				V.append( y / 19.0 )
+
+		img["R"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Vertex, R )
+		uvMap["R"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Vertex, U )
+		uvMap["G"] = PrimitiveVariable( PrimitiveVariable.Interpolation.Vertex, V )
+
+		op = UVDistortOp()
+		for filter in ( "Bilinear", "Cubic", "Lanczos" ) :
+
+			op["filter"].setValue( filter )
+			result = op( input = img, uvMap = uvMap )
+
+			self.assertEqual( result.dataWindow, window )
+			for i in range( 0, len( R ) ) :
+				self.assertAlmostEqual( result["R"].data[i], R[i], 4 )
+
 if __name__ == "__main__":
         unittest.main()
 